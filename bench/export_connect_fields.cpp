@@ -0,0 +1,190 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// Compares the hop-by-hop processing a relay does for every message against the implementation it
+// replaced, which collected the Connection options into heap-allocated strings and found our Via
+// with a Spirit X3 parse
+//
+// Usage: export-connect-fields-bench [iterations]
+//
+
+#include <foxy/detail/export_connect_fields.hpp>
+#include <foxy/detail/has_token.hpp>
+
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/rfc7230.hpp>
+
+#include <boost/range/algorithm.hpp>
+#include <boost/spirit/home/x3.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace http  = boost::beast::http;
+namespace range = boost::range;
+namespace x3    = boost::spirit::x3;
+
+namespace
+{
+auto
+legacy_export_connect_fields(http::fields& src, http::fields& dst) -> void
+{
+  auto connect_opts = std::vector<std::string>();
+  connect_opts.reserve(128);
+
+  auto const connect_fields = src.equal_range(http::field::connection);
+  auto       out            = std::back_inserter(connect_opts);
+
+  range::for_each(connect_fields, [out](auto const& connect_field) {
+    range::transform(http::token_list(connect_field.value()), out,
+                     [](auto const token_view) -> std::string {
+                       return std::string(token_view.begin(), token_view.end());
+                     });
+  });
+
+  range::sort(connect_opts);
+  range::unique(connect_opts);
+
+  auto const hop_by_hops = std::array<http::field, 11>{http::field::connection,
+                                                       http::field::keep_alive,
+                                                       http::field::proxy_authenticate,
+                                                       http::field::proxy_authentication_info,
+                                                       http::field::proxy_authorization,
+                                                       http::field::proxy_connection,
+                                                       http::field::proxy_features,
+                                                       http::field::proxy_instruction,
+                                                       http::field::te,
+                                                       http::field::trailer,
+                                                       http::field::transfer_encoding};
+
+  auto const is_connect_opt = [&](http::fields::value_type const& field) -> bool {
+    if (range::find(hop_by_hops, field.name()) != hop_by_hops.end()) { return true; }
+
+    for (auto const& opt : connect_opts) {
+      if (field.name_string() == opt) { return true; }
+    }
+    return false;
+  };
+
+  for (auto it = src.begin(); it != src.end();) {
+    if (!is_connect_opt(*it)) {
+      ++it;
+      continue;
+    }
+
+    dst.insert(it->name_string(), it->value());
+    it = src.erase(it);
+  }
+}
+
+auto
+legacy_has_foxy_via(http::fields const& fields) -> bool
+{
+  auto const field_range = fields.equal_range(http::field::via);
+  for (auto it = field_range.first; it != field_range.second; ++it) {
+    auto       begin = it->value().begin();
+    auto const end   = it->value().end();
+
+    if (x3::parse(begin, end,
+                  x3::no_case[*(x3::char_ - "1.1 foxy") >> x3::lit("1.1 foxy") >> *x3::char_])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// what a browser's request typically looks like by the time it reaches us
+//
+auto
+make_request_fields() -> http::fields
+{
+  auto fields = http::fields();
+  fields.insert(http::field::host, "www.example.com");
+  fields.insert(http::field::user_agent,
+                "Mozilla/5.0 (X11; Linux x86_64; rv:68.0) Gecko/20100101 Firefox/68.0");
+  fields.insert(http::field::accept, "text/html,application/xhtml+xml,*/*;q=0.8");
+  fields.insert(http::field::accept_language, "en-US,en;q=0.5");
+  fields.insert(http::field::accept_encoding, "gzip, deflate, br");
+  fields.insert(http::field::referer, "https://www.example.com/index.html");
+  fields.insert(http::field::cookie, "session=0123456789abcdef; theme=dark");
+  fields.insert(http::field::via, "1.1 edge.example.net");
+  fields.insert(http::field::connection, "keep-alive, x-request-start");
+  fields.insert(http::field::keep_alive, "timeout=5, max=1000");
+  fields.insert("X-Request-Start", "t=1546300800123");
+  return fields;
+}
+
+template <class F>
+auto
+measure(char const* name, std::size_t const iterations, F f) -> double
+{
+  auto sink = std::size_t{0};
+
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = std::size_t{0}; i < iterations; ++i) { sink += f(); }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+
+  auto const ns_per_op =
+    std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+
+  std::cout << name << ": " << ns_per_op << " ns/op (" << sink << ")\n";
+  return ns_per_op;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const iterations =
+    argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : std::size_t{200000};
+
+  auto const fields = make_request_fields();
+
+  // every run works on a fresh copy so copying is measured on its own and taken out of the others
+  //
+  auto const copy = measure("copy fields", iterations, [&] {
+    auto src = fields;
+    return static_cast<std::size_t>(std::distance(src.begin(), src.end()));
+  });
+
+  auto const legacy = measure("legacy export_connect_fields", iterations, [&] {
+    auto src = fields;
+    auto dst = http::fields();
+    legacy_export_connect_fields(src, dst);
+    return static_cast<std::size_t>(std::distance(dst.begin(), dst.end()));
+  });
+
+  auto const current = measure("export_connect_fields", iterations, [&] {
+    auto src = fields;
+    auto dst = http::fields();
+    foxy::detail::export_connect_fields(src, dst);
+    return static_cast<std::size_t>(std::distance(dst.begin(), dst.end()));
+  });
+
+  auto const legacy_via = measure("legacy has_foxy_via", iterations, [&] {
+    return static_cast<std::size_t>(legacy_has_foxy_via(fields));
+  });
+
+  auto const current_via = measure("has_foxy_via", iterations, [&] {
+    return static_cast<std::size_t>(foxy::detail::has_foxy_via(fields));
+  });
+
+  std::cout << "export_connect_fields speedup (copy excluded): "
+            << (legacy - copy) / (current - copy) << "x\n"
+            << "has_foxy_via speedup: " << legacy_via / current_via << "x\n";
+
+  return 0;
+}
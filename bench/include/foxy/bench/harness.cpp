@@ -0,0 +1,242 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/bench/harness.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+
+namespace
+{
+auto
+usage(char const* program) -> void
+{
+  std::cerr << "Usage: " << program << " [--json|--csv] [--filter=<text>] [--min-time=<ms>]"
+            << " [--connections=<n>] [--threads=<n>]\n";
+  std::exit(EXIT_FAILURE);
+}
+
+auto
+format_double(double const value) -> std::string
+{
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.3f", value);
+  return buf;
+}
+
+// benchmark names are ours, so the only characters that could need escaping are quotes and
+// backslashes
+//
+auto
+json_string(boost::string_view const str) -> std::string
+{
+  auto out = std::string("\"");
+  for (auto const c : str) {
+    if (c == '"' || c == '\\') { out += '\\'; }
+    out += c;
+  }
+  out += '"';
+  return out;
+}
+} // namespace
+
+auto
+foxy::bench::parse_options(int const argc, char** const argv) -> options
+{
+  auto opts = options();
+
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = boost::string_view(argv[i]);
+
+    if (arg == "--json") {
+      opts.json = true;
+    } else if (arg == "--csv") {
+      opts.csv = true;
+    } else if (arg.starts_with("--filter=")) {
+      opts.filter = static_cast<std::string>(arg.substr(9));
+    } else if (arg.starts_with("--min-time=")) {
+      auto const ms = std::strtol(argv[i] + 11, nullptr, 10);
+      if (ms <= 0) { usage(argv[0]); }
+      opts.min_time = std::chrono::milliseconds(ms);
+    } else if (arg.starts_with("--connections=")) {
+      auto const n = std::strtol(argv[i] + 14, nullptr, 10);
+      if (n <= 0) { usage(argv[0]); }
+      opts.connections = static_cast<std::size_t>(n);
+    } else if (arg.starts_with("--threads=")) {
+      auto const n = std::strtol(argv[i] + 10, nullptr, 10);
+      if (n <= 0) { usage(argv[0]); }
+      opts.threads = static_cast<std::size_t>(n);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  if (opts.json && opts.csv) { usage(argv[0]); }
+
+  return opts;
+}
+
+auto
+foxy::bench::result::ns_per_op() const noexcept -> double
+{
+  if (ops == 0) { return 0; }
+  return static_cast<double>(elapsed.count()) / static_cast<double>(ops);
+}
+
+auto
+foxy::bench::result::ops_per_s() const noexcept -> double
+{
+  if (elapsed.count() == 0) { return 0; }
+  return static_cast<double>(ops) * 1e9 / static_cast<double>(elapsed.count());
+}
+
+auto
+foxy::bench::result::mb_per_s() const noexcept -> double
+{
+  if (elapsed.count() == 0) { return 0; }
+  return static_cast<double>(bytes) * 1e3 / static_cast<double>(elapsed.count());
+}
+
+foxy::bench::suite::suite(options opts)
+  : opts_(std::move(opts))
+{
+}
+
+auto
+foxy::bench::suite::add(result r) -> void
+{
+  if (!opts_.json && !opts_.csv) {
+    std::cerr << r.name << ": " << format_double(r.ns_per_op()) << " ns/op\n";
+  }
+  results_.push_back(std::move(r));
+}
+
+auto
+foxy::bench::suite::is_selected(boost::string_view const name) const noexcept -> bool
+{
+  return opts_.filter.empty() || name.find(opts_.filter) != boost::string_view::npos;
+}
+
+auto
+foxy::bench::suite::opts() const noexcept -> options const&
+{
+  return opts_;
+}
+
+auto
+foxy::bench::suite::results() const noexcept -> std::vector<result> const&
+{
+  return results_;
+}
+
+auto
+foxy::bench::suite::report(std::ostream& os) const -> void
+{
+  auto const has_latency = std::any_of(results_.begin(), results_.end(),
+                                       [](auto const& r) { return r.latency.has_value(); });
+
+  if (opts_.json) {
+    os << "{\"benchmarks\":[";
+    auto is_first = true;
+    for (auto const& r : results_) {
+      if (!is_first) { os << ','; }
+      is_first = false;
+
+      os << "\n{\"name\":" << json_string(r.name) << ",\"ops\":" << r.ops
+         << ",\"bytes\":" << r.bytes << ",\"ns\":" << r.elapsed.count()
+         << ",\"ns_per_op\":" << format_double(r.ns_per_op())
+         << ",\"ops_per_s\":" << format_double(r.ops_per_s())
+         << ",\"mb_per_s\":" << format_double(r.mb_per_s());
+
+      if (r.latency) {
+        auto const& h = *r.latency;
+        os << ",\"latency_ns\":{\"mean\":" << h.mean()
+           << ",\"p50\":" << h.value_at_percentile(50)
+           << ",\"p90\":" << h.value_at_percentile(90)
+           << ",\"p99\":" << h.value_at_percentile(99)
+           << ",\"p999\":" << h.value_at_percentile(99.9) << ",\"max\":" << h.max() << "}";
+      }
+      os << "}";
+    }
+    os << "\n]}\n";
+    return;
+  }
+
+  if (opts_.csv) {
+    os << "name,ops,bytes,ns,ns_per_op,ops_per_s,mb_per_s,"
+          "latency_mean_ns,latency_p50_ns,latency_p90_ns,latency_p99_ns,latency_p999_ns,"
+          "latency_max_ns\n";
+
+    for (auto const& r : results_) {
+      os << r.name << ',' << r.ops << ',' << r.bytes << ',' << r.elapsed.count() << ','
+         << format_double(r.ns_per_op()) << ',' << format_double(r.ops_per_s()) << ','
+         << format_double(r.mb_per_s());
+
+      if (r.latency) {
+        auto const& h = *r.latency;
+        os << ',' << h.mean() << ',' << h.value_at_percentile(50) << ','
+           << h.value_at_percentile(90) << ',' << h.value_at_percentile(99) << ','
+           << h.value_at_percentile(99.9) << ',' << h.max();
+      } else {
+        os << ",,,,,,";
+      }
+      os << "\n";
+    }
+    return;
+  }
+
+  auto width = std::size_t{9};
+  for (auto const& r : results_) { width = (std::max)(width, r.name.size()); }
+
+  auto const pad = [&os](std::string const& str, std::size_t const n, bool const left) {
+    auto const fill = std::string(n > str.size() ? n - str.size() : 0, ' ');
+    if (left) {
+      os << str << fill;
+    } else {
+      os << fill << str;
+    }
+  };
+
+  // latencies are printed in microseconds, a loopback request takes tens of them
+  //
+  auto const micros = [](std::uint64_t const ns) {
+    return format_double(static_cast<double>(ns) / 1e3);
+  };
+
+  pad("benchmark", width, true);
+  pad("ns/op", 14, false);
+  pad("MB/s", 12, false);
+  pad("ops", 14, false);
+  if (has_latency) {
+    pad("ops/s", 14, false);
+    for (auto const* column : {"p50 us", "p90 us", "p99 us", "p999 us", "max us"}) {
+      pad(column, 12, false);
+    }
+  }
+  os << "\n";
+
+  for (auto const& r : results_) {
+    pad(r.name, width, true);
+    pad(format_double(r.ns_per_op()), 14, false);
+    pad(r.bytes > 0 ? format_double(r.mb_per_s()) : "-", 12, false);
+    pad(std::to_string(r.ops), 14, false);
+    if (r.latency) {
+      auto const& h = *r.latency;
+      pad(format_double(r.ops_per_s()), 14, false);
+      for (auto const p : {50.0, 90.0, 99.0, 99.9}) {
+        pad(micros(h.value_at_percentile(p)), 12, false);
+      }
+      pad(micros(h.max()), 12, false);
+    }
+    os << "\n";
+  }
+}
@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_BENCH_HARNESS_HPP_
+#define FOXY_BENCH_HARNESS_HPP_
+
+#include <foxy/session_histograms.hpp>
+
+#include <boost/optional/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace foxy
+{
+namespace bench
+{
+// options every benchmark executable understands:
+//
+//   --json            print the results as a single JSON object instead of a table
+//   --csv             print the results as CSV with a header row instead of a table
+//   --filter=<text>   only run the benchmarks whose name contains <text>
+//   --min-time=<ms>   how long each benchmark runs for at least, 250ms by default
+//
+// and the ones that put a server under load also take:
+//
+//   --connections=<n> how many client connections run at once, 16 by default
+//   --threads=<n>     how many threads run the io_context, 1 by default
+//
+struct options
+{
+  bool                      json = false;
+  bool                      csv  = false;
+  std::string               filter;
+  std::chrono::milliseconds min_time = std::chrono::milliseconds{250};
+
+  std::size_t connections = 16;
+  std::size_t threads     = 1;
+};
+
+// parse_options exits with a usage message when it's handed an argument it doesn't know
+//
+auto
+parse_options(int argc, char** argv) -> options;
+
+struct result
+{
+  std::string   name;
+  std::uint64_t ops   = 0;
+  std::uint64_t bytes = 0;
+
+  std::chrono::nanoseconds elapsed = std::chrono::nanoseconds::zero();
+
+  // a benchmark under load also records how long each of its ops took, in nanoseconds
+  //
+  boost::optional<::foxy::histogram> latency;
+
+  auto
+  ns_per_op() const noexcept -> double;
+
+  auto
+  ops_per_s() const noexcept -> double;
+
+  // `mb_per_s` counts megabytes as 10^6 bytes, it's zero for benchmarks that don't move bytes
+  //
+  auto
+  mb_per_s() const noexcept -> double;
+};
+
+// suite runs each benchmark for at least `min_time` and collects the results for `report`
+//
+// A benchmark is a callable that does `ops_per_call` operations over `bytes_per_call` bytes of
+// input every time it's called, and returns something derived from its work, like a length or a
+// count, so the compiler can't throw the work away.
+//
+struct suite
+{
+public:
+  explicit suite(options opts);
+
+  template <class F>
+  auto
+  run(boost::string_view name, std::size_t ops_per_call, std::size_t bytes_per_call, F&& f)
+    -> void;
+
+  // add records a result measured some other way, like a benchmark that drives its own event loop
+  //
+  auto
+  add(result r) -> void;
+
+  auto
+  is_selected(boost::string_view name) const noexcept -> bool;
+
+  auto
+  opts() const noexcept -> options const&;
+
+  auto
+  results() const noexcept -> std::vector<result> const&;
+
+  // report prints a table, or a JSON object of the form `{"benchmarks":[{"name":..,"ops":..,
+  // "bytes":..,"ns":..,"ns_per_op":..,"ops_per_s":..,"mb_per_s":..},...]}` when `--json` was
+  // passed, results with a latency histogram add `"latency_ns":{"mean":..,"p50":..,"p90":..,
+  // "p99":..,"p999":..,"max":..}`
+  //
+  // `--csv` prints a row of the same fields per result, the latency columns are empty for results
+  // without a histogram
+  //
+  auto
+  report(std::ostream& os) const -> void;
+
+private:
+  options             opts_;
+  std::vector<result> results_;
+
+  // every benchmark's return value is added up in here
+  //
+  std::size_t volatile sink_ = 0;
+};
+
+template <class F>
+auto
+suite::run(boost::string_view const name,
+           std::size_t const        ops_per_call,
+           std::size_t const        bytes_per_call,
+           F&&                      f) -> void
+{
+  if (!is_selected(name)) { return; }
+
+  using clock_type = std::chrono::steady_clock;
+
+  // the first call warms the caches up and isn't counted, after that the number of calls doubles
+  // until a single batch takes at least `min_time`
+  //
+  sink_ = sink_ + f();
+
+  auto calls   = std::uint64_t{1};
+  auto elapsed = clock_type::duration::zero();
+  while (true) {
+    auto sum = std::size_t{0};
+
+    auto const start = clock_type::now();
+    for (auto i = std::uint64_t{0}; i < calls; ++i) { sum += f(); }
+    elapsed = clock_type::now() - start;
+
+    sink_ = sink_ + sum;
+
+    if (elapsed >= opts_.min_time) { break; }
+    calls *= 2;
+  }
+
+  auto r    = result();
+  r.name    = static_cast<std::string>(name);
+  r.ops     = calls * ops_per_call;
+  r.bytes   = calls * bytes_per_call;
+  r.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+
+  add(std::move(r));
+}
+
+} // namespace bench
+} // namespace foxy
+
+#endif // FOXY_BENCH_HARNESS_HPP_
@@ -0,0 +1,351 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// Puts a foxy::listener on localhost under load from foxy::client_sessions, over plain TCP and TLS
+//
+// Every connection sends GETs for the whole `--min-time` and the server answers each of them with
+// a small body. The connections either wait for each response before sending the next request
+// (keep_alive), send `pipeline_depth` requests before reading any of the responses (pipelined),
+// or connect anew for every request (per_request). An op is a single request, its latency is
+// measured from when the client starts sending it until it's read the whole response, connecting
+// included for per_request. Both ends turn Nagle's algorithm off, a pipeline of small requests
+// otherwise sits out the peer's delayed ACKs.
+//
+// Usage: listener-bench [--json|--csv] [--filter=<text>] [--min-time=<ms>] [--connections=<n>]
+//                       [--threads=<n>]
+//
+
+#include <foxy/bench/harness.hpp>
+#include <foxy/test/helpers/ssl_ctx.hpp>
+
+#include <foxy/listener.hpp>
+#include <foxy/client_session.hpp>
+#include <foxy/session_histograms.hpp>
+
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ssl/context.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using boost::asio::ip::tcp;
+
+namespace
+{
+constexpr std::size_t pipeline_depth = 8;
+constexpr std::size_t body_size      = 128;
+
+enum class pattern
+{
+  keep_alive,
+  pipelined,
+  per_request
+};
+
+#include <boost/asio/yield.hpp>
+// handler answers every request of a connection until the client is done with it
+//
+struct handler : asio::coroutine
+{
+  foxy::server_session& server;
+
+  std::unique_ptr<http::request<http::empty_body>> request_handle =
+    std::make_unique<http::request<http::empty_body>>();
+
+  std::unique_ptr<http::response<http::string_body>> response_handle =
+    std::make_unique<http::response<http::string_body>>(
+      http::status::ok, 11, std::string(body_size, 'x'));
+
+  handler(foxy::server_session& server_)
+    : server(server_)
+  {
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0)
+    -> void
+  {
+    auto& request  = *request_handle;
+    auto& response = *response_handle;
+
+    reenter(*this)
+    {
+      server.stream.plain().set_option(tcp::no_delay(true));
+
+      while (true) {
+        request = {};
+
+        yield server.async_read(request, std::move(self));
+        if (ec) { break; }
+
+        response.keep_alive(request.keep_alive());
+        response.prepare_payload();
+
+        yield server.async_write(response, std::move(self));
+        if (ec || !request.keep_alive()) { break; }
+      }
+
+      // the client closing its connection is how every connection ends
+      //
+      self.complete({}, bytes_transferred);
+    }
+  }
+};
+#include <boost/asio/unyield.hpp>
+
+// connection is what one of the client connections of a run records
+//
+struct connection
+{
+  foxy::histogram latency;
+  std::uint64_t   ops   = 0;
+  std::uint64_t   bytes = 0;
+
+  boost::system::error_code ec;
+
+  auto
+  record(std::chrono::steady_clock::time_point const sent, std::size_t const n) -> void
+  {
+    auto const elapsed = std::chrono::steady_clock::now() - sent;
+    latency.record(static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+
+    ++ops;
+    bytes += n;
+  }
+};
+
+auto
+make_request() -> http::request<http::empty_body>
+{
+  auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+  request.set(http::field::host, "127.0.0.1");
+  return request;
+}
+
+auto
+run_keep_alive(foxy::client_session&                 client,
+               std::string const&                    port,
+               std::chrono::steady_clock::time_point deadline,
+               connection&                           conn,
+               asio::yield_context                   yield) -> void
+{
+  auto& ec = conn.ec;
+
+  client.async_connect("127.0.0.1", port, yield[ec]);
+  if (ec) { return; }
+  client.stream.plain().set_option(tcp::no_delay(true));
+
+  auto request = make_request();
+  while (std::chrono::steady_clock::now() < deadline) {
+    auto response = http::response<http::string_body>();
+
+    auto const sent = std::chrono::steady_clock::now();
+    client.async_request(request, response, yield[ec]);
+    if (ec) { return; }
+
+    conn.record(sent, response.body().size());
+  }
+
+  client.async_shutdown(yield[ec]);
+  ec = {};
+}
+
+auto
+run_pipelined(foxy::client_session&                 client,
+              std::string const&                    port,
+              std::chrono::steady_clock::time_point deadline,
+              connection&                           conn,
+              asio::yield_context                   yield) -> void
+{
+  auto& ec = conn.ec;
+
+  client.async_connect("127.0.0.1", port, yield[ec]);
+  if (ec) { return; }
+  client.stream.plain().set_option(tcp::no_delay(true));
+
+  auto request = make_request();
+  auto sent    = std::array<std::chrono::steady_clock::time_point, pipeline_depth>();
+  while (std::chrono::steady_clock::now() < deadline) {
+    for (auto& time : sent) {
+      time = std::chrono::steady_clock::now();
+      client.async_write(request, yield[ec]);
+      if (ec) { return; }
+    }
+
+    for (auto const time : sent) {
+      auto response = http::response<http::string_body>();
+      client.async_read(response, yield[ec]);
+      if (ec) { return; }
+
+      conn.record(time, response.body().size());
+    }
+  }
+
+  client.async_shutdown(yield[ec]);
+  ec = {};
+}
+
+auto
+run_per_request(asio::io_context&                     io,
+                foxy::session_opts const&             opts,
+                std::string const&                    port,
+                std::chrono::steady_clock::time_point deadline,
+                connection&                           conn,
+                asio::yield_context                   yield) -> void
+{
+  auto& ec = conn.ec;
+
+  auto request = make_request();
+  request.keep_alive(false);
+
+  while (std::chrono::steady_clock::now() < deadline) {
+    auto const sent = std::chrono::steady_clock::now();
+
+    auto client = foxy::client_session(io.get_executor(), opts);
+    client.async_connect("127.0.0.1", port, yield[ec]);
+    if (ec) { return; }
+    client.stream.plain().set_option(tcp::no_delay(true));
+
+    auto response = http::response<http::string_body>();
+    client.async_request(request, response, yield[ec]);
+    if (ec) { return; }
+
+    conn.record(sent, response.body().size());
+
+    client.async_shutdown(yield[ec]);
+    ec = {};
+  }
+}
+
+auto
+run(foxy::bench::suite& suite, std::string const& name, pattern const p, bool const is_tls)
+  -> void
+{
+  if (!suite.is_selected(name)) { return; }
+
+  auto const& bench_opts = suite.opts();
+
+  asio::io_context io{static_cast<int>(bench_opts.threads)};
+
+  // the listener can't tell us which port it got so we find a free one for it
+  //
+  auto port = std::string();
+  {
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    port          = std::to_string(acceptor.local_endpoint().port());
+  }
+
+  auto const endpoint = tcp::endpoint(asio::ip::make_address("127.0.0.1"),
+                                      static_cast<unsigned short>(std::stoi(port)));
+
+  auto listener = is_tls ? foxy::listener(io.get_executor(), endpoint,
+                                          foxy::test::make_server_ssl_ctx())
+                         : foxy::listener(io.get_executor(), endpoint);
+
+  listener.async_accept([](foxy::server_session& server) { return handler(server); });
+
+  // the test certificates are only good for trying TLS out, we don't verify them
+  //
+  auto client_ctx = foxy::test::make_client_ssl_ctx();
+  client_ctx.set_verify_mode(asio::ssl::verify_none);
+
+  auto client_opts             = foxy::session_opts();
+  client_opts.timeout          = std::chrono::seconds{30};
+  client_opts.verify_peer_cert = false;
+  if (is_tls) { client_opts.ssl_ctx = client_ctx; }
+
+  auto conns     = std::vector<connection>(bench_opts.connections);
+  auto remaining = std::atomic<std::size_t>(conns.size());
+
+  auto const started  = std::chrono::steady_clock::now();
+  auto const deadline = started + bench_opts.min_time;
+  auto       ended    = started;
+
+  for (auto& conn : conns) {
+    asio::spawn(io, [&, p](asio::yield_context yield) {
+      if (p == pattern::per_request) {
+        run_per_request(io, client_opts, port, deadline, conn, yield);
+      } else {
+        auto client = foxy::client_session(io.get_executor(), client_opts);
+        if (p == pattern::keep_alive) {
+          run_keep_alive(client, port, deadline, conn, yield);
+        } else {
+          run_pipelined(client, port, deadline, conn, yield);
+        }
+      }
+
+      if (remaining.fetch_sub(1) == 1) {
+        ended = std::chrono::steady_clock::now();
+        listener.shutdown();
+      }
+    });
+  }
+
+  auto threads = std::vector<std::thread>();
+  for (auto i = std::size_t{1}; i < bench_opts.threads; ++i) {
+    threads.emplace_back([&io] { io.run(); });
+  }
+  io.run();
+  for (auto& thread : threads) { thread.join(); }
+
+  auto r    = foxy::bench::result();
+  r.name    = name;
+  r.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(ended - started);
+  r.latency.emplace();
+
+  auto failed = std::size_t{0};
+  for (auto const& conn : conns) {
+    r.ops += conn.ops;
+    r.bytes += conn.bytes;
+    r.latency->merge(conn.latency);
+
+    if (conn.ec) {
+      ++failed;
+      std::cerr << name << ": a connection failed: " << conn.ec.message() << "\n";
+    }
+  }
+
+  if (failed > 0) { std::cerr << name << ": " << failed << " connections failed\n"; }
+
+  suite.add(std::move(r));
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto suite = foxy::bench::suite(foxy::bench::parse_options(argc, argv));
+
+  for (auto const is_tls : {false, true}) {
+    auto const prefix = std::string(is_tls ? "listener/tls/" : "listener/plain/");
+
+    run(suite, prefix + "keep_alive", pattern::keep_alive, is_tls);
+    run(suite, prefix + "pipelined", pattern::pipelined, is_tls);
+    run(suite, prefix + "per_request", pattern::per_request, is_tls);
+  }
+
+  suite.report(std::cout);
+  return 0;
+}
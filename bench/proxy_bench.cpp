@@ -0,0 +1,400 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// Puts a foxy::proxy between a local origin and foxy::client_sessions, all of them in-process on
+// localhost
+//
+// Every connection sends requests for the whole `--min-time`, one at a time. A request either
+// fetches a small body (small), downloads `large_body_size` bytes (download) or uploads them
+// (upload). The requests go:
+//
+//   direct      straight to the origin, what the proxy costs is the difference to this
+//   relay       through the proxy in absolute-form, over its pool of upstream connections
+//   tunnel      through a CONNECT tunnel the proxy relays HTTP messages over, one per request
+//   raw_tunnel  through a CONNECT tunnel with `raw_tunnel` set, which pumps opaque bytes
+//
+// An op is a single request, its latency is measured from when the client starts sending it until
+// it's read the whole response. MB/s counts the bodies of the workload, the responses of small and
+// download and the requests of upload.
+//
+// Usage: proxy-bench [--json|--csv] [--filter=<text>] [--min-time=<ms>] [--connections=<n>]
+//                    [--threads=<n>]
+//
+
+#include <foxy/bench/harness.hpp>
+
+#include <foxy/proxy.hpp>
+#include <foxy/listener.hpp>
+#include <foxy/client_session.hpp>
+#include <foxy/session_histograms.hpp>
+
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <boost/optional/optional.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using boost::asio::ip::tcp;
+
+namespace
+{
+constexpr std::size_t small_body_size = 128;
+constexpr std::size_t large_body_size = 1024 * 1024;
+
+enum class route
+{
+  direct,
+  relay,
+  tunnel,
+  raw_tunnel
+};
+
+enum class workload
+{
+  small,
+  download,
+  upload
+};
+
+using body_type = http::span_body<char const>;
+
+// the origin serves its bodies straight out of these
+//
+std::string const small_body(small_body_size, 's');
+std::string const large_body(large_body_size, 'l');
+
+#include <boost/asio/yield.hpp>
+// origin answers every request of a connection until the client, or the proxy, is done with it
+//
+// A GET of `/large` is answered with `large_body` and everything else, uploads included, with
+// `small_body`.
+//
+struct origin : asio::coroutine
+{
+  foxy::server_session& server;
+
+  std::unique_ptr<http::request_parser<http::string_body>> parser_handle;
+
+  std::unique_ptr<http::response<body_type>> response_handle =
+    std::make_unique<http::response<body_type>>(http::status::ok, 11);
+
+  origin(foxy::server_session& server_)
+    : server(server_)
+  {
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0)
+    -> void
+  {
+    auto& response = *response_handle;
+
+    reenter(*this)
+    {
+      server.stream.plain().set_option(tcp::no_delay(true));
+
+      while (true) {
+        parser_handle = std::make_unique<http::request_parser<http::string_body>>();
+        parser_handle->body_limit((std::numeric_limits<std::uint64_t>::max)());
+
+        yield server.async_read(*parser_handle, std::move(self));
+        if (ec) { break; }
+
+        {
+          auto const& request = parser_handle->get();
+
+          auto const& body = request.method() == http::verb::get && request.target() == "/large"
+                               ? large_body
+                               : small_body;
+
+          response.body() = body_type::value_type(body.data(), body.size());
+          response.keep_alive(request.keep_alive());
+          response.prepare_payload();
+        }
+
+        yield server.async_write(response, std::move(self));
+        if (ec || !parser_handle->get().keep_alive()) { break; }
+      }
+
+      // the client closing its connection is how every connection ends
+      //
+      self.complete({}, bytes_transferred);
+    }
+  }
+};
+#include <boost/asio/unyield.hpp>
+
+// connection is what one of the client connections of a run records
+//
+struct connection
+{
+  foxy::histogram latency;
+  std::uint64_t   ops   = 0;
+  std::uint64_t   bytes = 0;
+
+  boost::system::error_code ec;
+
+  auto
+  record(std::chrono::steady_clock::time_point const sent, std::size_t const n) -> void
+  {
+    auto const elapsed = std::chrono::steady_clock::now() - sent;
+    latency.record(static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+
+    ++ops;
+    bytes += n;
+  }
+};
+
+struct ports
+{
+  std::string origin;
+  std::string proxy;
+};
+
+auto
+make_request(route const r, workload const w, ports const& p) -> http::request<body_type>
+{
+  auto const path      = std::string(w == workload::download ? "/large" : "/small");
+  auto const authority = "127.0.0.1:" + p.origin;
+
+  auto request = http::request<body_type>(w == workload::upload ? http::verb::post
+                                                                  : http::verb::get,
+                                          r == route::relay ? "http://" + authority + path : path,
+                                          11);
+
+  request.set(http::field::host, authority);
+  if (w == workload::upload) {
+    request.body() = body_type::value_type(large_body.data(), large_body.size());
+  }
+  request.prepare_payload();
+
+  return request;
+}
+
+// open connects `client` to the origin or the proxy, and asks the proxy for a tunnel to the origin
+// for the tunnel routes
+//
+auto
+open(foxy::client_session&      client,
+     route const                r,
+     ports const&               p,
+     boost::system::error_code& ec,
+     asio::yield_context        yield) -> void
+{
+  client.async_connect("127.0.0.1", r == route::direct ? p.origin : p.proxy, yield[ec]);
+  if (ec) { return; }
+  client.stream.plain().set_option(tcp::no_delay(true));
+
+  if (r != route::tunnel && r != route::raw_tunnel) { return; }
+
+  auto const authority = "127.0.0.1:" + p.origin;
+
+  auto request = http::request<http::empty_body>(http::verb::connect, authority, 11);
+  request.set(http::field::host, authority);
+
+  auto parser = http::response_parser<http::empty_body>();
+  parser.skip(true);
+
+  client.async_request(request, parser, yield[ec]);
+  if (ec) { return; }
+
+  if (parser.get().result() != http::status::ok) { ec = asio::error::connection_refused; }
+}
+
+// run_connection keeps a connection busy until `deadline`
+//
+// A tunnel the proxy relays HTTP messages over goes back to expecting a CONNECT or an absolute-form
+// request after it's relayed one, so the tunnel route opens a new tunnel for every request and the
+// request's latency includes setting it up.
+//
+auto
+run_connection(asio::io_context&                     io,
+               foxy::session_opts const&             opts,
+               route const                           r,
+               workload const                        w,
+               ports const&                          p,
+               std::chrono::steady_clock::time_point deadline,
+               connection&                           conn,
+               asio::yield_context                   yield) -> void
+{
+  auto& ec = conn.ec;
+
+  auto const is_one_shot = r == route::tunnel;
+
+  auto client = boost::optional<foxy::client_session>();
+  if (!is_one_shot) {
+    client.emplace(io.get_executor(), opts);
+    open(*client, r, p, ec, yield);
+    if (ec) { return; }
+  }
+
+  auto request = make_request(r, w, p);
+  while (std::chrono::steady_clock::now() < deadline) {
+    auto const sent = std::chrono::steady_clock::now();
+
+    if (!client) {
+      client.emplace(io.get_executor(), opts);
+      open(*client, r, p, ec, yield);
+      if (ec) { return; }
+    }
+
+    auto parser = http::response_parser<http::string_body>();
+    parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+
+    client->async_request(request, parser, yield[ec]);
+    if (ec) { return; }
+
+    if (parser.get().result() != http::status::ok) {
+      ec = asio::error::connection_refused;
+      return;
+    }
+
+    conn.record(sent, w == workload::upload ? request.body().size() : parser.get().body().size());
+
+    if (is_one_shot) {
+      client->async_shutdown(yield[ec]);
+      client.reset();
+    }
+  }
+
+  if (client) { client->async_shutdown(yield[ec]); }
+  ec = {};
+}
+
+auto
+run(foxy::bench::suite& suite, std::string const& name, route const r, workload const w) -> void
+{
+  if (!suite.is_selected(name)) { return; }
+
+  auto const& bench_opts = suite.opts();
+
+  asio::io_context io{static_cast<int>(bench_opts.threads)};
+
+  auto const localhost = asio::ip::make_address("127.0.0.1");
+
+  // the listener can't tell us which port it got so we find a free one for it
+  //
+  auto p = ports();
+  {
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(localhost, 0));
+    p.origin      = std::to_string(acceptor.local_endpoint().port());
+  }
+
+  auto listener = foxy::listener(
+    io.get_executor(), tcp::endpoint(localhost, static_cast<unsigned short>(std::stoi(p.origin))));
+
+  listener.async_accept([](foxy::server_session& server) { return origin(server); });
+
+  auto proxy_opts       = foxy::session_opts();
+  proxy_opts.timeout    = std::chrono::seconds{30};
+  proxy_opts.raw_tunnel = r == route::raw_tunnel;
+
+  auto acceptor = tcp::acceptor(io, tcp::endpoint(localhost, 0));
+  p.proxy       = std::to_string(acceptor.local_endpoint().port());
+
+  auto proxy = std::make_shared<foxy::proxy>(std::move(acceptor), proxy_opts);
+  proxy->async_accept();
+
+  auto client_opts    = foxy::session_opts();
+  client_opts.timeout = std::chrono::seconds{30};
+
+  auto conns     = std::vector<connection>(bench_opts.connections);
+  auto remaining = std::atomic<std::size_t>(conns.size());
+
+  auto const started  = std::chrono::steady_clock::now();
+  auto const deadline = started + bench_opts.min_time;
+  auto       ended    = started;
+
+  for (auto& conn : conns) {
+    asio::spawn(io, [&](asio::yield_context yield) {
+      run_connection(io, client_opts, r, w, p, deadline, conn, yield);
+
+      // the proxy's pool of upstream connections goes away with it, which lets the origin's
+      // sessions end too
+      //
+      if (remaining.fetch_sub(1) == 1) {
+        ended = std::chrono::steady_clock::now();
+        listener.shutdown();
+        proxy->cancel();
+        proxy.reset();
+      }
+    });
+  }
+
+  auto threads = std::vector<std::thread>();
+  for (auto i = std::size_t{1}; i < bench_opts.threads; ++i) {
+    threads.emplace_back([&io] { io.run(); });
+  }
+  io.run();
+  for (auto& thread : threads) { thread.join(); }
+
+  auto result    = foxy::bench::result();
+  result.name    = name;
+  result.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(ended - started);
+  result.latency.emplace();
+
+  auto failed = std::size_t{0};
+  for (auto const& conn : conns) {
+    result.ops += conn.ops;
+    result.bytes += conn.bytes;
+    result.latency->merge(conn.latency);
+
+    if (conn.ec) {
+      ++failed;
+      std::cerr << name << ": a connection failed: " << conn.ec.message() << "\n";
+    }
+  }
+
+  if (failed > 0) { std::cerr << name << ": " << failed << " connections failed\n"; }
+
+  suite.add(std::move(result));
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto suite = foxy::bench::suite(foxy::bench::parse_options(argc, argv));
+
+  auto const routes = {std::make_pair("direct", route::direct),
+                       std::make_pair("relay", route::relay),
+                       std::make_pair("tunnel", route::tunnel),
+                       std::make_pair("raw_tunnel", route::raw_tunnel)};
+
+  auto const workloads = {std::make_pair("small", workload::small),
+                          std::make_pair("download", workload::download),
+                          std::make_pair("upload", workload::upload)};
+
+  for (auto const& r : routes) {
+    for (auto const& w : workloads) {
+      run(suite, std::string("proxy/") + r.first + "/" + w.first, r.second, w.second);
+    }
+  }
+
+  suite.report(std::cout);
+  return 0;
+}
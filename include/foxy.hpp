@@ -10,9 +10,13 @@
 #ifndef FOXY_HPP_
 #define FOXY_HPP_
 
+#include <foxy/access_list.hpp>
+#include <foxy/access_log.hpp>
+#include <foxy/backend_pool.hpp>
 #include <foxy/client_session.hpp>
 #include <foxy/code_point_iterator.hpp>
 #include <foxy/error.hpp>
+#include <foxy/health_checker.hpp>
 #include <foxy/listener.hpp>
 #include <foxy/log.hpp>
 #include <foxy/multi_stream.hpp>
@@ -22,6 +26,7 @@
 #include <foxy/server_session.hpp>
 #include <foxy/session_opts.hpp>
 #include <foxy/session.hpp>
+#include <foxy/sharded_proxy.hpp>
 #include <foxy/type_traits.hpp>
 #include <foxy/uri_parts.hpp>
 #include <foxy/uri.hpp>
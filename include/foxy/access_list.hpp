@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_ACCESS_LIST_HPP_
+#define FOXY_ACCESS_LIST_HPP_
+
+#include <boost/asio/ip/address.hpp>
+#include <boost/optional/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace foxy
+{
+enum class access_action {
+  allow,
+  deny
+};
+
+struct access_rule
+{
+  // either a domain name, which covers the domain itself and all of its subdomains, or an IPv4 or
+  // IPv6 address with an optional prefix length, e.g. "10.0.0.0/8" or "fe80::/10"
+  //
+  std::string   pattern;
+  access_action action = access_action::deny;
+};
+
+// access_list is a compiled set of access rules for the hosts a proxy connects to
+//
+// The most specific rule that covers a host decides, i.e. the one with the longest matching domain
+// suffix or the longest matching address prefix. Hosts no rule covers get the default action.
+//
+// Domains live in a trie of their labels read right to left and addresses in a radix tree of their
+// bits, IPv4 addresses are stored as IPv4-mapped IPv6 ones. Lookups never allocate and, since the
+// list can't be modified once it's built, can be made from any number of threads at once.
+//
+struct access_list
+{
+public:
+  // an empty list allows everything
+  //
+  access_list();
+
+  // throws a `boost::system::system_error` holding `foxy::error::bad_access_rule` for a pattern
+  // that's neither a valid domain name nor a valid address prefix, a later rule with the same
+  // pattern as an earlier one replaces it
+  //
+  explicit access_list(std::vector<access_rule> const& rules,
+                       access_action                   default_action = access_action::allow);
+
+  auto
+  default_action() const noexcept -> access_action;
+
+  // match returns the action of the most specific rule covering `host`, which is either a domain
+  // name or an IP address that may be enclosed in brackets
+  //
+  auto
+  match(boost::string_view host) const noexcept -> boost::optional<access_action>;
+
+  auto
+  match(boost::asio::ip::address const& address) const noexcept -> boost::optional<access_action>;
+
+  // check is `match` falling back to the default action
+  //
+  auto
+  check(boost::string_view host) const noexcept -> access_action;
+
+private:
+  using key_type = std::array<std::uint8_t, 16>;
+
+  // the children of a domain node are stored next to each other, sorted by their label
+  //
+  struct domain_node
+  {
+    std::uint32_t first_child  = 0;
+    std::uint32_t num_children = 0;
+    std::uint32_t label_offset = 0;
+    std::uint32_t label_size   = 0;
+    std::int8_t   action       = -1;
+  };
+
+  // a prefix node stands for the first `len` bits of its `key`, its children differ from each other
+  // in the bit right after those
+  //
+  struct prefix_node
+  {
+    key_type                     key      = {};
+    std::uint8_t                 len      = 0;
+    std::array<std::uint32_t, 2> children = {};
+    std::int8_t                  action   = -1;
+  };
+
+  auto
+  add_prefix(key_type const& key, std::uint8_t len, access_action action) -> void;
+
+  auto
+  match_domain(boost::string_view host) const noexcept -> boost::optional<access_action>;
+
+  auto
+  match_key(key_type const& key) const noexcept -> boost::optional<access_action>;
+
+  access_action default_;
+
+  // `domains_[0]` and `prefixes_[0]` are the roots, the root of the radix tree covers every address
+  //
+  std::vector<domain_node> domains_;
+  std::string              labels_;
+  std::vector<prefix_node> prefixes_;
+};
+
+// access_policy is the access list a proxy currently enforces
+//
+// Reloading swaps a whole new list in at once, lookups that are already underway finish against the
+// list they started with.
+//
+// All member functions are safe to call concurrently
+//
+struct access_policy
+{
+public:
+  access_policy();
+  explicit access_policy(access_list list);
+
+  access_policy(access_policy const&) = delete;
+  access_policy(access_policy&&)      = delete;
+
+  auto
+  reload(access_list list) -> void;
+
+  auto
+  get() const -> std::shared_ptr<access_list const>;
+
+private:
+  mutable std::mutex                 mtx_;
+  std::shared_ptr<access_list const> list_;
+};
+
+} // namespace foxy
+
+#endif // FOXY_ACCESS_LIST_HPP_
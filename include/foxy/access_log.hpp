@@ -0,0 +1,191 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_ACCESS_LOG_HPP_
+#define FOXY_ACCESS_LOG_HPP_
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace foxy
+{
+enum class access_kind : std::uint8_t {
+  // a request relayed to an origin or a backend, or one the proxy answered itself
+  //
+  request,
+
+  // a request answered out of the proxy's cache
+  //
+  cache_hit,
+
+  // a CONNECT tunnel, logged once it's closed
+  //
+  tunnel
+};
+
+enum class access_log_format {
+  // one JSON object per line
+  //
+  text,
+
+  // the `access_record`s themselves, back to back in the host's byte order
+  //
+  binary
+};
+
+// access_record is a single entry of the access log
+//
+// It's a fixed-size, trivially copyable struct so that it can be handed to the log without
+// allocating and written out as is. Targets longer than the record has room for are truncated.
+//
+struct access_record
+{
+  // when the request arrived and how long it took to answer, in microseconds
+  //
+  std::int64_t timestamp = 0;
+  std::int64_t duration  = 0;
+
+  // body bytes read from the client and body bytes sent to it, a tunnel counts everything
+  //
+  std::uint64_t bytes_in  = 0;
+  std::uint64_t bytes_out = 0;
+
+  // the client's address as an IPv6 address, IPv4 addresses are IPv4-mapped
+  //
+  std::array<std::uint8_t, 16> address = {};
+  std::uint16_t                port    = 0;
+
+  std::uint16_t status = 0;
+  access_kind   kind   = access_kind::request;
+
+  // a `boost::beast::http::verb`
+  //
+  std::uint8_t method = 0;
+
+  std::uint16_t         target_size = 0;
+  std::array<char, 200> target      = {};
+
+  auto
+  set_target(boost::string_view value) noexcept -> void;
+
+  auto
+  get_target() const noexcept -> boost::string_view;
+
+  auto
+  set_client(boost::asio::ip::tcp::endpoint const& endpoint) noexcept -> void;
+
+  auto
+  get_client() const -> boost::asio::ip::tcp::endpoint;
+};
+
+static_assert(std::is_trivially_copyable<access_record>::value,
+              "access records are copied into and out of the log's buffers byte for byte");
+
+// access_log writes access records to a file on a thread of its own
+//
+// Every thread that records gets a ring buffer of `ring_size` records that only it writes to and
+// only the log's thread reads from, so recording never takes a lock or makes a system call. The
+// first record a thread makes allocates its ring and is the only one that briefly takes the log's
+// lock. When a thread's ring is full, the record is dropped and counted instead of waiting for the
+// writer to catch up.
+//
+// The writer wakes up every `flush_interval`, gathers whatever all of the rings hold and writes it
+// out with as few system calls as it can, i.e. a single `writev(2)` for binary records.
+//
+// The log is flushed and closed when it's destroyed. All member functions are safe to call
+// concurrently.
+//
+struct access_log
+{
+public:
+  access_log()                  = delete;
+  access_log(access_log const&) = delete;
+  access_log(access_log&&)      = delete;
+
+  // opens `path` for appending, throws a `boost::system::system_error` if it can't
+  //
+  explicit access_log(std::string const&        path,
+                      access_log_format         format         = access_log_format::text,
+                      std::size_t               ring_size      = 4096,
+                      std::chrono::milliseconds flush_interval = std::chrono::milliseconds{100});
+
+  ~access_log();
+
+  // record returns false when the record had to be dropped
+  //
+  auto
+  record(access_record const& entry) noexcept -> bool;
+
+  // flush blocks until everything recorded before it was called has been written, it must not be
+  // called from an I/O thread
+  //
+  auto
+  flush() -> void;
+
+  auto
+  format() const noexcept -> access_log_format;
+
+  auto
+  num_written() const noexcept -> std::uint64_t;
+
+  auto
+  num_dropped() const noexcept -> std::uint64_t;
+
+private:
+  struct ring;
+
+  auto
+  local_ring() noexcept -> ring*;
+
+  auto
+  run() -> void;
+
+  auto
+  drain(std::vector<ring*> const& rings) -> void;
+
+  auto
+  write_all(char const* data, std::size_t size) -> bool;
+
+  std::uint64_t             id_;
+  access_log_format         format_;
+  std::size_t               ring_size_;
+  std::chrono::milliseconds flush_interval_;
+
+  int fd_ = -1;
+
+  std::mutex                         mtx_;
+  std::condition_variable            wake_;
+  std::condition_variable            flushed_;
+  std::vector<std::unique_ptr<ring>> rings_;
+  std::uint64_t                      flush_requests_ = 0;
+  std::uint64_t                      flushes_done_   = 0;
+  bool                               stop_           = false;
+
+  std::atomic<std::uint64_t> num_written_;
+  std::atomic<std::uint64_t> num_dropped_;
+
+  std::string text_;
+  std::thread writer_;
+};
+
+} // namespace foxy
+
+#endif // FOXY_ACCESS_LOG_HPP_
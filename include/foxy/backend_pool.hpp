@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_BACKEND_POOL_HPP_
+#define FOXY_BACKEND_POOL_HPP_
+
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace foxy
+{
+struct backend
+{
+  std::string host;
+  std::string service;
+};
+
+enum class balance_policy {
+  // backends take turns
+  //
+  round_robin,
+
+  // the backend with the fewest requests in flight, turns are taken among those that tie
+  //
+  least_outstanding,
+
+  // the request target is hashed onto a ring of backends so the same target keeps going to the
+  // same backend
+  //
+  consistent_hash
+};
+
+struct backend_health_opts
+{
+  using duration_type = std::chrono::steady_clock::duration;
+
+  // the number of consecutive failures, from requests and active probes alike, that eject a backend
+  //
+  std::size_t max_failures = 3;
+
+  // requests that take longer than this count as failures, zero turns the check off
+  //
+  duration_type latency_threshold = duration_type::zero();
+
+  // a backend is ejected for `base_ejection` the first time and twice as long for every ejection
+  // after that, up to `max_ejection`, until it's gone `max_ejection` without being ejected
+  //
+  duration_type base_ejection = std::chrono::seconds{10};
+  duration_type max_ejection  = std::chrono::seconds{300};
+};
+
+// backend_pool is the set of servers a reverse proxy balances its requests over
+//
+// Backends that keep failing are ejected and not picked again until their ejection is over or an
+// active probe finds them healthy, unless every backend is ejected in which case they all are
+//
+// All member functions are safe to call concurrently
+//
+struct backend_pool
+{
+public:
+  using clock_type    = std::chrono::steady_clock;
+  using duration_type = clock_type::duration;
+
+  // lease is a backend picked for a single request, the backend counts the request as outstanding
+  // for as long as the lease is alive
+  //
+  struct lease
+  {
+  public:
+    lease()             = default;
+    lease(lease const&) = delete;
+    lease(lease&& rhs) noexcept;
+
+    ~lease();
+
+    auto
+    operator=(lease&& rhs) noexcept -> lease&;
+
+    explicit operator bool() const noexcept;
+
+    auto
+    index() const noexcept -> std::size_t;
+
+    auto
+    get() const -> backend const&;
+
+    // complete reports how the request went and releases the lease, a lease that's only reset
+    // doesn't count towards the backend's health
+    //
+    auto
+    complete(boost::system::error_code ec) -> void;
+
+    auto
+    reset() -> void;
+
+  private:
+    friend struct backend_pool;
+
+    lease(backend_pool& pool, std::size_t index) noexcept;
+
+    backend_pool*          pool_  = nullptr;
+    std::size_t            index_ = 0;
+    clock_type::time_point start_;
+  };
+
+  backend_pool()                    = delete;
+  backend_pool(backend_pool const&) = delete;
+  backend_pool(backend_pool&&)      = delete;
+
+  // `backends` must not be empty
+  //
+  backend_pool(std::vector<backend> backends,
+               balance_policy       policy = balance_policy::round_robin,
+               backend_health_opts  health = {});
+
+  // acquire picks the backend for a request, only `balance_policy::consistent_hash` uses the `key`
+  //
+  // The backends in `skip` have already failed the request and are passed over like ejected ones,
+  // a consistent hash then moves on along the ring to the backend the key would fail over to
+  //
+  auto
+  acquire(boost::string_view key = {}, std::vector<std::size_t> const& skip = {}) -> lease;
+
+  // report_probe records the outcome of an active health check, a successful one readmits the
+  // backend straight away
+  //
+  auto
+  report_probe(std::size_t index, boost::system::error_code ec) -> void;
+
+  auto
+  policy() const noexcept -> balance_policy;
+
+  auto
+  size() const noexcept -> std::size_t;
+
+  auto
+  at(std::size_t index) const -> backend const&;
+
+  auto
+  outstanding(std::size_t index) const -> std::size_t;
+
+  auto
+  is_ejected(std::size_t index) const -> bool;
+
+private:
+  struct backend_state
+  {
+    std::size_t            outstanding   = 0;
+    std::size_t            failures      = 0;
+    std::size_t            ejections     = 0;
+    clock_type::time_point ejected_until = {};
+  };
+
+  auto
+  release(std::size_t index) -> void;
+
+  auto
+  complete(std::size_t index, boost::system::error_code ec, duration_type latency) -> void;
+
+  // must be called with `mtx_` held
+  //
+  auto
+  fail(backend_state& backend, clock_type::time_point now) -> void;
+
+  std::vector<backend> backends_;
+  balance_policy       policy_;
+  backend_health_opts  health_;
+
+  // the consistent hash ring, each backend owns many points on it so that the keys it loses or
+  // gains as backends come and go are spread evenly over the others
+  //
+  std::vector<std::pair<std::uint64_t, std::size_t>> ring_;
+
+  mutable std::mutex         mtx_;
+  std::vector<backend_state> states_;
+  std::size_t                next_ = 0;
+};
+
+} // namespace foxy
+
+#endif // FOXY_BACKEND_POOL_HPP_
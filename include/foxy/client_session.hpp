@@ -53,6 +53,12 @@ template <class DynamicBuffer>
 struct basic_client_session : public basic_session<boost::asio::ip::tcp::socket, DynamicBuffer>
 {
 public:
+  // how long the last `async_connect` took to resolve the host and connect to it, and then to
+  // complete the TLS handshake, which stays zero for a plain connection
+  //
+  std::chrono::steady_clock::duration connect_time   = std::chrono::steady_clock::duration::zero();
+  std::chrono::steady_clock::duration handshake_time = std::chrono::steady_clock::duration::zero();
+
   basic_client_session()                            = delete;
   basic_client_session(basic_client_session const&) = delete;
   basic_client_session(basic_client_session&&)      = default;
@@ -77,6 +83,26 @@ public:
     typename boost::asio::async_result<std::decay_t<RequestHandler>,
                                        void(boost::system::error_code)>::return_type;
 
+  template <class Serializer, class InterimParser, class UploadHandler>
+  auto
+  async_upload_header(Serializer& serializer, InterimParser& parser, UploadHandler&& handler) & ->
+    typename boost::asio::async_result<std::decay_t<UploadHandler>,
+                                       void(boost::system::error_code, bool)>::return_type;
+
+  template <class Serializer, class UploadHandler>
+  auto
+  async_upload_chunk(Serializer&               serializer,
+                     boost::asio::const_buffer chunk,
+                     UploadHandler&&           handler) & ->
+    typename boost::asio::async_result<std::decay_t<UploadHandler>,
+                                       void(boost::system::error_code, std::size_t)>::return_type;
+
+  template <class Serializer, class UploadHandler>
+  auto
+  async_upload_finish(Serializer& serializer, UploadHandler&& handler) & ->
+    typename boost::asio::async_result<std::decay_t<UploadHandler>,
+                                       void(boost::system::error_code, std::size_t)>::return_type;
+
   template <class ShutdownHandler>
   auto
   async_shutdown(ShutdownHandler&& handler) & ->
@@ -97,6 +123,7 @@ using client_session = basic_client_session<
 
 #include <foxy/impl/client_session/async_connect.impl.hpp>
 #include <foxy/impl/client_session/async_request.impl.hpp>
+#include <foxy/impl/client_session/async_upload.impl.hpp>
 #include <foxy/impl/client_session/async_shutdown.impl.hpp>
 
 #endif // FOXY_CLIENT_SESSION_HPP_
@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DECODING_BODY_HPP_
+#define FOXY_DECODING_BODY_HPP_
+
+#include <foxy/error.hpp>
+#include <foxy/detail/content_decoder.hpp>
+
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/core/buffers_range.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/buffer_body.hpp>
+
+#include <boost/optional/optional.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace foxy
+{
+// accept_encoding advertises every Content-Encoding that `decoding_body` knows how to undo
+//
+template <class Fields>
+auto
+accept_encoding(boost::beast::http::header<true, Fields>& request) -> void
+{
+  request.set(boost::beast::http::field::accept_encoding, "gzip, deflate");
+}
+
+// decoding_body wraps the reader of another Body, transparently undoing a gzip or deflate
+// Content-Encoding as the coded octets arrive off the wire
+//
+// The coded body is never buffered, only a small window of decoded octets at a time, which is then
+// handed to the underlying Body's reader. Bodies with an unknown coding are read as-is and the
+// Content-Encoding of the message is left untouched either way
+//
+template <class Body>
+struct decoding_body
+{
+  static_assert(!std::is_same<Body, boost::beast::http::buffer_body>::value,
+                "the underlying Body must accept every octet it's given");
+
+  using value_type = typename Body::value_type;
+
+  class reader
+  {
+  private:
+    static constexpr std::size_t buffer_size = 16 * 1024;
+
+    typename Body::reader                    inner_;
+    boost::optional<detail::content_decoder> decoder_;
+    std::unique_ptr<unsigned char[]>         buffer_;
+    bool                                     has_body_ = false;
+
+    // Beast constructs the reader alongside the parser so the header hasn't been parsed yet, we
+    // hold onto it and only look at its Content-Encoding once the body begins
+    //
+    void const* header_;
+    auto (*content_coding_)(void const*) -> detail::content_coding;
+
+  public:
+    template <bool isRequest, class Fields>
+    explicit reader(boost::beast::http::header<isRequest, Fields>& header, value_type& body)
+      : inner_(header, body)
+      , header_(std::addressof(header))
+      , content_coding_([](void const* p) -> detail::content_coding {
+        auto const& h = *static_cast<boost::beast::http::header<isRequest, Fields> const*>(p);
+        return detail::parse_content_coding(h[boost::beast::http::field::content_encoding]);
+      })
+    {
+    }
+
+    auto
+    init(boost::optional<std::uint64_t> const& content_length, boost::system::error_code& ec)
+      -> void
+    {
+      auto const coding = content_coding_(header_);
+      if (coding != detail::content_coding::gzip && coding != detail::content_coding::deflate) {
+        return inner_.init(content_length, ec);
+      }
+
+      decoder_.emplace(coding);
+      buffer_ = std::make_unique<unsigned char[]>(buffer_size);
+
+      // the length of the coded body says nothing about the length of the decoded one
+      //
+      inner_.init(boost::none, ec);
+    }
+
+    template <class ConstBufferSequence>
+    auto
+    put(ConstBufferSequence const& buffers, boost::system::error_code& ec) -> std::size_t
+    {
+      if (!decoder_) { return inner_.put(buffers, ec); }
+
+      ec = {};
+
+      auto consumed = std::size_t{0};
+      for (auto const buffer : boost::beast::buffers_range_ref(buffers)) {
+        auto input = boost::asio::const_buffer(buffer);
+
+        while (true) {
+          auto produced = std::size_t{0};
+
+          auto const n = decoder_->decode(input, boost::asio::buffer(buffer_.get(), buffer_size),
+                                          produced, ec);
+
+          input += n;
+          consumed += n;
+          has_body_ = has_body_ || n > 0;
+
+          if (ec) { return consumed; }
+
+          if (produced > 0) {
+            inner_.put(boost::asio::const_buffer(buffer_.get(), produced), ec);
+            if (ec) { return consumed; }
+          }
+
+          // a full window means the inflater may still be holding onto output, even if we've
+          // given it all of our input
+          //
+          if (produced == buffer_size) { continue; }
+          if (input.size() == 0 || n == 0) { break; }
+        }
+      }
+
+      return consumed;
+    }
+
+    auto
+    finish(boost::system::error_code& ec) -> void
+    {
+      if (decoder_ && has_body_ && !decoder_->is_done()) {
+        ec = ::foxy::error::bad_content_encoding;
+        return;
+      }
+
+      inner_.finish(ec);
+    }
+  };
+};
+
+} // namespace foxy
+
+#endif // FOXY_DECODING_BODY_HPP_
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_BODY_FILTER_HPP_
+#define FOXY_DETAIL_BODY_FILTER_HPP_
+
+#include <boost/beast/http/message.hpp>
+
+#include <boost/asio/buffer.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+namespace foxy
+{
+namespace detail
+{
+// body_filter is the filter that leaves both messages of a relay alone, filters derive from it and
+// hide whichever of its member functions they need
+//
+// A relay shows its filter each header before it's sent on and each chunk of a body as it's read,
+// in the relay's own buffer. A filter may look at a chunk, edit it in place and return it or a part
+// of it, or return a buffer of its own when its output doesn't fit, which has to stay valid until
+// the filter is called again. `is_last` is set for the final chunk of a body, which may be empty,
+// so that a filter that holds data back can let go of it.
+//
+// A filter that changes how long a body is has to fix up the header, e.g. by removing its
+// Content-Length and making the body chunked.
+//
+struct body_filter
+{
+  auto
+  on_request_header(boost::beast::http::request_header<>&) -> void
+  {
+  }
+
+  auto
+  on_request_body(boost::asio::mutable_buffer chunk, bool) -> boost::asio::mutable_buffer
+  {
+    return chunk;
+  }
+
+  auto
+  on_response_header(boost::beast::http::response_header<>&) -> void
+  {
+  }
+
+  auto
+  on_response_body(boost::asio::mutable_buffer chunk, bool) -> boost::asio::mutable_buffer
+  {
+    return chunk;
+  }
+};
+
+// body_filter_chain runs its filters in order, each one seeing what the one before it returned
+//
+template <class... Filters>
+struct body_filter_chain
+{
+private:
+  using index_sequence = std::index_sequence_for<Filters...>;
+
+  std::tuple<Filters...> filters_;
+
+  template <std::size_t... Is>
+  auto
+  request_header(boost::beast::http::request_header<>& header, std::index_sequence<Is...>) -> void
+  {
+    using expand = int[];
+    (void)expand{0, (std::get<Is>(filters_).on_request_header(header), 0)...};
+  }
+
+  template <std::size_t... Is>
+  auto
+  request_body(boost::asio::mutable_buffer chunk, bool is_last, std::index_sequence<Is...>)
+    -> boost::asio::mutable_buffer
+  {
+    using expand = int[];
+    (void)expand{0, (chunk = std::get<Is>(filters_).on_request_body(chunk, is_last), 0)...};
+    return chunk;
+  }
+
+  template <std::size_t... Is>
+  auto
+  response_header(boost::beast::http::response_header<>& header, std::index_sequence<Is...>)
+    -> void
+  {
+    using expand = int[];
+    (void)expand{0, (std::get<Is>(filters_).on_response_header(header), 0)...};
+  }
+
+  template <std::size_t... Is>
+  auto
+  response_body(boost::asio::mutable_buffer chunk, bool is_last, std::index_sequence<Is...>)
+    -> boost::asio::mutable_buffer
+  {
+    using expand = int[];
+    (void)expand{0, (chunk = std::get<Is>(filters_).on_response_body(chunk, is_last), 0)...};
+    return chunk;
+  }
+
+public:
+  body_filter_chain() = default;
+
+  explicit body_filter_chain(Filters... filters)
+    : filters_(std::move(filters)...)
+  {
+  }
+
+  template <std::size_t I>
+  auto
+  get() & -> std::tuple_element_t<I, std::tuple<Filters...>>&
+  {
+    return std::get<I>(filters_);
+  }
+
+  auto
+  on_request_header(boost::beast::http::request_header<>& header) -> void
+  {
+    request_header(header, index_sequence{});
+  }
+
+  auto
+  on_request_body(boost::asio::mutable_buffer chunk, bool is_last) -> boost::asio::mutable_buffer
+  {
+    return request_body(chunk, is_last, index_sequence{});
+  }
+
+  auto
+  on_response_header(boost::beast::http::response_header<>& header) -> void
+  {
+    response_header(header, index_sequence{});
+  }
+
+  auto
+  on_response_body(boost::asio::mutable_buffer chunk, bool is_last) -> boost::asio::mutable_buffer
+  {
+    return response_body(chunk, is_last, index_sequence{});
+  }
+};
+
+template <class... Filters>
+auto
+make_body_filter_chain(Filters... filters) -> body_filter_chain<Filters...>
+{
+  return body_filter_chain<Filters...>(std::move(filters)...);
+}
+
+// body_byte_counter counts the body bytes a relay reads in each direction
+//
+struct body_byte_counter : body_filter
+{
+  std::uint64_t request_bytes  = 0;
+  std::uint64_t response_bytes = 0;
+
+  auto
+  on_request_body(boost::asio::mutable_buffer chunk, bool) -> boost::asio::mutable_buffer
+  {
+    request_bytes += chunk.size();
+    return chunk;
+  }
+
+  auto
+  on_response_body(boost::asio::mutable_buffer chunk, bool) -> boost::asio::mutable_buffer
+  {
+    response_bytes += chunk.size();
+    return chunk;
+  }
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_BODY_FILTER_HPP_
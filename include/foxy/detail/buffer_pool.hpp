@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_BUFFER_POOL_HPP_
+#define FOXY_DETAIL_BUFFER_POOL_HPP_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace foxy
+{
+namespace detail
+{
+struct buffer_pool;
+
+// pooled_buffer is a move-only handle to a block of memory borrowed from a `buffer_pool`, the
+// block is handed back to the pool when the handle is destroyed or assigned to
+//
+struct pooled_buffer
+{
+private:
+  buffer_pool* pool_ = nullptr;
+  char*        data_ = nullptr;
+  std::size_t  size_ = 0;
+
+  friend struct buffer_pool;
+
+  pooled_buffer(buffer_pool* pool, char* data, std::size_t size) noexcept;
+
+public:
+  pooled_buffer() = default;
+
+  pooled_buffer(pooled_buffer const&) = delete;
+  pooled_buffer(pooled_buffer&& other) noexcept;
+
+  ~pooled_buffer();
+
+  auto
+  operator=(pooled_buffer const&) -> pooled_buffer& = delete;
+
+  auto
+  operator=(pooled_buffer&& other) noexcept -> pooled_buffer&;
+
+  auto
+  data() const noexcept -> char*
+  {
+    return data_;
+  }
+
+  auto
+  size() const noexcept -> std::size_t
+  {
+    return size_;
+  }
+};
+
+// buffer_pool hands out buffers in power-of-two size classes and keeps a bounded number of
+// released buffers of each class around for reuse
+//
+// Requests larger than the biggest class are allocated and freed directly
+//
+// The global pool also keeps a few buffers of each class in a cache per thread, in front of its
+// shared free lists, so the relays of different threads don't all contend on one lock. A thread's
+// cache goes back to the shared free lists when the thread exits
+//
+struct buffer_pool
+{
+public:
+  static constexpr std::size_t min_class_log2 = 10;
+  static constexpr std::size_t max_class_log2 = 20;
+
+  buffer_pool() = default;
+
+  buffer_pool(buffer_pool const&) = delete;
+  buffer_pool(buffer_pool&&)      = delete;
+
+  explicit buffer_pool(std::size_t max_cached_per_class);
+
+  // acquire returns a buffer at least `size` bytes large
+  //
+  auto
+  acquire(std::size_t size) -> pooled_buffer;
+
+  // global is the pool shared by every relay in the process
+  //
+  static auto
+  global() -> buffer_pool&;
+
+private:
+  friend struct pooled_buffer;
+
+  struct thread_cache;
+
+  static constexpr std::size_t num_classes       = max_class_log2 - min_class_log2 + 1;
+  static constexpr std::size_t max_thread_cached = 4;
+
+  // local_cache is null once the calling thread's cache has been destroyed
+  //
+  static auto
+  local_cache() noexcept -> thread_cache*;
+
+  auto
+  release(char* data, std::size_t size) noexcept -> void;
+
+  auto
+  release_shared(std::size_t idx, std::unique_ptr<char[]> buffer) noexcept -> void;
+
+  std::size_t max_cached_       = 16;
+  bool        is_thread_cached_ = false;
+
+  std::mutex                                                     mtx_;
+  std::array<std::vector<std::unique_ptr<char[]>>, num_classes> free_;
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_BUFFER_POOL_HPP_
@@ -39,6 +39,24 @@ close(Stream& stream)
   stream.close(ec);
 }
 
+// cancel aborts every pending operation on the stream, streams that can't be cancelled are closed
+// instead
+//
+template <class Stream, std::enable_if_t<is_cancelable_stream<Stream>::value, int> = 0>
+auto
+cancel(Stream& stream)
+{
+  auto ec = boost::system::error_code();
+  stream.cancel(ec);
+}
+
+template <class Stream, std::enable_if_t<!is_cancelable_stream<Stream>::value, int> = 0>
+auto
+cancel(Stream& stream)
+{
+  close(stream);
+}
+
 } // namespace detail
 } // namespace foxy
 
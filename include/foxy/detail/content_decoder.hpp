@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_CONTENT_DECODER_HPP_
+#define FOXY_DETAIL_CONTENT_DECODER_HPP_
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/zlib/inflate_stream.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/crc.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace foxy
+{
+namespace detail
+{
+enum class content_coding {
+  identity,
+  gzip,
+  deflate,
+
+  // a coding we don't know how to undo, the body is handed to the user as-is
+  //
+  unknown
+};
+
+// parse_content_coding maps the value of a Content-Encoding field to the single coding it applies
+//
+auto
+parse_content_coding(boost::string_view value) -> content_coding;
+
+// content_decoder incrementally undoes a gzip (RFC 1952) or deflate (RFC 1950) coding, accepting
+// its input in arbitrarily small pieces
+//
+// Servers are notorious for sending raw deflate streams as "deflate" so the zlib wrapper is only
+// expected when the first two octets form a valid zlib header
+//
+struct content_decoder
+{
+public:
+  content_decoder()                       = delete;
+  content_decoder(content_decoder const&) = delete;
+  content_decoder(content_decoder&&)      = default;
+
+  explicit content_decoder(content_coding coding);
+
+  // decode consumes octets from `input` and writes as many decoded octets into `output` as there is
+  // room for, returning the number of octets consumed
+  //
+  // `produced` is set to the number of decoded octets written into `output`
+  //
+  auto
+  decode(boost::asio::const_buffer   input,
+         boost::asio::mutable_buffer output,
+         std::size_t&                produced,
+         boost::system::error_code&  ec) -> std::size_t;
+
+  // is_done returns whether or not the entire coded stream, including its trailer, has been decoded
+  //
+  auto
+  is_done() const noexcept -> bool;
+
+private:
+  enum class state {
+    gzip_header,
+    gzip_extra_length,
+    gzip_extra,
+    gzip_name,
+    gzip_comment,
+    gzip_header_crc,
+    zlib_header,
+    body,
+    trailer,
+    done
+  };
+
+  auto
+  on_decoded(unsigned char const* data, std::size_t size) -> void;
+
+  auto
+  on_trailer(boost::system::error_code& ec) -> void;
+
+  boost::beast::zlib::inflate_stream inflater_;
+  content_coding                     coding_;
+  state                              state_;
+
+  std::array<unsigned char, 10> scratch_;
+  std::size_t                   scratch_size_ = 0;
+  std::size_t                   skip_         = 0;
+  unsigned char                 flags_        = 0;
+
+  // the running checksums and length of the decoded octets, used to validate the trailer
+  //
+  boost::crc_32_type crc_;
+  std::uint32_t      adler_a_ = 1;
+  std::uint32_t      adler_b_ = 0;
+  std::uint32_t      length_  = 0;
+
+  // whether or not a deflate stream came with its zlib header and trailer
+  //
+  bool has_zlib_ = false;
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_CONTENT_DECODER_HPP_
@@ -12,18 +12,12 @@
 
 #include <boost/beast/http/field.hpp>
 #include <boost/beast/http/fields.hpp>
-#include <boost/beast/http/type_traits.hpp>
-
 #include <boost/beast/http/rfc7230.hpp>
 
-#include <boost/utility/string_view.hpp>
-#include <boost/range/algorithm.hpp>
+#include <boost/beast/core/string.hpp>
 
-#include <type_traits>
-#include <array>
-#include <vector>
-#include <memory>
-#include <iterator>
+#include <boost/container/small_vector.hpp>
+#include <boost/utility/string_view.hpp>
 
 namespace foxy
 {
@@ -48,6 +42,32 @@ void
 export_connect_fields(boost::beast::http::basic_fields<Allocator>& src,
                       boost::beast::http::basic_fields<Allocator>& dst);
 
+// is_hop_by_hop is true for the fields that are always hop-by-hop, listed in Connection or not
+//
+inline auto
+is_hop_by_hop(boost::beast::http::field const name) noexcept -> bool
+{
+  namespace http = boost::beast::http;
+
+  switch (name) {
+    case http::field::connection:
+    case http::field::keep_alive:
+    case http::field::proxy_authenticate:
+    case http::field::proxy_authentication_info:
+    case http::field::proxy_authorization:
+    case http::field::proxy_connection:
+    case http::field::proxy_features:
+    case http::field::proxy_instruction:
+    case http::field::te:
+    case http::field::trailer:
+    case http::field::transfer_encoding:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
 } // namespace detail
 } // namespace foxy
 
@@ -57,56 +77,22 @@ foxy::detail::export_connect_fields(boost::beast::http::basic_fields<Allocator>&
                                     boost::beast::http::basic_fields<Allocator>& dst)
 {
   namespace http  = boost::beast::http;
-  namespace range = boost::range;
+  namespace beast = boost::beast;
 
-  using string_type =
-    std::basic_string<char, std::char_traits<char>,
-                      typename std::allocator_traits<Allocator>::template rebind_alloc<char>>;
-
-  // first collect all the Connection options into one coherent list
+  // the Connection options are views into `src`'s own Connection fields which is why those are
+  // only erased once everything else has been moved, a message rarely names more than a handful of
+  // options so they're kept on the stack
   //
-  auto connect_opts =
-    std::vector<string_type,
-                typename std::allocator_traits<Allocator>::template rebind_alloc<string_type>>(
-      src.get_allocator());
-
-  connect_opts.reserve(128);
+  auto connect_opts = boost::container::small_vector<boost::string_view, 16>();
 
   auto const connect_fields = src.equal_range(http::field::connection);
-  auto       out            = std::back_inserter(connect_opts);
-
-  range::for_each(connect_fields, [&src, out](auto const& connect_field) {
-    range::transform(
-      http::token_list(connect_field.value()), out, [&src](auto const token_view) -> string_type {
-        return string_type(token_view.begin(), token_view.end(), src.get_allocator());
-      });
-  });
-
-  range::sort(connect_opts);
-  range::unique(connect_opts);
-
-  // iterate the `src` fields, moving any connect headers and the corresponding tokens to the `dst`
-  // fields
-  //
-  auto const hop_by_hops = std::array<http::field, 11>{http::field::connection,
-                                                       http::field::keep_alive,
-                                                       http::field::proxy_authenticate,
-                                                       http::field::proxy_authentication_info,
-                                                       http::field::proxy_authorization,
-                                                       http::field::proxy_connection,
-                                                       http::field::proxy_features,
-                                                       http::field::proxy_instruction,
-                                                       http::field::te,
-                                                       http::field::trailer,
-                                                       http::field::transfer_encoding};
-
-  auto const is_connect_opt =
-    [&connect_opts,
-     &hop_by_hops](typename http::basic_fields<Allocator>::value_type const& field) -> bool {
-    if (range::find(hop_by_hops, field.name()) != hop_by_hops.end()) { return true; }
+  for (auto it = connect_fields.first; it != connect_fields.second; ++it) {
+    for (auto const token : http::token_list(it->value())) { connect_opts.push_back(token); }
+  }
 
+  auto const is_connect_opt = [&connect_opts](boost::string_view const name) -> bool {
     for (auto const opt : connect_opts) {
-      if (field.name_string() == opt) { return true; }
+      if (beast::iequals(name, opt)) { return true; }
     }
     return false;
   };
@@ -114,7 +100,14 @@ foxy::detail::export_connect_fields(boost::beast::http::basic_fields<Allocator>&
   for (auto it = src.begin(); it != src.end();) {
     auto const& field = *it;
 
-    if (!is_connect_opt(field)) {
+    if (field.name() == http::field::connection) {
+      dst.insert(http::field::connection, field.value());
+      ++it;
+      continue;
+    }
+
+    if (!is_hop_by_hop(field.name()) &&
+        (connect_opts.empty() || !is_connect_opt(field.name_string()))) {
       ++it;
       continue;
     }
@@ -122,6 +115,8 @@ foxy::detail::export_connect_fields(boost::beast::http::basic_fields<Allocator>&
     dst.insert(field.name_string(), field.value());
     it = src.erase(it);
   }
+
+  src.erase(http::field::connection);
 }
 
 #endif // FOXY_DETAIL_EXPORT_CONNECT_FIELDS_HPP_
@@ -15,38 +15,39 @@
 
 #include <boost/utility/string_view.hpp>
 
-#include <boost/spirit/home/x3.hpp>
-
 #include <algorithm>
-#include <numeric>
 
 namespace foxy
 {
 namespace detail
 {
+// has_foxy_via is true when any Via field names us, i.e. the message has already been through a
+// foxy relay and forwarding it again would loop
+//
 template <class Allocator>
 auto
 has_foxy_via(boost::beast::http::basic_fields<Allocator> const& fields) -> bool
 {
   namespace http = boost::beast::http;
-  namespace x3   = boost::spirit::x3;
 
-  auto const field_range = fields.equal_range(http::field::via);
+  auto const foxy = boost::string_view("1.1 foxy");
 
-  auto       begin = field_range.first;
-  auto const end   = field_range.second;
+  auto const to_lower = [](char const c) -> char {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+  };
 
-  auto found = false;
-  for (; begin != end; ++begin) {
-    auto       field_val_iter = begin->value().begin();
-    auto const field_val_end  = begin->value().end();
+  auto const field_range = fields.equal_range(http::field::via);
+  for (auto it = field_range.first; it != field_range.second; ++it) {
+    auto const value = it->value();
 
-    found = x3::parse(field_val_iter, field_val_end,
-                      x3::no_case[*(x3::char_ - "1.1 foxy") >> x3::lit("1.1 foxy") >> *x3::char_]);
+    auto const pos = std::search(value.begin(), value.end(), foxy.begin(), foxy.end(),
+                                 [&to_lower](char const lhs, char const rhs) -> bool {
+                                   return to_lower(lhs) == rhs;
+                                 });
 
-    if (found) { break; }
+    if (pos != value.end()) { return true; }
   }
-  return found;
+  return false;
 }
 
 } // namespace detail
@@ -0,0 +1,49 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_JSON_STRING_HPP_
+#define FOXY_DETAIL_JSON_STRING_HPP_
+
+#include <boost/utility/string_view.hpp>
+
+#include <string>
+
+namespace foxy
+{
+namespace detail
+{
+// append_json_string appends `str` to `out` as a quoted JSON string, control characters are
+// written as \u escapes and everything else, UTF-8 included, is passed through as is
+//
+inline auto
+append_json_string(std::string& out, boost::string_view const str) -> void
+{
+  static char const hex[] = "0123456789abcdef";
+
+  out += '"';
+  for (auto const c : str) {
+    auto const uc = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (uc < 0x20 || uc == 0x7f) {
+      out += "\\u00";
+      out += hex[uc >> 4];
+      out += hex[uc & 0xf];
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_JSON_STRING_HPP_
@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_OP_TIMER_HPP_
+#define FOXY_DETAIL_OP_TIMER_HPP_
+
+#include <foxy/session_op.hpp>
+#include <foxy/session_opts.hpp>
+#include <foxy/session_histograms.hpp>
+#include <foxy/session_errors.hpp>
+#include <foxy/tracer.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace foxy
+{
+namespace detail
+{
+// every session gets an id of its own when it's constructed, for tracers to tell them apart
+//
+inline auto
+next_session_id() noexcept -> std::uint64_t
+{
+  static std::atomic<std::uint64_t> ids{0};
+  return ids.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// op_timer times a single session operation for the session's `histograms` and `tracer`, it's
+// started when the operation is initiated and stopped right before the operation completes
+//
+// The clock is only read when the session has either of them. Building with both
+// FOXY_NO_SESSION_HISTOGRAMS and FOXY_NO_SESSION_TRACING leaves an empty struct behind so the
+// sessions don't pay for any of it.
+//
+#if defined(FOXY_NO_SESSION_HISTOGRAMS) && defined(FOXY_NO_SESSION_TRACING)
+
+struct op_timer
+{
+  op_timer(::foxy::session_opts const&, ::foxy::session_op, std::uint64_t) noexcept {}
+
+  template <class Session>
+  op_timer(Session& session, ::foxy::session_op const op) noexcept
+  {
+    session.current_op = op;
+  }
+
+  auto
+  stop(::foxy::session_opts const&, std::size_t = 0, boost::system::error_code = {}) const noexcept
+    -> void
+  {
+  }
+};
+
+#else
+
+struct op_timer
+{
+  std::chrono::steady_clock::time_point started;
+  std::uint64_t                         session;
+  ::foxy::session_op                    op;
+
+  op_timer(::foxy::session_opts const& opts,
+           ::foxy::session_op const    op_,
+           std::uint64_t const         session_)
+    : session(session_)
+    , op(op_)
+  {
+    if (!is_observed(opts)) { return; }
+
+    started = std::chrono::steady_clock::now();
+
+#if !defined(FOXY_NO_SESSION_TRACING)
+    if (opts.tracer) { opts.tracer->on_start(op, session); }
+#endif
+  }
+
+  // timing an operation of `session` also makes it the session's `current_op`
+  //
+  template <class Session>
+  op_timer(Session& session_, ::foxy::session_op const op_)
+    : op_timer(session_.opts, op_, session_.id)
+  {
+    session_.current_op = op_;
+  }
+
+  auto
+  stop(::foxy::session_opts const& opts,
+       std::size_t const           bytes = 0,
+       boost::system::error_code   ec    = {}) const -> void
+  {
+    if (!is_observed(opts)) { return; }
+
+#if !defined(FOXY_NO_SESSION_HISTOGRAMS)
+    if (opts.histograms) {
+      opts.histograms->record(op, std::chrono::steady_clock::now() - started, bytes);
+    }
+#endif
+
+#if !defined(FOXY_NO_SESSION_TRACING)
+    // a read that only filled its buffer didn't fail
+    //
+    if (opts.tracer) {
+      opts.tracer->on_end(op, session, started, bytes,
+                          ::foxy::is_failure(ec) ? ec : boost::system::error_code());
+    }
+#endif
+  }
+
+  static auto
+  is_observed(::foxy::session_opts const& opts) noexcept -> bool
+  {
+#if defined(FOXY_NO_SESSION_HISTOGRAMS)
+    return static_cast<bool>(opts.tracer);
+#elif defined(FOXY_NO_SESSION_TRACING)
+    return static_cast<bool>(opts.histograms);
+#else
+    return opts.histograms || opts.tracer;
+#endif
+  }
+};
+
+#endif
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_OP_TIMER_HPP_
@@ -0,0 +1,238 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_RAW_TUNNEL_HPP_
+#define FOXY_DETAIL_RAW_TUNNEL_HPP_
+
+#include <foxy/client_session.hpp>
+#include <foxy/server_session.hpp>
+#include <foxy/session_opts.hpp>
+#include <foxy/detail/buffer_pool.hpp>
+#include <foxy/detail/transfer_stats.hpp>
+#include <foxy/detail/tunnel_limits.hpp>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <boost/beast/core/async_base.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+
+namespace foxy
+{
+namespace detail
+{
+// raw_tunnel shovels opaque bytes between two plain sockets in both directions until both sides
+// have closed
+//
+// On Linux the bytes are moved with splice(2) through a pipe per direction so they never enter
+// userspace, elsewhere they are copied through a pooled buffer
+//
+// When one side sends EOF, the write half of the other side is shut down and the opposite direction
+// keeps going. The tunnel is torn down once every direction that's still open has gone
+// `session_opts::tunnel_idle_timeout` without moving a byte, when it falls below
+// `session_opts::tunnel_min_rate` or when the connection it belongs to expires.
+//
+struct raw_tunnel : std::enable_shared_from_this<raw_tunnel>
+{
+public:
+  using socket_type = boost::asio::ip::tcp::socket;
+  using clock_type  = std::chrono::steady_clock;
+
+private:
+  struct direction
+  {
+    socket_type* in  = nullptr;
+    socket_type* out = nullptr;
+
+    // a direction uses the pipe when it could be opened and falls back to the buffer otherwise
+    //
+    std::array<int, 2> pipe       = {{-1, -1}};
+    std::size_t        pipe_bytes = 0;
+    pooled_buffer      buffer;
+
+    clock_type::time_point last_active;
+
+    bool done = false;
+  };
+
+  boost::asio::strand<boost::asio::any_io_executor> strand_;
+  boost::asio::steady_timer                         timer_;
+
+  boost::beast::flat_buffer& preamble_;
+
+  std::array<direction, 2> directions_;
+
+  std::size_t               chunk_size_;
+  clock_type::duration      idle_timeout_;
+  clock_type::time_point    expires_;
+  rate_meter                meter_;
+  transfer_stats*           stats_;
+  boost::system::error_code ec_;
+
+  auto
+  start() -> void;
+
+  auto
+  pump(direction& d) -> void;
+
+  auto
+  splice_in(direction& d, boost::system::error_code ec) -> void;
+
+  auto
+  splice_out(direction& d, boost::system::error_code ec) -> void;
+
+  auto
+  on_read(direction& d, boost::system::error_code ec, std::size_t bytes_transferred) -> void;
+
+  auto
+  on_write(direction& d, boost::system::error_code ec) -> void;
+
+  auto
+  finish_direction(direction& d, boost::system::error_code ec) -> void;
+
+  auto
+  count(direction const& d, std::size_t bytes) -> void;
+
+  auto
+  wait_idle() -> void;
+
+  auto
+  on_idle_timer(boost::system::error_code ec) -> void;
+
+protected:
+  virtual auto
+  on_finish(boost::system::error_code ec) -> void = 0;
+
+public:
+  raw_tunnel()                  = delete;
+  raw_tunnel(raw_tunnel const&) = delete;
+  raw_tunnel(raw_tunnel&&)      = delete;
+
+  // `preamble` holds bytes the server has already buffered past the CONNECT request, they are
+  // forwarded to the client before anything else
+  //
+  // `stats`, when it's not null, counts the bytes moved in each direction
+  //
+  raw_tunnel(socket_type&               server,
+             socket_type&               client,
+             boost::beast::flat_buffer& preamble,
+             session_opts const&        opts,
+             clock_type::time_point     expires = (clock_type::time_point::max)(),
+             transfer_stats*            stats   = nullptr);
+
+  virtual ~raw_tunnel();
+
+  auto
+  run() -> void;
+};
+
+template <class Handler>
+struct raw_tunnel_op final : raw_tunnel
+{
+private:
+  boost::beast::async_base<Handler, typename ::foxy::session::executor_type> base_;
+
+protected:
+  auto
+  on_finish(boost::system::error_code ec) -> void override
+  {
+    base_.complete(false, ec);
+  }
+
+public:
+  raw_tunnel_op(Handler                 handler,
+                ::foxy::server_session& server,
+                ::foxy::client_session& client,
+                clock_type::time_point  expires,
+                transfer_stats*         stats)
+    : raw_tunnel(server.stream.plain(),
+                 client.stream.plain(),
+                 server.buffer,
+                 client.opts,
+                 expires,
+                 stats)
+    , base_(std::move(handler), server.get_executor())
+  {
+  }
+};
+
+struct run_async_raw_tunnel_op
+{
+  template <class Handler>
+  auto
+  operator()(Handler&&                          handler,
+             ::foxy::server_session&            server,
+             ::foxy::client_session&            client,
+             raw_tunnel::clock_type::time_point expires,
+             transfer_stats*                    stats = nullptr) -> void
+  {
+    std::make_shared<raw_tunnel_op<std::decay_t<Handler>>>(std::forward<Handler>(handler), server,
+                                                           client, expires, stats)
+      ->run();
+  }
+};
+
+// async_raw_tunnel requires that neither session is using TLS
+//
+template <class CompletionToken>
+auto
+async_raw_tunnel(::foxy::server_session& server,
+                 ::foxy::client_session& client,
+                 CompletionToken&&       token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code)>(
+    run_async_raw_tunnel_op{}, token, server, client,
+    (raw_tunnel::clock_type::time_point::max)());
+}
+
+// this overload tears the tunnel down at `expires` no matter how busy it is
+//
+template <class CompletionToken>
+auto
+async_raw_tunnel(::foxy::server_session&            server,
+                 ::foxy::client_session&            client,
+                 raw_tunnel::clock_type::time_point expires,
+                 CompletionToken&&                  token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code)>(
+    run_async_raw_tunnel_op{}, token, server, client, expires);
+}
+
+// this overload also counts the bytes the tunnel moves in `stats`
+//
+template <class CompletionToken>
+auto
+async_raw_tunnel(::foxy::server_session&            server,
+                 ::foxy::client_session&            client,
+                 raw_tunnel::clock_type::time_point expires,
+                 transfer_stats*                    stats,
+                 CompletionToken&&                  token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code)>(
+    run_async_raw_tunnel_op{}, token, server, client, expires, stats);
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_RAW_TUNNEL_HPP_
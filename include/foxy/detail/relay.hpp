@@ -13,7 +13,14 @@
 #include <foxy/session.hpp>
 #include <foxy/type_traits.hpp>
 #include <foxy/detail/export_connect_fields.hpp>
+#include <foxy/detail/body_filter.hpp>
 #include <foxy/detail/has_token.hpp>
+#include <foxy/detail/op_timer.hpp>
+#include <foxy/detail/buffer_pool.hpp>
+#include <foxy/detail/close_stream.hpp>
+#include <foxy/detail/relay_tap.hpp>
+#include <foxy/detail/transfer_stats.hpp>
+#include <foxy/detail/tunnel_limits.hpp>
 
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/parser.hpp>
@@ -22,16 +29,30 @@
 #include <boost/beast/http/buffer_body.hpp>
 #include <boost/beast/http/empty_body.hpp>
 #include <boost/beast/http/error.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/write.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/optional/optional.hpp>
 
 #include <boost/system/error_code.hpp>
 
-#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 
 namespace foxy
 {
 namespace detail
 {
-template <class Stream, class DynamicBuffer, class RelayHandler>
+// BodyFilter may be a reference type, in which case the caller's filter is used as is and has to
+// outlive the relay
+//
+template <class Stream, class DynamicBuffer, class RelayHandler, class BodyFilter = body_filter>
 struct relay_op : boost::beast::stable_async_base<
                     RelayHandler,
                     typename ::foxy::basic_session<Stream, DynamicBuffer>::executor_type>,
@@ -52,7 +73,9 @@ struct relay_op : boost::beast::stable_async_base<
 
   struct state
   {
-    std::array<char, 2048> buffer;
+    pooled_buffer req_buffer;
+    pooled_buffer res_buffer;
+    std::size_t   max_buffer_size;
 
     parser<true, buffer_body>             req_parser;
     serializer<true, buffer_body, fields> req_sr;
@@ -66,28 +89,164 @@ struct relay_op : boost::beast::stable_async_base<
 
     boost::system::error_code ec;
 
+    // only used when relaying full-duplex, `join` never expires on its own and is cancelled by the
+    // request pump once it's done
+    //
+    boost::optional<boost::asio::steady_timer> join;
+    boost::system::error_code                  req_ec;
+
+    // how much the last reads put in the buffers, which the filter may have trimmed or replaced
+    //
+    std::size_t req_read = 0;
+    std::size_t res_read = 0;
+
+    bool is_duplex     = false;
+    bool req_done      = true;
+    bool req_abandoned = false;
+
+    relay_tap*      tap   = nullptr;
+    transfer_stats* stats = nullptr;
+
+    BodyFilter filter;
+
+    // body chunks in both directions count towards the minimum transfer rate of the tunnel
+    //
+    rate_meter meter;
+
+    // the relay as a whole is a span of its own, traced under the session of the client that sent
+    // the request
+    //
+    op_timer      span;
+    std::uint64_t body_bytes = 0;
+
     bool close_tunnel;
 
-    state()
-      : req_sr(req_parser.get())
+    state(::foxy::session_opts const& opts, std::uint64_t const session, BodyFilter filter_)
+      : req_buffer(buffer_pool::global().acquire(opts.relay_buffer_min))
+      , res_buffer(buffer_pool::global().acquire(opts.relay_buffer_min))
+      , max_buffer_size((std::max)(opts.relay_buffer_min, opts.relay_buffer_max))
+      , req_sr(req_parser.get())
       , req(req_parser.get())
       , res_sr(res_parser.get())
       , res(res_parser.get())
+      , filter(std::forward<BodyFilter>(filter_))
+      , meter(opts.tunnel_min_rate, opts.tunnel_rate_window)
+      , span(opts, ::foxy::session_op::relay, session)
       , close_tunnel{false}
     {
+      set_body_limits();
     }
 
-    state(parser<true, empty_body>&& req_parser_)
-      : req_parser(std::move(req_parser_))
+    state(::foxy::session_opts const& opts,
+          std::uint64_t const         session,
+          parser<true, empty_body>&&  req_parser_,
+          relay_tap*                  tap_,
+          BodyFilter                  filter_)
+      : req_buffer(buffer_pool::global().acquire(opts.relay_buffer_min))
+      , res_buffer(buffer_pool::global().acquire(opts.relay_buffer_min))
+      , max_buffer_size((std::max)(opts.relay_buffer_min, opts.relay_buffer_max))
+      , req_parser(std::move(req_parser_))
       , req_sr(req_parser.get())
       , req(req_parser.get())
       , res_sr(res_parser.get())
       , res(res_parser.get())
+      , tap(tap_)
+      , filter(std::forward<BodyFilter>(filter_))
+      , meter(opts.tunnel_min_rate, opts.tunnel_rate_window)
+      , span(opts, ::foxy::session_op::relay, session)
       , close_tunnel{false}
     {
+      set_body_limits();
+    }
+
+    // a relay has no business capping how large the messages it forwards are
+    //
+    auto
+    set_body_limits() -> void
+    {
+      req_parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+      res_parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+    }
+
+    // a read that fills the buffer is a sign of a large transfer so the next read is given twice
+    // the room, this is only safe to call once the previous chunk has been written out
+    //
+    auto
+    grow_buffer(pooled_buffer& buffer, std::size_t const bytes_read) -> void
+    {
+      if (bytes_read < buffer.size() || buffer.size() >= max_buffer_size) { return; }
+      buffer = buffer_pool::global().acquire((std::min)(buffer.size() * 2, max_buffer_size));
+    }
+
+    // the filter sees each chunk where it was read and the message's body is pointed at whatever
+    // it hands back, which only costs a copy when the filter rewrites the chunk somewhere else
+    //
+    // A filter that hands back nothing is holding data back, the body's data is nulled so the
+    // serializer asks for the next chunk instead of writing an empty one, which would end a
+    // chunked body early.
+    //
+    auto
+    filter_request_body() -> void
+    {
+      auto const chunk = filter.on_request_body(
+        boost::asio::mutable_buffer(req.body().data, req.body().size), !req.body().more);
+
+      req.body().data = chunk.size() > 0 ? chunk.data() : nullptr;
+      req.body().size = chunk.size();
+    }
+
+    auto
+    filter_response_body() -> void
+    {
+      auto const chunk = filter.on_response_body(
+        boost::asio::mutable_buffer(res.body().data, res.body().size), !res.body().more);
+
+      res.body().data = chunk.size() > 0 ? chunk.data() : nullptr;
+      res.body().size = chunk.size();
     }
   };
 
+  // request_pump forwards the request body upstream while the relay op itself is busy with the
+  // response
+  //
+  // It uses Beast's untimed operations directly because a session only has the one timer and the
+  // relay op's own reads and writes are already using it
+  //
+  struct request_pump : boost::asio::coroutine
+  {
+    using executor_type = typename relay_op::executor_type;
+
+    ::foxy::basic_session<Stream, DynamicBuffer>& server;
+    ::foxy::basic_session<Stream, DynamicBuffer>& client;
+    state&                                        s;
+    executor_type                                 executor;
+    boost::system::error_code                     read_ec;
+
+    request_pump(::foxy::basic_session<Stream, DynamicBuffer>& server_,
+                 ::foxy::basic_session<Stream, DynamicBuffer>& client_,
+                 state&                                        s_,
+                 executor_type                                 executor_)
+      : server(server_)
+      , client(client_)
+      , s(s_)
+      , executor(std::move(executor_))
+    {
+    }
+
+    auto
+    get_executor() const noexcept -> executor_type
+    {
+      return executor;
+    }
+
+    auto
+    operator()(boost::system::error_code ec = {}, std::size_t const bytes_transferred = 0) -> void;
+  };
+
+  struct on_join_t
+  {
+  };
+
   ::foxy::basic_session<Stream, DynamicBuffer>& server;
   ::foxy::basic_session<Stream, DynamicBuffer>& client;
   state&                                        s;
@@ -99,7 +258,9 @@ public:
 
   relay_op(::foxy::basic_session<Stream, DynamicBuffer>& server_,
            RelayHandler                                  handler,
-           ::foxy::basic_session<Stream, DynamicBuffer>& client_)
+           ::foxy::basic_session<Stream, DynamicBuffer>& client_,
+           transfer_stats*                               stats,
+           BodyFilter                                    filter)
     : boost::beast::stable_async_base<
         RelayHandler,
         typename ::foxy::basic_session<Stream, DynamicBuffer>::executor_type>(
@@ -107,15 +268,22 @@ public:
         server_.get_executor())
     , server(server_)
     , client(client_)
-    , s(boost::beast::allocate_stable<state>(*this))
+    , s(boost::beast::allocate_stable<state>(*this,
+                                             client_.opts,
+                                             server_.id,
+                                             std::forward<BodyFilter>(filter)))
   {
+    s.stats = stats;
     (*this)({}, 0, false);
   }
 
   relay_op(::foxy::basic_session<Stream, DynamicBuffer>& server_,
            RelayHandler                                  handler,
            ::foxy::basic_session<Stream, DynamicBuffer>& client_,
-           parser<true, empty_body>&&                    req_parser)
+           parser<true, empty_body>&&                    req_parser,
+           relay_tap*                                    tap,
+           transfer_stats*                               stats,
+           BodyFilter                                    filter)
     : boost::beast::stable_async_base<
         RelayHandler,
         typename ::foxy::basic_session<Stream, DynamicBuffer>::executor_type>(
@@ -123,22 +291,123 @@ public:
         server_.get_executor())
     , server(server_)
     , client(client_)
-    , s(boost::beast::allocate_stable<state>(*this, std::move(req_parser)))
+    , s(boost::beast::allocate_stable<state>(*this,
+                                             client_.opts,
+                                             server_.id,
+                                             std::move(req_parser),
+                                             tap,
+                                             std::forward<BodyFilter>(filter)))
   {
+    s.stats = stats;
     (*this)({}, 0, false);
   }
 
+  // cancel_pump aborts whatever the request pump is waiting on, it's only called once the relay op
+  // has nothing of its own pending on either session
+  //
+  auto
+  cancel_pump() -> void
+  {
+    s.req_abandoned = true;
+
+    ::foxy::detail::cancel(server.stream.is_ssl() ? server.stream.ssl().next_layer()
+                                                  : server.stream.plain());
+
+    ::foxy::detail::cancel(client.stream.is_ssl() ? client.stream.ssl().next_layer()
+                                                  : client.stream.plain());
+  }
+
   auto
   operator()(boost::system::error_code ec,
              std::size_t const         bytes_transferred,
              bool const                is_continuation = true) -> void;
+
+  auto
+  operator()(on_join_t, boost::system::error_code) -> void
+  {
+    (*this)({}, 0);
+  }
 };
 
-template <class Stream, class DynamicBuffer, class RelayHandler>
+template <class Stream, class DynamicBuffer, class RelayHandler, class BodyFilter>
+auto
+relay_op<Stream, DynamicBuffer, RelayHandler, BodyFilter>::request_pump::
+operator()(boost::system::error_code ec, std::size_t const) -> void
+{
+  namespace http = boost::beast::http;
+
+  BOOST_ASIO_CORO_REENTER(*this)
+  {
+    do {
+      read_ec = {};
+
+      if (!s.req_parser.is_done()) {
+        s.req.body().data = s.req_buffer.data();
+        s.req.body().size = s.req_buffer.size();
+
+        BOOST_ASIO_CORO_YIELD
+        http::async_read(server.stream, server.buffer, s.req_parser, std::move(*this));
+
+        if (ec == http::error::need_buffer) { ec = {}; }
+        if (ec) { read_ec = ec; }
+
+        // the relay op may have given up on the request while the read was already complete and
+        // queued, in which case the cancellation never reached us
+        //
+        if (s.req_abandoned) { break; }
+
+        s.req.body().size = s.req_buffer.size() - s.req.body().size;
+        s.req.body().data = s.req_buffer.data();
+        s.req.body().more = !s.req_parser.is_done();
+
+        if (s.stats) { s.stats->count_in(s.req.body().size); }
+        s.body_bytes += s.req.body().size;
+
+        // the relay op is likely waiting on a response the upstream won't send before it has the
+        // whole request so it has to be woken up
+        //
+        if (!s.meter.on_transfer(s.req.body().size)) {
+          read_ec = boost::asio::error::timed_out;
+          ::foxy::detail::cancel(client.stream.is_ssl() ? client.stream.ssl().next_layer()
+                                                        : client.stream.plain());
+          break;
+        }
+
+        s.req_read = s.req.body().size;
+        s.filter_request_body();
+
+      } else {
+        s.req.body().data = nullptr;
+        s.req.body().size = 0;
+      }
+
+      BOOST_ASIO_CORO_YIELD
+      http::async_write(client.stream, s.req_sr, std::move(*this));
+
+      if (ec == http::error::need_buffer) { ec = {}; }
+      if (ec || read_ec || s.req_abandoned) { break; }
+
+      // the relay op is waiting on the upstream's response under the client's timeout, an upload
+      // that's still making progress pushes that deadline back
+      //
+      client.timer.expires_after(client.opts.timeout);
+
+      s.grow_buffer(s.req_buffer, s.req_read);
+
+    } while (!s.req_parser.is_done() && !s.req_sr.is_done());
+
+    s.req_ec   = ec ? ec : read_ec;
+    s.req_done = true;
+    s.join->cancel();
+  }
+}
+
+template <class Stream, class DynamicBuffer, class RelayHandler, class BodyFilter>
 auto
-relay_op<Stream, DynamicBuffer, RelayHandler>::operator()(boost::system::error_code ec,
-                                                          std::size_t const bytes_transferred,
-                                                          bool const        is_continuation) -> void
+relay_op<Stream, DynamicBuffer, RelayHandler, BodyFilter>::operator()(
+  boost::system::error_code ec,
+  std::size_t const         bytes_transferred,
+  bool const                is_continuation) -> void
 {
   namespace http = boost::beast::http;
 
@@ -158,6 +427,8 @@ relay_op<Stream, DynamicBuffer, RelayHandler>::operator()(boost::system::error_c
     //
     BOOST_ASIO_CORO_YIELD
     {
+      s.filter.on_request_header(s.req);
+
       s.close_tunnel        = s.close_tunnel || !s.req.keep_alive();
       auto const is_chunked = s.req.chunked();
 
@@ -174,35 +445,65 @@ relay_op<Stream, DynamicBuffer, RelayHandler>::operator()(boost::system::error_c
     }
     if (ec) { goto upcall; }
 
-    do {
-      s.ec = {};
+    // a request with a body that's still coming in can be pumped upstream alongside the response so
+    // the upstream is free to answer early
+    //
+    s.is_duplex = client.opts.relay_full_duplex && !s.req_parser.is_done();
 
-      if (!s.req_parser.is_done()) {
-        s.req.body().data = s.buffer.data();
-        s.req.body().size = s.buffer.size();
+    if (s.is_duplex) {
+      s.req_done = false;
+      s.join.emplace(client.get_executor(), (boost::asio::steady_timer::time_point::max)());
 
-        BOOST_ASIO_CORO_YIELD
-        server.async_read(s.req_parser, std::move(*this));
+      request_pump(server, client, s, this->get_executor())();
 
-        if (ec == http::error::need_buffer) { ec = {}; }
-        if (ec) { s.ec = ec; }
+    } else {
+      do {
+        s.ec = {};
 
-        s.req.body().size = s.buffer.size() - s.req.body().size;
-        s.req.body().data = s.buffer.data();
-        s.req.body().more = !s.req_parser.is_done();
+        if (!s.req_parser.is_done()) {
+          s.req.body().data = s.req_buffer.data();
+          s.req.body().size = s.req_buffer.size();
 
-      } else {
-        s.req.body().data = nullptr;
-        s.req.body().size = 0;
-      }
+          BOOST_ASIO_CORO_YIELD
+          server.async_read(s.req_parser, std::move(*this));
 
-      BOOST_ASIO_CORO_YIELD
-      client.async_write(s.req_sr, std::move(*this));
+          if (ec == http::error::need_buffer) { ec = {}; }
+          if (ec) { s.ec = ec; }
 
-      if (ec == http::error::need_buffer) { ec = {}; }
-      if (ec || s.ec) { goto upcall; }
+          s.req.body().size = s.req_buffer.size() - s.req.body().size;
+          s.req.body().data = s.req_buffer.data();
+          s.req.body().more = !s.req_parser.is_done();
 
-    } while (!s.req_parser.is_done() && !s.req_sr.is_done());
+          if (s.stats) { s.stats->count_in(s.req.body().size); }
+          s.body_bytes += s.req.body().size;
+
+          if (!s.meter.on_transfer(s.req.body().size)) {
+            ec = boost::asio::error::timed_out;
+            goto upcall;
+          }
+
+          s.req_read = s.req.body().size;
+          s.filter_request_body();
+
+        } else {
+          s.req.body().data = nullptr;
+          s.req.body().size = 0;
+        }
+
+        BOOST_ASIO_CORO_YIELD
+        client.async_write(s.req_sr, std::move(*this));
+
+        if (ec == http::error::need_buffer) { ec = {}; }
+        if (ec || s.ec) { goto upcall; }
+
+        s.grow_buffer(s.req_buffer, s.req_read);
+
+      } while (!s.req_parser.is_done() && !s.req_sr.is_done());
+
+      // however long the upstream takes to answer isn't the request body's doing
+      //
+      s.meter.restart();
+    }
 
     // TODO: if there's an actual here when reading the response header, send a 502 back to the
     // client; once the header is sent, it doesn't make sense to send a 502 on top of the already
@@ -212,6 +513,23 @@ relay_op<Stream, DynamicBuffer, RelayHandler>::operator()(boost::system::error_c
     client.async_read_header(s.res_parser, std::move(*this));
     if (ec) { goto upcall; }
 
+    s.meter.restart();
+
+    if (s.stats) {
+      s.stats->status = s.res.result_int();
+      s.stats->mark_first_byte();
+    }
+
+    s.filter.on_response_header(s.res);
+
+    // the tap may take a response without a body off our hands, e.g. a 304 to a revalidation it
+    // started, and then there's nothing left for us to relay
+    //
+    if (s.tap && !s.tap->on_response_header(s.res) && s.res_parser.is_done()) {
+      s.close_tunnel = s.close_tunnel || !s.res.keep_alive();
+      goto finish;
+    }
+
     BOOST_ASIO_CORO_YIELD
     {
       s.close_tunnel = s.close_tunnel || !s.res.keep_alive();
@@ -235,8 +553,8 @@ relay_op<Stream, DynamicBuffer, RelayHandler>::operator()(boost::system::error_c
       s.ec = {};
 
       if (!s.res_parser.is_done()) {
-        s.res.body().data = s.buffer.data();
-        s.res.body().size = s.buffer.size();
+        s.res.body().data = s.res_buffer.data();
+        s.res.body().size = s.res_buffer.size();
 
         BOOST_ASIO_CORO_YIELD
         client.async_read(s.res_parser, std::move(*this));
@@ -244,10 +562,25 @@ relay_op<Stream, DynamicBuffer, RelayHandler>::operator()(boost::system::error_c
         if (ec == http::error::need_buffer) { ec = {}; }
         if (ec) { s.ec = ec; }
 
-        s.res.body().size = s.buffer.size() - s.res.body().size;
-        s.res.body().data = s.buffer.data();
+        s.res.body().size = s.res_buffer.size() - s.res.body().size;
+        s.res.body().data = s.res_buffer.data();
         s.res.body().more = !s.res_parser.is_done();
 
+        if (s.stats) { s.stats->count_out(s.res.body().size); }
+        s.body_bytes += s.res.body().size;
+
+        if (!s.meter.on_transfer(s.res.body().size)) {
+          ec = boost::asio::error::timed_out;
+          goto upcall;
+        }
+
+        s.res_read = s.res.body().size;
+        s.filter_response_body();
+
+        if (s.tap && s.res.body().size > 0) {
+          s.tap->on_response_body(boost::asio::const_buffer(s.res.body().data, s.res.body().size));
+        }
+
       } else {
         s.res.body().data = nullptr;
         s.res.body().size = 0;
@@ -259,14 +592,44 @@ relay_op<Stream, DynamicBuffer, RelayHandler>::operator()(boost::system::error_c
       if (ec == http::error::need_buffer) { ec = {}; }
       if (ec || s.ec) { goto upcall; }
 
+      s.grow_buffer(s.res_buffer, s.res_read);
+
     } while (!s.res_parser.is_done() && !s.res_sr.is_done());
 
+    // the response made it through so the relay succeeded, but a request that didn't make it
+    // upstream in its entirety leaves neither connection fit for reuse
+    //
+  finish:
+    if (s.is_duplex) {
+      if (!s.req_done) { cancel_pump(); }
+
+      if (!s.req_done) {
+        BOOST_ASIO_CORO_YIELD
+        s.join->async_wait(boost::beast::bind_front_handler(std::move(*this), on_join_t{}));
+      }
+
+      if (s.req_abandoned || s.req_ec) { s.close_tunnel = true; }
+    }
+
     {
+      s.span.stop(client.opts, s.body_bytes);
+
       auto const close_tunnel = s.close_tunnel;
       return this->complete(is_continuation, boost::system::error_code(), close_tunnel);
     }
 
   upcall:
+    if (!s.req_done) {
+      s.ec = ec;
+      cancel_pump();
+
+      BOOST_ASIO_CORO_YIELD
+      s.join->async_wait(boost::beast::bind_front_handler(std::move(*this), on_join_t{}));
+
+      ec = s.ec;
+    }
+
+    s.span.stop(client.opts, s.body_bytes, ec);
     this->complete(is_continuation, ec, true);
   }
 }
@@ -277,9 +640,11 @@ struct run_async_relay_op
   auto
   operator()(Handler&&                                     handler,
              ::foxy::basic_session<Stream, DynamicBuffer>& server,
-             ::foxy::basic_session<Stream, DynamicBuffer>& client) -> void
+             ::foxy::basic_session<Stream, DynamicBuffer>& client,
+             transfer_stats*                               stats = nullptr) -> void
   {
-    relay_op<Stream, DynamicBuffer, Handler>(server, std::forward<Handler>(handler), client);
+    relay_op<Stream, DynamicBuffer, Handler>(server, std::forward<Handler>(handler), client,
+                                             stats, body_filter{});
   }
 
   template <class Handler, class Stream, class DynamicBuffer, class Parser>
@@ -287,10 +652,39 @@ struct run_async_relay_op
   operator()(Handler&&                                     handler,
              ::foxy::basic_session<Stream, DynamicBuffer>& server,
              ::foxy::basic_session<Stream, DynamicBuffer>& client,
-             Parser&&                                      parser)
+             Parser&&                                      parser,
+             relay_tap*                                    tap   = nullptr,
+             transfer_stats*                               stats = nullptr)
   {
     relay_op<Stream, DynamicBuffer, Handler>(server, std::forward<Handler>(handler), client,
-                                             std::move(parser));
+                                             std::move(parser), tap, stats, body_filter{});
+  }
+};
+
+struct run_async_filtered_relay_op
+{
+  template <class Handler, class Stream, class DynamicBuffer, class BodyFilter>
+  auto
+  operator()(Handler&&                                     handler,
+             ::foxy::basic_session<Stream, DynamicBuffer>& server,
+             ::foxy::basic_session<Stream, DynamicBuffer>& client,
+             BodyFilter&&                                  filter) -> void
+  {
+    relay_op<Stream, DynamicBuffer, Handler, BodyFilter>(
+      server, std::forward<Handler>(handler), client, nullptr, std::forward<BodyFilter>(filter));
+  }
+
+  template <class Handler, class Stream, class DynamicBuffer, class Parser, class BodyFilter>
+  auto
+  operator()(Handler&&                                     handler,
+             ::foxy::basic_session<Stream, DynamicBuffer>& server,
+             ::foxy::basic_session<Stream, DynamicBuffer>& client,
+             Parser&&                                      parser,
+             BodyFilter&&                                  filter) -> void
+  {
+    relay_op<Stream, DynamicBuffer, Handler, BodyFilter>(server, std::forward<Handler>(handler),
+                                                         client, std::move(parser), nullptr,
+                                                         nullptr, std::forward<BodyFilter>(filter));
   }
 };
 
@@ -306,6 +700,21 @@ async_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
     run_async_relay_op{}, token, server, client);
 }
 
+// this overload adds what the relay moved to `stats`
+//
+template <class Stream, class DynamicBuffer, class CompletionToken>
+auto
+async_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
+            ::foxy::basic_session<Stream, DynamicBuffer>& client,
+            transfer_stats*                               stats,
+            CompletionToken&&                             token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
+    run_async_relay_op{}, token, server, client, stats);
+}
+
 template <class Stream, class DynamicBuffer, class Parser, class CompletionToken>
 auto
 async_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
@@ -319,6 +728,74 @@ async_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
     run_async_relay_op{}, token, server, client, std::move(parser));
 }
 
+// this overload shows the response to `tap` as it's relayed
+//
+template <class Stream, class DynamicBuffer, class Parser, class CompletionToken>
+auto
+async_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
+            ::foxy::basic_session<Stream, DynamicBuffer>& client,
+            Parser&&                                      parser,
+            relay_tap*                                    tap,
+            CompletionToken&&                             token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
+    run_async_relay_op{}, token, server, client, std::move(parser), tap);
+}
+
+template <class Stream, class DynamicBuffer, class Parser, class CompletionToken>
+auto
+async_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
+            ::foxy::basic_session<Stream, DynamicBuffer>& client,
+            Parser&&                                      parser,
+            relay_tap*                                    tap,
+            transfer_stats*                               stats,
+            CompletionToken&&                             token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
+    run_async_relay_op{}, token, server, client, std::move(parser), tap, stats);
+}
+
+// async_filtered_relay relays a single request and its response through `filter`, see body_filter
+//
+// A filter passed as an lvalue is used in place and has to outlive the relay, one passed as an
+// rvalue is moved into the relay's state.
+//
+template <class Stream, class DynamicBuffer, class BodyFilter, class CompletionToken>
+auto
+async_filtered_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
+                     ::foxy::basic_session<Stream, DynamicBuffer>& client,
+                     BodyFilter&&                                  filter,
+                     CompletionToken&&                             token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
+    run_async_filtered_relay_op{}, token, server, client, std::forward<BodyFilter>(filter));
+}
+
+template <class Stream,
+          class DynamicBuffer,
+          class Parser,
+          class BodyFilter,
+          class CompletionToken>
+auto
+async_filtered_relay(::foxy::basic_session<Stream, DynamicBuffer>& server,
+                     ::foxy::basic_session<Stream, DynamicBuffer>& client,
+                     Parser&&                                      parser,
+                     BodyFilter&&                                  filter,
+                     CompletionToken&&                             token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
+    run_async_filtered_relay_op{}, token, server, client, std::move(parser),
+    std::forward<BodyFilter>(filter));
+}
+
 } // namespace detail
 } // namespace foxy
 
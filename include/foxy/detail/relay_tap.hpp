@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_RELAY_TAP_HPP_
+#define FOXY_DETAIL_RELAY_TAP_HPP_
+
+#include <boost/beast/http/message.hpp>
+
+#include <boost/asio/buffer.hpp>
+
+namespace foxy
+{
+namespace detail
+{
+// relay_tap lets the owner of a relay watch the response go by without having to buffer it
+//
+struct relay_tap
+{
+  virtual ~relay_tap() = default;
+
+  // on_response_header sees the upstream's header before its hop-by-hop fields are stripped
+  //
+  // Returning false keeps a response that has no body from being relayed at all, the relay then
+  // completes as if it had been sent and the owner is expected to answer the client itself
+  //
+  virtual auto
+  on_response_header(boost::beast::http::response_header<> const& header) -> bool = 0;
+
+  // on_response_body is handed each chunk of the decoded body before it's written to the client
+  //
+  virtual auto
+  on_response_body(boost::asio::const_buffer chunk) -> void = 0;
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_RELAY_TAP_HPP_
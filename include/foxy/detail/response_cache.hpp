@@ -0,0 +1,317 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_RESPONSE_CACHE_HPP_
+#define FOXY_DETAIL_RESPONSE_CACHE_HPP_
+
+#include <foxy/detail/relay_tap.hpp>
+
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/status.hpp>
+
+#include <boost/optional/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace foxy
+{
+namespace detail
+{
+// cache_control holds the directives of a message's Cache-Control fields that a shared cache cares
+// about, see RFC 9111 section 5.2
+//
+struct cache_control
+{
+  bool no_store        = false;
+  bool no_cache        = false;
+  bool is_private      = false;
+  bool is_public       = false;
+  bool must_revalidate = false;
+
+  boost::optional<std::chrono::seconds> max_age;
+  boost::optional<std::chrono::seconds> s_maxage;
+};
+
+auto
+parse_cache_control(boost::beast::http::fields const& fields) -> cache_control;
+
+// parse_http_date only understands the IMF-fixdate format, e.g. "Sun, 06 Nov 1994 08:49:37 GMT",
+// which every sender has been required to generate since RFC 7231
+//
+auto
+parse_http_date(boost::string_view date) -> boost::optional<std::chrono::system_clock::time_point>;
+
+// spill_file is a response body written out to disk and mapped back into memory
+//
+struct spill_file;
+
+// cached_response is an immutable snapshot of a stored response, a freshened response is stored as
+// a new snapshot so anyone still writing out the old one is unaffected
+//
+struct cached_response
+{
+  using clock_type    = std::chrono::system_clock;
+  using duration_type = clock_type::duration;
+
+  boost::beast::http::status status = boost::beast::http::status::ok;
+
+  // end-to-end fields only, the hop-by-hop ones are stripped before storing
+  //
+  boost::beast::http::fields fields;
+  std::string                body;
+
+  // a response that was spilled to disk keeps its body in a mapped file instead of `body`
+  //
+  std::shared_ptr<spill_file const> spilled;
+
+  clock_type::time_point response_time;
+  duration_type          corrected_initial_age = duration_type::zero();
+  duration_type          freshness_lifetime    = duration_type::zero();
+
+  // the request fields named by the response's Vary and the values they had
+  //
+  std::vector<std::pair<std::string, std::string>> vary;
+
+  auto
+  age(clock_type::time_point now) const -> duration_type;
+
+  auto
+  is_fresh(clock_type::time_point now) const -> bool;
+
+  auto
+  has_validators() const -> bool;
+
+  // content is the body, wherever it's kept
+  //
+  auto
+  content() const -> boost::string_view;
+
+  auto
+  size() const -> std::size_t;
+};
+
+// response_cache is a bounded, in-memory LRU of responses fit for a shared cache as per RFC 9111
+//
+// Entries are keyed by the effective request URI and a key may hold several variants when the
+// origin Varies its responses, `max_bytes` bounds the sum of every stored body and field
+//
+// Given a `spill_path`, the entries evicted from memory are written to files in that directory and
+// mapped back in, a second LRU bounded by `spill_max_bytes`. The files are unlinked as soon as
+// they're mapped so nothing is left behind however the process ends
+//
+// All member functions are safe to call concurrently
+//
+struct response_cache
+{
+public:
+  using clock_type = cached_response::clock_type;
+  using entry_type = std::shared_ptr<cached_response const>;
+
+  response_cache()                      = delete;
+  response_cache(response_cache const&) = delete;
+  response_cache(response_cache&&)      = delete;
+
+  response_cache(std::size_t max_bytes,
+                 std::size_t max_object_size,
+                 std::string spill_path      = std::string(),
+                 std::size_t spill_max_bytes = 0);
+
+  static auto
+  make_key(boost::string_view scheme,
+           boost::string_view host,
+           boost::string_view service,
+           boost::string_view target) -> std::string;
+
+  // is_storable implements the checks of RFC 9111 section 3 for a response to a GET
+  //
+  static auto
+  is_storable(boost::beast::http::request_header<> const&  request,
+              boost::beast::http::response_header<> const& response) -> bool;
+
+  // requires_validation is true when the request asks that anything we've stored be checked with
+  // the origin first
+  //
+  static auto
+  requires_validation(boost::beast::http::request_header<> const& request) -> bool;
+
+  auto
+  max_object_size() const noexcept -> std::size_t;
+
+  // lookup returns the variant stored under `key` that matches the request, fresh or not
+  //
+  auto
+  lookup(boost::string_view key, boost::beast::http::request_header<> const& request)
+    -> entry_type;
+
+  // store takes the full response, hop-by-hop fields and all, and returns the stored snapshot or
+  // null if the response couldn't be stored
+  //
+  auto
+  store(boost::string_view                           key,
+        boost::beast::http::request_header<> const&  request,
+        boost::beast::http::response_header<> const& response,
+        std::string                                  body) -> entry_type;
+
+  // freshen applies a 304 Not Modified to a stored response, see RFC 9111 section 4.3.4
+  //
+  auto
+  freshen(boost::string_view                           key,
+          entry_type const&                            entry,
+          boost::beast::http::request_header<> const&  request,
+          boost::beast::http::response_header<> const& not_modified) -> entry_type;
+
+  // invalidate drops every variant stored under `key`
+  //
+  auto
+  invalidate(boost::string_view key) -> void;
+
+  // begin_fill coalesces concurrent misses
+  //
+  // The first caller for a key becomes the one to fetch it and gets true back, everyone else gets
+  // false and has `notify` invoked once the fetch is over, successful or not
+  //
+  auto
+  begin_fill(boost::string_view key, std::function<void()> notify) -> bool;
+
+  auto
+  end_fill(boost::string_view key) -> void;
+
+  // size is the number of responses stored in memory, bytes the memory they account for, the
+  // spilled_ variants are the same for the ones on disk
+  //
+  auto
+  size() const -> std::size_t;
+
+  auto
+  bytes() const -> std::size_t;
+
+  auto
+  spilled_size() const -> std::size_t;
+
+  auto
+  spilled_bytes() const -> std::size_t;
+
+private:
+  struct node
+  {
+    std::string key;
+    entry_type  entry;
+    bool        is_spilled = false;
+  };
+
+  using lru_type = std::list<node>;
+
+  auto
+  insert(std::string key, entry_type entry) -> void;
+
+  // insert_spilled must be called without `mtx_` held, `invalidations` is the count from when the
+  // entry was evicted
+  //
+  auto
+  insert_spilled(std::string key, entry_type entry, std::uint64_t invalidations) -> void;
+
+  // erase and forget require `mtx_` to be held, forget leaves `variants_` alone
+  //
+  auto
+  erase(lru_type::iterator pos) -> void;
+
+  auto
+  forget(lru_type::iterator pos) -> void;
+
+  std::size_t max_bytes_;
+  std::size_t max_object_size_;
+  std::size_t bytes_ = 0;
+
+  std::string spill_path_;
+  std::size_t spill_max_bytes_;
+  std::size_t spilled_bytes_ = 0;
+
+  // an entry being written out may have been invalidated by the time it's mapped
+  //
+  std::uint64_t invalidations_ = 0;
+
+  mutable std::mutex mtx_;
+
+  // most recently used at the front, `variants_` points into both
+  //
+  lru_type lru_;
+  lru_type spilled_;
+
+  std::unordered_map<std::string, std::vector<lru_type::iterator>>    variants_;
+  std::unordered_map<std::string, std::vector<std::function<void()>>> fills_;
+};
+
+// cache_fill follows a relayed response into the cache
+//
+// It copies what it needs out of the request up front because the relay takes the request over,
+// a fill that won the race in `begin_fill` ends it when destroyed
+//
+struct cache_fill final : relay_tap
+{
+public:
+  cache_fill()                  = delete;
+  cache_fill(cache_fill const&) = delete;
+  cache_fill(cache_fill&&)      = delete;
+
+  cache_fill(response_cache&                             cache,
+             std::string                                 key,
+             boost::beast::http::request_header<> const& request,
+             bool                                        is_filling);
+
+  ~cache_fill() override;
+
+  // revalidate makes a 304 Not Modified refer to `entry` instead of being relayed
+  //
+  auto
+  revalidate(response_cache::entry_type entry) -> void;
+
+  auto
+  is_not_modified() const noexcept -> bool;
+
+  // commit stores the relayed response and must only be called once it was relayed in full, after a
+  // 304 it freshens the revalidated entry instead, returns the snapshot to answer the client with
+  //
+  auto
+  commit() -> response_cache::entry_type;
+
+  auto
+  on_response_header(boost::beast::http::response_header<> const& header) -> bool override;
+
+  auto
+  on_response_body(boost::asio::const_buffer chunk) -> void override;
+
+private:
+  response_cache&                       cache_;
+  std::string                           key_;
+  boost::beast::http::request_header<>  request_;
+  boost::beast::http::response_header<> response_;
+  std::string                           body_;
+  response_cache::entry_type            revalidating_;
+
+  bool is_filling_;
+  bool is_storable_     = false;
+  bool is_not_modified_ = false;
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_RESPONSE_CACHE_HPP_
@@ -11,6 +11,7 @@
 #define FOXY_DETAIL_TIMED_OP_WRAPPER_V3_HPP_
 
 #include <foxy/session.hpp>
+#include <foxy/session_errors.hpp>
 #include <foxy/detail/close_stream.hpp>
 
 #include <boost/asio/compose.hpp>
@@ -27,6 +28,7 @@
 
 #include <boost/assert.hpp>
 
+#include <chrono>
 #include <memory>
 #include <utility>
 #include <tuple>
@@ -59,6 +61,10 @@ struct async_timer_initiation<Ret(Args...)>
       boost::asio::coroutine               timer_coro;
       bool                                 done = false;
 
+      // only read when the session counts its errors, it's how long a timed out op actually ran
+      //
+      std::chrono::steady_clock::time_point started;
+
       state()             = delete;
       state(state const&) = delete;
       state(state&&)      = default;
@@ -128,6 +134,12 @@ struct async_timer_initiation<Ret(Args...)>
         // our user's async op completed before the timer did, mark the op as true and cancel
         // the pending cancel op
         //
+        // `on_error` skips the `need_buffer` every read into a full `buffer_body` finishes with
+        //
+        if (session_.opts.errors) {
+          session_.opts.errors->on_error(session_.current_op, std::get<0>(*(p_->results)));
+        }
+
         p_->done = true;
         session_.timer.cancel();
       }
@@ -168,13 +180,15 @@ struct async_timer_initiation<Ret(Args...)>
           return;
         }
 
-        // maybe handle if (ec) { ... } here
-        //
-
         // the timer expired naturally, mark the op as done and close the stream
         //
         p_->done = true;
 
+        if (session_.opts.errors) {
+          session_.opts.errors->on_timeout(session_.current_op, session_.opts.timeout,
+                                           std::chrono::steady_clock::now() - s.started);
+        }
+
         auto& stream =
           session_.stream.is_ssl() ? session_.stream.ssl().next_layer() : session_.stream.plain();
 
@@ -185,6 +199,10 @@ struct async_timer_initiation<Ret(Args...)>
     auto intermediate_handler =
       intermediate_completion_handler(std::forward<CompletionHandler>(handler), session);
 
+    if (session.opts.errors) {
+      intermediate_handler.p_->started = std::chrono::steady_clock::now();
+    }
+
     session.timer.expires_after(session.opts.timeout);
     session.timer.async_wait(boost::beast::bind_front_handler(
       static_cast<intermediate_completion_handler const&>(intermediate_handler), on_timer_t{}));
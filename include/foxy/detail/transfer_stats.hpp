@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_TRANSFER_STATS_HPP_
+#define FOXY_DETAIL_TRANSFER_STATS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace foxy
+{
+namespace detail
+{
+// relaxed_counter is a count that only a single thread adds to and that any thread may read, so
+// adding to it is a plain load and store instead of a locked read-modify-write
+//
+struct relaxed_counter
+{
+  std::atomic<std::uint64_t> value{0};
+
+  relaxed_counter() = default;
+
+  relaxed_counter(relaxed_counter const& other) noexcept
+    : value(other.load())
+  {
+  }
+
+  auto
+  operator=(relaxed_counter const& other) noexcept -> relaxed_counter&
+  {
+    value.store(other.load(), std::memory_order_relaxed);
+    return *this;
+  }
+
+  auto
+  add(std::uint64_t const n) noexcept -> void
+  {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  auto
+  load() const noexcept -> std::uint64_t
+  {
+    return value.load(std::memory_order_relaxed);
+  }
+
+  operator std::uint64_t() const noexcept { return load(); }
+};
+
+// transfer_stats is what a relay or a tunnel tells its owner about the traffic it moved, the byte
+// counts are added to so the same stats can sum up several relays
+//
+// `bytes_in` counts what the proxy's client sent and `bytes_out` what it was sent, for a relay
+// that's only the message bodies. Whatever is counted is counted in `parent` too, e.g. a single
+// request's stats roll up into its connection's.
+//
+// `first_byte` is when the upstream's response started to come back, it's left alone once it's
+// been set.
+//
+struct transfer_stats
+{
+  unsigned        status = 0;
+  relaxed_counter bytes_in;
+  relaxed_counter bytes_out;
+
+  std::chrono::steady_clock::time_point first_byte;
+
+  transfer_stats* parent = nullptr;
+
+  auto
+  count_in(std::uint64_t const n) noexcept -> void
+  {
+    for (auto* stats = this; stats; stats = stats->parent) { stats->bytes_in.add(n); }
+  }
+
+  auto
+  count_out(std::uint64_t const n) noexcept -> void
+  {
+    for (auto* stats = this; stats; stats = stats->parent) { stats->bytes_out.add(n); }
+  }
+
+  auto
+  mark_first_byte() noexcept -> void
+  {
+    if (first_byte == std::chrono::steady_clock::time_point()) {
+      first_byte = std::chrono::steady_clock::now();
+    }
+  }
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_TRANSFER_STATS_HPP_
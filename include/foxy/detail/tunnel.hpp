@@ -14,22 +14,97 @@
 #include <foxy/server_session.hpp>
 #include <foxy/type_traits.hpp>
 #include <foxy/parse_uri.hpp>
+#include <foxy/error.hpp>
+#include <foxy/access_list.hpp>
+#include <foxy/access_log.hpp>
+#include <foxy/backend_pool.hpp>
+#include <foxy/tunnel_metrics.hpp>
+#include <foxy/detail/op_timer.hpp>
 #include <foxy/detail/relay.hpp>
+#include <foxy/detail/upstream_pool.hpp>
+#include <foxy/detail/response_cache.hpp>
+#include <foxy/detail/transfer_stats.hpp>
+#include <foxy/detail/tunnel_limits.hpp>
 
 #include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/error.hpp>
 #include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/span_body.hpp>
 #include <boost/beast/http/fields.hpp>
 #include <boost/beast/http/verb.hpp>
 #include <boost/beast/http/status.hpp>
+#include <boost/beast/http/write.hpp>
 
 #include <boost/beast/core/detect_ssl.hpp>
 
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
 #include <boost/optional/optional.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
 namespace foxy
 {
 namespace detail
 {
+// can_raw_tunnel is true when the proxy has been configured for raw tunnels and neither side of the
+// tunnel is speaking TLS to the proxy
+//
+inline auto
+can_raw_tunnel(::foxy::server_session& server, ::foxy::client_session& client) -> bool
+{
+  return client.opts.raw_tunnel && !server.stream.is_ssl() && !client.stream.is_ssl();
+}
+
+// is_origin_form also accepts the asterisk-form of a server-wide OPTIONS request
+//
+inline auto
+is_origin_form(boost::string_view target) -> bool
+{
+  return (!target.empty() && target.front() == '/') || target == "*";
+}
+
+// is_idempotent is true for the methods whose requests can be sent twice with the same effect as
+// sending them once, RFC 7231 section 4.2.2
+//
+inline auto
+is_idempotent(boost::beast::http::verb method) -> bool
+{
+  namespace http = boost::beast::http;
+
+  switch (method) {
+    case http::verb::get:
+    case http::verb::head:
+    case http::verb::options:
+    case http::verb::trace:
+    case http::verb::put:
+    case http::verb::delete_:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// is_stale is true for the errors a pooled connection the origin has closed in the meantime fails
+// with
+//
+inline auto
+is_stale(boost::system::error_code ec) -> bool
+{
+  return ec == boost::beast::http::error::end_of_stream || ec == boost::asio::error::eof ||
+         ec == boost::asio::error::connection_reset || ec == boost::asio::error::broken_pipe ||
+         ec == boost::asio::error::connection_aborted;
+}
+
 template <class TunnelHandler>
 struct tunnel_op
   : boost::beast::stable_async_base<TunnelHandler, typename ::foxy::session::executor_type>,
@@ -45,6 +120,60 @@ struct tunnel_op
 
     foxy::basic_uri_parts<char> uri_parts;
 
+    // when pooling, absolute-form requests are relayed through a connection borrowed from the pool
+    // instead of the tunnel's own client session
+    //
+    std::unique_ptr<::foxy::client_session> upstream;
+
+    // the origin can close a pooled connection just as we take it out of the pool, a request that
+    // isn't answered on a `is_reused` connection goes out once more on a fresh one if it's safe to
+    // send twice, from the copy of its header in `replay`
+    //
+    bool        is_reused       = false;
+    bool        is_retry        = false;
+    bool        is_request_read = false;
+    std::string replay;
+
+    std::string host;
+    std::string service;
+    std::string target;
+
+    // with a cache, a GET for an absolute-form URI is answered from `entry` whenever it's fresh or
+    // the origin confirms it still is, the first miss for a URI fetches it while later ones wait on
+    // `fill_wait` for it to be stored
+    //
+    std::string                                cache_key;
+    ::foxy::detail::response_cache::entry_type entry;
+    boost::optional<::foxy::detail::cache_fill> fill;
+    std::shared_ptr<boost::asio::steady_timer> fill_wait;
+
+    boost::optional<boost::beast::http::response<boost::beast::http::span_body<char const>>> cached;
+
+    // in reverse proxy mode, the backend the current request is sent to and the backends we've
+    // failed to connect to so far
+    //
+    ::foxy::backend_pool::lease backend;
+    std::vector<std::size_t>    failed_backends;
+
+    // when the current request's header arrived, a client's deadline counts down from here
+    //
+    std::chrono::steady_clock::time_point received;
+
+    // every request the proxy answers is traced as a span of the client's session
+    //
+    boost::optional<::foxy::detail::op_timer> span;
+
+    // what the access log is told about the current request, `record` is started as soon as the
+    // request's header arrives and finished once it's been answered
+    //
+    ::foxy::access_record          record;
+    ::foxy::detail::transfer_stats stats;
+
+    bool is_cacheable = false;
+    bool is_filling   = false;
+    bool is_hit       = false;
+    bool keep_alive   = false;
+
     boost::tribool is_ssl;
 
     bool is_authority = false;
@@ -52,29 +181,59 @@ struct tunnel_op
     bool is_absolute  = false;
     bool is_http      = false;
 
-    bool close_tunnel = false;
+    // `is_relayed` is true for a single request relayed to an origin or a backend, as opposed to a
+    // CONNECT
+    //
+    bool is_reverse = false;
+    bool is_relayed = false;
+
+    bool is_past_deadline = false;
+    bool close_tunnel     = false;
   };
 
-  ::foxy::server_session& server;
-  ::foxy::client_session& client;
-  state&                  s;
+  ::foxy::server_session&               server;
+  ::foxy::client_session&               client;
+  ::foxy::detail::upstream_pool*        pool;
+  ::foxy::detail::response_cache*       cache;
+  std::chrono::steady_clock::time_point expires;
+  ::foxy::access_record*                tunnel_record;
+  ::foxy::tunnel_metrics::tunnel*       metrics;
+  state&                                s;
 
 public:
   tunnel_op()                 = delete;
   tunnel_op(tunnel_op const&) = default;
   tunnel_op(tunnel_op&&)      = default;
 
-  tunnel_op(foxy::server_session& server_, TunnelHandler handler, foxy::client_session& client_)
+  tunnel_op(foxy::server_session&                 server_,
+            TunnelHandler                         handler,
+            foxy::client_session&                 client_,
+            ::foxy::detail::upstream_pool*        pool_,
+            ::foxy::detail::response_cache*       cache_,
+            std::chrono::steady_clock::time_point expires_,
+            ::foxy::access_record*                tunnel_record_,
+            ::foxy::tunnel_metrics::tunnel*       metrics_)
     : boost::beast::stable_async_base<TunnelHandler, typename ::foxy::session::executor_type>(
         std::move(handler),
         server_.get_executor())
     , server(server_)
     , client(client_)
+    , pool(pool_)
+    , cache(cache_)
+    , expires(expires_)
+    , tunnel_record(tunnel_record_)
+    , metrics(metrics_)
     , s(boost::beast::allocate_stable<state>(*this))
   {
     (*this)({}, 0, false);
   }
 
+  auto
+  upstream() -> ::foxy::client_session&
+  {
+    return s.upstream ? *s.upstream : client;
+  }
+
   struct on_connect_t
   {
   };
@@ -87,6 +246,10 @@ public:
   {
   };
 
+  struct on_fill_wait_t
+  {
+  };
+
   auto
   operator()(boost::system::error_code ec,
              std::size_t const         bytes_transferred,
@@ -100,8 +263,128 @@ public:
 
   auto
   operator()(on_detect_t, boost::system::error_code ec, boost::tribool is_ssl_) -> void;
+
+  auto
+  operator()(on_fill_wait_t, boost::system::error_code) -> void
+  {
+    // the wait ends by being cancelled when the fill we're waiting on is done, or by timing out in
+    // which case we fetch the response ourselves
+    //
+    (*this)({}, 0);
+  }
+
+  // make_cached_response answers the current request with `s.entry`
+  //
+  auto
+  make_cached_response() -> void;
+
+  auto
+  start_record() -> void;
+
+  // log_request hands the current request to the access log and the tunnel's metrics once it's
+  // been answered
+  //
+  auto
+  log_request(::foxy::access_kind       kind,
+              unsigned                  status,
+              std::uint64_t             bytes_out,
+              boost::system::error_code ec) -> void;
+
+  // sample_tcp_info is only called while the upstream, if any, is still ours
+  //
+  auto
+  sample_tcp_info() -> void;
 };
 
+template <class TunnelHandler>
+auto
+tunnel_op<TunnelHandler>::start_record() -> void
+{
+  using namespace std::chrono;
+
+  auto& entry = s.record;
+  entry       = ::foxy::access_record();
+
+  entry.timestamp = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+  entry.method    = static_cast<std::uint8_t>(s.parser->get().method());
+  entry.set_target(s.parser->get().target());
+
+  auto       ec     = boost::system::error_code();
+  auto const remote = server.stream.plain().remote_endpoint(ec);
+  if (!ec) { entry.set_client(remote); }
+}
+
+template <class TunnelHandler>
+auto
+tunnel_op<TunnelHandler>::log_request(::foxy::access_kind const       kind,
+                                      unsigned const                  status,
+                                      std::uint64_t const             bytes_out,
+                                      boost::system::error_code const ec) -> void
+{
+  if (s.span) {
+    s.span->stop(client.opts, bytes_out, ec);
+    s.span.reset();
+  }
+
+  if (metrics) {
+    using duration_type = ::foxy::tunnel_metrics::duration_type;
+
+    metrics->on_response(s.stats.first_byte == std::chrono::steady_clock::time_point()
+                           ? boost::optional<duration_type>()
+                           : boost::optional<duration_type>(s.stats.first_byte - s.received));
+  }
+
+  auto* const log = client.opts.access_log.get();
+  if (!log) { return; }
+
+  auto entry      = s.record;
+  entry.kind      = kind;
+  entry.status    = static_cast<std::uint16_t>(status);
+  entry.bytes_in  = s.stats.bytes_in;
+  entry.bytes_out = bytes_out;
+  entry.duration  = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - s.received)
+                     .count();
+
+  log->record(entry);
+}
+
+template <class TunnelHandler>
+auto
+tunnel_op<TunnelHandler>::sample_tcp_info() -> void
+{
+  if (!metrics) { return; }
+
+  metrics->on_tcp_info(::foxy::sample_tcp_info(server.stream.plain()),
+                       ::foxy::sample_tcp_info(upstream().stream.plain()));
+}
+
+template <class TunnelHandler>
+auto
+tunnel_op<TunnelHandler>::make_cached_response() -> void
+{
+  namespace http = boost::beast::http;
+
+  using clock_type = ::foxy::detail::cached_response::clock_type;
+
+  auto const& entry = *s.entry;
+
+  s.cached.emplace(entry.status, 11);
+
+  auto& res = *s.cached;
+  for (auto const& field : entry.fields) { res.insert(field.name_string(), field.value()); }
+
+  auto const age = std::chrono::duration_cast<std::chrono::seconds>(entry.age(clock_type::now()));
+  res.set(http::field::age, std::to_string(age.count()));
+  res.insert(http::field::via, "1.1 foxy");
+
+  res.keep_alive(s.keep_alive && !s.close_tunnel);
+
+  auto const content = entry.content();
+  res.body()         = http::span_body<char const>::value_type(content.data(), content.size());
+  res.prepare_payload();
+}
+
 template <class TunnelHandler>
 auto
 tunnel_op<TunnelHandler>::operator()(on_connect_t, boost::system::error_code ec) -> void
@@ -111,8 +394,11 @@ tunnel_op<TunnelHandler>::operator()(on_connect_t, boost::system::error_code ec)
 
 template <class TunnelHandler>
 auto
-tunnel_op<TunnelHandler>::operator()(on_relay_t, boost::system::error_code ec, bool) -> void
+tunnel_op<TunnelHandler>::operator()(on_relay_t,
+                                     boost::system::error_code ec,
+                                     bool                      close_tunnel) -> void
 {
+  s.close_tunnel = close_tunnel;
   (*this)(ec, 0);
 }
 
@@ -142,21 +428,51 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
   {
     while (true) {
       s.parser.emplace();
+      s.parser->body_limit((std::numeric_limits<std::uint64_t>::max)());
 
       s.response.emplace();
 
+      // a fill we were doing for the last request ends here at the latest
+      //
+      s.fill.reset();
+      s.fill_wait.reset();
+      s.backend.reset();
+      s.entry.reset();
+      s.cached.reset();
+
+      s.stats        = {};
+      s.stats.parent = metrics ? &metrics->stats : nullptr;
+
+      s.is_cacheable     = false;
+      s.is_filling       = false;
+      s.is_hit           = false;
+      s.is_past_deadline = false;
+
       BOOST_ASIO_CORO_YIELD
       server.async_read_header(*s.parser, std::move(*this));
 
       if (ec) { goto upcall; }
 
+      s.received = std::chrono::steady_clock::now();
+      s.span.emplace(client.opts, ::foxy::session_op::tunnel, server.id);
+
       s.uri_parts = foxy::parse_uri(s.parser->get().target());
 
+      if (client.opts.access_log) { start_record(); }
+
       s.is_authority = s.uri_parts.is_authority();
       s.is_connect   = s.parser->get().method() == http::verb::connect;
       s.is_absolute  = s.uri_parts.is_absolute();
       s.is_http      = s.uri_parts.is_http();
 
+      // a reverse proxy sends everything but CONNECT on to its backends and never acts as a forward
+      // proxy
+      //
+      s.is_reverse = client.opts.backends && !s.is_connect &&
+                     (s.is_absolute ? s.is_http : is_origin_form(s.parser->get().target()));
+
+      s.is_relayed = s.is_reverse || (!client.opts.backends && s.is_absolute && s.is_http);
+
       if (s.is_connect && s.is_authority && !s.parser->keep_alive()) {
         s.close_tunnel = true;
 
@@ -167,34 +483,181 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
         BOOST_ASIO_CORO_YIELD
         server.async_write(*s.response, std::move(*this));
 
+        log_request(::foxy::access_kind::request, s.response->result_int(),
+                    s.response->body().size(), ec);
+
         if (ec) { goto upcall; }
         break;
       }
 
-      if ((s.is_connect && s.is_authority) || (s.is_absolute && s.is_http)) {
-        BOOST_ASIO_CORO_YIELD
+      if (s.is_relayed || (!client.opts.backends && s.is_connect && s.is_authority)) {
         {
           auto const scheme =
             client.stream.is_ssl() ? boost::string_view("https") : boost::string_view("http");
 
-          auto port = s.uri_parts.port().size() == 0 ? static_cast<std::string>(scheme)
+          s.host    = static_cast<std::string>(s.uri_parts.host());
+          s.service = s.uri_parts.port().size() == 0 ? static_cast<std::string>(scheme)
                                                      : static_cast<std::string>(s.uri_parts.port());
 
-          client.async_connect(static_cast<std::string>(s.uri_parts.host()), std::move(port),
-                               bind_front_handler(std::move(*this), on_connect_t{}));
+          // the origin-form target an absolute-form request is forwarded with
+          //
+          auto const path =
+            s.uri_parts.path().size() == 0
+              ? (s.parser->get().method() == http::verb::options ? boost::string_view("*")
+                                                                 : boost::string_view("/"))
+              : s.uri_parts.path();
+
+          s.target = static_cast<std::string>(path);
+          if (s.uri_parts.query().size() > 0) {
+            s.target += "?";
+            s.target += static_cast<std::string>(s.uri_parts.query());
+          }
+
+          if (s.is_reverse && !s.is_absolute) {
+            s.target = static_cast<std::string>(s.parser->get().target());
+          }
+        }
+
+        // a forward proxy only connects to the hosts its access policy allows
+        //
+        if (!s.is_reverse && client.opts.access &&
+            client.opts.access->get()->check(s.uri_parts.host()) == ::foxy::access_action::deny) {
+          s.close_tunnel = !s.parser->get().keep_alive() || !s.parser->is_done();
+
+          s.response->result(http::status::forbidden);
+          s.response->body() = "Access to " + s.host + " is denied by the proxy's policy\n\n";
+          s.response->keep_alive(!s.close_tunnel);
+          s.response->prepare_payload();
+
+          BOOST_ASIO_CORO_YIELD
+          server.async_write(*s.response, std::move(*this));
+
+          log_request(::foxy::access_kind::request, s.response->result_int(),
+                      s.response->body().size(), ec);
+
+          if (ec) { goto upcall; }
+          if (s.close_tunnel) { break; }
+          continue;
+        }
+
+        if (cache && s.is_relayed) {
+          // behind a reverse proxy, the backends all serve the host the client asked for
+          //
+          s.cache_key = s.is_reverse
+                          ? ::foxy::detail::response_cache::make_key(
+                              "http", s.parser->get()[http::field::host], {}, s.target)
+                          : ::foxy::detail::response_cache::make_key(
+                              client.stream.is_ssl() ? "https" : "http", s.host, s.service,
+                              s.target);
+
+          s.is_cacheable = s.parser->get().method() == http::verb::get && s.parser->is_done();
+
+          // RFC 9111 section 4.4, an unsafe request invalidates what's stored for its URI
+          //
+          switch (s.parser->get().method()) {
+            case http::verb::get:
+            case http::verb::head:
+            case http::verb::options:
+            case http::verb::trace:
+              break;
+
+            default:
+              cache->invalidate(s.cache_key);
+          }
+        }
+
+        while (s.is_cacheable) {
+          s.entry  = cache->lookup(s.cache_key, s.parser->get());
+          s.is_hit = s.entry &&
+                     s.entry->is_fresh(::foxy::detail::cached_response::clock_type::now()) &&
+                     !::foxy::detail::response_cache::requires_validation(s.parser->get());
+
+          if (s.is_hit || s.fill_wait) { break; }
+
+          s.fill_wait = std::make_shared<net::steady_timer>(client.get_executor());
+
+          // the fill may end on any thread so the wait is cancelled from our own executor
+          //
+          s.is_filling = cache->begin_fill(
+            s.cache_key, [executor = this->get_executor(), timer = s.fill_wait]() {
+              net::post(executor, [timer]() { timer->cancel(); });
+            });
+
+          if (s.is_filling) { break; }
+
+          s.fill_wait->expires_after(client.opts.timeout);
+
+          BOOST_ASIO_CORO_YIELD
+          s.fill_wait->async_wait(bind_front_handler(std::move(*this), on_fill_wait_t{}));
+        }
+
+        if (s.is_cacheable && !s.is_hit) {
+          s.fill.emplace(*cache, s.cache_key, s.parser->get(), s.is_filling);
+        }
+
+        // nothing has been sent to a backend we can't connect to so the request moves on to the
+        // next one, the failure counts against the backend's health either way
+        //
+        s.failed_backends.clear();
+        while (true) {
+          if (s.is_reverse && !s.is_hit) {
+            s.backend = client.opts.backends->acquire(s.target, s.failed_backends);
+            s.host    = s.backend.get().host;
+            s.service = s.backend.get().service;
+          }
+
+          s.is_reused = false;
+          if (pool && s.is_relayed && !s.is_hit) {
+            s.upstream  = pool->take(s.host, s.service);
+            s.is_reused = s.upstream != nullptr;
+            if (!s.upstream) {
+              s.upstream =
+                std::make_unique<::foxy::client_session>(client.get_executor(), client.opts);
+            }
+          }
+
+          if (!s.is_hit && (!s.upstream || !s.upstream->stream.plain().is_open())) {
+            s.is_reused = false;
+
+            BOOST_ASIO_CORO_YIELD
+            upstream().async_connect(s.host, s.service,
+                                     bind_front_handler(std::move(*this), on_connect_t{}));
+
+            if (!ec && metrics) {
+              metrics->on_connect(s.host, s.service, upstream().connect_time,
+                                  upstream().handshake_time);
+              sample_tcp_info();
+            }
+          }
+
+          if (!ec || !s.is_reverse) { break; }
+
+          s.failed_backends.push_back(s.backend.index());
+          if (s.failed_backends.size() >= client.opts.backends->size()) { break; }
+
+          s.backend.complete(ec);
+          s.upstream.reset();
+          ec = {};
         }
 
         if (ec) {
-          s.response->result(http::status::bad_request);
-          s.response->body() =
-            "Unable to connect to the remote at: " + static_cast<std::string>(s.uri_parts.host()) +
-            "\nError code: " + ec.message() + "\n\n";
+          s.upstream.reset();
+          s.backend.complete(ec);
+
+          s.response->result(ec == ::foxy::error::access_denied ? http::status::forbidden
+                             : s.is_reverse                         ? http::status::bad_gateway
+                                                                    : http::status::bad_request);
+          s.response->body() = "Unable to connect to the remote at: " + s.host +
+                               "\nError code: " + ec.message() + "\n\n";
 
           s.response->prepare_payload();
 
           BOOST_ASIO_CORO_YIELD
           server.async_write(*s.response, std::move(*this));
 
+          log_request(::foxy::access_kind::request, s.response->result_int(),
+                      s.response->body().size(), ec);
+
           if (ec) { goto upcall; }
           if (s.parser->get().keep_alive()) { continue; }
           break;
@@ -209,42 +672,229 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
         BOOST_ASIO_CORO_YIELD
         server.async_write(*s.response, std::move(*this));
 
+        log_request(::foxy::access_kind::request, s.response->result_int(),
+                    s.response->body().size(), ec);
+
         if (ec) { goto upcall; }
         if (s.parser.get().keep_alive()) { continue; }
         break;
       }
 
-      if (s.is_absolute && s.is_http) {
-        s.parser->get().keep_alive(false);
-
-        BOOST_ASIO_CORO_YIELD
+      // the client's deadline is checked one last time right before its request leaves the proxy
+      // and the upstream is told how much of it is left
+      //
+      if (s.is_relayed && !s.is_hit && !client.opts.deadline_header.empty()) {
         {
-          auto const path =
-            s.uri_parts.path().size() == 0
-              ? (s.parser->get().method() == http::verb::options ? boost::string_view("*")
-                                                                 : boost::string_view("/"))
-              : s.uri_parts.path();
+          auto&      request = s.parser->get();
+          auto const field   = request.find(client.opts.deadline_header);
 
-          auto target = static_cast<std::string>(path);
-          if (s.uri_parts.query().size() > 0) {
-            target += "?";
-            target += static_cast<std::string>(s.uri_parts.query());
+          auto const budget = ::foxy::detail::remaining_budget(
+            field == request.end() ? boost::none : ::foxy::detail::parse_deadline(field->value()),
+            s.received, expires, std::chrono::steady_clock::now());
+
+          if (budget) {
+            auto const ms = std::chrono::duration_cast<std::chrono::milliseconds>(*budget);
+
+            s.is_past_deadline = ms.count() <= 0;
+            if (!s.is_past_deadline) {
+              request.set(client.opts.deadline_header, std::to_string(ms.count()));
+            }
           }
+        }
+
+        if (s.is_past_deadline) {
+          // nothing has been sent upstream so a pooled connection is still good for someone else
+          //
+          if (s.upstream) { pool->put(s.host, s.service, std::move(s.upstream)); }
+          s.backend.reset();
 
-          auto hostname = static_cast<std::string>(s.uri_parts.host());
-          if (s.uri_parts.port().size() > 0) {
-            hostname += ":";
-            hostname += static_cast<std::string>(s.uri_parts.port());
+          s.close_tunnel = !s.parser->get().keep_alive() || !s.parser->is_done();
+
+          s.response->result(http::status::gateway_timeout);
+          s.response->body() = "The request's deadline passed before it could be sent upstream\n\n";
+          s.response->keep_alive(!s.close_tunnel);
+          s.response->prepare_payload();
+
+          BOOST_ASIO_CORO_YIELD
+          server.async_write(*s.response, std::move(*this));
+
+          log_request(::foxy::access_kind::request, s.response->result_int(),
+                      s.response->body().size(), ec);
+
+          if (ec) { goto upcall; }
+          if (s.close_tunnel) { break; }
+          continue;
+        }
+      }
+
+      if (s.is_relayed) { s.keep_alive = s.parser->get().keep_alive(); }
+
+      if (s.is_relayed && !s.is_hit) {
+        // without a pool, the upstream connection can only serve this one request
+        //
+        if (!pool) { s.parser->get().keep_alive(false); }
+
+        // a stale response can still be served if the origin tells us it hasn't changed, unless the
+        // client brought conditions of its own for the origin to answer
+        //
+        if (s.fill && s.entry && s.entry->has_validators() &&
+            s.parser->get().find(http::field::if_none_match) == s.parser->get().end() &&
+            s.parser->get().find(http::field::if_modified_since) == s.parser->get().end()) {
+          auto const etag          = s.entry->fields.find(http::field::etag);
+          auto const last_modified = s.entry->fields.find(http::field::last_modified);
+
+          if (etag != s.entry->fields.end()) {
+            s.parser->get().set(http::field::if_none_match, etag->value());
           }
 
-          s.parser->get().target(target);
-          s.parser->get().set(http::field::host, hostname);
+          if (last_modified != s.entry->fields.end()) {
+            s.parser->get().set(http::field::if_modified_since, last_modified->value());
+          }
 
-          async_relay(server, client, std::move(*s.parser),
-                      bind_front_handler(std::move(*this), on_relay_t{}));
+          s.fill->revalidate(s.entry);
         }
 
+        s.is_retry = false;
+        while (true) {
+          BOOST_ASIO_CORO_YIELD
+          {
+            if (!s.is_retry) {
+              if (s.is_reverse) {
+                // the backend only ever sees the proxy connect so it's told who the client is, the
+                // client's Host is passed along untouched
+                //
+                auto       remote_ec = boost::system::error_code();
+                auto const remote    = server.stream.plain().remote_endpoint(remote_ec);
+                if (!remote_ec) {
+                  s.parser->get().insert("X-Forwarded-For", remote.address().to_string());
+                }
+              } else {
+                auto hostname = static_cast<std::string>(s.uri_parts.host());
+                if (s.uri_parts.port().size() > 0) {
+                  hostname += ":";
+                  hostname += static_cast<std::string>(s.uri_parts.port());
+                }
+
+                s.parser->get().set(http::field::host, hostname);
+              }
+
+              s.parser->get().target(s.target);
+
+              s.is_request_read = s.parser->is_done();
+
+              s.replay.clear();
+              if (s.is_reused && s.is_request_read &&
+                  is_idempotent(s.parser->get().method())) {
+                auto header = std::ostringstream();
+                header << s.parser->get().base();
+                s.replay = header.str();
+              }
+            }
+
+            async_relay(server, upstream(), std::move(*s.parser), s.fill.get_ptr(), &s.stats,
+                        bind_front_handler(std::move(*this), on_relay_t{}));
+          }
+
+          // nothing has reached the client until the upstream's response header arrives
+          //
+          if (!ec || s.is_retry || s.replay.empty() || s.stats.status != 0 || !is_stale(ec)) {
+            break;
+          }
+
+          s.is_retry = true;
+          s.upstream = std::make_unique<::foxy::client_session>(client.get_executor(), client.opts);
+
+          BOOST_ASIO_CORO_YIELD
+          upstream().async_connect(s.host, s.service,
+                                   bind_front_handler(std::move(*this), on_connect_t{}));
+
+          if (ec) { break; }
+          if (metrics) {
+            metrics->on_connect(s.host, s.service, upstream().connect_time,
+                                upstream().handshake_time);
+          }
+
+          s.parser.emplace();
+          s.parser->body_limit((std::numeric_limits<std::uint64_t>::max)());
+          s.parser->put(net::buffer(s.replay), ec);
+          if (ec) { break; }
+        }
+
+        s.backend.complete(ec);
+        sample_tcp_info();
+
+        // an upstream that fails before it answers gets the client a 502 instead of a connection
+        // that closes on it without a word
+        //
+        if (ec && s.stats.status == 0) {
+          s.upstream.reset();
+
+          s.close_tunnel = s.close_tunnel || !s.keep_alive || !s.is_request_read;
+
+          s.response->result(http::status::bad_gateway);
+          s.response->body() = "The remote at: " + s.host + " failed before it answered" +
+                               "\nError code: " + ec.message() + "\n\n";
+          s.response->keep_alive(!s.close_tunnel);
+          s.response->prepare_payload();
+
+          BOOST_ASIO_CORO_YIELD
+          server.async_write(*s.response, std::move(*this));
+
+          log_request(::foxy::access_kind::request, s.response->result_int(),
+                      s.response->body().size(), ec);
+
+          if (ec) { goto upcall; }
+          if (s.close_tunnel) { break; }
+          continue;
+        }
+
+        if (ec) {
+          log_request(::foxy::access_kind::request, s.stats.status, s.stats.bytes_out, ec);
+          goto upcall;
+        }
+
+        // the response was relayed in full so it can be stored, or it was a 304 and the entry we
+        // revalidated is now what the client gets
+        //
+        if (s.fill) {
+          auto entry = s.fill->commit();
+          if (s.fill->is_not_modified()) {
+            s.entry  = std::move(entry);
+            s.is_hit = s.entry != nullptr;
+          }
+          s.fill.reset();
+        }
+
+        // both ends agreed to keep their connections so the client can send us another request
+        // while the upstream waits in the pool for whoever needs the origin next
+        //
+        if (s.upstream && !s.close_tunnel) {
+          pool->put(s.host, s.service, std::move(s.upstream));
+        } else {
+          s.upstream.reset();
+          s.close_tunnel = true;
+        }
+
+        if (!s.is_hit) {
+          log_request(::foxy::access_kind::request, s.stats.status, s.stats.bytes_out, ec);
+
+          if (s.close_tunnel) { break; }
+          continue;
+        }
+      }
+
+      if (s.is_relayed) {
+        make_cached_response();
+
+        BOOST_ASIO_CORO_YIELD
+        server.async_write(*s.cached, std::move(*this));
+
+        log_request(::foxy::access_kind::cache_hit, s.cached->result_int(),
+                    s.cached->body().size(), ec);
+
         if (ec) { goto upcall; }
+        if (s.keep_alive && !s.close_tunnel) { continue; }
+
         s.close_tunnel = true;
         break;
       }
@@ -254,6 +904,19 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
       BOOST_ASIO_CORO_YIELD
       server.async_write(*s.response, std::move(*this));
 
+      // the tunnel is only logged once it's closed, by whoever runs it
+      //
+      if (tunnel_record && client.opts.access_log) {
+        *tunnel_record        = s.record;
+        tunnel_record->kind   = ::foxy::access_kind::tunnel;
+        tunnel_record->status = static_cast<std::uint16_t>(s.response->result_int());
+      }
+
+      // for a CONNECT, the span only covers setting the tunnel up
+      //
+      s.span->stop(client.opts, 0, ec);
+      s.span.reset();
+
       if (ec) {
         s.close_tunnel = true;
         goto upcall;
@@ -263,7 +926,9 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
       break;
     }
 
-    if (!ec && !s.close_tunnel) {
+    // a raw tunnel only shovels bytes so there's nothing to sniff
+    //
+    if (!ec && !s.close_tunnel && !::foxy::detail::can_raw_tunnel(server, client)) {
       BOOST_ASIO_CORO_YIELD
       boost::beast::async_detect_ssl(server.stream.plain(), server.buffer,
                                      bind_front_handler(std::move(*this), on_detect_t{}));
@@ -275,6 +940,8 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
     }
 
   upcall:
+    if (s.span) { s.span->stop(client.opts, 0, ec); }
+
     auto const close_tunnel = s.close_tunnel;
     this->complete(is_continuation, ec, close_tunnel);
   }
@@ -284,9 +951,17 @@ struct run_async_tunnel_op
 {
   template <class Handler>
   auto
-  operator()(Handler&& handler, foxy::server_session& server, foxy::client_session& client) -> void
+  operator()(Handler&&                             handler,
+             foxy::server_session&                 server,
+             foxy::client_session&                 client,
+             ::foxy::detail::upstream_pool*        pool,
+             ::foxy::detail::response_cache*       cache,
+             std::chrono::steady_clock::time_point expires,
+             ::foxy::access_record*                tunnel_record = nullptr,
+             ::foxy::tunnel_metrics::tunnel*       metrics       = nullptr) -> void
   {
-    tunnel_op<Handler>(server, std::forward<Handler>(handler), client);
+    tunnel_op<Handler>(server, std::forward<Handler>(handler), client, pool, cache, expires,
+                       tunnel_record, metrics);
   }
 };
 
@@ -297,7 +972,52 @@ async_tunnel(foxy::server_session& server, foxy::client_session& client, Complet
                                      void(boost::system::error_code, bool)>::return_type
 {
   return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
-    run_async_tunnel_op{}, token, server, client);
+    run_async_tunnel_op{}, token, server, client, nullptr, nullptr,
+    (std::chrono::steady_clock::time_point::max)());
+}
+
+// this overload reuses upstream connections from `pool` for absolute-form requests and keeps the
+// client connection open between them, GETs are answered out of `cache` when it's not null
+//
+// `expires` is when the client connection reaches its maximum lifetime, it caps the deadline passed
+// upstream
+//
+template <class CompletionToken>
+auto
+async_tunnel(foxy::server_session&                 server,
+             foxy::client_session&                 client,
+             ::foxy::detail::upstream_pool*        pool,
+             ::foxy::detail::response_cache*       cache,
+             std::chrono::steady_clock::time_point expires,
+             CompletionToken&&                     token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
+    run_async_tunnel_op{}, token, server, client, pool, cache, expires);
+}
+
+// with an access log in the client's options, every request is logged once it's been answered,
+// an established CONNECT tunnel is written to `tunnel_record` instead so that whoever runs the
+// tunnel can log it once it's over
+//
+// `metrics`, when it's not null, is the connection's entry in the proxy's tunnel metrics
+//
+template <class CompletionToken>
+auto
+async_tunnel(foxy::server_session&                 server,
+             foxy::client_session&                 client,
+             ::foxy::detail::upstream_pool*        pool,
+             ::foxy::detail::response_cache*       cache,
+             std::chrono::steady_clock::time_point expires,
+             ::foxy::access_record*                tunnel_record,
+             ::foxy::tunnel_metrics::tunnel*       metrics,
+             CompletionToken&&                     token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, bool)>(
+    run_async_tunnel_op{}, token, server, client, pool, cache, expires, tunnel_record, metrics);
 }
 
 } // namespace detail
@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_TUNNEL_LIMITS_HPP_
+#define FOXY_DETAIL_TUNNEL_LIMITS_HPP_
+
+#include <boost/optional/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace foxy
+{
+namespace detail
+{
+// rate_meter tells a transfer that's making progress apart from one that's only trickling along
+//
+// The bytes moved are summed up over consecutive windows and a window that moved fewer than
+// `min_rate` bytes per second fails the meter. A window starts with the first byte that's moved
+// and is only judged when a transfer ends it so a transfer that stalls altogether is left to the
+// session's timeout.
+//
+// Silence counts against the window it falls into, a peer that sends a byte just after every window
+// would otherwise never be judged at all. Only `restart`, between the phases of a relay, drops a
+// window unjudged so that e.g. an upstream taking its time with the response header isn't held
+// against the body that follows.
+//
+struct rate_meter
+{
+public:
+  using clock_type    = std::chrono::steady_clock;
+  using duration_type = clock_type::duration;
+
+  rate_meter() = default;
+
+  rate_meter(std::size_t const min_rate, duration_type const window)
+    : min_rate_(min_rate)
+    , window_(window)
+  {
+  }
+
+  auto
+  is_enabled() const noexcept -> bool
+  {
+    return min_rate_ > 0 && window_ > duration_type::zero();
+  }
+
+  // on_transfer records `bytes` and returns false when it ends a window that fell short
+  //
+  auto
+  on_transfer(std::size_t const bytes, clock_type::time_point const now = clock_type::now())
+    -> bool
+  {
+    if (!is_enabled() || bytes == 0) { return true; }
+
+    if (!is_running_) {
+      is_running_   = true;
+      window_start_ = now;
+      window_bytes_ = bytes;
+      return true;
+    }
+
+    window_bytes_ += bytes;
+
+    auto const elapsed = now - window_start_;
+    if (elapsed < window_) { return true; }
+
+    auto const required =
+      static_cast<double>(min_rate_) * std::chrono::duration<double>(elapsed).count();
+
+    auto const is_fast_enough = static_cast<double>(window_bytes_) >= required;
+
+    window_start_ = now;
+    window_bytes_ = 0;
+
+    return is_fast_enough;
+  }
+
+  // restart drops the current window without judging it, the next transfer starts a new one
+  //
+  auto
+  restart() noexcept -> void
+  {
+    is_running_ = false;
+  }
+
+private:
+  std::size_t            min_rate_   = 0;
+  duration_type          window_     = duration_type::zero();
+  bool                   is_running_ = false;
+  clock_type::time_point window_start_;
+  std::uint64_t          window_bytes_ = 0;
+};
+
+// parse_deadline reads the value of a deadline header, a plain count of milliseconds
+//
+inline auto
+parse_deadline(boost::string_view const value) -> boost::optional<std::chrono::milliseconds>
+{
+  using rep = std::chrono::milliseconds::rep;
+
+  if (value.empty() || value.size() > 12) { return boost::none; }
+
+  auto ms = rep{0};
+  for (auto const c : value) {
+    if (c < '0' || c > '9') { return boost::none; }
+    ms = ms * 10 + (c - '0');
+  }
+
+  return std::chrono::milliseconds(ms);
+}
+
+// remaining_budget is how long a request has left when it's about to be sent upstream, the client's
+// own deadline is counted from when its request arrived and both it and the connection's `expires`
+// may be missing
+//
+inline auto
+remaining_budget(boost::optional<std::chrono::milliseconds> const client_deadline,
+                 std::chrono::steady_clock::time_point const      received,
+                 std::chrono::steady_clock::time_point const      expires,
+                 std::chrono::steady_clock::time_point const      now)
+  -> boost::optional<std::chrono::steady_clock::duration>
+{
+  auto budget = boost::optional<std::chrono::steady_clock::duration>();
+
+  if (expires != (std::chrono::steady_clock::time_point::max)()) { budget = expires - now; }
+
+  if (client_deadline) {
+    auto const left = received + *client_deadline - now;
+    if (!budget || left < *budget) { budget = left; }
+  }
+
+  return budget;
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_TUNNEL_LIMITS_HPP_
@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_UPSTREAM_POOL_HPP_
+#define FOXY_DETAIL_UPSTREAM_POOL_HPP_
+
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace foxy
+{
+namespace detail
+{
+// upstream_pool holds on to idle keep-alive connections to origins so that the proxy can reuse them
+// for later requests, no matter which client connection they come in on
+//
+// Connections that have sat idle for longer than `idle_timeout` or that the origin has since closed
+// are thrown away instead of being handed out. A timer sweeps out the ones nobody comes back for so
+// they don't hold on to their sockets, which is why the pool must be owned by a std::shared_ptr.
+//
+// All member functions are safe to call concurrently
+//
+struct upstream_pool : public std::enable_shared_from_this<upstream_pool>
+{
+public:
+  using clock_type    = std::chrono::steady_clock;
+  using duration_type = clock_type::duration;
+
+  upstream_pool()                     = delete;
+  upstream_pool(upstream_pool const&) = delete;
+  upstream_pool(upstream_pool&&)      = delete;
+
+  // the sweep runs on `executor`
+  //
+  upstream_pool(boost::asio::any_io_executor executor,
+                std::size_t                  max_idle_per_origin,
+                duration_type                idle_timeout);
+
+  // take returns an idle connection to the origin or null if there isn't a usable one
+  //
+  auto
+  take(boost::string_view host, boost::string_view service)
+    -> std::unique_ptr<::foxy::client_session>;
+
+  // put hands a connection that's done with its current request back to the pool, the connection
+  // is closed instead if the origin already has `max_idle_per_origin` idle connections
+  //
+  auto
+  put(boost::string_view host, boost::string_view service,
+      std::unique_ptr<::foxy::client_session> session) -> void;
+
+  // close drops every idle connection and stops the sweep, connections that are put back after it
+  // are closed straight away
+  //
+  auto
+  close() -> void;
+
+  // size is the number of idle connections across all origins
+  //
+  auto
+  size() const -> std::size_t;
+
+private:
+  struct idle_session
+  {
+    std::unique_ptr<::foxy::client_session> session;
+    clock_type::time_point                  idle_since;
+  };
+
+  // must be called with `mtx_` held
+  //
+  auto
+  schedule_sweep(clock_type::time_point at) -> void;
+
+  auto
+  sweep(boost::system::error_code ec) -> void;
+
+  std::size_t   max_idle_;
+  duration_type idle_timeout_;
+
+  mutable std::mutex                                         mtx_;
+  std::unordered_map<std::string, std::vector<idle_session>> idle_;
+
+  // the sweep's wait only holds on to a weak_ptr to the pool, destroying the timer along with the
+  // pool is what ends it
+  //
+  boost::asio::steady_timer                                  timer_;
+  bool                                                       is_sweep_scheduled_ = false;
+  bool                                                       is_closed_          = false;
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_UPSTREAM_POOL_HPP_
@@ -0,0 +1,545 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DOWNLOAD_HPP_
+#define FOXY_DOWNLOAD_HPP_
+
+#include <foxy/client_session.hpp>
+#include <foxy/session_opts.hpp>
+#include <foxy/error.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/buffer_body.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/status.hpp>
+
+#include <boost/optional/optional.hpp>
+#include <boost/utility/string_view.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace foxy
+{
+struct download_opts
+{
+  // the maximum number of connections used to fetch the object when the remote supports range
+  // requests
+  //
+  std::size_t max_connections = 4;
+
+  // the number of bytes requested by each `Range` request
+  //
+  std::uint64_t segment_size = 1024 * 1024;
+
+  // the size of the buffer each connection streams the body through on its way to the sink
+  //
+  std::size_t buffer_size = 64 * 1024;
+
+  // the options each underlying `client_session` is constructed with
+  //
+  session_opts session = {};
+};
+
+// memory_sink writes the downloaded object into a contiguous, resizable container such as a
+// `std::string` or `std::vector<char>`
+//
+template <class Container>
+struct memory_sink
+{
+  Container& data;
+
+  auto
+  prepare(std::uint64_t const size, boost::system::error_code& ec) -> void
+  {
+    data.resize(static_cast<std::size_t>(size));
+    ec = {};
+  }
+
+  auto
+  write_at(std::uint64_t const        offset,
+           boost::asio::const_buffer  buffer,
+           boost::system::error_code& ec) -> void
+  {
+    ec = {};
+    if (buffer.size() == 0) { return; }
+
+    auto const end = static_cast<std::size_t>(offset) + buffer.size();
+    if (end > data.size()) { data.resize(end); }
+
+    std::copy_n(static_cast<char const*>(buffer.data()), buffer.size(),
+                reinterpret_cast<char*>(&data[0]) + offset);
+  }
+};
+
+template <class Container>
+auto
+make_memory_sink(Container& data) -> memory_sink<Container>
+{
+  return memory_sink<Container>{data};
+}
+
+// file_sink writes the downloaded object into a file, preallocating it once the size is known so
+// that every segment can be written in place
+//
+struct file_sink
+{
+  boost::beast::file file;
+
+  file_sink() = default;
+
+  file_sink(char const* path, boost::system::error_code& ec)
+  {
+    file.open(path, boost::beast::file_mode::write, ec);
+  }
+
+  auto
+  prepare(std::uint64_t const size, boost::system::error_code& ec) -> void
+  {
+    ec = {};
+    if (size == 0) { return; }
+
+    auto const zero = char{0};
+
+    file.seek(size - 1, ec);
+    if (ec) { return; }
+
+    file.write(&zero, 1, ec);
+  }
+
+  auto
+  write_at(std::uint64_t const        offset,
+           boost::asio::const_buffer  buffer,
+           boost::system::error_code& ec) -> void
+  {
+    file.seek(offset, ec);
+
+    while (!ec && buffer.size() > 0) {
+      auto const n = file.write(buffer.data(), buffer.size(), ec);
+      buffer += n;
+    }
+  }
+};
+
+namespace detail
+{
+// parse_content_range parses the `bytes first-last/complete-length` form of a Content-Range field
+// value, returning false for anything else including the unsatisfied-range form
+//
+inline auto
+parse_content_range(boost::string_view value,
+                    std::uint64_t&     first,
+                    std::uint64_t&     last,
+                    std::uint64_t&     total) -> bool
+{
+  auto const parse_int = [&value](std::uint64_t& out) -> bool {
+    auto const* const begin = value.begin();
+    auto const*       pos   = begin;
+
+    out = 0;
+    for (; pos != value.end() && *pos >= '0' && *pos <= '9'; ++pos) {
+      auto const digit = static_cast<std::uint64_t>(*pos - '0');
+      if (out > (UINT64_MAX - digit) / 10) { return false; }
+      out = out * 10 + digit;
+    }
+
+    value.remove_prefix(static_cast<std::size_t>(pos - begin));
+    return pos != begin;
+  };
+
+  auto const parse_lit = [&value](char const c) -> bool {
+    if (value.empty() || value.front() != c) { return false; }
+    value.remove_prefix(1);
+    return true;
+  };
+
+  if (!value.starts_with("bytes ")) { return false; }
+  value.remove_prefix(6);
+
+  return parse_int(first) && parse_lit('-') && parse_int(last) && parse_lit('/') &&
+         parse_int(total) && value.empty() && first <= last && last < total;
+}
+
+// is_empty_range tells whether a Content-Range field value is the `bytes */0` a remote answers a
+// Range request for an empty object with
+//
+inline auto
+is_empty_range(boost::string_view value) -> bool
+{
+  if (!value.starts_with("bytes */")) { return false; }
+  value.remove_prefix(8);
+
+  return !value.empty() && value.find_first_not_of('0') == boost::string_view::npos;
+}
+
+template <class Sink, class Handler>
+struct download_state
+{
+  using executor_type = boost::asio::strand<boost::asio::any_io_executor>;
+
+  executor_type strand;
+  download_opts opts;
+  std::string   host;
+  std::string   service;
+  std::string   target;
+  Sink&         sink;
+  Handler       handler;
+
+  // `total` is only meaningful once the first response has been parsed
+  // `next_offset` is the first byte that no connection has claimed yet
+  //
+  boost::optional<std::uint64_t> total;
+  std::uint64_t                  next_offset = 0;
+  std::uint64_t                  written     = 0;
+  std::size_t                    active      = 0;
+  boost::system::error_code      ec;
+
+  download_state(executor_type strand_,
+                 download_opts opts_,
+                 std::string   host_,
+                 std::string   service_,
+                 std::string   target_,
+                 Sink&         sink_,
+                 Handler&&     handler_)
+    : strand(std::move(strand_))
+    , opts(std::move(opts_))
+    , host(std::move(host_))
+    , service(std::move(service_))
+    , target(std::move(target_))
+    , sink(sink_)
+    , handler(std::move(handler_))
+  {
+    if (opts.max_connections == 0) { opts.max_connections = 1; }
+    if (opts.segment_size == 0) { opts.segment_size = 1; }
+    if (opts.buffer_size == 0) { opts.buffer_size = 1; }
+  }
+
+  // claim the next segment for a connection, returning false once there's nothing left to fetch
+  //
+  auto
+  claim(std::uint64_t& first, std::uint64_t& last) -> bool
+  {
+    if (ec || !total || next_offset >= *total) { return false; }
+
+    first       = next_offset;
+    last        = (std::min)(first + opts.segment_size, *total) - 1;
+    next_offset = last + 1;
+    return true;
+  }
+};
+
+template <class Sink, class Handler>
+struct download_op : boost::asio::coroutine
+{
+  using state_type    = download_state<Sink, Handler>;
+  using executor_type = typename state_type::executor_type;
+
+  using request_type = boost::beast::http::request<boost::beast::http::empty_body>;
+  using parser_type  = boost::beast::http::response_parser<boost::beast::http::buffer_body>;
+
+  struct frame
+  {
+    std::unique_ptr<::foxy::client_session> client;
+    request_type                            request;
+    boost::optional<parser_type>            parser;
+    std::vector<char>                       buffer;
+
+    // the range this connection is currently responsible for and the next byte to be written
+    //
+    std::uint64_t first  = 0;
+    std::uint64_t last   = 0;
+    std::uint64_t offset = 0;
+
+    bool is_connected = false;
+    bool is_probe     = false;
+
+    // the body of the response isn't part of the object, like the error page of a 416
+    //
+    bool is_discarded = false;
+
+    frame(state_type& s)
+      : client(std::make_unique<::foxy::client_session>(s.strand, s.opts.session))
+      , request(boost::beast::http::verb::get, s.target, 11)
+      , buffer(s.opts.buffer_size)
+    {
+      request.set(boost::beast::http::field::host, s.host);
+    }
+  };
+
+  std::shared_ptr<state_type> p_;
+  std::unique_ptr<frame>      f_;
+
+  download_op()                   = delete;
+  download_op(download_op const&) = delete;
+  download_op(download_op&&)      = default;
+
+  download_op(std::shared_ptr<state_type> p, std::uint64_t first, std::uint64_t last, bool is_probe)
+    : p_(std::move(p))
+    , f_(std::make_unique<frame>(*p_))
+  {
+    f_->first    = first;
+    f_->last     = last;
+    f_->is_probe = is_probe;
+  }
+
+  auto
+  get_executor() const noexcept -> executor_type
+  {
+    return p_->strand;
+  }
+
+  // inspect the header of a response, learning the size of the object from the first one
+  //
+  auto
+  on_header() -> boost::system::error_code
+  {
+    namespace http = boost::beast::http;
+
+    auto& s = *p_;
+    auto& f = *f_;
+
+    auto const& res = f.parser->get();
+
+    // the remote ignored our Range which means we have to fall back to a single stream
+    //
+    if (f.is_probe && res.result() == http::status::ok) {
+      auto ec = boost::system::error_code();
+
+      s.total       = f.parser->content_length();
+      s.next_offset = s.total ? *s.total : 0;
+      if (s.total) { s.sink.prepare(*s.total, ec); }
+
+      f.offset = 0;
+      return ec;
+    }
+
+    // there's no range of an empty object that's satisfiable, not even our probe's first segment
+    //
+    if (f.is_probe && res.result() == http::status::range_not_satisfiable &&
+        is_empty_range(res[http::field::content_range])) {
+      auto ec = boost::system::error_code();
+
+      s.total       = 0;
+      s.next_offset = 0;
+      s.sink.prepare(0, ec);
+
+      f.is_discarded = true;
+      return ec;
+    }
+
+    if (res.result() != http::status::partial_content) { return ::foxy::error::unexpected_status; }
+
+    auto first = std::uint64_t{0};
+    auto last  = std::uint64_t{0};
+    auto total = std::uint64_t{0};
+
+    if (!parse_content_range(res[http::field::content_range], first, last, total)) {
+      return ::foxy::error::bad_content_range;
+    }
+
+    if (f.is_probe) {
+      auto ec = boost::system::error_code();
+
+      s.total       = total;
+      s.next_offset = (std::min)(f.last + 1, total);
+      s.sink.prepare(total, ec);
+      if (ec) { return ec; }
+
+      f.last = (std::min)(f.last, total - 1);
+      spawn_workers();
+    }
+
+    if (first != f.first || last != f.last || total != *s.total) {
+      return ::foxy::error::bad_content_range;
+    }
+
+    f.offset = first;
+    return {};
+  }
+
+  auto
+  spawn_workers() -> void
+  {
+    auto& s = *p_;
+
+    auto first = std::uint64_t{0};
+    auto last  = std::uint64_t{0};
+
+    while (s.active < s.opts.max_connections && s.claim(first, last)) {
+      ++s.active;
+      boost::asio::post(download_op(p_, first, last, false));
+    }
+  }
+
+  auto
+  finish(boost::system::error_code ec) -> void
+  {
+    auto& s = *p_;
+    if (ec && !s.ec) { s.ec = ec; }
+    if (--s.active > 0) { return; }
+
+    auto const written = s.written;
+    auto const result  = s.ec;
+
+    auto handler = std::move(s.handler);
+    auto ex      = boost::asio::get_associated_executor(handler, s.strand);
+
+    boost::asio::post(ex, boost::beast::bind_front_handler(std::move(handler), result, written));
+  }
+
+  auto operator()(boost::system::error_code ec = {}, std::size_t const bytes_transferred = 0)
+    -> void
+  {
+    namespace http = boost::beast::http;
+
+    auto& s = *p_;
+    auto& f = *f_;
+
+    BOOST_ASIO_CORO_REENTER(*this)
+    {
+      while (true) {
+        if (!f.is_connected) {
+          BOOST_ASIO_CORO_YIELD f.client->async_connect(s.host, s.service, std::move(*this));
+          if (ec) { goto upcall; }
+          f.is_connected = true;
+        }
+
+        f.request.set(http::field::range,
+                      "bytes=" + std::to_string(f.first) + "-" + std::to_string(f.last));
+
+        f.parser.emplace();
+        f.parser->body_limit((std::numeric_limits<std::uint64_t>::max)());
+
+        BOOST_ASIO_CORO_YIELD f.client->async_write(f.request, std::move(*this));
+        if (ec) { goto upcall; }
+
+        BOOST_ASIO_CORO_YIELD f.client->async_read_header(*f.parser, std::move(*this));
+        if (ec) { goto upcall; }
+
+        ec = on_header();
+        if (ec) { goto upcall; }
+
+        while (!f.parser->is_done()) {
+          f.parser->get().body().data = f.buffer.data();
+          f.parser->get().body().size = f.buffer.size();
+
+          BOOST_ASIO_CORO_YIELD f.client->async_read(*f.parser, std::move(*this));
+          if (ec == http::error::need_buffer) { ec = {}; }
+          if (ec) { goto upcall; }
+
+          if (!f.is_discarded) {
+            auto const n = f.buffer.size() - f.parser->get().body().size;
+
+            s.sink.write_at(f.offset, boost::asio::buffer(f.buffer.data(), n), ec);
+            if (ec) { goto upcall; }
+
+            f.offset += n;
+            s.written += n;
+          }
+
+          // another connection failed, there's no point in finishing this segment
+          //
+          if (s.ec) { goto upcall; }
+        }
+
+        if (!f.parser->keep_alive()) {
+          f.client       = std::make_unique<::foxy::client_session>(s.strand, s.opts.session);
+          f.is_connected = false;
+        }
+
+        f.is_probe = false;
+        if (!s.claim(f.first, f.last)) { break; }
+      }
+
+      if (f.is_connected) {
+        BOOST_ASIO_CORO_YIELD f.client->async_shutdown(std::move(*this));
+        ec = {};
+      }
+
+    upcall:
+      finish(ec);
+    }
+  }
+};
+
+struct run_async_download_op
+{
+  template <class Handler, class Sink>
+  auto
+  operator()(Handler&&                    handler,
+             boost::asio::any_io_executor ex,
+             std::string                  host,
+             std::string                  service,
+             std::string                  target,
+             Sink&                        sink,
+             download_opts                opts) -> void
+  {
+    using state_type = download_state<Sink, std::decay_t<Handler>>;
+    using op_type    = download_op<Sink, std::decay_t<Handler>>;
+
+    auto const first = std::uint64_t{0};
+    auto const last  = (std::max)(opts.segment_size, std::uint64_t{1}) - 1;
+
+    auto p = std::make_shared<state_type>(boost::asio::make_strand(ex), std::move(opts),
+                                          std::move(host), std::move(service), std::move(target),
+                                          sink, std::forward<Handler>(handler));
+
+    // the first request doubles as our probe for the size of the object and whether or not the
+    // remote supports range requests
+    //
+    p->active = 1;
+    boost::asio::post(op_type(std::move(p), first, last, true));
+  }
+};
+
+} // namespace detail
+
+// async_download fetches `target` from the remote denoted by `host` and `service` and writes it
+// into the `sink`, using up to `opts.max_connections` parallel range requests when the remote
+// supports them
+//
+template <class Sink, class DownloadHandler>
+auto
+async_download(boost::asio::any_io_executor ex,
+               std::string                  host,
+               std::string                  service,
+               std::string                  target,
+               Sink&                        sink,
+               download_opts                opts,
+               DownloadHandler&&            handler) ->
+  typename boost::asio::async_result<std::decay_t<DownloadHandler>,
+                                     void(boost::system::error_code, std::uint64_t)>::return_type
+{
+  return boost::asio::async_initiate<DownloadHandler,
+                                     void(boost::system::error_code, std::uint64_t)>(
+    ::foxy::detail::run_async_download_op{}, handler, ex, std::move(host), std::move(service),
+    std::move(target), sink, std::move(opts));
+}
+
+} // namespace foxy
+
+#endif // FOXY_DOWNLOAD_HPP_
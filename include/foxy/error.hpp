@@ -19,7 +19,36 @@ enum class error {
   // our pct-decoding function hit a consecutive percent sign which means it doesn't follow a valid
   // grammar for URIs
   //
-  unexpected_pct = 1
+  unexpected_pct = 1,
+
+  // the remote answered with a status code the operation doesn't know how to handle
+  //
+  unexpected_status,
+
+  // the remote's Content-Range was malformed or didn't describe the range that was requested
+  //
+  bad_content_range,
+
+  // a gzip or deflate coded body was malformed, truncated or failed its checksum
+  //
+  bad_content_encoding,
+
+  // the upstream has failed too many times in a row and requests to it are being rejected until it
+  // has had time to recover
+  //
+  circuit_open,
+
+  // the upstream already has as many requests in flight as it's currently allowed
+  //
+  concurrency_limit,
+
+  // an access rule's pattern is neither a domain name nor an address prefix
+  //
+  bad_access_rule,
+
+  // the access policy doesn't allow connecting to the target
+  //
+  access_denied
 };
 }
 
@@ -53,6 +82,13 @@ public:
   {
     switch (static_cast<::foxy::error>(ev)) {
       case ::foxy::error::unexpected_pct: return "consecutive percent sign detected";
+      case ::foxy::error::unexpected_status: return "unexpected HTTP status code";
+      case ::foxy::error::bad_content_range: return "Content-Range does not match the request";
+      case ::foxy::error::bad_content_encoding: return "malformed gzip or deflate coded body";
+      case ::foxy::error::circuit_open: return "circuit open for upstream";
+      case ::foxy::error::concurrency_limit: return "upstream concurrency limit reached";
+      case ::foxy::error::bad_access_rule: return "malformed access rule";
+      case ::foxy::error::access_denied: return "target denied by access policy";
 
       default: return "foxy default error";
     }
@@ -78,7 +114,7 @@ public:
 };
 } // namespace detail
 
-auto
+inline auto
 make_error_code(::foxy::error ev) -> boost::system::error_code
 {
   static detail::foxy_error_category const cat{};
@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_HEALTH_CHECKER_HPP_
+#define FOXY_HEALTH_CHECKER_HPP_
+
+#include <foxy/backend_pool.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace foxy
+{
+struct health_check_opts
+{
+  using duration_type = std::chrono::steady_clock::duration;
+
+  // every backend is probed once per `interval`, a probe that takes longer than `timeout` fails
+  //
+  duration_type interval = std::chrono::seconds{5};
+  duration_type timeout  = std::chrono::seconds{2};
+
+  // the target of the GET each probe sends, anything but a 5xx answer counts as healthy
+  //
+  std::string target = "/";
+};
+
+// health_checker actively probes the backends of a pool and reports the outcomes to it, so that
+// dead backends are ejected before requests run into them and come back as soon as they recover
+//
+struct health_checker : public std::enable_shared_from_this<health_checker>
+{
+public:
+  using executor_type = boost::asio::strand<boost::asio::any_io_executor>;
+
+private:
+  executor_type                         strand_;
+  boost::asio::steady_timer             timer_;
+  std::shared_ptr<::foxy::backend_pool> backends_;
+  health_check_opts                     opts_;
+
+  boost::asio::coroutine coro_;
+  bool                   is_cancelled_ = false;
+
+  auto loop(boost::system::error_code) -> void;
+
+public:
+  health_checker()                      = delete;
+  health_checker(health_checker const&) = delete;
+  health_checker(health_checker&&)      = delete;
+
+  health_checker(boost::asio::any_io_executor          executor,
+                 std::shared_ptr<::foxy::backend_pool> backends,
+                 health_check_opts                     opts = {});
+
+  auto
+  get_executor() -> executor_type;
+
+  // async_run probes every backend straight away and then once per interval until cancelled
+  //
+  auto
+  async_run() -> void;
+
+  auto
+  cancel() -> void;
+};
+
+} // namespace foxy
+
+#endif // FOXY_HEALTH_CHECKER_HPP_
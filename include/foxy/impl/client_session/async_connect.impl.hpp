@@ -11,6 +11,12 @@
 #define FOXY_IMPL_CLIENT_SESSION_ASYNC_CONNECT_IMPL_HPP_
 
 #include <foxy/client_session.hpp>
+#include <foxy/access_list.hpp>
+#include <foxy/error.hpp>
+#include <foxy/detail/op_timer.hpp>
+
+#include <algorithm>
+#include <chrono>
 
 namespace foxy
 {
@@ -26,24 +32,29 @@ struct connect_op : boost::asio::coroutine
     boost::asio::ip::tcp::endpoint               endpoint;
     std::string                                  host;
     std::string                                  service;
+    std::shared_ptr<::foxy::access_list const>   access;
+    std::chrono::steady_clock::time_point        started;
+    ::foxy::detail::op_timer                     timing;
   };
 
-  std::unique_ptr<state, boost::alloc_deleter<state, Allocator>>      p_;
-  ::foxy::basic_session<boost::asio::ip::tcp::socket, DynamicBuffer>& session;
+  std::unique_ptr<state, boost::alloc_deleter<state, Allocator>> p_;
+  ::foxy::basic_client_session<DynamicBuffer>&                   session;
 
   connect_op()                  = delete;
   connect_op(connect_op const&) = delete;
   connect_op(connect_op&&)      = default;
 
-  connect_op(Allocator const&                                                    allocator,
-             Executor                                                            executor,
-             std::string                                                         host_,
-             std::string                                                         service_,
-             ::foxy::basic_session<boost::asio::ip::tcp::socket, DynamicBuffer>& session_)
+  connect_op(Allocator const&                             allocator,
+             Executor                                     executor,
+             std::string                                  host_,
+             std::string                                  service_,
+             ::foxy::basic_client_session<DynamicBuffer>& session_)
     : p_(boost::allocate_unique<state>(
         allocator,
         {boost::asio::ip::tcp::resolver(executor), boost::asio::ip::tcp::resolver::results_type{},
-         boost::asio::ip::tcp::endpoint{}, std::move(host_), std::move(service_)}))
+         boost::asio::ip::tcp::endpoint{}, std::move(host_), std::move(service_), nullptr,
+         std::chrono::steady_clock::now(),
+         ::foxy::detail::op_timer(session_, ::foxy::session_op::connect)}))
     , session(session_)
   {
   }
@@ -85,28 +96,64 @@ struct connect_op : boost::asio::coroutine
     auto& s = *p_;
     BOOST_ASIO_CORO_REENTER(*this)
     {
+      session.connect_time   = std::chrono::steady_clock::duration::zero();
+      session.handshake_time = std::chrono::steady_clock::duration::zero();
+
       BOOST_ASIO_CORO_YIELD s.resolver.async_resolve(
         s.host, s.service, boost::beast::bind_front_handler(std::move(self), on_resolve_t{}));
 
-      if (ec) { goto upcall; }
+      if (ec) {
+        s.timing.stop(session.opts, 0, ec);
+        goto upcall;
+      }
+
+      // the addresses a name resolves to are checked against the access policy before any of them
+      // is connected to, the policy is read once so a reload can't change it halfway through
+      //
+      if (session.opts.access) {
+        s.access = session.opts.access->get();
+
+        auto const is_denied = [&](auto const& entry) {
+          return s.access->match(entry.endpoint().address()) == ::foxy::access_action::deny;
+        };
+
+        if (std::all_of(s.endpoint_range.begin(), s.endpoint_range.end(), is_denied)) {
+          ec = ::foxy::error::access_denied;
+          s.timing.stop(session.opts, 0, ec);
+          goto upcall;
+        }
+      }
 
       BOOST_ASIO_CORO_YIELD boost::asio::async_connect(
         session.stream.plain(), s.endpoint_range,
+        [access = s.access](boost::system::error_code const&,
+                            boost::asio::ip::tcp::endpoint const& endpoint_) {
+          return !access || access->match(endpoint_.address()) != ::foxy::access_action::deny;
+        },
         boost::beast::bind_front_handler(std::move(self), on_connect_t{}));
 
+      s.timing.stop(session.opts, 0, ec);
       if (ec) { goto upcall; }
 
+      session.connect_time = std::chrono::steady_clock::now() - s.started;
+
       if (session.stream.is_ssl()) {
         if (session.opts.verify_peer_cert) {
           ::foxy::certify::set_sni_hostname(session.stream.ssl(), s.host);
           ::foxy::certify::set_server_hostname(session.stream.ssl().native_handle(), s.host);
         }
 
+        s.timing = ::foxy::detail::op_timer(session, ::foxy::session_op::handshake);
+
         BOOST_ASIO_CORO_YIELD
         session.stream.ssl().async_handshake(boost::asio::ssl::stream_base::client,
                                              std::move(self));
 
+        s.timing.stop(session.opts, 0, ec);
         if (ec) { goto upcall; }
+
+        session.handshake_time =
+          std::chrono::steady_clock::now() - s.started - session.connect_time;
       }
 
     upcall:
@@ -11,6 +11,7 @@
 #define FOXY_IMPL_CLIENT_SESSION_ASYNC_REQUEST_IMPL_HPP_
 
 #include <foxy/client_session.hpp>
+#include <foxy/detail/op_timer.hpp>
 
 namespace foxy
 {
@@ -24,7 +25,8 @@ basic_client_session<DynamicBuffer>::async_request(Request const&   request,
                                      void(boost::system::error_code)>::return_type
 {
   return ::foxy::detail::async_timer<void(boost::system::error_code)>(
-    [&request, &parser, self = this, coro = boost::asio::coroutine()](
+    [&request, &parser, self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::write)](
       auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferrred = 0) mutable {
       auto& s = *self;
 
@@ -32,10 +34,14 @@ basic_client_session<DynamicBuffer>::async_request(Request const&   request,
       {
         BOOST_ASIO_CORO_YIELD
         boost::beast::http::async_write(s.stream, request, std::move(cb));
+        op.stop(s.opts, bytes_transferrred, ec);
         if (ec) { goto upcall; }
 
+        op = ::foxy::detail::op_timer(s, ::foxy::session_op::read);
+
         BOOST_ASIO_CORO_YIELD
         boost::beast::http::async_read(s.stream, s.buffer, parser, std::move(cb));
+        op.stop(s.opts, bytes_transferrred, ec);
         if (ec) { goto upcall; }
 
       upcall:
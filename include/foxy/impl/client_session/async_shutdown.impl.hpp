@@ -11,6 +11,7 @@
 #define FOXY_IMPL_CLIENT_SESSION_ASYNC_SHUTDOWN_IMPL_HPP_
 
 #include <foxy/client_session.hpp>
+#include <foxy/detail/op_timer.hpp>
 
 namespace foxy
 {
@@ -22,8 +23,9 @@ basic_client_session<DynamicBuffer>::async_shutdown(ShutdownHandler&& handler) &
                                      void(boost::system::error_code)>::return_type
 {
   return ::foxy::detail::async_timer<void(boost::system::error_code)>(
-    [self = this, coro = boost::asio::coroutine()](auto& cb, boost::system::error_code ec = {},
-                                                   std::size_t bytes_transferrred = 0) mutable {
+    [self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::shutdown)](
+      auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferrred = 0) mutable {
       auto& s = *self;
 
       BOOST_ASIO_CORO_REENTER(coro)
@@ -38,6 +40,7 @@ basic_client_session<DynamicBuffer>::async_shutdown(ShutdownHandler&& handler) &
         s.stream.plain().close(ec);
 
       upcall:
+        op.stop(s.opts, 0, ec);
         return cb.complete(ec);
       }
     },
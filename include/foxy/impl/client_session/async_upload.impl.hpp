@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_IMPL_CLIENT_SESSION_ASYNC_UPLOAD_IMPL_HPP_
+#define FOXY_IMPL_CLIENT_SESSION_ASYNC_UPLOAD_IMPL_HPP_
+
+#include <foxy/client_session.hpp>
+#include <foxy/detail/op_timer.hpp>
+
+#include <boost/beast/http/buffer_body.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/status.hpp>
+#include <boost/beast/core/string.hpp>
+
+namespace foxy
+{
+namespace detail
+{
+// the serializer only ever hands out a const view of the message when the Body is a `buffer_body`
+// but the message itself is owned (mutably) by the user so it's safe to point the body at the next
+// chunk of the upload through it
+//
+template <class Serializer>
+auto
+upload_body(Serializer& serializer) -> boost::beast::http::buffer_body::value_type&
+{
+  return const_cast<boost::beast::http::buffer_body::value_type&>(serializer.get().body());
+}
+
+template <class Fields>
+auto
+expects_continue(Fields const& fields) -> bool
+{
+  return boost::beast::iequals(fields[boost::beast::http::field::expect], "100-continue");
+}
+
+} // namespace detail
+
+template <class DynamicBuffer>
+template <class Serializer, class InterimParser, class UploadHandler>
+auto
+basic_client_session<DynamicBuffer>::async_upload_header(Serializer&     serializer,
+                                                         InterimParser&  parser,
+                                                         UploadHandler&& handler) & ->
+  typename boost::asio::async_result<std::decay_t<UploadHandler>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  return ::foxy::detail::async_timer<void(boost::system::error_code, bool)>(
+    [&serializer, &parser, self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::write_header)](
+      auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0) mutable {
+      auto& s = *self;
+
+      BOOST_ASIO_CORO_REENTER(coro)
+      {
+        BOOST_ASIO_CORO_YIELD
+        boost::beast::http::async_write_header(s.stream, serializer, std::move(cb));
+        op.stop(s.opts, bytes_transferred, ec);
+        if (ec) { goto upcall; }
+
+        // without an `Expect: 100-continue` there's nothing to wait for and the caller is free to
+        // begin sending the body immediately
+        //
+        if (!::foxy::detail::expects_continue(serializer.get())) {
+          return cb.complete(boost::system::error_code{}, true);
+        }
+
+        // otherwise, the server either gives us the go-ahead or it answers with the final
+        // response, in which case the body must never be sent and the caller reads the rest of
+        // the response using the header we've just parsed
+        //
+        op = ::foxy::detail::op_timer(s, ::foxy::session_op::read_header);
+
+        BOOST_ASIO_CORO_YIELD
+        boost::beast::http::async_read_header(s.stream, s.buffer, parser, std::move(cb));
+        op.stop(s.opts, bytes_transferred, ec);
+        if (ec) { goto upcall; }
+
+        return cb.complete(boost::system::error_code{},
+                           parser.get().result() == boost::beast::http::status::continue_);
+
+      upcall:
+        cb.complete(ec, false);
+      }
+    },
+    *this, std::forward<UploadHandler>(handler));
+}
+
+template <class DynamicBuffer>
+template <class Serializer, class UploadHandler>
+auto
+basic_client_session<DynamicBuffer>::async_upload_chunk(Serializer&               serializer,
+                                                        boost::asio::const_buffer chunk,
+                                                        UploadHandler&&           handler) & ->
+  typename boost::asio::async_result<std::decay_t<UploadHandler>,
+                                     void(boost::system::error_code, std::size_t)>::return_type
+{
+  return ::foxy::detail::async_timer<void(boost::system::error_code, std::size_t)>(
+    [&serializer, chunk, self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::write)](
+      auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0) mutable {
+      auto& s    = *self;
+      auto& body = ::foxy::detail::upload_body(serializer);
+
+      BOOST_ASIO_CORO_REENTER(coro)
+      {
+        body.data = chunk.size() > 0 ? const_cast<void*>(chunk.data()) : nullptr;
+        body.size = chunk.size();
+        body.more = true;
+
+        // the serializer hands back `need_buffer` once it's drained the chunk which is exactly
+        // when the producer is allowed to hand us more data
+        //
+        BOOST_ASIO_CORO_YIELD
+        boost::beast::http::async_write(s.stream, serializer, std::move(cb));
+        if (ec == boost::beast::http::error::need_buffer) { ec = {}; }
+        op.stop(s.opts, bytes_transferred, ec);
+
+        body.data = nullptr;
+        body.size = 0;
+
+        cb.complete(ec, bytes_transferred);
+      }
+    },
+    *this, std::forward<UploadHandler>(handler));
+}
+
+template <class DynamicBuffer>
+template <class Serializer, class UploadHandler>
+auto
+basic_client_session<DynamicBuffer>::async_upload_finish(Serializer&     serializer,
+                                                         UploadHandler&& handler) & ->
+  typename boost::asio::async_result<std::decay_t<UploadHandler>,
+                                     void(boost::system::error_code, std::size_t)>::return_type
+{
+  return ::foxy::detail::async_timer<void(boost::system::error_code, std::size_t)>(
+    [&serializer, self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::write)](
+      auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0) mutable {
+      auto& s    = *self;
+      auto& body = ::foxy::detail::upload_body(serializer);
+
+      BOOST_ASIO_CORO_REENTER(coro)
+      {
+        body.data = nullptr;
+        body.size = 0;
+        body.more = false;
+
+        BOOST_ASIO_CORO_YIELD
+        boost::beast::http::async_write(s.stream, serializer, std::move(cb));
+        op.stop(s.opts, bytes_transferred, ec);
+
+        cb.complete(ec, bytes_transferred);
+      }
+    },
+    *this, std::forward<UploadHandler>(handler));
+}
+
+} // namespace foxy
+
+#endif // FOXY_IMPL_CLIENT_SESSION_ASYNC_UPLOAD_IMPL_HPP_
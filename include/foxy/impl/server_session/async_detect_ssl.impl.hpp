@@ -27,6 +27,8 @@ basic_server_session<DynamicBuffer>::async_detect_ssl(DetectHandler&& handler) &
       auto& s = *self;
       BOOST_ASIO_CORO_REENTER(coro)
       {
+        s.current_op = ::foxy::session_op::read_header;
+
         BOOST_ASIO_CORO_YIELD boost::beast::async_detect_ssl(s.stream, s.buffer, std::move(cb));
         return cb.complete(ec, detected_ssl);
       }
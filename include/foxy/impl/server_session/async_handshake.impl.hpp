@@ -11,6 +11,7 @@
 #define FOXY_IMPL_SERVER_SESSION_ASYNC_HANDSHAKE_HPP_
 
 #include <foxy/server_session.hpp>
+#include <foxy/detail/op_timer.hpp>
 
 namespace foxy
 {
@@ -22,8 +23,9 @@ basic_server_session<DynamicBuffer>::async_handshake(HandshakeHandler&& handler)
                                      void(boost::system::error_code, std::size_t)>::return_type
 {
   return ::foxy::detail::async_timer<void(boost::system::error_code, std::size_t)>(
-    [self = this, coro = boost::asio::coroutine()](auto& cb, boost::system::error_code ec = {},
-                                                   std::size_t bytes_transferred = 0) mutable {
+    [self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::handshake)](
+      auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0) mutable {
       auto& s = *self;
       BOOST_ASIO_CORO_REENTER(coro)
       {
@@ -37,6 +39,7 @@ basic_server_session<DynamicBuffer>::async_handshake(HandshakeHandler&& handler)
 
           s.buffer.consume(bytes_transferred);
 
+          op.stop(s.opts, bytes_transferred);
           return cb.complete(boost::system::error_code{}, bytes_transferred);
         }
 
@@ -44,9 +47,11 @@ basic_server_session<DynamicBuffer>::async_handshake(HandshakeHandler&& handler)
         s.stream.ssl().async_handshake(boost::asio::ssl::stream_base::server, std::move(cb));
         if (ec) { goto upcall; }
 
+        op.stop(s.opts);
         return cb.complete(boost::system::error_code{}, 0);
 
       upcall:
+        op.stop(s.opts, 0, ec);
         return cb.complete(ec, 0);
       }
     },
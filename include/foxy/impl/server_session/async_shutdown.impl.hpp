@@ -11,6 +11,7 @@
 #define FOXY_IMPL_SERVER_SESSION_ASYNC_SHUTDOWN_IMPL_HPP_
 
 #include <foxy/server_session.hpp>
+#include <foxy/detail/op_timer.hpp>
 
 namespace foxy
 {
@@ -22,8 +23,9 @@ basic_server_session<DynamicBuffer>::async_shutdown(ShutdownHandler&& handler) &
                                      void(boost::system::error_code)>::return_type
 {
   return ::foxy::detail::async_timer<void(boost::system::error_code, std::size_t)>(
-    [self = this, coro = boost::asio::coroutine()](auto& cb, boost::system::error_code ec = {},
-                                                   std::size_t bytes_transferred = 0) mutable {
+    [self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::shutdown)](
+      auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0) mutable {
       auto& s = *self;
       BOOST_ASIO_CORO_REENTER(coro)
       {
@@ -50,6 +52,7 @@ basic_server_session<DynamicBuffer>::async_shutdown(ShutdownHandler&& handler) &
         s.stream.plain().shutdown(boost::asio::ip::tcp::socket::shutdown_receive, ec);
         s.stream.plain().close(ec);
 
+        op.stop(s.opts, 0, ec);
         return cb.complete(ec, 0);
       }
     },
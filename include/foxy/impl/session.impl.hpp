@@ -11,6 +11,7 @@
 #define FOXY_SESSION_IMPL_HPP_
 
 #include <foxy/session.hpp>
+#include <foxy/detail/op_timer.hpp>
 
 namespace foxy
 {
@@ -23,6 +24,7 @@ foxy::basic_session<Stream, DynamicBuffer>::basic_session(boost::asio::any_io_ex
   , stream(opts.ssl_ctx ? stream_type(executor, *opts.ssl_ctx) : stream_type(executor))
   , buffer(std::forward<BufferArgs>(bargs)...)
   , timer(executor)
+  , id(::foxy::detail::next_session_id())
 {
 }
 
@@ -35,6 +37,7 @@ foxy::basic_session<Stream, DynamicBuffer>::basic_session(boost::asio::io_contex
   , stream(opts.ssl_ctx ? stream_type(io, *opts.ssl_ctx) : stream_type(io))
   , buffer(std::forward<BufferArgs>(bargs)...)
   , timer(io)
+  , id(::foxy::detail::next_session_id())
 {
 }
 
@@ -47,6 +50,7 @@ foxy::basic_session<Stream, DynamicBuffer>::basic_session(stream_type  stream_,
   , stream(std::move(stream_))
   , buffer(std::forward<BufferArgs>(bargs)...)
   , timer(stream.get_executor())
+  , id(::foxy::detail::next_session_id())
 {
 }
 
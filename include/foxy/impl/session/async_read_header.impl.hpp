@@ -12,6 +12,7 @@
 
 #include <foxy/session.hpp>
 #include <foxy/detail/timed_op_wrapper_v3.hpp>
+#include <foxy/detail/op_timer.hpp>
 
 namespace foxy
 {
@@ -23,13 +24,15 @@ basic_session<Stream, DynamicBuffer>::async_read_header(Parser& parser, ReadHand
                                      void(boost::system::error_code, std::size_t)>::return_type
 {
   return ::foxy::detail::async_timer<void(boost::system::error_code, std::size_t)>(
-    [&parser, self = this, coro = boost::asio::coroutine()](
+    [&parser, self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::read_header)](
       auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferrred = 0) mutable {
       BOOST_ASIO_CORO_REENTER(coro)
       {
         BOOST_ASIO_CORO_YIELD boost::beast::http::async_read_header(self->stream, self->buffer,
                                                                     parser, std::move(cb));
 
+        op.stop(self->opts, bytes_transferrred, ec);
         cb.complete(ec, bytes_transferrred);
       }
     },
@@ -12,6 +12,7 @@
 
 #include <foxy/session.hpp>
 #include <foxy/detail/timed_op_wrapper_v3.hpp>
+#include <foxy/detail/op_timer.hpp>
 
 namespace foxy
 {
@@ -24,13 +25,15 @@ basic_session<Stream, DynamicBuffer>::async_write(Serializer&    serializer,
                                      void(boost::system::error_code, std::size_t)>::return_type
 {
   return ::foxy::detail::async_timer<void(boost::system::error_code, std::size_t)>(
-    [&serializer, self = this, coro = boost::asio::coroutine()](
+    [&serializer, self = this, coro = boost::asio::coroutine(),
+     op = ::foxy::detail::op_timer(*this, ::foxy::session_op::write)](
       auto& cb, boost::system::error_code ec = {}, std::size_t bytes_transferrred = 0) mutable {
       BOOST_ASIO_CORO_REENTER(coro)
       {
         BOOST_ASIO_CORO_YIELD boost::beast::http::async_write(self->stream, serializer,
                                                               std::move(cb));
 
+        op.stop(self->opts, bytes_transferrred, ec);
         cb.complete(ec, bytes_transferrred);
       }
     },
@@ -12,6 +12,8 @@
 
 #include <foxy/session.hpp>
 #include <foxy/multi_stream.hpp>
+#include <foxy/detail/upstream_pool.hpp>
+#include <foxy/detail/response_cache.hpp>
 
 #include <boost/beast/http/serializer.hpp>
 #include <boost/beast/http/buffer_body.hpp>
@@ -47,6 +49,14 @@ private:
   executor_type        strand_;
   ::foxy::session_opts client_opts_;
 
+  // idle upstream connections shared by every client of the proxy, null when pooling is disabled
+  //
+  std::shared_ptr<::foxy::detail::upstream_pool> upstreams_;
+
+  // the proxy's HTTP cache, null unless `client_opts.cache_max_bytes` is set
+  //
+  std::shared_ptr<::foxy::detail::response_cache> cache_;
+
   boost::asio::coroutine accept_coro_;
 
   auto loop(boost::system::error_code) -> void;
@@ -61,12 +71,20 @@ public:
         bool                     reuse_addr  = false,
         session_opts             client_opts = {});
 
+  // takes over an acceptor that is already bound and listening, sessions accepted by the proxy run
+  // on the acceptor's executor
+  //
+  explicit proxy(acceptor_type acceptor, session_opts client_opts = {});
+
   auto
   get_executor() -> executor_type;
 
   auto
   async_accept() -> void;
 
+  // cancel stops accepting and closes the idle upstream connections, the connections already
+  // accepted are left to finish
+  //
   auto
   cancel() -> void;
 };
@@ -10,6 +10,7 @@
 #ifndef FOXY_SESSION_HPP_
 #define FOXY_SESSION_HPP_
 
+#include <foxy/session_op.hpp>
 #include <foxy/session_opts.hpp>
 #include <foxy/multi_stream.hpp>
 #include <foxy/type_traits.hpp>
@@ -26,6 +27,8 @@
 #include <boost/beast/http/write.hpp>
 #include <boost/beast/core/flat_buffer.hpp>
 
+#include <cstdint>
+
 namespace foxy
 {
 template <class Stream, class DynamicBuffer>
@@ -49,6 +52,14 @@ public:
   buffer_type  buffer;
   timer_type   timer;
 
+  // unique to each session in the process, it's how a tracer tells sessions apart
+  //
+  std::uint64_t id;
+
+  // the operation the session is in the middle of, a timeout or an error is counted against it
+  //
+  ::foxy::session_op current_op = ::foxy::session_op::read_header;
+
   basic_session()                     = delete;
   basic_session(basic_session const&) = delete;
   basic_session(basic_session&&)      = default;
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SESSION_ERRORS_HPP_
+#define FOXY_SESSION_ERRORS_HPP_
+
+#include <foxy/session_op.hpp>
+
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace foxy
+{
+// error_class sorts the errors a session's operations fail with into the few kinds worth telling
+// apart when tuning timeouts and limits
+//
+enum class error_class : unsigned char
+{
+  eof,
+  reset,
+  refused,
+  aborted,
+  resolve,
+  tls,
+  http,
+  other
+};
+
+constexpr std::size_t error_class_count = 8;
+
+auto
+classify(boost::system::error_code ec) noexcept -> error_class;
+
+auto
+to_string(error_class ec) noexcept -> boost::string_view;
+
+// is_failure is false for success and for the errors healthy sessions complete with all the time,
+// like the `need_buffer` of a read that filled the buffer of a `buffer_body`
+//
+auto
+is_failure(boost::system::error_code ec) noexcept -> bool;
+
+// session_errors counts how the operations of the sessions it's attached to fail
+//
+// An operation whose `session_opts::timeout` runs out is counted as a timeout of whatever the
+// session was doing at that point, along with the budget it had and how long it actually ran
+// before the session's timer closed the stream. Every other failure is counted by its
+// `error_class`. The errors a timed out operation completes with aren't counted again.
+//
+// All member functions are safe to call concurrently.
+//
+struct session_errors
+{
+public:
+  using duration_type = std::chrono::steady_clock::duration;
+
+  struct phase
+  {
+    std::uint64_t timeouts = 0;
+
+    // `budget` is the timeout of the latest operation that ran out of time, `elapsed_total` and
+    // `elapsed_max` add up how long the timed out operations ran
+    //
+    duration_type budget        = duration_type::zero();
+    duration_type elapsed_total = duration_type::zero();
+    duration_type elapsed_max   = duration_type::zero();
+
+    std::array<std::uint64_t, error_class_count> errors = {};
+
+    auto
+    operator[](error_class ec) const noexcept -> std::uint64_t;
+  };
+
+  struct snapshot_type
+  {
+    std::array<phase, session_op_count> phases;
+
+    auto
+    operator[](session_op op) const noexcept -> phase const&;
+
+    auto
+    timeouts() const noexcept -> std::uint64_t;
+
+    auto
+    errors(error_class ec) const noexcept -> std::uint64_t;
+  };
+
+  session_errors() = default;
+
+  session_errors(session_errors const&) = delete;
+  session_errors(session_errors&&)      = delete;
+
+  auto
+  on_timeout(session_op op, duration_type budget, duration_type elapsed) noexcept -> void;
+
+  auto
+  on_error(session_op op, boost::system::error_code ec) noexcept -> void;
+
+  auto
+  snapshot() const -> snapshot_type;
+
+  auto
+  reset() noexcept -> void;
+
+private:
+  struct counters
+  {
+    std::atomic<std::uint64_t>                                timeouts{0};
+    std::atomic<duration_type::rep>                           budget{0};
+    std::atomic<duration_type::rep>                           elapsed_total{0};
+    std::atomic<duration_type::rep>                           elapsed_max{0};
+    std::array<std::atomic<std::uint64_t>, error_class_count> errors = {};
+  };
+
+  std::array<counters, session_op_count> phases_;
+};
+
+} // namespace foxy
+
+#endif // FOXY_SESSION_ERRORS_HPP_
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SESSION_HISTOGRAMS_HPP_
+#define FOXY_SESSION_HISTOGRAMS_HPP_
+
+#include <foxy/session_op.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace foxy
+{
+// histogram counts unsigned values in log-linear buckets, the way HdrHistogram does
+//
+// Values below 32 get a bucket each, every power of two above that is split into 32 buckets so a
+// value is never reported more than about 3% off. Values past 2^36 land in the last bucket, which
+// still reports the largest value seen.
+//
+struct histogram
+{
+public:
+  static constexpr unsigned    sub_bucket_bits  = 5;
+  static constexpr unsigned    max_exponent     = 36;
+  static constexpr std::size_t sub_bucket_count = std::size_t{1} << sub_bucket_bits;
+  static constexpr std::size_t bucket_count =
+    (max_exponent - sub_bucket_bits + 1) * sub_bucket_count;
+
+  histogram();
+
+  auto
+  record(std::uint64_t value) noexcept -> void;
+
+  auto
+  merge(histogram const& other) noexcept -> void;
+
+  auto
+  count() const noexcept -> std::uint64_t;
+
+  auto
+  min() const noexcept -> std::uint64_t;
+
+  auto
+  max() const noexcept -> std::uint64_t;
+
+  auto
+  mean() const noexcept -> std::uint64_t;
+
+  // value_at_percentile returns the largest value in the bucket holding the `percentile`th value,
+  // a percentile of 99.9 gives the p999
+  //
+  auto
+  value_at_percentile(double percentile) const noexcept -> std::uint64_t;
+
+private:
+  std::vector<std::uint64_t> buckets_;
+
+  std::uint64_t count_ = 0;
+  std::uint64_t sum_   = 0;
+  std::uint64_t min_   = 0;
+  std::uint64_t max_   = 0;
+};
+
+// session_histograms records how long each operation of the sessions it's attached to takes, and
+// how many bytes it moves
+//
+// Attach one to `session_opts::histograms` and every `async_read_header`, `async_read`,
+// `async_write_header`, `async_write`, connect, TLS handshake and shutdown of those sessions is
+// recorded as it completes, failed ones included. A proxy also records its relays and the requests
+// it answers.
+//
+// Recording goes to one of a number of shards picked by the recording thread so that sessions
+// running on different threads rarely share a lock, a snapshot merges all of them.
+//
+// All member functions are safe to call concurrently.
+//
+struct session_histograms
+{
+public:
+  using clock_type    = std::chrono::steady_clock;
+  using duration_type = clock_type::duration;
+
+  // phase is everything recorded for a single kind of operation, `latency` is in nanoseconds
+  //
+  struct phase
+  {
+    histogram     latency;
+    std::uint64_t bytes = 0;
+
+    auto
+    count() const noexcept -> std::uint64_t;
+
+    auto
+    percentile(double p) const noexcept -> duration_type;
+  };
+
+  struct snapshot_type
+  {
+    std::array<phase, session_op_count> phases;
+
+    auto
+    operator[](session_op op) const noexcept -> phase const&;
+  };
+
+  // a `shard_count` of zero uses one shard per hardware thread
+  //
+  explicit session_histograms(std::size_t shard_count = 0);
+
+  session_histograms(session_histograms const&) = delete;
+  session_histograms(session_histograms&&)      = delete;
+
+  auto
+  record(session_op op, duration_type elapsed, std::size_t bytes) -> void;
+
+  auto
+  snapshot() const -> snapshot_type;
+
+  auto
+  reset() -> void;
+
+private:
+  struct shard
+  {
+    std::mutex                          mtx;
+    std::array<phase, session_op_count> phases;
+  };
+
+  std::vector<std::unique_ptr<shard>> shards_;
+};
+
+} // namespace foxy
+
+#endif // FOXY_SESSION_HISTOGRAMS_HPP_
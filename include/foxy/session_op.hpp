@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SESSION_OP_HPP_
+#define FOXY_SESSION_OP_HPP_
+
+#include <boost/utility/string_view.hpp>
+
+#include <cstddef>
+
+namespace foxy
+{
+// session_op names the operations that sessions time for their histograms and tracer
+//
+// `relay` is a whole request and response relayed through the proxy and `tunnel` is everything the
+// proxy does for a single request of a client, from its header arriving until it's been answered
+//
+enum class session_op : unsigned char
+{
+  read_header,
+  read,
+  write_header,
+  write,
+  connect,
+  handshake,
+  shutdown,
+  relay,
+  tunnel
+};
+
+constexpr std::size_t session_op_count = 9;
+
+inline auto
+to_string(session_op const op) noexcept -> boost::string_view
+{
+  switch (op) {
+    case session_op::read_header:
+      return "read_header";
+    case session_op::read:
+      return "read";
+    case session_op::write_header:
+      return "write_header";
+    case session_op::write:
+      return "write";
+    case session_op::connect:
+      return "connect";
+    case session_op::handshake:
+      return "handshake";
+    case session_op::shutdown:
+      return "shutdown";
+    case session_op::relay:
+      return "relay";
+    case session_op::tunnel:
+      return "tunnel";
+  }
+  return "unknown";
+}
+
+} // namespace foxy
+
+#endif // FOXY_SESSION_OP_HPP_
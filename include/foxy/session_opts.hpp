@@ -15,8 +15,20 @@
 
 #include <boost/optional/optional.hpp>
 
+#include <cstddef>
+#include <memory>
+#include <string>
+
 namespace foxy
 {
+struct access_log;
+struct access_policy;
+struct backend_pool;
+struct session_errors;
+struct session_histograms;
+struct tracer;
+struct tunnel_metrics;
+
 struct session_opts
 {
   using duration_type = typename boost::asio::steady_timer::duration;
@@ -24,6 +36,95 @@ struct session_opts
   boost::optional<boost::asio::ssl::context&> ssl_ctx          = {};
   duration_type                               timeout          = std::chrono::seconds{1};
   bool                                        verify_peer_cert = true;
+
+  // the relay options are read from the client session of a relay, i.e. the proxy's `client_opts`
+  //
+  // bodies start out being moved `relay_buffer_min` bytes at a time, the buffer doubles every time
+  // a read fills it until it reaches `relay_buffer_max`
+  //
+  // with `relay_full_duplex`, a request body is forwarded upstream while the response is relayed
+  // back instead of before it
+  //
+  std::size_t relay_buffer_min  = 4 * 1024;
+  std::size_t relay_buffer_max  = 256 * 1024;
+  bool        relay_full_duplex = false;
+
+  // when set on the proxy's client options, CONNECT tunnels between two plain sockets skip HTTP
+  // relaying and pump opaque bytes instead, a tunnel that moves nothing in any of its open
+  // directions for `tunnel_idle_timeout` is closed
+  //
+  bool          raw_tunnel          = false;
+  duration_type tunnel_idle_timeout = std::chrono::seconds{60};
+
+  // limits on a client connection to the proxy as a whole, however many requests or tunnels it
+  // carries, zero turns a limit off
+  //
+  // the connection is closed once it's been open for `tunnel_max_lifetime`, and a relayed body or
+  // raw tunnel that moves fewer than `tunnel_min_rate` bytes per second over a `tunnel_rate_window`
+  // is aborted even if every single read finishes within `timeout`
+  //
+  duration_type tunnel_max_lifetime = duration_type::zero();
+  std::size_t   tunnel_min_rate     = 0;
+  duration_type tunnel_rate_window  = std::chrono::seconds{10};
+
+  // with a `deadline_header`, that header of a relayed request is read as the number of
+  // milliseconds the client is willing to wait and is passed upstream with the time spent in the
+  // proxy taken off, capped by what's left of `tunnel_max_lifetime`, a request whose budget runs
+  // out before it's sent is answered with a 504
+  //
+  std::string deadline_header = {};
+
+  // the proxy keeps up to `max_idle_upstreams` idle keep-alive connections per origin around for
+  // absolute-form requests and drops them after `upstream_idle_timeout`, a max of 0 turns pooling
+  // off so that every such request gets its own upstream connection
+  //
+  std::size_t   max_idle_upstreams    = 8;
+  duration_type upstream_idle_timeout = std::chrono::seconds{30};
+
+  // a non-zero `cache_max_bytes` gives the proxy a shared HTTP cache of that size for GETs of
+  // absolute-form URIs, responses with bodies over `cache_max_object_size` are relayed but not kept
+  //
+  std::size_t cache_max_bytes       = 0;
+  std::size_t cache_max_object_size = 1024 * 1024;
+
+  // with a `cache_spill_path`, responses the cache evicts from memory are written to files in that
+  // directory and mapped back in, up to `cache_spill_max_bytes` of them
+  //
+  std::string cache_spill_path      = {};
+  std::size_t cache_spill_max_bytes = 0;
+
+  // setting `backends` turns the proxy into a reverse proxy, every request that isn't a CONNECT is
+  // sent to one of the pool's backends instead of the origin the client names
+  //
+  std::shared_ptr<::foxy::backend_pool> backends = nullptr;
+
+  // a client session with an `access` policy doesn't connect to addresses the policy denies, a
+  // forward proxy also refuses hosts it denies by name
+  //
+  std::shared_ptr<::foxy::access_policy> access = nullptr;
+
+  // the proxy records every request it answers and every tunnel it closes in `access_log`
+  //
+  std::shared_ptr<::foxy::access_log> access_log = nullptr;
+
+  // the proxy tracks each of its client connections in `tunnel_metrics`, bytes relayed, upstream
+  // latencies and kernel TCP samples included
+  //
+  std::shared_ptr<::foxy::tunnel_metrics> tunnel_metrics = nullptr;
+
+  // every read, write, connect, handshake and shutdown of a session is timed into `histograms`,
+  // sessions can share one
+  //
+  std::shared_ptr<::foxy::session_histograms> histograms = nullptr;
+
+  // `tracer` is told when each of those operations starts and ends, a proxy also traces its relays
+  // and every request it answers
+  //
+  std::shared_ptr<::foxy::tracer> tracer = nullptr;
+
+  // each operation of the session that runs out of `timeout` or fails is counted in `errors`
+  //
+  std::shared_ptr<::foxy::session_errors> errors = nullptr;
 };
 } // namespace foxy
 
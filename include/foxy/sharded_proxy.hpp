@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SHARDED_PROXY_HPP_
+#define FOXY_SHARDED_PROXY_HPP_
+
+#include <foxy/proxy.hpp>
+#include <foxy/session_opts.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace foxy
+{
+// sharded_proxy runs one foxy::proxy per thread, each with its own io_context and its own acceptor
+// bound to the same endpoint via SO_REUSEPORT so the kernel spreads incoming connections across the
+// threads
+//
+// Every connection lives out its life on the thread that accepted it, both of a tunnel's sessions
+// and its upstream connection pool included, so shards share nothing
+//
+// On platforms without SO_REUSEPORT the proxy runs a single shard
+//
+struct sharded_proxy
+{
+public:
+  using endpoint_type = boost::asio::ip::tcp::endpoint;
+  using duration_type = std::chrono::steady_clock::duration;
+
+private:
+  // a shard's io_context runs out of work, and its thread makes good on `drained`, once its
+  // acceptor is closed and the last of its connections is done
+  //
+  struct shard
+  {
+    boost::asio::io_context      io;
+    std::shared_ptr<foxy::proxy> proxy;
+    std::thread                  thread;
+    std::future<void>            drained;
+
+    shard() : io(1) {}
+  };
+
+  std::vector<std::unique_ptr<shard>> shards_;
+  endpoint_type                       endpoint_;
+
+public:
+  sharded_proxy()                     = delete;
+  sharded_proxy(sharded_proxy const&) = delete;
+  sharded_proxy(sharded_proxy&&)      = delete;
+
+  sharded_proxy(endpoint_type const& endpoint,
+                std::size_t          num_shards  = std::thread::hardware_concurrency(),
+                session_opts         client_opts = {});
+
+  ~sharded_proxy();
+
+  // the endpoint all of the shards are listening on, useful when binding to port 0
+  //
+  auto
+  local_endpoint() const -> endpoint_type;
+
+  auto
+  size() const noexcept -> std::size_t;
+
+  // run starts accepting on every shard, each in its own thread, and returns immediately
+  //
+  auto
+  run() -> void;
+
+  // stop closes the acceptors and gives the connections still in flight `drain_timeout` to finish,
+  // the ones that haven't by then are aborted, and joins the threads
+  //
+  auto
+  stop(duration_type drain_timeout = std::chrono::seconds{10}) -> void;
+};
+
+} // namespace foxy
+
+#endif // FOXY_SHARDED_PROXY_HPP_
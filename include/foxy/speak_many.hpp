@@ -0,0 +1,386 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SPEAK_MANY_HPP_
+#define FOXY_SPEAK_MANY_HPP_
+
+#include <foxy/client_session.hpp>
+#include <foxy/error.hpp>
+#include <foxy/session_opts.hpp>
+#include <foxy/upstream_health.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/core/async_base.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace foxy
+{
+// speak_target is the default target type for `speak_many`
+// Users are free to supply their own type so long as it has `host` and `service` members that are
+// convertible to `std::string`
+//
+struct speak_target
+{
+  std::string host;
+  std::string service;
+  std::string target = "/";
+};
+
+struct speak_many_opts
+{
+  // the maximum number of connections open at any one time, across all hosts
+  //
+  std::size_t max_connections = 64;
+
+  // the maximum number of connections open to a single host:service pair
+  //
+  std::size_t max_connections_per_host = 6;
+
+  // the options each underlying `client_session` is constructed with
+  //
+  session_opts session = {};
+
+  // when set, every request is made with a permit from `health` so that a failing upstream has its
+  // requests rejected up front and an overloaded one is given fewer connections
+  //
+  std::shared_ptr<upstream_health> health = nullptr;
+
+  // how long a connection waits before it asks `health` again after being refused a permit because
+  // the upstream is at its concurrency limit
+  //
+  std::chrono::steady_clock::duration permit_retry_interval = std::chrono::milliseconds{50};
+};
+
+namespace detail
+{
+// ignore_done stands in for the completion handler of the `speak_many` overload without one
+//
+struct ignore_done
+{
+  auto
+  operator()() const noexcept -> void
+  {
+  }
+};
+
+template <class Target, class RequestFactory, class ResultHandler, class DoneHandler>
+struct speak_many_state
+{
+  using executor_type = boost::asio::strand<boost::asio::any_io_executor>;
+
+  struct host_state
+  {
+    std::string        host;
+    std::string        service;
+    std::deque<Target> queued;
+    std::size_t        active      = 0;
+    bool               is_runnable = false;
+  };
+
+  executor_type   strand;
+  speak_many_opts opts;
+  RequestFactory  request_factory;
+  ResultHandler   on_result;
+
+  boost::beast::async_base<DoneHandler, boost::asio::any_io_executor> done;
+
+  std::unordered_map<std::string, host_state> hosts;
+
+  // the hosts that have queued targets and room for another connection, serviced round-robin so
+  // that a single large host can't starve the rest
+  //
+  std::deque<host_state*> runnable;
+  std::size_t             active = 0;
+
+  // the targets that are yet to be reported to `on_result`
+  //
+  std::size_t remaining = 0;
+
+  speak_many_state(boost::asio::any_io_executor ex,
+                   speak_many_opts              opts_,
+                   RequestFactory&&             request_factory_,
+                   ResultHandler&&              on_result_,
+                   DoneHandler&&                done_)
+    : strand(boost::asio::make_strand(ex))
+    , opts(std::move(opts_))
+    , request_factory(std::move(request_factory_))
+    , on_result(std::move(on_result_))
+    , done(std::move(done_), ex)
+  {
+    if (opts.max_connections == 0) { opts.max_connections = 1; }
+    if (opts.max_connections_per_host == 0) { opts.max_connections_per_host = 1; }
+  }
+
+  auto
+  enqueue(Target target) -> void
+  {
+    auto key = static_cast<std::string>(target.host);
+    key += ':';
+    key += static_cast<std::string>(target.service);
+
+    auto& h = hosts[key];
+    if (h.host.empty()) {
+      h.host    = static_cast<std::string>(target.host);
+      h.service = static_cast<std::string>(target.service);
+    }
+
+    h.queued.push_back(std::move(target));
+    ++remaining;
+    make_runnable(h);
+  }
+
+  // report hands a target's outcome to `on_result` and completes `done` after the last one
+  //
+  auto
+  report(Target const& target, boost::system::error_code ec) -> void
+  {
+    on_result(target, ec);
+    if (--remaining == 0) { done.complete(false); }
+  }
+
+  auto
+  host_limit(host_state const& h) const -> std::size_t
+  {
+    if (!opts.health) { return opts.max_connections_per_host; }
+
+    auto const limit = (std::max)(opts.health->limit(h.host, h.service), std::size_t{1});
+    return (std::min)(limit, opts.max_connections_per_host);
+  }
+
+  auto
+  make_runnable(host_state& h) -> void
+  {
+    if (h.is_runnable || h.queued.empty() || h.active >= host_limit(h)) { return; }
+
+    h.is_runnable = true;
+    runnable.push_back(std::addressof(h));
+  }
+};
+
+template <class Target, class RequestFactory, class ResultHandler, class DoneHandler>
+struct speak_many_op : boost::asio::coroutine
+{
+  using state_type    = speak_many_state<Target, RequestFactory, ResultHandler, DoneHandler>;
+  using host_type     = typename state_type::host_state;
+  using executor_type = typename state_type::executor_type;
+
+  std::shared_ptr<state_type>                p_;
+  host_type&                                 h;
+  std::unique_ptr<::foxy::client_session>    client;
+  std::unique_ptr<Target>                    target;
+  std::unique_ptr<boost::asio::steady_timer> retry_timer;
+  upstream_health::permit                    permit;
+  bool                                       is_connected = false;
+  bool                                       is_permitted = true;
+
+  speak_many_op()                     = delete;
+  speak_many_op(speak_many_op const&) = delete;
+  speak_many_op(speak_many_op&&)      = default;
+
+  speak_many_op(std::shared_ptr<state_type> p, host_type& h_, Target target_)
+    : p_(std::move(p))
+    , h(h_)
+    , client(std::make_unique<::foxy::client_session>(p_->strand, p_->opts.session))
+    , target(std::make_unique<Target>(std::move(target_)))
+  {
+  }
+
+  auto
+  get_executor() const noexcept -> executor_type
+  {
+    return p_->strand;
+  }
+
+  // keep_alive is supplied by the user's request operation and denotes whether or not the
+  // connection may be used for the next request to the same host
+  //
+  auto operator()(boost::system::error_code ec = {}, bool keep_alive = false) -> void
+  {
+    auto& s = *p_;
+    BOOST_ASIO_CORO_REENTER(*this)
+    {
+      while (true) {
+        if (s.opts.health) {
+          permit       = s.opts.health->try_acquire(h.host, h.service, ec);
+          is_permitted = !ec;
+
+          // only an open circuit fails the target, an upstream at its concurrency limit is just
+          // busy so the target waits for a permit instead
+          //
+          if (ec == ::foxy::error::concurrency_limit) {
+            // our own connections to the host are over its lowered limit, the others take the
+            // target over as they finish
+            //
+            if (h.active > s.host_limit(h)) {
+              h.queued.push_front(std::move(*target));
+              break;
+            }
+
+            if (!retry_timer) {
+              retry_timer = std::make_unique<boost::asio::steady_timer>(s.strand);
+            }
+            retry_timer->expires_after(s.opts.permit_retry_interval);
+
+            BOOST_ASIO_CORO_YIELD retry_timer->async_wait(std::move(*this));
+            continue;
+          }
+        }
+
+        if (is_permitted && !is_connected) {
+          BOOST_ASIO_CORO_YIELD client->async_connect(h.host, h.service, std::move(*this));
+          is_connected = !ec;
+        }
+
+        if (is_permitted && is_connected) {
+          BOOST_ASIO_CORO_YIELD
+          boost::asio::async_compose<speak_many_op, void(boost::system::error_code, bool)>(
+            s.request_factory(*client, static_cast<Target const&>(*target)), *this, s.strand);
+        }
+
+        if (is_permitted && s.opts.health) { s.opts.health->release(permit, ec); }
+
+        s.report(static_cast<Target const&>(*target), ec);
+
+        if (is_permitted && (ec || !keep_alive)) {
+          if (is_connected) { BOOST_ASIO_CORO_YIELD client->async_shutdown(std::move(*this)); }
+
+          client       = std::make_unique<::foxy::client_session>(s.strand, s.opts.session);
+          is_connected = false;
+        }
+
+        // the upstream's limit may have dropped since this connection was opened
+        //
+        if (h.queued.empty() || h.active > s.host_limit(h)) { break; }
+
+        *target = std::move(h.queued.front());
+        h.queued.pop_front();
+      }
+
+      if (is_connected) { BOOST_ASIO_CORO_YIELD client->async_shutdown(std::move(*this)); }
+
+      --h.active;
+      --s.active;
+
+      s.make_runnable(h);
+      pump(p_);
+    }
+  }
+
+  static auto
+  pump(std::shared_ptr<state_type> const& p) -> void
+  {
+    auto& s = *p;
+    while (s.active < s.opts.max_connections && !s.runnable.empty()) {
+      auto& h = *s.runnable.front();
+      s.runnable.pop_front();
+      h.is_runnable = false;
+
+      ++h.active;
+      ++s.active;
+
+      auto target = std::move(h.queued.front());
+      h.queued.pop_front();
+
+      boost::asio::post(speak_many_op(p, h, std::move(target)));
+
+      s.make_runnable(h);
+    }
+  }
+};
+
+struct run_speak_many_op
+{
+  template <class DoneHandler, class TargetRange, class RequestFactory, class ResultHandler>
+  auto
+  operator()(DoneHandler&&                handler,
+             boost::asio::any_io_executor ex,
+             TargetRange const&           targets,
+             RequestFactory&&             request_factory,
+             ResultHandler&&              on_result,
+             speak_many_opts              opts) -> void
+  {
+    using target_type = std::decay_t<decltype(*std::begin(targets))>;
+    using state_type =
+      speak_many_state<target_type, std::decay_t<RequestFactory>, std::decay_t<ResultHandler>,
+                       std::decay_t<DoneHandler>>;
+    using op_type = speak_many_op<target_type, std::decay_t<RequestFactory>,
+                                  std::decay_t<ResultHandler>, std::decay_t<DoneHandler>>;
+
+    auto p = std::make_shared<state_type>(
+      std::move(ex), std::move(opts),
+      std::decay_t<RequestFactory>(std::forward<RequestFactory>(request_factory)),
+      std::decay_t<ResultHandler>(std::forward<ResultHandler>(on_result)),
+      std::decay_t<DoneHandler>(std::forward<DoneHandler>(handler)));
+
+    for (auto const& target : targets) { p->enqueue(target); }
+
+    boost::asio::post(p->strand, [p]() mutable {
+      if (p->remaining == 0) { return p->done.complete(false); }
+      op_type::pump(p);
+    });
+  }
+};
+
+} // namespace detail
+
+// speak_many runs the `request_factory_` once for each element of `targets_`, never holding open
+// more than `opts.max_connections` connections in total or `opts.max_connections_per_host`
+// connections to any one host
+//
+// Each connection is reused for the rest of its host's targets for as long as the user's request
+// operation reports that it is still alive, `token` completes once every target was reported to
+// `on_result_`
+//
+template <class TargetRange, class RequestFactory, class ResultHandler, class CompletionToken>
+auto
+speak_many(boost::asio::any_io_executor ex,
+           TargetRange const&           targets_,
+           RequestFactory&&             request_factory_,
+           ResultHandler&&              on_result_,
+           speak_many_opts              opts_,
+           CompletionToken&&            token) ->
+  typename boost::asio::async_result<std::decay_t<CompletionToken>, void()>::return_type
+{
+  return boost::asio::async_initiate<CompletionToken, void()>(
+    ::foxy::detail::run_speak_many_op{}, token, std::move(ex), targets_,
+    std::forward<RequestFactory>(request_factory_), std::forward<ResultHandler>(on_result_),
+    std::move(opts_));
+}
+
+template <class TargetRange, class RequestFactory, class ResultHandler>
+auto
+speak_many(boost::asio::any_io_executor ex,
+           TargetRange const&           targets_,
+           RequestFactory&&             request_factory_,
+           ResultHandler&&              on_result_,
+           speak_many_opts              opts_ = {}) -> void
+{
+  ::foxy::speak_many(std::move(ex), targets_, std::forward<RequestFactory>(request_factory_),
+                     std::forward<ResultHandler>(on_result_), std::move(opts_),
+                     ::foxy::detail::ignore_done{});
+}
+
+} // namespace foxy
+
+#endif // FOXY_SPEAK_MANY_HPP_
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_TRACER_HPP_
+#define FOXY_TRACER_HPP_
+
+#include <foxy/session_op.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+
+namespace foxy
+{
+// tracer is told when each operation of the sessions it's attached to starts and ends
+//
+// `session` is the `id` of the session the operation ran on, for a relay or a proxied request it's
+// the session of the client that sent the request. Both hooks are called from the session's own
+// executor, so a tracer shared by sessions on several threads has to synchronize itself.
+//
+// Neither hook does anything by default.
+//
+struct tracer
+{
+  using clock_type = std::chrono::steady_clock;
+
+  virtual ~tracer() = default;
+
+  virtual auto
+  on_start(session_op op, std::uint64_t session) -> void;
+
+  virtual auto
+  on_end(session_op                op,
+         std::uint64_t             session,
+         clock_type::time_point    started,
+         std::size_t               bytes,
+         boost::system::error_code ec) -> void;
+};
+
+// chrome_tracer keeps every span it's told about in memory and writes them out in the Chrome trace
+// event format, which chrome://tracing and Perfetto load as a waterfall with a row per session
+//
+// Once `max_spans` have been kept, later spans are counted as dropped instead.
+//
+// All member functions are safe to call concurrently.
+//
+struct chrome_tracer : tracer
+{
+public:
+  explicit chrome_tracer(std::size_t max_spans = 1024 * 1024);
+
+  auto
+  on_end(session_op                op,
+         std::uint64_t             session,
+         clock_type::time_point    started,
+         std::size_t               bytes,
+         boost::system::error_code ec) -> void override;
+
+  auto
+  size() const -> std::size_t;
+
+  auto
+  dropped() const -> std::uint64_t;
+
+  // write prints the spans kept so far as a JSON object, their times are in microseconds since the
+  // tracer was created
+  //
+  auto
+  write(std::ostream& os) const -> void;
+
+  auto
+  clear() -> void;
+
+private:
+  struct span
+  {
+    session_op                op;
+    std::uint64_t             session;
+    clock_type::time_point    started;
+    clock_type::time_point    ended;
+    std::size_t               bytes;
+    boost::system::error_code ec;
+  };
+
+  clock_type::time_point const epoch_;
+  std::size_t const            max_spans_;
+
+  mutable std::mutex mtx_;
+  std::vector<span>  spans_;
+  std::uint64_t      dropped_ = 0;
+};
+
+} // namespace foxy
+
+#endif // FOXY_TRACER_HPP_
@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_TUNNEL_METRICS_HPP_
+#define FOXY_TUNNEL_METRICS_HPP_
+
+#include <foxy/detail/transfer_stats.hpp>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/optional/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace foxy
+{
+// tcp_info is what the kernel knows about a TCP connection at the time it's sampled, see tcp(7)
+//
+struct tcp_info
+{
+  std::chrono::microseconds rtt     = std::chrono::microseconds::zero();
+  std::chrono::microseconds rtt_var = std::chrono::microseconds::zero();
+
+  // the congestion window in segments, and how many segments were retransmitted over the
+  // connection's lifetime and are currently considered lost
+  //
+  std::uint32_t snd_cwnd    = 0;
+  std::uint32_t retransmits = 0;
+  std::uint32_t lost        = 0;
+};
+
+// sample_tcp_info asks the kernel about `socket`, it returns none on platforms without TCP_INFO and
+// for sockets that aren't open
+//
+auto
+sample_tcp_info(boost::asio::ip::tcp::socket& socket) -> boost::optional<tcp_info>;
+
+// tunnel_metrics keeps track of what the client connections of a proxy are doing
+//
+// Each connection gets a `tunnel` when it's accepted and gives it back when it's closed. Bytes are
+// counted as they're relayed while latencies and kernel samples are recorded as requests finish,
+// each tunnel keeping its own until it's closed and they're folded into the totals. Only opening
+// and closing a connection takes the lock every connection shares.
+//
+// All member functions are safe to call concurrently.
+//
+struct tunnel_metrics
+{
+public:
+  using clock_type    = std::chrono::steady_clock;
+  using duration_type = clock_type::duration;
+
+  // latency sums up a number of durations
+  //
+  struct latency
+  {
+    std::uint64_t count = 0;
+    duration_type sum   = duration_type::zero();
+    duration_type max   = duration_type::zero();
+
+    auto
+    add(duration_type d) noexcept -> void;
+
+    auto
+    merge(latency const& other) noexcept -> void;
+
+    auto
+    mean() const noexcept -> duration_type;
+  };
+
+  // tunnel_sample is a single connection as of the snapshot it's part of, the latencies are those
+  // of its most recent upstream connection and response and zero until there's been one
+  //
+  struct tunnel_sample
+  {
+    std::uint64_t                  id = 0;
+    boost::asio::ip::tcp::endpoint client;
+    std::string                    upstream;
+
+    duration_type lifetime   = duration_type::zero();
+    duration_type connect    = duration_type::zero();
+    duration_type handshake  = duration_type::zero();
+    duration_type first_byte = duration_type::zero();
+
+    std::uint64_t bytes_in  = 0;
+    std::uint64_t bytes_out = 0;
+    std::uint64_t requests  = 0;
+
+    boost::optional<tcp_info> client_tcp;
+    boost::optional<tcp_info> upstream_tcp;
+  };
+
+  // totals covers every connection the metrics have seen, open or closed
+  //
+  struct totals
+  {
+    std::uint64_t opened    = 0;
+    std::uint64_t closed    = 0;
+    std::uint64_t bytes_in  = 0;
+    std::uint64_t bytes_out = 0;
+    std::uint64_t requests  = 0;
+
+    latency connect;
+    latency handshake;
+    latency first_byte;
+    latency lifetime;
+  };
+
+  struct snapshot_type
+  {
+    totals                     total;
+    std::vector<tunnel_sample> tunnels;
+  };
+
+  // tunnel is the part of the metrics a single connection updates, only the connection itself
+  // ever writes to it
+  //
+  struct tunnel
+  {
+  public:
+    tunnel(std::uint64_t id, boost::asio::ip::tcp::endpoint client);
+
+    // everything relayed for the connection is counted here, a relay's own stats are pointed at
+    // `stats` as their parent
+    //
+    ::foxy::detail::transfer_stats stats;
+
+    auto
+    on_connect(boost::string_view host,
+               boost::string_view service,
+               duration_type      connect,
+               duration_type      handshake) -> void;
+
+    // on_response counts a request answered or a tunnel closed, along with how long its response
+    // took to start arriving when it came from upstream
+    //
+    auto
+    on_response(boost::optional<duration_type> first_byte) -> void;
+
+    // on_tcp_info keeps the latest sample of either side of the connection, none leaves the
+    // previous one
+    //
+    auto
+    on_tcp_info(boost::optional<tcp_info> client_side, boost::optional<tcp_info> upstream_side)
+      -> void;
+
+  private:
+    friend tunnel_metrics;
+
+    std::uint64_t                  id_;
+    boost::asio::ip::tcp::endpoint client_;
+    clock_type::time_point         opened_;
+
+    mutable std::mutex mtx_;
+    std::string        upstream_;
+    duration_type      connect_    = duration_type::zero();
+    duration_type      handshake_  = duration_type::zero();
+    duration_type      first_byte_ = duration_type::zero();
+    std::uint64_t      requests_   = 0;
+
+    latency connects_;
+    latency handshakes_;
+    latency first_bytes_;
+
+    boost::optional<tcp_info> client_tcp_;
+    boost::optional<tcp_info> upstream_tcp_;
+
+    auto
+    sample(clock_type::time_point now) const -> tunnel_sample;
+
+    // accumulate adds the requests and latencies the tunnel has seen so far to `total`
+    //
+    auto
+    accumulate(totals& total) const -> void;
+  };
+
+  tunnel_metrics()                      = default;
+  tunnel_metrics(tunnel_metrics const&) = delete;
+  tunnel_metrics(tunnel_metrics&&)      = delete;
+
+  // open starts tracking a new connection from `client`, close stops tracking it and adds what it
+  // did to the totals
+  //
+  auto
+  open(boost::asio::ip::tcp::endpoint client) -> std::shared_ptr<tunnel>;
+
+  auto
+  close(tunnel& t) -> void;
+
+  auto
+  snapshot() const -> snapshot_type;
+
+private:
+  mutable std::mutex                                          mtx_;
+  std::unordered_map<std::uint64_t, std::shared_ptr<tunnel>> tunnels_;
+  std::uint64_t                                               next_id_ = 0;
+  totals                                                      totals_;
+};
+
+} // namespace foxy
+
+#endif // FOXY_TUNNEL_METRICS_HPP_
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_UPSTREAM_HEALTH_HPP_
+#define FOXY_UPSTREAM_HEALTH_HPP_
+
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace foxy
+{
+struct upstream_health_opts
+{
+  using duration_type = std::chrono::steady_clock::duration;
+
+  // the concurrency limit every origin starts out with and the bounds it's adjusted within
+  //
+  std::size_t initial_limit = 8;
+  std::size_t min_limit     = 1;
+  std::size_t max_limit     = 256;
+
+  // requests slower than this are treated as a sign of overload, the same as a failure
+  //
+  duration_type latency_threshold = std::chrono::seconds{1};
+
+  // the factor the limit is multiplied by upon overload, the limit grows back by roughly one for
+  // every `limit` requests that complete successfully
+  //
+  double backoff = 0.5;
+
+  // the number of consecutive failures that open the circuit and how long it stays open before a
+  // single probe request is let through
+  //
+  std::size_t   failure_threshold = 5;
+  duration_type open_duration     = std::chrono::seconds{5};
+};
+
+enum class circuit_state {
+  closed,
+  open,
+  half_open
+};
+
+// upstream_health tracks the health of every origin a client talks to
+//
+// Each origin has a concurrency limit that is adjusted using AIMD based on the latency and outcome
+// of its requests, and a circuit breaker that rejects requests outright once the origin has failed
+// too many times in a row
+//
+// All member functions are safe to call concurrently
+//
+struct upstream_health
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  // permit is handed out by `try_acquire` and must be handed back to `release` once the request
+  // completes
+  //
+  struct permit
+  {
+    std::string            origin;
+    clock_type::time_point start;
+    bool                   is_probe = false;
+  };
+
+  upstream_health()                       = default;
+  upstream_health(upstream_health const&) = delete;
+
+  explicit upstream_health(upstream_health_opts opts);
+
+  // try_acquire reserves a slot for a request to the origin, failing with `error::circuit_open` or
+  // `error::concurrency_limit` when the request should not be made
+  //
+  auto
+  try_acquire(boost::string_view         host,
+              boost::string_view         service,
+              boost::system::error_code& ec) -> permit;
+
+  // release returns the permit's slot, updating the origin's limit and circuit with the outcome
+  // and latency of the request
+  //
+  auto
+  release(permit const& p, boost::system::error_code ec) -> void;
+
+  auto
+  limit(boost::string_view host, boost::string_view service) const -> std::size_t;
+
+  auto
+  state(boost::string_view host, boost::string_view service) const -> circuit_state;
+
+private:
+  struct origin_state
+  {
+    double                 limit     = 0;
+    std::size_t            in_flight = 0;
+    std::size_t            failures  = 0;
+    circuit_state          circuit   = circuit_state::closed;
+    clock_type::time_point opened_at = {};
+
+    // when the limit was last decreased
+    //
+    clock_type::time_point backed_off_at = {};
+  };
+
+  auto
+  get_origin(std::string const& origin) -> origin_state&;
+
+  auto
+  find_origin(boost::string_view host, boost::string_view service) const -> origin_state const*;
+
+  upstream_health_opts opts_;
+
+  mutable std::mutex                            mtx_;
+  std::unordered_map<std::string, origin_state> origins_;
+};
+
+} // namespace foxy
+
+#endif // FOXY_UPSTREAM_HEALTH_HPP_
@@ -0,0 +1,441 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/access_list.hpp>
+#include <foxy/error.hpp>
+
+#include <boost/system/system_error.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace
+{
+using key_type = std::array<std::uint8_t, 16>;
+
+auto constexpr const max_host_size = std::size_t{253};
+
+auto
+to_lower(char const c) noexcept -> unsigned char
+{
+  return static_cast<unsigned char>((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+}
+
+auto
+is_label_char(char const c) noexcept -> bool
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' ||
+         c == '_';
+}
+
+// compare_label orders labels the way the trie's children are sorted, `stored` is always lower-case
+// already
+//
+auto
+compare_label(boost::string_view const label, boost::string_view const stored) noexcept -> int
+{
+  auto const n = (std::min)(label.size(), stored.size());
+  for (auto i = std::size_t{0}; i < n; ++i) {
+    auto const lhs = to_lower(label[i]);
+    auto const rhs = static_cast<unsigned char>(stored[i]);
+    if (lhs != rhs) { return lhs < rhs ? -1 : 1; }
+  }
+
+  if (label.size() == stored.size()) { return 0; }
+  return label.size() < stored.size() ? -1 : 1;
+}
+
+auto
+get_bit(key_type const& key, std::size_t const idx) noexcept -> std::size_t
+{
+  return (key[idx / 8] >> (7 - idx % 8)) & 1u;
+}
+
+auto
+common_prefix_size(key_type const& lhs, key_type const& rhs, std::size_t const max) noexcept
+  -> std::size_t
+{
+  auto bits = std::size_t{0};
+  for (auto i = std::size_t{0}; i < lhs.size() && bits < max; ++i) {
+    auto const diff = static_cast<std::uint8_t>(lhs[i] ^ rhs[i]);
+    if (diff == 0) {
+      bits += 8;
+      continue;
+    }
+
+    auto mask = std::uint8_t{0x80};
+    while ((diff & mask) == 0) {
+      ++bits;
+      mask >>= 1;
+    }
+    break;
+  }
+  return (std::min)(bits, max);
+}
+
+auto
+mask_key(key_type key, std::size_t const len) noexcept -> key_type
+{
+  for (auto i = std::size_t{0}; i < key.size(); ++i) {
+    auto const first = i * 8;
+    if (first >= len) {
+      key[i] = 0;
+    } else if (first + 8 > len) {
+      key[i] &= static_cast<std::uint8_t>(0xff << (8 - (len - first)));
+    }
+  }
+  return key;
+}
+
+// to_key stores an IPv4 address as the IPv4-mapped IPv6 address so a single tree holds both, `bias`
+// is what a prefix length has to be shifted by
+//
+auto
+to_key(boost::asio::ip::address const& address, std::size_t& bias) noexcept -> key_type
+{
+  if (address.is_v6()) {
+    bias = 0;
+    return address.to_v6().to_bytes();
+  }
+
+  bias = 96;
+  return boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4()).to_bytes();
+}
+
+// parse_address parses an IP literal without allocating, an IPv6 literal may be enclosed in
+// brackets as it is in a URI
+//
+auto
+parse_address(boost::string_view str) noexcept -> boost::optional<boost::asio::ip::address>
+{
+  if (str.size() >= 2 && str.front() == '[' && str.back() == ']') {
+    str.remove_prefix(1);
+    str.remove_suffix(1);
+  }
+
+  auto buf = std::array<char, 64>();
+  if (str.empty() || str.size() >= buf.size()) { return boost::none; }
+
+  for (auto const c : str) {
+    auto const is_address_char = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+                                 (c >= 'A' && c <= 'F') || c == '.' || c == ':';
+    if (!is_address_char) { return boost::none; }
+  }
+
+  std::copy(str.begin(), str.end(), buf.begin());
+  buf[str.size()] = '\0';
+
+  auto       ec      = boost::system::error_code();
+  auto const address = boost::asio::ip::make_address(buf.data(), ec);
+  if (ec) { return boost::none; }
+
+  return address;
+}
+
+[[noreturn]] auto
+throw_bad_rule(std::string const& pattern) -> void
+{
+  boost::throw_exception(boost::system::system_error(
+    ::foxy::make_error_code(::foxy::error::bad_access_rule), "foxy::access_list: " + pattern));
+}
+
+} // namespace
+
+foxy::access_list::access_list()
+  : default_(access_action::allow)
+  , domains_(1)
+  , prefixes_(1)
+{
+}
+
+foxy::access_list::access_list(std::vector<access_rule> const& rules,
+                               access_action const             default_action)
+  : access_list()
+{
+  default_ = default_action;
+
+  // domains are collected into an ordinary trie first and then laid out breadth-first, which puts
+  // every node's children next to each other in the order `std::map` already sorted them in
+  //
+  struct build_node
+  {
+    std::map<std::string, std::size_t> children;
+    std::int8_t                        action = -1;
+  };
+
+  auto nodes = std::vector<build_node>(1);
+
+  for (auto const& rule : rules) {
+    auto pattern = boost::string_view(rule.pattern);
+
+    auto const slash = pattern.find('/');
+    if (auto const address = parse_address(pattern.substr(0, slash))) {
+      auto       bias = std::size_t{0};
+      auto const key  = to_key(*address, bias);
+      auto       len  = std::size_t{128};
+
+      if (slash != boost::string_view::npos) {
+        auto const digits = pattern.substr(slash + 1);
+        if (digits.empty() || digits.size() > 3) { throw_bad_rule(rule.pattern); }
+
+        len = 0;
+        for (auto const c : digits) {
+          if (c < '0' || c > '9') { throw_bad_rule(rule.pattern); }
+          len = len * 10 + static_cast<std::size_t>(c - '0');
+        }
+
+        len += bias;
+        if (len > 128) { throw_bad_rule(rule.pattern); }
+      }
+
+      add_prefix(mask_key(key, len), static_cast<std::uint8_t>(len), rule.action);
+      continue;
+    }
+
+    if (!pattern.empty() && pattern.front() == '.') { pattern.remove_prefix(1); }
+    if (!pattern.empty() && pattern.back() == '.') { pattern.remove_suffix(1); }
+
+    if (pattern.empty() || pattern.size() > max_host_size) { throw_bad_rule(rule.pattern); }
+
+    auto idx = std::size_t{0};
+    auto end = pattern.size();
+    while (true) {
+      auto const dot   = pattern.rfind('.', end - 1);
+      auto const begin = dot == boost::string_view::npos ? 0 : dot + 1;
+      auto const label = pattern.substr(begin, end - begin);
+
+      if (label.empty() || !std::all_of(label.begin(), label.end(), is_label_char)) {
+        throw_bad_rule(rule.pattern);
+      }
+
+      auto lowered = std::string(label.size(), '\0');
+      std::transform(label.begin(), label.end(), lowered.begin(),
+                     [](char const c) { return static_cast<char>(to_lower(c)); });
+
+      auto const pos = nodes[idx].children.find(lowered);
+      if (pos != nodes[idx].children.end()) {
+        idx = pos->second;
+      } else {
+        nodes[idx].children.emplace(std::move(lowered), nodes.size());
+        idx = nodes.size();
+        nodes.emplace_back();
+      }
+
+      if (dot == boost::string_view::npos) { break; }
+      if (dot == 0) { throw_bad_rule(rule.pattern); }
+      end = dot;
+    }
+
+    nodes[idx].action = static_cast<std::int8_t>(rule.action);
+  }
+
+  auto order = std::vector<std::size_t>{0};
+  domains_.reserve(nodes.size());
+
+  for (auto i = std::size_t{0}; i < order.size(); ++i) {
+    auto const& node = nodes[order[i]];
+
+    domains_[i].first_child  = static_cast<std::uint32_t>(order.size());
+    domains_[i].num_children = static_cast<std::uint32_t>(node.children.size());
+    domains_[i].action       = node.action;
+
+    for (auto const& child : node.children) {
+      auto next         = domain_node();
+      next.label_offset = static_cast<std::uint32_t>(labels_.size());
+      next.label_size   = static_cast<std::uint32_t>(child.first.size());
+
+      labels_ += child.first;
+      domains_.push_back(next);
+      order.push_back(child.second);
+    }
+  }
+
+  domains_.shrink_to_fit();
+  labels_.shrink_to_fit();
+  prefixes_.shrink_to_fit();
+}
+
+auto
+foxy::access_list::add_prefix(key_type const& key, std::uint8_t const len, access_action action)
+  -> void
+{
+  auto const make_node = [&](key_type const& node_key, std::size_t const node_len) {
+    auto node = prefix_node();
+    node.key  = mask_key(node_key, node_len);
+    node.len  = static_cast<std::uint8_t>(node_len);
+
+    prefixes_.push_back(node);
+    return static_cast<std::uint32_t>(prefixes_.size() - 1);
+  };
+
+  // every node on the way down is a prefix of `key`, the root being the empty prefix
+  //
+  auto idx = std::uint32_t{0};
+  while (true) {
+    if (prefixes_[idx].len == len) {
+      prefixes_[idx].action = static_cast<std::int8_t>(action);
+      return;
+    }
+
+    auto const bit   = get_bit(key, prefixes_[idx].len);
+    auto const child = prefixes_[idx].children[bit];
+
+    if (child == 0) {
+      auto const leaf = make_node(key, len);
+
+      prefixes_[leaf].action        = static_cast<std::int8_t>(action);
+      prefixes_[idx].children[bit] = leaf;
+      return;
+    }
+
+    auto const common =
+      common_prefix_size(key, prefixes_[child].key, (std::min)(len, prefixes_[child].len));
+
+    if (common == prefixes_[child].len) {
+      idx = child;
+      continue;
+    }
+
+    // the new prefix splits the edge to `child` where the two first differ, or ends on it
+    //
+    auto const split = make_node(key, common);
+
+    prefixes_[split].children[get_bit(prefixes_[child].key, common)] = child;
+    prefixes_[idx].children[bit]                                      = split;
+
+    if (common == len) {
+      prefixes_[split].action = static_cast<std::int8_t>(action);
+      return;
+    }
+
+    auto const leaf = make_node(key, len);
+
+    prefixes_[leaf].action                         = static_cast<std::int8_t>(action);
+    prefixes_[split].children[get_bit(key, common)] = leaf;
+    return;
+  }
+}
+
+auto
+foxy::access_list::default_action() const noexcept -> access_action
+{
+  return default_;
+}
+
+auto
+foxy::access_list::match(boost::string_view host) const noexcept -> boost::optional<access_action>
+{
+  if (auto const address = parse_address(host)) { return match(*address); }
+  return match_domain(host);
+}
+
+auto
+foxy::access_list::match(boost::asio::ip::address const& address) const noexcept
+  -> boost::optional<access_action>
+{
+  auto bias = std::size_t{0};
+  return match_key(to_key(address, bias));
+}
+
+auto
+foxy::access_list::check(boost::string_view host) const noexcept -> access_action
+{
+  return match(host).value_or(default_);
+}
+
+auto
+foxy::access_list::match_domain(boost::string_view host) const noexcept
+  -> boost::optional<access_action>
+{
+  if (!host.empty() && host.back() == '.') { host.remove_suffix(1); }
+
+  auto result = boost::optional<access_action>();
+  if (host.empty()) { return result; }
+
+  auto idx = std::size_t{0};
+  auto end = host.size();
+  while (true) {
+    auto const dot   = host.rfind('.', end - 1);
+    auto const begin = dot == boost::string_view::npos ? 0 : dot + 1;
+    auto const label = host.substr(begin, end - begin);
+
+    auto const& node  = domains_[idx];
+    auto const  first = domains_.begin() + node.first_child;
+    auto const  last  = first + node.num_children;
+
+    auto const child =
+      std::lower_bound(first, last, label, [this](domain_node const& x, boost::string_view value) {
+        return compare_label(value, {labels_.data() + x.label_offset, x.label_size}) > 0;
+      });
+
+    if (child == last ||
+        compare_label(label, {labels_.data() + child->label_offset, child->label_size}) != 0) {
+      break;
+    }
+
+    idx = static_cast<std::size_t>(child - domains_.begin());
+    if (child->action >= 0) { result = static_cast<access_action>(child->action); }
+
+    if (dot == boost::string_view::npos || dot == 0) { break; }
+    end = dot;
+  }
+
+  return result;
+}
+
+auto
+foxy::access_list::match_key(key_type const& key) const noexcept -> boost::optional<access_action>
+{
+  auto result = boost::optional<access_action>();
+
+  auto idx = std::uint32_t{0};
+  while (true) {
+    auto const& node = prefixes_[idx];
+    if (common_prefix_size(key, node.key, node.len) < node.len) { break; }
+
+    if (node.action >= 0) { result = static_cast<access_action>(node.action); }
+    if (node.len == 128) { break; }
+
+    idx = node.children[get_bit(key, node.len)];
+    if (idx == 0) { break; }
+  }
+
+  return result;
+}
+
+foxy::access_policy::access_policy()
+  : access_policy(access_list())
+{
+}
+
+foxy::access_policy::access_policy(access_list list)
+  : list_(std::make_shared<access_list const>(std::move(list)))
+{
+}
+
+auto
+foxy::access_policy::reload(access_list list) -> void
+{
+  // the old list is released outside of the lock, it may be large
+  //
+  auto next = std::make_shared<access_list const>(std::move(list));
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+    list_.swap(next);
+  }
+}
+
+auto
+foxy::access_policy::get() const -> std::shared_ptr<access_list const>
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  return list_;
+}
@@ -0,0 +1,443 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/access_log.hpp>
+#include <foxy/detail/json_string.hpp>
+
+#include <boost/beast/http/verb.hpp>
+
+#include <boost/system/system_error.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// ring is a single-producer, single-consumer queue of records
+//
+// `tail` is only ever advanced by the thread the ring belongs to and `head` only by the log's
+// writer, they're kept on cache lines of their own so the two don't fight over them
+//
+struct foxy::access_log::ring
+{
+  explicit ring(std::size_t const capacity)
+    : slots(capacity)
+    , mask(capacity - 1)
+  {
+  }
+
+  std::vector<access_record> slots;
+  std::size_t                mask;
+
+  char                     pad0[64];
+  std::atomic<std::size_t> head{0};
+  char                     pad1[64];
+  std::atomic<std::size_t> tail{0};
+  char                     pad2[64];
+};
+
+namespace
+{
+auto
+next_log_id() -> std::uint64_t
+{
+  static auto ids = std::atomic<std::uint64_t>{0};
+  return ++ids;
+}
+
+// the rings this thread owns, by the id of the log they belong to, ids are never reused so the
+// entries of a log that's gone are simply never matched again
+//
+auto
+thread_rings() -> std::vector<std::pair<std::uint64_t, void*>>&
+{
+  thread_local auto rings = std::vector<std::pair<std::uint64_t, void*>>();
+  return rings;
+}
+
+auto
+round_up_pow2(std::size_t n) -> std::size_t
+{
+  auto size = std::size_t{1};
+  while (size < n) { size <<= 1; }
+  return size;
+}
+
+auto
+kind_name(foxy::access_kind const kind) -> char const*
+{
+  switch (kind) {
+    case foxy::access_kind::request: return "request";
+    case foxy::access_kind::cache_hit: return "cache_hit";
+    case foxy::access_kind::tunnel: return "tunnel";
+  }
+  return "unknown";
+}
+
+auto
+append_text(std::string& out, foxy::access_record const& entry) -> void
+{
+  auto const client = entry.get_client();
+
+  auto address = client.address();
+  if (address.is_v6() && address.to_v6().is_v4_mapped()) {
+    address = boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, address.to_v6());
+  }
+
+  auto const method =
+    boost::beast::http::to_string(static_cast<boost::beast::http::verb>(entry.method));
+
+  out += "{\"timestamp\":";
+  out += std::to_string(entry.timestamp);
+  out += ",\"client\":";
+  foxy::detail::append_json_string(out,
+                                   address.to_string() + ":" + std::to_string(client.port()));
+  out += ",\"kind\":\"";
+  out += kind_name(entry.kind);
+  out += "\",\"method\":";
+  foxy::detail::append_json_string(out, method);
+  out += ",\"target\":";
+  foxy::detail::append_json_string(out, entry.get_target());
+  out += ",\"status\":";
+  out += std::to_string(entry.status);
+  out += ",\"bytes_in\":";
+  out += std::to_string(entry.bytes_in);
+  out += ",\"bytes_out\":";
+  out += std::to_string(entry.bytes_out);
+  out += ",\"duration\":";
+  out += std::to_string(entry.duration);
+  out += "}\n";
+}
+
+[[noreturn]] auto
+throw_errno(char const* what) -> void
+{
+  boost::throw_exception(boost::system::system_error(
+    boost::system::error_code(errno, boost::system::system_category()), what));
+}
+
+} // namespace
+
+auto
+foxy::access_record::set_target(boost::string_view const value) noexcept -> void
+{
+  auto const size = (std::min)(value.size(), target.size());
+  std::copy(value.begin(), value.begin() + size, target.begin());
+  target_size = static_cast<std::uint16_t>(size);
+}
+
+auto
+foxy::access_record::get_target() const noexcept -> boost::string_view
+{
+  return {target.data(), target_size};
+}
+
+auto
+foxy::access_record::set_client(boost::asio::ip::tcp::endpoint const& endpoint) noexcept -> void
+{
+  auto const ip = endpoint.address();
+
+  address = ip.is_v6()
+              ? ip.to_v6().to_bytes()
+              : boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, ip.to_v4()).to_bytes();
+
+  port = endpoint.port();
+}
+
+auto
+foxy::access_record::get_client() const -> boost::asio::ip::tcp::endpoint
+{
+  return {boost::asio::ip::address_v6(address), port};
+}
+
+foxy::access_log::access_log(std::string const&              path,
+                             access_log_format const         format,
+                             std::size_t const               ring_size,
+                             std::chrono::milliseconds const flush_interval)
+  : id_(next_log_id())
+  , format_(format)
+  , ring_size_(round_up_pow2((std::max)(ring_size, std::size_t{2})))
+  , flush_interval_(flush_interval)
+  , num_written_(0)
+  , num_dropped_(0)
+{
+#if defined(_WIN32)
+  fd_ = ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+
+  if (fd_ < 0) { throw_errno("foxy::access_log"); }
+
+  writer_ = std::thread([this] { run(); });
+}
+
+foxy::access_log::~access_log()
+{
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+    stop_     = true;
+  }
+  wake_.notify_all();
+  writer_.join();
+
+#if defined(_WIN32)
+  ::_close(fd_);
+#else
+  ::close(fd_);
+#endif
+}
+
+auto
+foxy::access_log::local_ring() noexcept -> ring*
+{
+  auto& rings = thread_rings();
+  for (auto const& r : rings) {
+    if (r.first == id_) { return static_cast<ring*>(r.second); }
+  }
+
+  // the log owns the ring so it's kept around until everything in it has been written, even if
+  // the thread exits first
+  //
+  try {
+    auto owned = std::make_unique<ring>(ring_size_);
+    auto p     = owned.get();
+    {
+      auto lock = std::lock_guard<std::mutex>(mtx_);
+      rings_.push_back(std::move(owned));
+    }
+
+    rings.emplace_back(id_, p);
+    return p;
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+auto
+foxy::access_log::record(access_record const& entry) noexcept -> bool
+{
+  auto* r = local_ring();
+  if (!r) {
+    num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  auto const tail = r->tail.load(std::memory_order_relaxed);
+  auto const head = r->head.load(std::memory_order_acquire);
+
+  if (tail - head == r->slots.size()) {
+    num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  r->slots[tail & r->mask] = entry;
+  r->tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+auto
+foxy::access_log::flush() -> void
+{
+  auto lock = std::unique_lock<std::mutex>(mtx_);
+
+  auto const ticket = ++flush_requests_;
+  wake_.notify_all();
+  flushed_.wait(lock, [&] { return flushes_done_ >= ticket || stop_; });
+}
+
+auto
+foxy::access_log::format() const noexcept -> access_log_format
+{
+  return format_;
+}
+
+auto
+foxy::access_log::num_written() const noexcept -> std::uint64_t
+{
+  return num_written_.load(std::memory_order_relaxed);
+}
+
+auto
+foxy::access_log::num_dropped() const noexcept -> std::uint64_t
+{
+  return num_dropped_.load(std::memory_order_relaxed);
+}
+
+auto
+foxy::access_log::run() -> void
+{
+  auto rings = std::vector<ring*>();
+
+  while (true) {
+    auto ticket = std::uint64_t{0};
+    auto stop   = false;
+    {
+      auto lock = std::unique_lock<std::mutex>(mtx_);
+      wake_.wait_for(lock, flush_interval_,
+                     [&] { return stop_ || flush_requests_ > flushes_done_; });
+
+      ticket = flush_requests_;
+      stop   = stop_;
+
+      rings.clear();
+      for (auto const& r : rings_) { rings.push_back(r.get()); }
+    }
+
+    drain(rings);
+
+    {
+      auto lock     = std::lock_guard<std::mutex>(mtx_);
+      flushes_done_ = ticket;
+    }
+    flushed_.notify_all();
+
+    if (stop) { break; }
+  }
+}
+
+auto
+foxy::access_log::drain(std::vector<ring*> const& rings) -> void
+{
+  auto num_records = std::uint64_t{0};
+
+  if (format_ == access_log_format::text) {
+    text_.clear();
+
+    for (auto* r : rings) {
+      auto const head = r->head.load(std::memory_order_relaxed);
+      auto const tail = r->tail.load(std::memory_order_acquire);
+
+      for (auto i = head; i != tail; ++i) { append_text(text_, r->slots[i & r->mask]); }
+
+      r->head.store(tail, std::memory_order_release);
+      num_records += tail - head;
+    }
+
+    auto& counter = write_all(text_.data(), text_.size()) ? num_written_ : num_dropped_;
+    counter.fetch_add(num_records, std::memory_order_relaxed);
+    return;
+  }
+
+  // binary records are written straight out of the rings, each ring holds at most two runs of
+  // them, and the slots are only handed back once they've been written
+  //
+  struct run_type
+  {
+    char const* data;
+    std::size_t size;
+  };
+
+  auto runs  = std::vector<run_type>();
+  auto tails = std::vector<std::size_t>();
+
+  for (auto* r : rings) {
+    auto const head = r->head.load(std::memory_order_relaxed);
+    auto const tail = r->tail.load(std::memory_order_acquire);
+    tails.push_back(tail);
+
+    if (head == tail) { continue; }
+
+    auto const first = head & r->mask;
+    auto const count = tail - head;
+    auto const size  = (std::min)(count, r->slots.size() - first);
+
+    runs.push_back({reinterpret_cast<char const*>(r->slots.data() + first),
+                    size * sizeof(access_record)});
+
+    if (size < count) {
+      runs.push_back({reinterpret_cast<char const*>(r->slots.data()),
+                      (count - size) * sizeof(access_record)});
+    }
+
+    num_records += count;
+  }
+
+  auto is_written = true;
+
+#if defined(_WIN32)
+  for (auto const& run : runs) { is_written = is_written && write_all(run.data, run.size); }
+#else
+  auto iov = std::vector<::iovec>();
+  for (auto const& run : runs) {
+    iov.push_back({const_cast<char*>(run.data), run.size});
+  }
+
+  auto pos = std::size_t{0};
+  while (pos < iov.size()) {
+    auto const count = (std::min)(iov.size() - pos, static_cast<std::size_t>(IOV_MAX));
+
+    auto const n = ::writev(fd_, iov.data() + pos, static_cast<int>(count));
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+      is_written = false;
+      break;
+    }
+
+    // a short write leaves the rest of the batch to be written one run at a time
+    //
+    auto written = static_cast<std::size_t>(n);
+    while (pos < iov.size() && written >= iov[pos].iov_len) {
+      written -= iov[pos].iov_len;
+      ++pos;
+    }
+
+    if (pos < iov.size() && written > 0) {
+      is_written = write_all(static_cast<char const*>(iov[pos].iov_base) + written,
+                             iov[pos].iov_len - written);
+      if (!is_written) { break; }
+      ++pos;
+    }
+  }
+#endif
+
+  for (auto i = std::size_t{0}; i < rings.size(); ++i) {
+    rings[i]->head.store(tails[i], std::memory_order_release);
+  }
+
+  auto& counter = is_written ? num_written_ : num_dropped_;
+  counter.fetch_add(num_records, std::memory_order_relaxed);
+}
+
+auto
+foxy::access_log::write_all(char const* data, std::size_t size) -> bool
+{
+  // records we can't write are counted as dropped, the proxy keeps going regardless
+  //
+  while (size > 0) {
+#if defined(_WIN32)
+    auto const n =
+      ::_write(fd_, data, static_cast<unsigned>((std::min)(size, std::size_t{1} << 30)));
+#else
+    auto const n = ::write(fd_, data, size);
+#endif
+
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+
+    data += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
@@ -0,0 +1,318 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/backend_pool.hpp>
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace
+{
+auto constexpr const points_per_backend = std::size_t{128};
+
+// FNV-1a followed by the splitmix64 finalizer, FNV alone leaves similar keys too close together on
+// the ring
+//
+auto
+hash(boost::string_view str) -> std::uint64_t
+{
+  auto h = std::uint64_t{14695981039346656037ull};
+  for (auto const c : str) {
+    h ^= static_cast<unsigned char>(c);
+    h *= std::uint64_t{1099511628211ull};
+  }
+
+  h ^= h >> 30;
+  h *= std::uint64_t{0xbf58476d1ce4e5b9ull};
+  h ^= h >> 27;
+  h *= std::uint64_t{0x94d049bb133111ebull};
+  h ^= h >> 31;
+
+  return h;
+}
+
+} // namespace
+
+foxy::backend_pool::lease::lease(backend_pool& pool, std::size_t index) noexcept
+  : pool_(&pool)
+  , index_(index)
+  , start_(clock_type::now())
+{
+}
+
+foxy::backend_pool::lease::lease(lease&& rhs) noexcept
+  : pool_(rhs.pool_)
+  , index_(rhs.index_)
+  , start_(rhs.start_)
+{
+  rhs.pool_ = nullptr;
+}
+
+foxy::backend_pool::lease::~lease()
+{
+  reset();
+}
+
+auto
+foxy::backend_pool::lease::operator=(lease&& rhs) noexcept -> lease&
+{
+  if (this != &rhs) {
+    reset();
+
+    pool_  = rhs.pool_;
+    index_ = rhs.index_;
+    start_ = rhs.start_;
+
+    rhs.pool_ = nullptr;
+  }
+  return *this;
+}
+
+foxy::backend_pool::lease::operator bool() const noexcept
+{
+  return pool_ != nullptr;
+}
+
+auto
+foxy::backend_pool::lease::index() const noexcept -> std::size_t
+{
+  return index_;
+}
+
+auto
+foxy::backend_pool::lease::get() const -> backend const&
+{
+  BOOST_ASSERT(pool_);
+  return pool_->at(index_);
+}
+
+auto
+foxy::backend_pool::lease::complete(boost::system::error_code ec) -> void
+{
+  if (pool_) {
+    pool_->complete(index_, ec, clock_type::now() - start_);
+    pool_ = nullptr;
+  }
+}
+
+auto
+foxy::backend_pool::lease::reset() -> void
+{
+  if (pool_) {
+    pool_->release(index_);
+    pool_ = nullptr;
+  }
+}
+
+foxy::backend_pool::backend_pool(std::vector<backend> backends,
+                                 balance_policy       policy,
+                                 backend_health_opts  health)
+  : backends_(std::move(backends))
+  , policy_(policy)
+  , health_(std::move(health))
+  , states_(backends_.size())
+{
+  BOOST_ASSERT(!backends_.empty());
+
+  if (health_.max_failures == 0) { health_.max_failures = 1; }
+  health_.max_ejection = (std::max)(health_.max_ejection, health_.base_ejection);
+
+  if (policy_ != balance_policy::consistent_hash) { return; }
+
+  ring_.reserve(backends_.size() * points_per_backend);
+  for (auto idx = std::size_t{0}; idx < backends_.size(); ++idx) {
+    auto const name = backends_[idx].host + ":" + backends_[idx].service + "#";
+    for (auto point = std::size_t{0}; point < points_per_backend; ++point) {
+      ring_.emplace_back(hash(name + std::to_string(point)), idx);
+    }
+  }
+  std::sort(ring_.begin(), ring_.end());
+}
+
+auto
+foxy::backend_pool::acquire(boost::string_view key, std::vector<std::size_t> const& skip) -> lease
+{
+  auto const now = clock_type::now();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  // a request that has failed on every backend gets to try them all again
+  //
+  auto const is_skipped = [&](std::size_t idx) {
+    return std::find(skip.begin(), skip.end(), idx) != skip.end();
+  };
+
+  auto any_left = false;
+  for (auto idx = std::size_t{0}; idx < backends_.size() && !any_left; ++idx) {
+    any_left = !is_skipped(idx);
+  }
+
+  // once every backend has been ejected they're all fair game again, sending requests somewhere
+  // beats failing all of them
+  //
+  auto any_admitted = false;
+  for (auto idx = std::size_t{0}; idx < backends_.size() && !any_admitted; ++idx) {
+    any_admitted = (!any_left || !is_skipped(idx)) && states_[idx].ejected_until <= now;
+  }
+
+  auto const is_admitted = [&](std::size_t idx) {
+    if (any_left && is_skipped(idx)) { return false; }
+    return !any_admitted || states_[idx].ejected_until <= now;
+  };
+
+  auto idx = std::size_t{0};
+
+  switch (policy_) {
+    case balance_policy::round_robin:
+      for (auto num_tried = std::size_t{0}; num_tried < backends_.size(); ++num_tried) {
+        idx   = next_;
+        next_ = (next_ + 1) % backends_.size();
+        if (is_admitted(idx)) { break; }
+      }
+      break;
+
+    case balance_policy::least_outstanding: {
+      // start the scan where the last one left off so that idle backends share the load
+      //
+      auto found = false;
+      for (auto offset = std::size_t{0}; offset < backends_.size(); ++offset) {
+        auto const candidate = (next_ + offset) % backends_.size();
+        if (!is_admitted(candidate)) { continue; }
+
+        if (!found || states_[candidate].outstanding < states_[idx].outstanding) {
+          idx   = candidate;
+          found = true;
+        }
+      }
+      next_ = (idx + 1) % backends_.size();
+      break;
+    }
+
+    case balance_policy::consistent_hash: {
+      auto const point = std::make_pair(hash(key), std::size_t{0});
+
+      // the keys of an ejected or skipped backend go to whoever is next on the ring
+      //
+      auto pos = std::lower_bound(ring_.begin(), ring_.end(), point);
+      for (auto num_tried = std::size_t{0}; num_tried < ring_.size(); ++num_tried, ++pos) {
+        if (pos == ring_.end()) { pos = ring_.begin(); }
+        if (is_admitted(pos->second)) { break; }
+      }
+
+      idx = pos->second;
+      break;
+    }
+  }
+
+  ++states_[idx].outstanding;
+  return lease(*this, idx);
+}
+
+auto
+foxy::backend_pool::report_probe(std::size_t index, boost::system::error_code ec) -> void
+{
+  auto const now = clock_type::now();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto& backend = states_.at(index);
+  if (ec) {
+    fail(backend, now);
+    return;
+  }
+
+  backend.failures      = 0;
+  backend.ejected_until = (std::min)(backend.ejected_until, now);
+}
+
+auto
+foxy::backend_pool::release(std::size_t index) -> void
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+  --states_[index].outstanding;
+}
+
+auto
+foxy::backend_pool::complete(std::size_t               index,
+                             boost::system::error_code ec,
+                             duration_type             latency) -> void
+{
+  auto const now = clock_type::now();
+
+  auto const is_slow =
+    health_.latency_threshold > duration_type::zero() && latency > health_.latency_threshold;
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto& backend = states_[index];
+  --backend.outstanding;
+
+  if (ec || is_slow) {
+    fail(backend, now);
+  } else {
+    backend.failures = 0;
+  }
+}
+
+auto
+foxy::backend_pool::fail(backend_state& backend, clock_type::time_point now) -> void
+{
+  if (++backend.failures < health_.max_failures) { return; }
+
+  backend.failures = 0;
+
+  // a backend that has stayed in for long enough starts over from the shortest ejection
+  //
+  if (now - backend.ejected_until >= health_.max_ejection) { backend.ejections = 0; }
+
+  auto ejection = health_.base_ejection;
+  for (auto idx = std::size_t{0}; idx < backend.ejections && ejection < health_.max_ejection;
+       ++idx) {
+    ejection *= 2;
+  }
+
+  ++backend.ejections;
+  backend.ejected_until = now + (std::min)(ejection, health_.max_ejection);
+}
+
+auto
+foxy::backend_pool::policy() const noexcept -> balance_policy
+{
+  return policy_;
+}
+
+auto
+foxy::backend_pool::size() const noexcept -> std::size_t
+{
+  return backends_.size();
+}
+
+auto
+foxy::backend_pool::at(std::size_t index) const -> backend const&
+{
+  return backends_.at(index);
+}
+
+auto
+foxy::backend_pool::outstanding(std::size_t index) const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+  return states_.at(index).outstanding;
+}
+
+auto
+foxy::backend_pool::is_ejected(std::size_t index) const -> bool
+{
+  auto const now = clock_type::now();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+  return states_.at(index).ejected_until > now;
+}
@@ -0,0 +1,189 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/buffer_pool.hpp>
+
+#include <utility>
+
+namespace
+{
+// is_cache_destroyed outlives the thread's cache so buffers released after it, during thread or
+// static destruction, go straight to the shared free lists
+//
+thread_local bool is_cache_destroyed = false;
+
+// size_class returns the log2 of the smallest power of two that holds `size`, never smaller than
+// the pool's smallest class
+//
+auto
+size_class(std::size_t const size) noexcept -> std::size_t
+{
+  auto log2 = foxy::detail::buffer_pool::min_class_log2;
+  while ((std::size_t{1} << log2) < size) { ++log2; }
+  return log2;
+}
+
+} // namespace
+
+constexpr std::size_t foxy::detail::buffer_pool::min_class_log2;
+constexpr std::size_t foxy::detail::buffer_pool::max_class_log2;
+constexpr std::size_t foxy::detail::buffer_pool::num_classes;
+constexpr std::size_t foxy::detail::buffer_pool::max_thread_cached;
+
+struct foxy::detail::buffer_pool::thread_cache
+{
+  std::array<std::array<std::unique_ptr<char[]>, max_thread_cached>, num_classes> free;
+  std::array<std::size_t, num_classes>                                           sizes = {};
+
+  thread_cache() = default;
+
+  thread_cache(thread_cache const&) = delete;
+  thread_cache(thread_cache&&)      = delete;
+
+  ~thread_cache()
+  {
+    is_cache_destroyed = true;
+
+    auto& pool = buffer_pool::global();
+    for (auto idx = std::size_t{0}; idx < num_classes; ++idx) {
+      while (sizes[idx] > 0) { pool.release_shared(idx, std::move(free[idx][--sizes[idx]])); }
+    }
+  }
+};
+
+foxy::detail::pooled_buffer::pooled_buffer(buffer_pool* pool, char* data, std::size_t size) noexcept
+  : pool_(pool)
+  , data_(data)
+  , size_(size)
+{
+}
+
+foxy::detail::pooled_buffer::pooled_buffer(pooled_buffer&& other) noexcept
+  : pool_(std::exchange(other.pool_, nullptr))
+  , data_(std::exchange(other.data_, nullptr))
+  , size_(std::exchange(other.size_, 0))
+{
+}
+
+foxy::detail::pooled_buffer::~pooled_buffer()
+{
+  if (pool_) { pool_->release(data_, size_); }
+}
+
+auto
+foxy::detail::pooled_buffer::operator=(pooled_buffer&& other) noexcept -> pooled_buffer&
+{
+  if (this == std::addressof(other)) { return *this; }
+
+  if (pool_) { pool_->release(data_, size_); }
+
+  pool_ = std::exchange(other.pool_, nullptr);
+  data_ = std::exchange(other.data_, nullptr);
+  size_ = std::exchange(other.size_, 0);
+
+  return *this;
+}
+
+foxy::detail::buffer_pool::buffer_pool(std::size_t max_cached_per_class)
+  : max_cached_(max_cached_per_class)
+{
+}
+
+auto
+foxy::detail::buffer_pool::acquire(std::size_t size) -> pooled_buffer
+{
+  auto const log2 = size_class(size);
+  if (log2 > max_class_log2) { return {this, new char[size], size}; }
+
+  auto const class_size = std::size_t{1} << log2;
+  auto const idx        = log2 - min_class_log2;
+
+  if (is_thread_cached_) {
+    auto* const cache = local_cache();
+    if (cache && cache->sizes[idx] > 0) {
+      return {this, cache->free[idx][--cache->sizes[idx]].release(), class_size};
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mtx_};
+
+    auto& free_list = free_[idx];
+    if (!free_list.empty()) {
+      auto* const data = free_list.back().release();
+      free_list.pop_back();
+      return {this, data, class_size};
+    }
+  }
+
+  return {this, new char[class_size], class_size};
+}
+
+auto
+foxy::detail::buffer_pool::global() -> buffer_pool&
+{
+  // intentionally leaked so that buffers released during static destruction still have a pool to
+  // go back to
+  //
+  static auto* const pool = [] {
+    auto* const p        = new buffer_pool();
+    p->is_thread_cached_ = true;
+    return p;
+  }();
+
+  return *pool;
+}
+
+auto
+foxy::detail::buffer_pool::local_cache() noexcept -> thread_cache*
+{
+  if (is_cache_destroyed) { return nullptr; }
+
+  thread_local thread_cache cache;
+  return &cache;
+}
+
+auto
+foxy::detail::buffer_pool::release(char* data, std::size_t size) noexcept -> void
+{
+  auto buffer = std::unique_ptr<char[]>(data);
+
+  auto const log2 = size_class(size);
+  if (log2 > max_class_log2 || (std::size_t{1} << log2) != size) { return; }
+
+  auto const idx = log2 - min_class_log2;
+
+  if (is_thread_cached_) {
+    auto* const cache = local_cache();
+    if (cache && cache->sizes[idx] < max_thread_cached) {
+      cache->free[idx][cache->sizes[idx]++] = std::move(buffer);
+      return;
+    }
+  }
+
+  release_shared(idx, std::move(buffer));
+}
+
+auto
+foxy::detail::buffer_pool::release_shared(std::size_t const       idx,
+                                          std::unique_ptr<char[]> buffer) noexcept -> void
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto& free_list = free_[idx];
+  if (free_list.size() >= max_cached_) { return; }
+
+  // a failure to grow the free list just means the buffer is freed instead of cached
+  //
+  try {
+    free_list.push_back(std::move(buffer));
+  }
+  catch (...) {
+  }
+}
@@ -0,0 +1,332 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/content_decoder.hpp>
+#include <foxy/error.hpp>
+
+#include <boost/beast/core/string.hpp>
+#include <boost/assert.hpp>
+
+#include <algorithm>
+
+namespace zlib = boost::beast::zlib;
+
+namespace
+{
+// the flag bits of a gzip member header
+//
+unsigned char const gzip_fhcrc    = 0x02;
+unsigned char const gzip_fextra   = 0x04;
+unsigned char const gzip_fname    = 0x08;
+unsigned char const gzip_fcomment = 0x10;
+unsigned char const gzip_reserved = 0xe0;
+
+// the largest number of octets that can be summed before the Adler-32 sums have to be reduced
+//
+std::size_t const   adler_nmax = 5552;
+std::uint32_t const adler_mod  = 65521;
+
+auto
+load_le32(unsigned char const* p) -> std::uint32_t
+{
+  return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+         (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+auto
+load_be32(unsigned char const* p) -> std::uint32_t
+{
+  return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+         (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+}
+
+} // namespace
+
+auto
+foxy::detail::parse_content_coding(boost::string_view value) -> content_coding
+{
+  auto const is_ows = [](char const c) { return c == ' ' || c == '\t'; };
+
+  while (!value.empty() && is_ows(value.front())) { value.remove_prefix(1); }
+  while (!value.empty() && is_ows(value.back())) { value.remove_suffix(1); }
+
+  if (value.empty() || boost::beast::iequals(value, "identity")) {
+    return content_coding::identity;
+  }
+
+  if (boost::beast::iequals(value, "gzip") || boost::beast::iequals(value, "x-gzip")) {
+    return content_coding::gzip;
+  }
+
+  if (boost::beast::iequals(value, "deflate")) { return content_coding::deflate; }
+
+  // this includes stacked codings like "deflate, gzip" which we make no attempt to undo
+  //
+  return content_coding::unknown;
+}
+
+foxy::detail::content_decoder::content_decoder(content_coding coding)
+  : coding_(coding)
+  , state_(coding == content_coding::gzip ? state::gzip_header : state::zlib_header)
+{
+  BOOST_ASSERT(coding == content_coding::gzip || coding == content_coding::deflate);
+}
+
+auto
+foxy::detail::content_decoder::decode(boost::asio::const_buffer   input,
+                                      boost::asio::mutable_buffer output,
+                                      std::size_t&                produced,
+                                      boost::system::error_code&  ec) -> std::size_t
+{
+  auto const* const begin = static_cast<unsigned char const*>(input.data());
+  auto const* const end   = begin + input.size();
+  auto const*       in    = begin;
+
+  auto* const out_begin = static_cast<unsigned char*>(output.data());
+  auto* const out_end   = out_begin + output.size();
+  auto*       out       = out_begin;
+
+  ec = {};
+
+  // buffers the next `size` octets of the input into `scratch_`, returning false if we need more
+  //
+  auto const gather = [&](std::size_t const size) -> bool {
+    while (in != end && scratch_size_ < size) { scratch_[scratch_size_++] = *in++; }
+    return scratch_size_ == size;
+  };
+
+  // skips past a zero-terminated field of the gzip header, returning false if we need more
+  //
+  auto const skip_string = [&]() -> bool {
+    in = std::find(in, end, static_cast<unsigned char>(0));
+    if (in == end) { return false; }
+
+    ++in;
+    return true;
+  };
+
+  while (true) {
+    switch (state_) {
+      case state::gzip_header:
+        if (!gather(10)) { goto suspend; }
+
+        if (scratch_[0] != 0x1f || scratch_[1] != 0x8b || scratch_[2] != 8 ||
+            (scratch_[3] & gzip_reserved)) {
+          ec = ::foxy::error::bad_content_encoding;
+          goto suspend;
+        }
+
+        flags_        = scratch_[3];
+        scratch_size_ = 0;
+        state_        = state::gzip_extra_length;
+        break;
+
+      case state::gzip_extra_length:
+        if (flags_ & gzip_fextra) {
+          if (!gather(2)) { goto suspend; }
+
+          skip_         = static_cast<std::size_t>(scratch_[0]) | (scratch_[1] << 8);
+          scratch_size_ = 0;
+        }
+
+        state_ = state::gzip_extra;
+        break;
+
+      case state::gzip_extra: {
+        auto const n = (std::min)(skip_, static_cast<std::size_t>(end - in));
+
+        in += n;
+        skip_ -= n;
+        if (skip_ > 0) { goto suspend; }
+
+        state_ = state::gzip_name;
+        break;
+      }
+
+      case state::gzip_name:
+        if ((flags_ & gzip_fname) && !skip_string()) { goto suspend; }
+
+        state_ = state::gzip_comment;
+        break;
+
+      case state::gzip_comment:
+        if ((flags_ & gzip_fcomment) && !skip_string()) { goto suspend; }
+
+        state_ = state::gzip_header_crc;
+        break;
+
+      case state::gzip_header_crc:
+        if (flags_ & gzip_fhcrc) {
+          if (!gather(2)) { goto suspend; }
+          scratch_size_ = 0;
+        }
+
+        state_ = state::body;
+        break;
+
+      case state::zlib_header: {
+        if (!gather(2)) { goto suspend; }
+
+        auto const cmf = static_cast<unsigned>(scratch_[0]);
+        auto const flg = static_cast<unsigned>(scratch_[1]);
+
+        has_zlib_ = (cmf & 0x0f) == 8 && (cmf >> 4) <= 7 && ((cmf << 8) | flg) % 31 == 0;
+
+        if (has_zlib_) {
+          // preset dictionaries are never used by HTTP
+          //
+          if (flg & 0x20) {
+            ec = ::foxy::error::bad_content_encoding;
+            goto suspend;
+          }
+
+          scratch_size_ = 0;
+        }
+
+        // otherwise the two octets we've buffered are the start of a raw deflate stream and are
+        // replayed into the inflater before the rest of the input
+        //
+        skip_  = 0;
+        state_ = state::body;
+        break;
+      }
+
+      case state::body: {
+        if (out == out_end) { goto suspend; }
+
+        auto const is_replay = scratch_size_ > 0;
+
+        auto zs      = zlib::z_params();
+        zs.next_in   = is_replay ? scratch_.data() + skip_ : in;
+        zs.avail_in  = is_replay ? scratch_size_ - skip_ : static_cast<std::size_t>(end - in);
+        zs.next_out  = out;
+        zs.avail_out = static_cast<std::size_t>(out_end - out);
+
+        inflater_.write(zs, zlib::Flush::sync, ec);
+
+        auto const* const next_in = static_cast<unsigned char const*>(zs.next_in);
+        if (is_replay) {
+          skip_ = static_cast<std::size_t>(next_in - scratch_.data());
+          if (skip_ == scratch_size_) {
+            scratch_size_ = 0;
+            skip_         = 0;
+          }
+        } else {
+          in = next_in;
+        }
+
+        auto* const next_out = static_cast<unsigned char*>(zs.next_out);
+        on_decoded(out, static_cast<std::size_t>(next_out - out));
+        out = next_out;
+
+        if (ec == zlib::error::end_of_stream) {
+          ec            = {};
+          scratch_size_ = 0;
+          skip_         = 0;
+          state_        = state::trailer;
+          break;
+        }
+
+        if (ec == zlib::error::need_buffers) {
+          ec = {};
+          if (!is_replay) { goto suspend; }
+          break;
+        }
+
+        if (ec) { goto suspend; }
+        if (!is_replay && in == end) { goto suspend; }
+        break;
+      }
+
+      case state::trailer: {
+        auto const size = coding_ == content_coding::gzip ? 8 : (has_zlib_ ? 4 : 0);
+        if (!gather(size)) { goto suspend; }
+
+        on_trailer(ec);
+        if (ec) { goto suspend; }
+
+        scratch_size_ = 0;
+        state_        = state::done;
+        break;
+      }
+
+      case state::done:
+        if (in == end) { goto suspend; }
+
+        // a gzip body is allowed to be several members one after the other
+        //
+        if (coding_ == content_coding::gzip) {
+          inflater_.reset();
+          crc_.reset();
+          length_ = 0;
+          state_  = state::gzip_header;
+          break;
+        }
+
+        // anything following a deflate stream is ignored
+        //
+        in = end;
+        goto suspend;
+    }
+  }
+
+suspend:
+  produced = static_cast<std::size_t>(out - out_begin);
+  return static_cast<std::size_t>(in - begin);
+}
+
+auto
+foxy::detail::content_decoder::is_done() const noexcept -> bool
+{
+  return state_ == state::done;
+}
+
+auto
+foxy::detail::content_decoder::on_decoded(unsigned char const* data, std::size_t size) -> void
+{
+  if (coding_ == content_coding::gzip) {
+    crc_.process_bytes(data, size);
+    length_ += static_cast<std::uint32_t>(size);
+    return;
+  }
+
+  if (!has_zlib_) { return; }
+
+  while (size > 0) {
+    auto const n = (std::min)(size, adler_nmax);
+    for (auto const* p = data; p != data + n; ++p) {
+      adler_a_ += *p;
+      adler_b_ += adler_a_;
+    }
+
+    adler_a_ %= adler_mod;
+    adler_b_ %= adler_mod;
+
+    data += n;
+    size -= n;
+  }
+}
+
+auto
+foxy::detail::content_decoder::on_trailer(boost::system::error_code& ec) -> void
+{
+  ec = {};
+
+  if (coding_ == content_coding::gzip) {
+    auto const crc   = load_le32(scratch_.data());
+    auto const isize = load_le32(scratch_.data() + 4);
+
+    if (crc != crc_.checksum() || isize != length_) { ec = ::foxy::error::bad_content_encoding; }
+    return;
+  }
+
+  if (has_zlib_ && load_be32(scratch_.data()) != ((adler_b_ << 16) | adler_a_)) {
+    ec = ::foxy::error::bad_content_encoding;
+  }
+}
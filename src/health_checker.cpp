@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/health_checker.hpp>
+#include <foxy/client_session.hpp>
+#include <foxy/error.hpp>
+
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/verb.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/bind_executor.hpp>
+
+#include <functional>
+#include <memory>
+
+namespace http = boost::beast::http;
+
+using namespace std::placeholders;
+
+namespace
+{
+struct probe_op : boost::asio::coroutine
+{
+public:
+  struct state
+  {
+    foxy::client_session                session;
+    std::shared_ptr<foxy::backend_pool> backends;
+    std::size_t                         index;
+    http::request<http::empty_body>     request;
+    http::response<http::string_body>   response;
+
+    state(boost::asio::any_io_executor        executor,
+          std::shared_ptr<foxy::backend_pool> backends_,
+          std::size_t                         index_,
+          foxy::health_check_opts const&      opts)
+      : session(executor, {})
+      , backends(std::move(backends_))
+      , index(index_)
+      , request(http::verb::get, opts.target, 11)
+    {
+      session.opts.timeout = opts.timeout;
+
+      auto const& backend = backends->at(index);
+      request.set(http::field::host, backend.host + ":" + backend.service);
+      request.keep_alive(false);
+    }
+  };
+
+  using executor_type = typename foxy::client_session::executor_type;
+
+  std::unique_ptr<state> p_;
+
+  probe_op(boost::asio::any_io_executor        executor,
+           std::shared_ptr<foxy::backend_pool> backends,
+           std::size_t                         index,
+           foxy::health_check_opts const&      opts)
+    : p_(std::make_unique<state>(executor, std::move(backends), index, opts))
+  {
+  }
+
+  auto
+  get_executor() const noexcept -> executor_type
+  {
+    return p_->session.get_executor();
+  };
+
+  auto operator()(boost::system::error_code ec = {}) -> void
+  {
+    auto& s = *p_;
+    BOOST_ASIO_CORO_REENTER(*this)
+    {
+      BOOST_ASIO_CORO_YIELD
+      {
+        auto const& backend = s.backends->at(s.index);
+        s.session.async_connect(backend.host, backend.service, std::move(*this));
+      }
+
+      if (!ec) {
+        BOOST_ASIO_CORO_YIELD
+        s.session.async_request(s.request, s.response, std::move(*this));
+      }
+
+      if (!ec && s.response.result_int() >= 500) { ec = foxy::error::unexpected_status; }
+
+      s.backends->report_probe(s.index, ec);
+
+      {
+        auto ignored = boost::system::error_code();
+        s.session.stream.plain().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        s.session.stream.plain().close(ignored);
+      }
+    }
+  }
+};
+
+} // namespace
+
+foxy::health_checker::health_checker(boost::asio::any_io_executor          executor,
+                                     std::shared_ptr<::foxy::backend_pool> backends,
+                                     health_check_opts                     opts)
+  : strand_(executor)
+  , timer_(strand_)
+  , backends_(std::move(backends))
+  , opts_(std::move(opts))
+{
+}
+
+auto
+foxy::health_checker::get_executor() -> executor_type
+{
+  return strand_;
+}
+
+auto
+foxy::health_checker::async_run() -> void
+{
+  boost::asio::post(strand_, std::bind(&health_checker::loop, shared_from_this(),
+                                       boost::system::error_code()));
+}
+
+auto
+foxy::health_checker::cancel() -> void
+{
+  boost::asio::post(strand_, [self = shared_from_this()] {
+    self->is_cancelled_ = true;
+    self->timer_.cancel();
+  });
+}
+
+auto
+foxy::health_checker::loop(boost::system::error_code ec) -> void
+{
+  BOOST_ASIO_CORO_REENTER(coro_)
+  {
+    while (!is_cancelled_) {
+      // probes run on their own and report straight to the pool, a slow backend never holds up the
+      // next round for the others
+      //
+      for (auto idx = std::size_t{0}; idx < backends_->size(); ++idx) {
+        boost::asio::post(probe_op(strand_.get_inner_executor(), backends_, idx, opts_));
+      }
+
+      timer_.expires_after(opts_.interval);
+
+      BOOST_ASIO_CORO_YIELD
+      timer_.async_wait(std::bind(&health_checker::loop, shared_from_this(), _1));
+
+      if (ec == boost::asio::error::operation_aborted) { break; }
+    }
+  }
+}
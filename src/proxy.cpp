@@ -8,13 +8,18 @@
 //
 
 #include <foxy/proxy.hpp>
+#include <foxy/access_log.hpp>
 #include <foxy/server_session.hpp>
 #include <foxy/client_session.hpp>
 #include <foxy/log.hpp>
+#include <foxy/tunnel_metrics.hpp>
 #include <foxy/utility.hpp>
 
+#include <foxy/detail/close_stream.hpp>
 #include <foxy/detail/relay.hpp>
 #include <foxy/detail/tunnel.hpp>
+#include <foxy/detail/raw_tunnel.hpp>
+#include <foxy/detail/transfer_stats.hpp>
 
 #include <boost/beast/http/parser.hpp>
 #include <boost/beast/http/message.hpp>
@@ -28,9 +33,11 @@
 
 #include <boost/asio/error.hpp>
 #include <boost/asio/bind_executor.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 #include <boost/assert.hpp>
 
+#include <chrono>
 #include <memory>
 #include <iostream>
 
@@ -45,6 +52,43 @@ using namespace std::placeholders;
 
 namespace
 {
+// lifetime_watch closes a client connection's sockets once the connection has been open for
+// `tunnel_max_lifetime`, which fails whatever is in flight on them
+//
+// It outlives the connection it watches so the timer's handler can always tell whether there's
+// still anything to close.
+//
+struct lifetime_watch
+{
+  boost::asio::steady_timer timer;
+  foxy::server_session*     session = nullptr;
+  foxy::client_session*     client  = nullptr;
+
+  // a raw tunnel runs on a strand of its own and enforces the deadline itself
+  //
+  bool is_raw  = false;
+  bool is_done = false;
+
+  lifetime_watch(foxy::server_session& session_, foxy::client_session& client_)
+    : timer(session_.get_executor())
+    , session(std::addressof(session_))
+    , client(std::addressof(client_))
+  {
+  }
+
+  auto
+  on_expired() -> void
+  {
+    if (is_done || is_raw) { return; }
+
+    foxy::detail::close(session->stream.is_ssl() ? session->stream.ssl().next_layer()
+                                                 : session->stream.plain());
+
+    foxy::detail::close(client->stream.is_ssl() ? client->stream.ssl().next_layer()
+                                                : client->stream.plain());
+  }
+};
+
 struct async_connect_op : boost::asio::coroutine
 {
 public:
@@ -58,12 +102,65 @@ public:
     //
     foxy::client_session client;
 
+    // keeps the proxy's upstream pool alive for as long as we might hand connections back to it
+    //
+    std::shared_ptr<foxy::detail::upstream_pool>  upstreams;
+    std::shared_ptr<foxy::detail::response_cache> cache;
+
     http::response_parser<http::empty_body> shutdown_parser;
 
-    state(foxy::multi_stream stream, foxy::session_opts const& client_opts)
+    // when the connection reaches its maximum lifetime, `watch` is null if it doesn't have one
+    //
+    std::chrono::steady_clock::time_point expires = (std::chrono::steady_clock::time_point::max)();
+    std::shared_ptr<lifetime_watch>       watch;
+
+    // a CONNECT tunnel is logged once it's closed, with everything that went through it
+    //
+    foxy::access_record          tunnel_record;
+    foxy::detail::transfer_stats tunnel_stats;
+
+    // the connection's entry in the proxy's tunnel metrics, if it has any, and when its CONNECT
+    // tunnel was established
+    //
+    std::shared_ptr<foxy::tunnel_metrics::tunnel> metrics;
+    std::chrono::steady_clock::time_point         established;
+
+    state(foxy::multi_stream                            stream,
+          foxy::session_opts const&                     client_opts,
+          std::shared_ptr<foxy::detail::upstream_pool>  upstreams_,
+          std::shared_ptr<foxy::detail::response_cache> cache_)
       : session(std::move(stream), {})
       , client(session.get_executor(), client_opts)
+      , upstreams(std::move(upstreams_))
+      , cache(std::move(cache_))
     {
+      // the client connection is traced alongside the requests and relays it carries
+      //
+      session.opts.tracer = client_opts.tracer;
+
+      if (client_opts.tunnel_max_lifetime > foxy::session_opts::duration_type::zero()) {
+        expires = std::chrono::steady_clock::now() + client_opts.tunnel_max_lifetime;
+        watch   = std::make_shared<lifetime_watch>(session, client);
+        watch->timer.expires_at(expires);
+      }
+
+      if (client_opts.tunnel_metrics) {
+        auto       ec     = boost::system::error_code();
+        auto const remote = session.stream.plain().remote_endpoint(ec);
+
+        metrics             = client_opts.tunnel_metrics->open(remote);
+        tunnel_stats.parent = &metrics->stats;
+      }
+    }
+
+    ~state()
+    {
+      if (metrics) { client.opts.tunnel_metrics->close(*metrics); }
+
+      if (!watch) { return; }
+
+      watch->is_done = true;
+      watch->timer.cancel();
     }
   };
 
@@ -72,8 +169,14 @@ public:
   std::unique_ptr<state> p_;
   executor_type          strand;
 
-  async_connect_op(foxy::multi_stream stream, foxy::session_opts const& client_opts)
-    : p_(std::make_unique<state>(std::move(stream), client_opts))
+  async_connect_op(foxy::multi_stream                            stream,
+                   foxy::session_opts const&                     client_opts,
+                   std::shared_ptr<foxy::detail::upstream_pool>  upstreams,
+                   std::shared_ptr<foxy::detail::response_cache> cache)
+    : p_(std::make_unique<state>(std::move(stream),
+                                 client_opts,
+                                 std::move(upstreams),
+                                 std::move(cache)))
     , strand(p_->session.get_executor())
   {
   }
@@ -91,21 +194,73 @@ public:
     auto& s = *p_;
     BOOST_ASIO_CORO_REENTER(*this)
     {
+      if (s.watch) {
+        s.watch->timer.async_wait(boost::asio::bind_executor(
+          strand, [watch = s.watch](boost::system::error_code ec) {
+            if (!ec) { watch->on_expired(); }
+          }));
+      }
+
       while (true) {
         BOOST_ASIO_CORO_YIELD
-        ::foxy::detail::async_tunnel(s.session, s.client, std::move(*this));
+        ::foxy::detail::async_tunnel(s.session, s.client, s.upstreams.get(), s.cache.get(),
+                                     s.expires, &s.tunnel_record, s.metrics.get(),
+                                     std::move(*this));
         if (ec) { break; }
         if (close_tunnel) { break; }
 
+        if (s.established == std::chrono::steady_clock::time_point()) {
+          s.established = std::chrono::steady_clock::now();
+        }
+
+        if (::foxy::detail::can_raw_tunnel(s.session, s.client)) {
+          if (s.watch) { s.watch->is_raw = true; }
+
+          BOOST_ASIO_CORO_YIELD
+          ::foxy::detail::async_raw_tunnel(s.session, s.client, s.expires, &s.tunnel_stats,
+                                           std::move(*this));
+          break;
+        }
+
         BOOST_ASIO_CORO_YIELD
-        ::foxy::detail::async_relay(s.session, s.client, std::move(*this));
+        ::foxy::detail::async_relay(s.session, s.client, &s.tunnel_stats, std::move(*this));
         if (ec) { break; }
 
         if (close_tunnel) { break; }
       }
 
+      if (s.client.opts.access_log && s.tunnel_record.status != 0) {
+        using namespace std::chrono;
+
+        auto const now = duration_cast<microseconds>(system_clock::now().time_since_epoch());
+
+        s.tunnel_record.duration  = now.count() - s.tunnel_record.timestamp;
+        s.tunnel_record.bytes_in  = s.tunnel_stats.bytes_in;
+        s.tunnel_record.bytes_out = s.tunnel_stats.bytes_out;
+
+        s.client.opts.access_log->record(s.tunnel_record);
+      }
+
+      if (s.metrics && s.established != std::chrono::steady_clock::time_point()) {
+        using duration_type = foxy::tunnel_metrics::duration_type;
+
+        auto const& first_byte = s.tunnel_stats.first_byte;
+
+        s.metrics->on_tcp_info(foxy::sample_tcp_info(s.session.stream.plain()),
+                               foxy::sample_tcp_info(s.client.stream.plain()));
+
+        s.metrics->on_response(first_byte == std::chrono::steady_clock::time_point()
+                                 ? optional<duration_type>()
+                                 : optional<duration_type>(first_byte - s.established));
+      }
+
       BOOST_ASIO_CORO_YIELD s.session.async_shutdown(std::move(*this));
-      BOOST_ASIO_CORO_YIELD s.client.async_shutdown(std::move(*this));
+
+      // pooled absolute-form requests never touch our own client session
+      //
+      if (s.client.stream.plain().is_open()) {
+        BOOST_ASIO_CORO_YIELD s.client.async_shutdown(std::move(*this));
+      }
 
       if (ec == boost::asio::error::eof) {
         // Rationale:
@@ -123,11 +278,27 @@ foxy::proxy::proxy(boost::asio::io_context& io,
                    endpoint_type const&     endpoint,
                    bool                     reuse_addr,
                    foxy::session_opts       client_opts)
-  : stream_(io.get_executor())
-  , acceptor_(io.get_executor(), endpoint, reuse_addr)
+  : proxy(acceptor_type(io.get_executor(), endpoint, reuse_addr), std::move(client_opts))
+{
+}
+
+foxy::proxy::proxy(acceptor_type acceptor, foxy::session_opts client_opts)
+  : stream_(acceptor.get_executor())
+  , acceptor_(std::move(acceptor))
   , strand_(stream_.get_executor())
   , client_opts_(std::move(client_opts))
 {
+  if (client_opts_.max_idle_upstreams > 0) {
+    upstreams_ = std::make_shared<foxy::detail::upstream_pool>(acceptor_.get_executor(),
+                                                               client_opts_.max_idle_upstreams,
+                                                               client_opts_.upstream_idle_timeout);
+  }
+
+  if (client_opts_.cache_max_bytes > 0) {
+    cache_ = std::make_shared<foxy::detail::response_cache>(
+      client_opts_.cache_max_bytes, client_opts_.cache_max_object_size,
+      client_opts_.cache_spill_path, client_opts_.cache_spill_max_bytes);
+  }
 }
 
 auto
@@ -139,7 +310,15 @@ foxy::proxy::get_executor() -> executor_type
 auto
 foxy::proxy::cancel() -> void
 {
-  strand_.post([self = shared_from_this()] { self->acceptor_.cancel(); }, std::allocator<char>());
+  strand_.post(
+    [self = shared_from_this()] {
+      self->acceptor_.cancel();
+
+      // the idle upstreams would otherwise keep the executor busy until they time out
+      //
+      if (self->upstreams_) { self->upstreams_->close(); }
+    },
+    std::allocator<char>());
 }
 
 auto
@@ -173,7 +352,7 @@ foxy::proxy::loop(boost::system::error_code ec) -> void
         continue;
       }
 
-      boost::asio::post(async_connect_op(std::move(stream_), client_opts_));
+      boost::asio::post(async_connect_op(std::move(stream_), client_opts_, upstreams_, cache_));
     }
   }
 }
@@ -0,0 +1,390 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/raw_tunnel.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/write.hpp>
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#if defined(__linux__)
+auto
+close_pipe(std::array<int, 2>& pipe) -> void
+{
+  for (auto& fd : pipe) {
+    if (fd != -1) { ::close(fd); }
+    fd = -1;
+  }
+}
+
+// open_pipe creates a non-blocking pipe sized to hold `size` bytes, the pipe keeps the kernel's
+// default capacity if it can't be grown
+//
+auto
+open_pipe(std::array<int, 2>& pipe, std::size_t const size) -> bool
+{
+  if (::pipe2(pipe.data(), O_NONBLOCK | O_CLOEXEC) != 0) {
+    pipe = {{-1, -1}};
+    return false;
+  }
+
+  ::fcntl(pipe[1], F_SETPIPE_SZ, static_cast<int>(size));
+  return true;
+}
+
+auto
+last_error() -> boost::system::error_code
+{
+  return {errno, boost::system::system_category()};
+}
+
+// splice_to_socket moves bytes out of a pipe into a socket whose peer may have gone away
+//
+// splice(2) has no MSG_NOSIGNAL so SIGPIPE is blocked for the calling thread around it, a SIGPIPE
+// the call raises is then taken off the thread before the old mask is put back. One that was
+// already pending belongs to someone else and is left alone.
+//
+auto
+splice_to_socket(int const pipe, int const socket, std::size_t const size) -> ssize_t
+{
+  sigset_t sigpipe;
+  ::sigemptyset(&sigpipe);
+  ::sigaddset(&sigpipe, SIGPIPE);
+
+  sigset_t pending;
+  ::sigemptyset(&pending);
+  ::sigpending(&pending);
+  auto const was_pending = ::sigismember(&pending, SIGPIPE) == 1;
+
+  sigset_t old_mask;
+  ::pthread_sigmask(SIG_BLOCK, &sigpipe, &old_mask);
+
+  auto const n = ::splice(pipe, nullptr, socket, nullptr, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  auto const error = errno;
+
+  if (n < 0 && error == EPIPE && !was_pending) {
+    auto const no_wait = timespec{0, 0};
+    while (::sigtimedwait(&sigpipe, nullptr, &no_wait) == -1 && errno == EINTR) {}
+  }
+
+  ::pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+
+  errno = error;
+  return n;
+}
+#endif
+
+} // namespace
+
+foxy::detail::raw_tunnel::raw_tunnel(socket_type&               server,
+                                     socket_type&               client,
+                                     boost::beast::flat_buffer& preamble,
+                                     session_opts const&        opts,
+                                     clock_type::time_point     expires,
+                                     transfer_stats*            stats)
+  : strand_(boost::asio::make_strand(server.get_executor()))
+  , timer_(strand_)
+  , preamble_(preamble)
+  , chunk_size_((std::max)(opts.relay_buffer_max, std::size_t{4096}))
+  , idle_timeout_(opts.tunnel_idle_timeout)
+  , expires_(expires)
+  , meter_(opts.tunnel_min_rate, opts.tunnel_rate_window)
+  , stats_(stats)
+{
+  directions_[0].in  = std::addressof(server);
+  directions_[0].out = std::addressof(client);
+
+  directions_[1].in  = std::addressof(client);
+  directions_[1].out = std::addressof(server);
+}
+
+foxy::detail::raw_tunnel::~raw_tunnel()
+{
+#if defined(__linux__)
+  for (auto& d : directions_) { close_pipe(d.pipe); }
+#endif
+}
+
+auto
+foxy::detail::raw_tunnel::run() -> void
+{
+  boost::asio::dispatch(strand_, [self = shared_from_this()] {
+    if (self->preamble_.size() == 0) { return self->start(); }
+
+    boost::asio::async_write(
+      *self->directions_[0].out, self->preamble_.data(),
+      boost::asio::bind_executor(self->strand_, [self](boost::system::error_code ec,
+                                                       std::size_t bytes_transferred) {
+        self->preamble_.consume(bytes_transferred);
+        self->count(self->directions_[0], bytes_transferred);
+        if (ec) {
+          self->ec_ = ec;
+          for (auto& d : self->directions_) { d.done = true; }
+          return self->on_finish(ec);
+        }
+        self->start();
+      }));
+  });
+}
+
+auto
+foxy::detail::raw_tunnel::start() -> void
+{
+  auto const now = clock_type::now();
+
+  for (auto& d : directions_) {
+    d.last_active = now;
+
+    auto ec = boost::system::error_code();
+    d.in->native_non_blocking(true, ec);
+
+#if defined(__linux__)
+    if (!ec && open_pipe(d.pipe, chunk_size_)) { continue; }
+#endif
+
+    d.buffer = buffer_pool::global().acquire(chunk_size_);
+  }
+
+  for (auto& d : directions_) { pump(d); }
+
+  wait_idle();
+}
+
+auto
+foxy::detail::raw_tunnel::pump(direction& d) -> void
+{
+  if (ec_) { return finish_direction(d, ec_); }
+
+  auto self = shared_from_this();
+
+  if (d.pipe[0] != -1) {
+    return d.in->async_wait(socket_type::wait_read,
+                            boost::asio::bind_executor(
+                              strand_, [self, &d](boost::system::error_code ec) {
+                                self->splice_in(d, ec);
+                              }));
+  }
+
+  d.in->async_read_some(
+    boost::asio::buffer(d.buffer.data(), d.buffer.size()),
+    boost::asio::bind_executor(
+      strand_, [self, &d](boost::system::error_code ec, std::size_t bytes_transferred) {
+        self->on_read(d, ec, bytes_transferred);
+      }));
+}
+
+auto
+foxy::detail::raw_tunnel::splice_in(direction& d, boost::system::error_code ec) -> void
+{
+  if (ec || ec_) { return finish_direction(d, ec ? ec : ec_); }
+
+#if defined(__linux__)
+  while (true) {
+    auto const n = ::splice(d.in->native_handle(), nullptr, d.pipe[1], nullptr, chunk_size_,
+                            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+    if (n > 0) {
+      d.pipe_bytes += static_cast<std::size_t>(n);
+      d.last_active = clock_type::now();
+      count(d, static_cast<std::size_t>(n));
+
+      if (!meter_.on_transfer(static_cast<std::size_t>(n), d.last_active)) {
+        return finish_direction(d, boost::asio::error::timed_out);
+      }
+      return splice_out(d, {});
+    }
+
+    if (n == 0) { return finish_direction(d, {}); }
+
+    if (errno == EINTR) { continue; }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) { return pump(d); }
+
+    return finish_direction(d, last_error());
+  }
+#endif
+}
+
+auto
+foxy::detail::raw_tunnel::splice_out(direction& d, boost::system::error_code ec) -> void
+{
+  if (ec || ec_) { return finish_direction(d, ec ? ec : ec_); }
+
+#if defined(__linux__)
+  while (d.pipe_bytes > 0) {
+    auto const n = splice_to_socket(d.pipe[0], d.out->native_handle(), d.pipe_bytes);
+
+    if (n > 0) {
+      d.pipe_bytes -= static_cast<std::size_t>(n);
+      d.last_active = clock_type::now();
+      continue;
+    }
+
+    if (n < 0 && errno == EINTR) { continue; }
+
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      auto self = shared_from_this();
+      return d.out->async_wait(socket_type::wait_write,
+                               boost::asio::bind_executor(
+                                 strand_, [self, &d](boost::system::error_code ec) {
+                                   self->splice_out(d, ec);
+                                 }));
+    }
+
+    return finish_direction(d, n < 0 ? last_error() : boost::asio::error::broken_pipe);
+  }
+#endif
+
+  pump(d);
+}
+
+auto
+foxy::detail::raw_tunnel::on_read(direction&                d,
+                                  boost::system::error_code ec,
+                                  std::size_t               bytes_transferred) -> void
+{
+  if (ec == boost::asio::error::eof) { return finish_direction(d, {}); }
+  if (ec || ec_) { return finish_direction(d, ec ? ec : ec_); }
+
+  d.last_active = clock_type::now();
+  count(d, bytes_transferred);
+
+  if (!meter_.on_transfer(bytes_transferred, d.last_active)) {
+    return finish_direction(d, boost::asio::error::timed_out);
+  }
+
+  auto self = shared_from_this();
+  boost::asio::async_write(
+    *d.out, boost::asio::buffer(d.buffer.data(), bytes_transferred),
+    boost::asio::bind_executor(strand_, [self, &d](boost::system::error_code ec, std::size_t) {
+      self->on_write(d, ec);
+    }));
+}
+
+auto
+foxy::detail::raw_tunnel::on_write(direction& d, boost::system::error_code ec) -> void
+{
+  if (ec || ec_) { return finish_direction(d, ec ? ec : ec_); }
+
+  d.last_active = clock_type::now();
+  pump(d);
+}
+
+auto
+foxy::detail::raw_tunnel::finish_direction(direction& d, boost::system::error_code ec) -> void
+{
+  if (d.done) { return; }
+  d.done = true;
+
+  if (ec) {
+    // any error tears the whole tunnel down, cancelling the sockets wakes up the other direction
+    // which then sees `ec_` and finishes too
+    //
+    if (!ec_) { ec_ = ec; }
+
+    auto ignored = boost::system::error_code();
+    for (auto& other : directions_) { other.in->cancel(ignored); }
+  } else {
+    // a clean EOF is forwarded as a half-close so the peer can finish sending its side
+    //
+    auto ignored = boost::system::error_code();
+    d.out->shutdown(socket_type::shutdown_send, ignored);
+  }
+
+  auto const is_done =
+    std::all_of(directions_.begin(), directions_.end(), [](direction const& x) { return x.done; });
+
+  if (!is_done) { return; }
+
+  timer_.cancel();
+
+#if defined(__linux__)
+  for (auto& x : directions_) { close_pipe(x.pipe); }
+#endif
+
+  on_finish(ec_);
+}
+
+auto
+foxy::detail::raw_tunnel::wait_idle() -> void
+{
+  auto const has_idle_timeout = idle_timeout_ > clock_type::duration::zero();
+  auto const has_expiry       = expires_ != (clock_type::time_point::max)();
+
+  if (!has_idle_timeout && !has_expiry) { return; }
+
+  // the deadline is the tunnel's and not each direction's, a tunnel that only streams one way is
+  // busy however long its other direction stays silent
+  //
+  auto last_active = clock_type::time_point::min();
+  for (auto const& d : directions_) {
+    if (!d.done) { last_active = (std::max)(last_active, d.last_active); }
+  }
+
+  auto const expiry =
+    has_idle_timeout ? (std::min)(last_active + idle_timeout_, expires_) : expires_;
+
+  auto self = shared_from_this();
+  timer_.expires_at(expiry);
+  timer_.async_wait(boost::asio::bind_executor(
+    strand_, [self](boost::system::error_code ec) { self->on_idle_timer(ec); }));
+}
+
+auto
+foxy::detail::raw_tunnel::on_idle_timer(boost::system::error_code ec) -> void
+{
+  auto const is_done =
+    std::all_of(directions_.begin(), directions_.end(), [](direction const& x) { return x.done; });
+
+  if (is_done || ec_ || (ec && ec != boost::asio::error::operation_aborted)) { return; }
+
+  auto last_active = clock_type::time_point::min();
+  for (auto const& d : directions_) {
+    if (!d.done) { last_active = (std::max)(last_active, d.last_active); }
+  }
+
+  auto const now = clock_type::now();
+
+  auto const is_idle =
+    idle_timeout_ > clock_type::duration::zero() && now - last_active >= idle_timeout_;
+
+  if (!is_idle && now < expires_) { return wait_idle(); }
+
+  ec_ = boost::asio::error::timed_out;
+
+  auto ignored = boost::system::error_code();
+  for (auto& d : directions_) { d.in->cancel(ignored); }
+}
+
+auto
+foxy::detail::raw_tunnel::count(direction const& d, std::size_t const bytes) -> void
+{
+  if (!stats_) { return; }
+
+  // the first direction carries what the proxy's client sends
+  //
+  if (std::addressof(d) == directions_.data()) { return stats_->count_in(bytes); }
+
+  if (bytes > 0) { stats_->mark_first_byte(); }
+  stats_->count_out(bytes);
+}
@@ -0,0 +1,874 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/response_cache.hpp>
+#include <foxy/detail/export_connect_fields.hpp>
+
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/rfc7230.hpp>
+#include <boost/beast/http/verb.hpp>
+
+#include <boost/beast/core/string.hpp>
+
+#include <boost/core/ignore_unused.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace http = boost::beast::http;
+
+using clock_type    = foxy::detail::cached_response::clock_type;
+using duration_type = foxy::detail::cached_response::duration_type;
+
+struct foxy::detail::spill_file
+{
+  void*       data = nullptr;
+  std::size_t size = 0;
+
+  spill_file()                  = default;
+  spill_file(spill_file const&) = delete;
+  spill_file(spill_file&&)      = delete;
+
+  ~spill_file()
+  {
+#if defined(__unix__) || defined(__APPLE__)
+    if (data) { ::munmap(data, size); }
+#endif
+  }
+};
+
+namespace
+{
+auto
+trim(boost::string_view str) -> boost::string_view
+{
+  while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) { str.remove_prefix(1); }
+  while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) { str.remove_suffix(1); }
+  return str;
+}
+
+// parse_number saturates at `max` instead of overflowing
+//
+auto
+parse_number(boost::string_view str, std::uint64_t const max) -> boost::optional<std::uint64_t>
+{
+  if (str.empty()) { return boost::none; }
+
+  auto value = std::uint64_t{0};
+  for (auto const c : str) {
+    if (c < '0' || c > '9') { return boost::none; }
+    value = value > max / 10 ? max : (std::min)(value * 10 + static_cast<unsigned>(c - '0'), max);
+  }
+
+  return value;
+}
+
+// parse_delta_seconds caps values at 2^31 as RFC 9111 section 1.2.2 asks
+//
+auto
+parse_delta_seconds(boost::string_view str) -> boost::optional<std::chrono::seconds>
+{
+  if (str.size() >= 2 && str.front() == '"' && str.back() == '"') {
+    str.remove_prefix(1);
+    str.remove_suffix(1);
+  }
+
+  auto const seconds = parse_number(str, std::uint64_t{2147483648});
+  if (!seconds) { return boost::none; }
+
+  return std::chrono::seconds(static_cast<std::chrono::seconds::rep>(*seconds));
+}
+
+// days_from_civil is Howard Hinnant's algorithm for the number of days since the Unix epoch
+//
+auto
+days_from_civil(std::int64_t y, unsigned const m, unsigned const d) -> std::int64_t
+{
+  y -= m <= 2;
+  auto const era = (y >= 0 ? y : y - 399) / 400;
+  auto const yoe = static_cast<unsigned>(y - era * 400);
+  auto const doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  auto const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+auto
+parse_digits(boost::string_view str, std::size_t const pos, std::size_t const len)
+  -> boost::optional<unsigned>
+{
+  auto value = 0u;
+  for (auto idx = pos; idx < pos + len; ++idx) {
+    auto const c = str[idx];
+    if (c < '0' || c > '9') { return boost::none; }
+    value = value * 10 + static_cast<unsigned>(c - '0');
+  }
+  return value;
+}
+
+auto
+field_date(http::fields const& fields, http::field const name)
+  -> boost::optional<clock_type::time_point>
+{
+  auto const pos = fields.find(name);
+  if (pos == fields.end()) { return boost::none; }
+  return foxy::detail::parse_http_date(pos->value());
+}
+
+// joined_values is how a request's field is compared for Vary, every instance of the field joined
+// together in order
+//
+auto
+joined_values(http::fields const& fields, boost::string_view name) -> std::string
+{
+  auto joined = std::string();
+
+  auto const range = fields.equal_range(name);
+  for (auto pos = range.first; pos != range.second; ++pos) {
+    if (!joined.empty()) { joined += ", "; }
+    auto const value = trim(pos->value());
+    joined.append(value.data(), value.size());
+  }
+
+  return joined;
+}
+
+auto
+vary_names(http::fields const& fields) -> std::vector<std::string>
+{
+  auto names = std::vector<std::string>();
+
+  auto const range = fields.equal_range(http::field::vary);
+  for (auto pos = range.first; pos != range.second; ++pos) {
+    for (auto const name : http::token_list(pos->value())) {
+      names.emplace_back(name.data(), name.size());
+    }
+  }
+
+  return names;
+}
+
+auto
+matches(foxy::detail::cached_response const& entry, http::fields const& request) -> bool
+{
+  return std::all_of(entry.vary.begin(), entry.vary.end(), [&](auto const& field) {
+    return joined_values(request, field.first) == field.second;
+  });
+}
+
+auto
+is_heuristically_cacheable(http::status const status) -> bool
+{
+  switch (status) {
+    case http::status::ok:
+    case http::status::non_authoritative_information:
+    case http::status::no_content:
+    case http::status::multiple_choices:
+    case http::status::moved_permanently:
+    case http::status::permanent_redirect:
+    case http::status::not_found:
+    case http::status::method_not_allowed:
+    case http::status::gone:
+    case http::status::uri_too_long:
+    case http::status::not_implemented:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// stamp works out how old a response is and how long it stays fresh from its fields, as per RFC
+// 9111 sections 4.2.1 and 4.2.3
+//
+auto
+stamp(foxy::detail::cached_response& entry, clock_type::time_point const response_time) -> void
+{
+  auto const& fields = entry.fields;
+
+  auto const cc   = foxy::detail::parse_cache_control(fields);
+  auto const date = field_date(fields, http::field::date).value_or(response_time);
+
+  auto age_value = duration_type::zero();
+  {
+    auto const pos = fields.find(http::field::age);
+    if (pos != fields.end()) {
+      age_value = parse_delta_seconds(trim(pos->value())).value_or(std::chrono::seconds(0));
+    }
+  }
+
+  auto const apparent_age = (std::max)(duration_type::zero(), response_time - date);
+
+  entry.response_time         = response_time;
+  entry.corrected_initial_age = (std::max)(apparent_age, age_value);
+
+  if (cc.no_cache) {
+    entry.freshness_lifetime = duration_type::zero();
+
+  } else if (cc.s_maxage) {
+    entry.freshness_lifetime = *cc.s_maxage;
+
+  } else if (cc.max_age) {
+    entry.freshness_lifetime = *cc.max_age;
+
+  } else if (fields.find(http::field::expires) != fields.end()) {
+    // an Expires we can't make sense of means the response is already stale
+    //
+    auto const expires       = field_date(fields, http::field::expires);
+    entry.freshness_lifetime = expires ? (std::max)(duration_type::zero(), *expires - date)
+                                       : duration_type::zero();
+
+  } else if (auto const last_modified = field_date(fields, http::field::last_modified)) {
+    // the usual heuristic of a tenth of the time since the resource last changed, capped at a day
+    //
+    entry.freshness_lifetime =
+      is_heuristically_cacheable(entry.status)
+        ? (std::min)(duration_type(std::chrono::hours(24)),
+                     (std::max)(duration_type::zero(), (date - *last_modified) / 10))
+        : duration_type::zero();
+
+  } else {
+    entry.freshness_lifetime = duration_type::zero();
+  }
+}
+
+// end_to_end copies the fields worth storing, a cache works out its own Age and Content-Length when
+// it serves a response
+//
+auto
+end_to_end(http::fields fields) -> http::fields
+{
+  auto hop_by_hops = http::fields();
+  foxy::detail::export_connect_fields(fields, hop_by_hops);
+
+  fields.erase(http::field::age);
+  fields.erase(http::field::content_length);
+
+  return fields;
+}
+
+// spill moves an entry's body into a file in `dir` that's mapped back in and unlinked right away,
+// returns null when the file can't be written or mapped
+//
+auto
+spill(std::string const& dir, std::shared_ptr<foxy::detail::cached_response const> entry)
+  -> std::shared_ptr<foxy::detail::cached_response const>
+{
+  // a response freshened after it was spilled is mapped already and an empty body has nothing to
+  // map at all
+  //
+  if (entry->spilled || entry->body.empty()) { return entry; }
+
+  auto spilled = std::make_shared<foxy::detail::cached_response>();
+
+  spilled->status                = entry->status;
+  spilled->fields                = entry->fields;
+  spilled->response_time         = entry->response_time;
+  spilled->corrected_initial_age = entry->corrected_initial_age;
+  spilled->freshness_lifetime    = entry->freshness_lifetime;
+  spilled->vary                  = entry->vary;
+
+#if defined(__unix__) || defined(__APPLE__)
+  auto path = dir + "/foxy-cache-XXXXXX";
+
+  auto const fd = ::mkstemp(&path[0]);
+  if (fd < 0) { return nullptr; }
+
+  ::unlink(path.c_str());
+
+  auto const& body    = entry->body;
+  auto        written = std::size_t{0};
+  while (written < body.size()) {
+    auto const num_written = ::write(fd, body.data() + written, body.size() - written);
+    if (num_written < 0 && errno == EINTR) { continue; }
+    if (num_written <= 0) {
+      ::close(fd);
+      return nullptr;
+    }
+    written += static_cast<std::size_t>(num_written);
+  }
+
+  auto const data = ::mmap(nullptr, body.size(), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) { return nullptr; }
+
+  auto file  = std::make_shared<foxy::detail::spill_file>();
+  file->data = data;
+  file->size = body.size();
+
+  spilled->spilled = std::move(file);
+  return spilled;
+#else
+  boost::ignore_unused(dir);
+  return nullptr;
+#endif
+}
+
+auto
+make_vary(http::fields const& response, http::fields const& request)
+  -> std::vector<std::pair<std::string, std::string>>
+{
+  auto vary = std::vector<std::pair<std::string, std::string>>();
+  for (auto& name : vary_names(response)) {
+    auto value = joined_values(request, name);
+    vary.emplace_back(std::move(name), std::move(value));
+  }
+  return vary;
+}
+
+} // namespace
+
+auto
+foxy::detail::parse_cache_control(http::fields const& fields) -> cache_control
+{
+  using boost::beast::iequals;
+
+  auto cc = cache_control();
+
+  auto const range = fields.equal_range(http::field::cache_control);
+  for (auto pos = range.first; pos != range.second; ++pos) {
+    auto value = pos->value();
+
+    while (!value.empty()) {
+      // directive values may be quoted strings with commas in them
+      //
+      auto in_quotes = false;
+      auto end       = std::size_t{0};
+      for (; end < value.size(); ++end) {
+        if (value[end] == '"') { in_quotes = !in_quotes; }
+        if (value[end] == ',' && !in_quotes) { break; }
+      }
+
+      auto const directive = trim(value.substr(0, end));
+      value.remove_prefix((std::min)(end + 1, value.size()));
+
+      auto const eq   = directive.find('=');
+      auto const name = trim(directive.substr(0, eq));
+      auto const arg =
+        eq == boost::string_view::npos ? boost::string_view() : trim(directive.substr(eq + 1));
+
+      if (iequals(name, "no-store")) {
+        cc.no_store = true;
+      } else if (iequals(name, "no-cache")) {
+        cc.no_cache = true;
+      } else if (iequals(name, "private")) {
+        cc.is_private = true;
+      } else if (iequals(name, "public")) {
+        cc.is_public = true;
+      } else if (iequals(name, "must-revalidate") || iequals(name, "proxy-revalidate")) {
+        cc.must_revalidate = true;
+      } else if (iequals(name, "max-age")) {
+        // a max-age we can't parse is treated as zero so we err on the side of revalidating
+        //
+        cc.max_age = parse_delta_seconds(arg).value_or(std::chrono::seconds(0));
+      } else if (iequals(name, "s-maxage")) {
+        cc.s_maxage = parse_delta_seconds(arg).value_or(std::chrono::seconds(0));
+      }
+    }
+  }
+
+  return cc;
+}
+
+auto
+foxy::detail::parse_http_date(boost::string_view date)
+  -> boost::optional<std::chrono::system_clock::time_point>
+{
+  // Sun, 06 Nov 1994 08:49:37 GMT
+  // 0123456789012345678901234567
+  //
+  date = trim(date);
+  if (date.size() != 29 || date.substr(3, 2) != ", " || date.substr(25) != " GMT") {
+    return boost::none;
+  }
+
+  static auto const months = std::array<boost::string_view, 12>{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+  auto const month_pos = std::find(months.begin(), months.end(), date.substr(8, 3));
+  if (month_pos == months.end()) { return boost::none; }
+
+  auto const day    = parse_digits(date, 5, 2);
+  auto const year   = parse_digits(date, 12, 4);
+  auto const hour   = parse_digits(date, 17, 2);
+  auto const minute = parse_digits(date, 20, 2);
+  auto const second = parse_digits(date, 23, 2);
+
+  if (!day || !year || !hour || !minute || !second) { return boost::none; }
+  if (date[7] != ' ' || date[11] != ' ' || date[16] != ' ' || date[19] != ':' || date[22] != ':') {
+    return boost::none;
+  }
+
+  if (*day < 1 || *day > 31 || *hour > 23 || *minute > 59 || *second > 60) { return boost::none; }
+
+  auto const month = static_cast<unsigned>(month_pos - months.begin()) + 1;
+  auto const days  = days_from_civil(*year, month, *day);
+
+  auto const since_epoch = std::chrono::hours(24) * days + std::chrono::hours(*hour) +
+                           std::chrono::minutes(*minute) + std::chrono::seconds(*second);
+
+  return std::chrono::system_clock::time_point(
+    std::chrono::duration_cast<std::chrono::system_clock::duration>(since_epoch));
+}
+
+auto
+foxy::detail::cached_response::age(clock_type::time_point const now) const -> duration_type
+{
+  return corrected_initial_age + (std::max)(duration_type::zero(), now - response_time);
+}
+
+auto
+foxy::detail::cached_response::is_fresh(clock_type::time_point const now) const -> bool
+{
+  return freshness_lifetime > age(now);
+}
+
+auto
+foxy::detail::cached_response::has_validators() const -> bool
+{
+  return fields.find(http::field::etag) != fields.end() ||
+         fields.find(http::field::last_modified) != fields.end();
+}
+
+auto
+foxy::detail::cached_response::content() const -> boost::string_view
+{
+  if (spilled) { return {static_cast<char const*>(spilled->data), spilled->size}; }
+  return body;
+}
+
+auto
+foxy::detail::cached_response::size() const -> std::size_t
+{
+  // a rough stand-in for the bookkeeping each field and entry costs us
+  //
+  auto constexpr const overhead = std::size_t{64};
+
+  auto total = sizeof(cached_response) + content().size();
+  for (auto const& field : fields) {
+    total += field.name_string().size() + field.value().size() + overhead;
+  }
+  for (auto const& field : vary) { total += field.first.size() + field.second.size() + overhead; }
+  return total;
+}
+
+foxy::detail::response_cache::response_cache(std::size_t max_bytes,
+                                             std::size_t max_object_size,
+                                             std::string spill_path,
+                                             std::size_t spill_max_bytes)
+  : max_bytes_(max_bytes)
+  , max_object_size_((std::min)(max_bytes, max_object_size))
+  , spill_path_(std::move(spill_path))
+  , spill_max_bytes_(spill_path_.empty() ? 0 : spill_max_bytes)
+{
+}
+
+auto
+foxy::detail::response_cache::make_key(boost::string_view scheme,
+                                       boost::string_view host,
+                                       boost::string_view service,
+                                       boost::string_view target) -> std::string
+{
+  auto key = std::string();
+  key.reserve(scheme.size() + host.size() + service.size() + target.size() + 4);
+
+  key.append(scheme.data(), scheme.size());
+  key += "://";
+  key.append(host.data(), host.size());
+  key += ':';
+  key.append(service.data(), service.size());
+  key.append(target.data(), target.size());
+
+  return key;
+}
+
+auto
+foxy::detail::response_cache::is_storable(http::request_header<> const&  request,
+                                          http::response_header<> const& response) -> bool
+{
+  if (request.method() != http::verb::get) { return false; }
+
+  auto const req_cc = parse_cache_control(request);
+  auto const res_cc = parse_cache_control(response);
+
+  if (req_cc.no_store || res_cc.no_store || res_cc.is_private) { return false; }
+
+  // a shared cache may only reuse an authenticated response when the origin says so
+  //
+  if (request.find(http::field::authorization) != request.end() && !res_cc.is_public &&
+      !res_cc.s_maxage && !res_cc.must_revalidate) {
+    return false;
+  }
+
+  for (auto const& name : vary_names(response)) {
+    if (name == "*") { return false; }
+  }
+
+  auto const status = response.result();
+
+  auto const has_explicit_lifetime = res_cc.max_age || res_cc.s_maxage ||
+                                     response.find(http::field::expires) != response.end();
+
+  if (is_heuristically_cacheable(status)) { return true; }
+
+  return has_explicit_lifetime &&
+         (status == http::status::found || status == http::status::temporary_redirect);
+}
+
+auto
+foxy::detail::response_cache::requires_validation(http::request_header<> const& request) -> bool
+{
+  auto const cc = parse_cache_control(request);
+  if (cc.no_cache || (cc.max_age && *cc.max_age == std::chrono::seconds(0))) { return true; }
+
+  // HTTP/1.0 clients say the same thing with Pragma
+  //
+  auto const pragma = request.find(http::field::pragma);
+  return pragma != request.end() && boost::beast::iequals(trim(pragma->value()), "no-cache");
+}
+
+auto
+foxy::detail::response_cache::max_object_size() const noexcept -> std::size_t
+{
+  return max_object_size_;
+}
+
+auto
+foxy::detail::response_cache::lookup(boost::string_view key, http::request_header<> const& request)
+  -> entry_type
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto const pos = variants_.find(key.to_string());
+  if (pos == variants_.end()) { return nullptr; }
+
+  for (auto const node_pos : pos->second) {
+    if (!matches(*node_pos->entry, request)) { continue; }
+
+    // a spilled response is served from its mapping and stays on disk, the page cache is what
+    // keeps it at hand
+    //
+    auto& lru = node_pos->is_spilled ? spilled_ : lru_;
+    lru.splice(lru.begin(), lru, node_pos);
+    return node_pos->entry;
+  }
+
+  return nullptr;
+}
+
+auto
+foxy::detail::response_cache::store(boost::string_view             key,
+                                    http::request_header<> const&  request,
+                                    http::response_header<> const& response,
+                                    std::string                    body) -> entry_type
+{
+  if (!is_storable(request, response) || body.size() > max_object_size_) { return nullptr; }
+
+  auto entry    = std::make_shared<cached_response>();
+  entry->status = response.result();
+  entry->fields = end_to_end(response);
+  entry->body   = std::move(body);
+  entry->vary   = make_vary(response, request);
+
+  stamp(*entry, clock_type::now());
+
+  if (entry->size() > max_object_size_) { return nullptr; }
+
+  insert(key.to_string(), entry);
+  return entry;
+}
+
+auto
+foxy::detail::response_cache::freshen(boost::string_view             key,
+                                      entry_type const&              entry,
+                                      http::request_header<> const&  request,
+                                      http::response_header<> const& not_modified) -> entry_type
+{
+  if (!entry) { return nullptr; }
+
+  auto freshened = std::make_shared<cached_response>(*entry);
+
+  // the 304's fields replace the stored ones of the same name
+  //
+  auto const updates = end_to_end(not_modified);
+  for (auto const& field : updates) { freshened->fields.erase(field.name_string()); }
+  for (auto const& field : updates) {
+    freshened->fields.insert(field.name_string(), field.value());
+  }
+
+  freshened->vary = make_vary(freshened->fields, request);
+  stamp(*freshened, clock_type::now());
+
+  auto const cc = parse_cache_control(freshened->fields);
+  if (cc.no_store || cc.is_private) {
+    invalidate(key);
+    return freshened;
+  }
+
+  insert(key.to_string(), freshened);
+  return freshened;
+}
+
+auto
+foxy::detail::response_cache::invalidate(boost::string_view key) -> void
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  ++invalidations_;
+
+  auto const pos = variants_.find(key.to_string());
+  if (pos == variants_.end()) { return; }
+
+  auto const node_positions = std::move(pos->second);
+  variants_.erase(pos);
+
+  for (auto const node_pos : node_positions) { forget(node_pos); }
+}
+
+auto
+foxy::detail::response_cache::begin_fill(boost::string_view key, std::function<void()> notify)
+  -> bool
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto const inserted = fills_.emplace(key.to_string(), std::vector<std::function<void()>>());
+  if (inserted.second) { return true; }
+
+  inserted.first->second.push_back(std::move(notify));
+  return false;
+}
+
+auto
+foxy::detail::response_cache::end_fill(boost::string_view key) -> void
+{
+  auto waiters = std::vector<std::function<void()>>();
+  {
+    std::lock_guard<std::mutex> lock{mtx_};
+
+    auto const pos = fills_.find(key.to_string());
+    if (pos == fills_.end()) { return; }
+
+    waiters = std::move(pos->second);
+    fills_.erase(pos);
+  }
+
+  for (auto& notify : waiters) { notify(); }
+}
+
+auto
+foxy::detail::response_cache::size() const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+  return lru_.size();
+}
+
+auto
+foxy::detail::response_cache::bytes() const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+  return bytes_;
+}
+
+auto
+foxy::detail::response_cache::spilled_size() const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+  return spilled_.size();
+}
+
+auto
+foxy::detail::response_cache::spilled_bytes() const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+  return spilled_bytes_;
+}
+
+auto
+foxy::detail::response_cache::insert(std::string key, entry_type entry) -> void
+{
+  auto evicted       = std::vector<node>();
+  auto invalidations = std::uint64_t{0};
+  {
+    std::lock_guard<std::mutex> lock{mtx_};
+
+    auto& node_positions = variants_[key];
+
+    // a response replaces whichever variant it was selected by, in memory or on disk
+    //
+    auto const same_variant = std::find_if(
+      node_positions.begin(), node_positions.end(),
+      [&](auto const node_pos) { return node_pos->entry->vary == entry->vary; });
+
+    if (same_variant != node_positions.end()) {
+      forget(*same_variant);
+      node_positions.erase(same_variant);
+    }
+
+    bytes_ += entry->size();
+    lru_.push_front(node{key, std::move(entry)});
+    node_positions.push_back(lru_.begin());
+
+    while (bytes_ > max_bytes_ && !lru_.empty()) {
+      auto const pos = std::prev(lru_.end());
+      if (pos->entry->size() <= spill_max_bytes_) { evicted.push_back(*pos); }
+      erase(pos);
+    }
+
+    invalidations = invalidations_;
+  }
+
+  // the files are written without holding the lock so lookups aren't held up by the disk
+  //
+  for (auto& evictee : evicted) {
+    auto spilled = spill(spill_path_, std::move(evictee.entry));
+    if (!spilled) { continue; }
+
+    insert_spilled(std::move(evictee.key), std::move(spilled), invalidations);
+  }
+}
+
+auto
+foxy::detail::response_cache::insert_spilled(std::string         key,
+                                             entry_type          entry,
+                                             std::uint64_t const invalidations) -> void
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  if (invalidations != invalidations_) { return; }
+
+  // a newer response for the same variant may have been stored while this one was written out
+  //
+  auto const variants = variants_.find(key);
+  if (variants != variants_.end() &&
+      std::any_of(variants->second.begin(), variants->second.end(),
+                  [&](auto const node_pos) { return node_pos->entry->vary == entry->vary; })) {
+    return;
+  }
+
+  spilled_bytes_ += entry->size();
+  spilled_.push_front(node{key, std::move(entry), true});
+  variants_[key].push_back(spilled_.begin());
+
+  while (spilled_bytes_ > spill_max_bytes_ && !spilled_.empty()) {
+    erase(std::prev(spilled_.end()));
+  }
+}
+
+auto
+foxy::detail::response_cache::erase(lru_type::iterator pos) -> void
+{
+  auto const variants = variants_.find(pos->key);
+
+  auto& node_positions = variants->second;
+  node_positions.erase(std::find(node_positions.begin(), node_positions.end(), pos));
+  if (node_positions.empty()) { variants_.erase(variants); }
+
+  forget(pos);
+}
+
+auto
+foxy::detail::response_cache::forget(lru_type::iterator pos) -> void
+{
+  if (pos->is_spilled) {
+    spilled_bytes_ -= pos->entry->size();
+    spilled_.erase(pos);
+  } else {
+    bytes_ -= pos->entry->size();
+    lru_.erase(pos);
+  }
+}
+
+foxy::detail::cache_fill::cache_fill(response_cache&               cache,
+                                     std::string                   key,
+                                     http::request_header<> const& request,
+                                     bool                          is_filling)
+  : cache_(cache)
+  , key_(std::move(key))
+  , request_(request)
+  , is_filling_(is_filling)
+{
+}
+
+foxy::detail::cache_fill::~cache_fill()
+{
+  if (is_filling_) { cache_.end_fill(key_); }
+}
+
+auto
+foxy::detail::cache_fill::revalidate(response_cache::entry_type entry) -> void
+{
+  revalidating_ = std::move(entry);
+}
+
+auto
+foxy::detail::cache_fill::is_not_modified() const noexcept -> bool
+{
+  return is_not_modified_;
+}
+
+auto
+foxy::detail::cache_fill::commit() -> response_cache::entry_type
+{
+  if (is_not_modified_) { return cache_.freshen(key_, revalidating_, request_, response_); }
+  if (is_storable_) { return cache_.store(key_, request_, response_, std::move(body_)); }
+  return nullptr;
+}
+
+auto
+foxy::detail::cache_fill::on_response_header(http::response_header<> const& header) -> bool
+{
+  if (revalidating_ && header.result() == http::status::not_modified) {
+    is_not_modified_ = true;
+    response_        = header;
+    return false;
+  }
+
+  is_storable_ = response_cache::is_storable(request_, header);
+  if (!is_storable_) { return true; }
+
+  response_ = header;
+
+  auto const content_length = header.find(http::field::content_length);
+  if (content_length != header.end()) {
+    auto const length =
+      parse_number(trim(content_length->value()), (std::numeric_limits<std::uint64_t>::max)());
+
+    if (!length || *length > cache_.max_object_size()) {
+      is_storable_ = false;
+      return true;
+    }
+
+    body_.reserve(static_cast<std::size_t>(*length));
+  }
+
+  return true;
+}
+
+auto
+foxy::detail::cache_fill::on_response_body(boost::asio::const_buffer chunk) -> void
+{
+  if (!is_storable_) { return; }
+
+  if (body_.size() + chunk.size() > cache_.max_object_size()) {
+    is_storable_ = false;
+    body_        = std::string();
+    return;
+  }
+
+  body_.append(static_cast<char const*>(chunk.data()), chunk.size());
+}
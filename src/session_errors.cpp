@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session_errors.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/ssl/error.hpp>
+
+#include <boost/beast/http/error.hpp>
+
+namespace
+{
+auto
+is_http_category(boost::system::error_category const& category) noexcept -> bool
+{
+  return category == boost::beast::http::make_error_code(boost::beast::http::error::end_of_stream)
+                       .category();
+}
+} // namespace
+
+auto
+foxy::classify(boost::system::error_code const ec) noexcept -> error_class
+{
+  namespace error = boost::asio::error;
+
+  if (ec == error::eof || ec == boost::beast::http::error::end_of_stream) {
+    return error_class::eof;
+  }
+
+  if (ec == error::operation_aborted) { return error_class::aborted; }
+
+  if (ec == error::connection_reset || ec == error::connection_aborted ||
+      ec == error::broken_pipe) {
+    return error_class::reset;
+  }
+
+  if (ec == error::connection_refused || ec == error::host_unreachable ||
+      ec == error::network_unreachable || ec == error::timed_out) {
+    return error_class::refused;
+  }
+
+  auto const& category = ec.category();
+
+  if (category == error::get_netdb_category() || category == error::get_addrinfo_category()) {
+    return error_class::resolve;
+  }
+
+  if (category == error::get_ssl_category() ||
+      category == boost::asio::ssl::error::get_stream_category()) {
+    return error_class::tls;
+  }
+
+  if (is_http_category(category)) { return error_class::http; }
+
+  return error_class::other;
+}
+
+auto
+foxy::is_failure(boost::system::error_code const ec) noexcept -> bool
+{
+  return ec && ec != boost::beast::http::error::need_buffer;
+}
+
+auto
+foxy::to_string(error_class const ec) noexcept -> boost::string_view
+{
+  switch (ec) {
+    case error_class::eof:
+      return "eof";
+    case error_class::reset:
+      return "reset";
+    case error_class::refused:
+      return "refused";
+    case error_class::aborted:
+      return "aborted";
+    case error_class::resolve:
+      return "resolve";
+    case error_class::tls:
+      return "tls";
+    case error_class::http:
+      return "http";
+    case error_class::other:
+      return "other";
+  }
+  return "unknown";
+}
+
+auto
+foxy::session_errors::phase::operator[](error_class const ec) const noexcept -> std::uint64_t
+{
+  return errors[static_cast<std::size_t>(ec)];
+}
+
+auto
+foxy::session_errors::snapshot_type::operator[](session_op const op) const noexcept
+  -> phase const&
+{
+  return phases[static_cast<std::size_t>(op)];
+}
+
+auto
+foxy::session_errors::snapshot_type::timeouts() const noexcept -> std::uint64_t
+{
+  auto total = std::uint64_t{0};
+  for (auto const& phase : phases) { total += phase.timeouts; }
+  return total;
+}
+
+auto
+foxy::session_errors::snapshot_type::errors(error_class const ec) const noexcept -> std::uint64_t
+{
+  auto total = std::uint64_t{0};
+  for (auto const& phase : phases) { total += phase[ec]; }
+  return total;
+}
+
+auto
+foxy::session_errors::on_timeout(session_op const    op,
+                                 duration_type const budget,
+                                 duration_type const elapsed) noexcept -> void
+{
+  auto& phase = phases_[static_cast<std::size_t>(op)];
+
+  phase.timeouts.fetch_add(1, std::memory_order_relaxed);
+  phase.budget.store(budget.count(), std::memory_order_relaxed);
+  phase.elapsed_total.fetch_add(elapsed.count(), std::memory_order_relaxed);
+
+  auto max = phase.elapsed_max.load(std::memory_order_relaxed);
+  while (max < elapsed.count() &&
+         !phase.elapsed_max.compare_exchange_weak(max, elapsed.count(),
+                                                  std::memory_order_relaxed)) {
+  }
+}
+
+auto
+foxy::session_errors::on_error(session_op const op, boost::system::error_code const ec) noexcept
+  -> void
+{
+  if (!is_failure(ec)) { return; }
+
+  phases_[static_cast<std::size_t>(op)]
+    .errors[static_cast<std::size_t>(classify(ec))]
+    .fetch_add(1, std::memory_order_relaxed);
+}
+
+auto
+foxy::session_errors::snapshot() const -> snapshot_type
+{
+  auto snapshot = snapshot_type();
+  for (auto i = std::size_t{0}; i < session_op_count; ++i) {
+    auto const& from = phases_[i];
+    auto&       to   = snapshot.phases[i];
+
+    to.timeouts      = from.timeouts.load(std::memory_order_relaxed);
+    to.budget        = duration_type(from.budget.load(std::memory_order_relaxed));
+    to.elapsed_total = duration_type(from.elapsed_total.load(std::memory_order_relaxed));
+    to.elapsed_max   = duration_type(from.elapsed_max.load(std::memory_order_relaxed));
+
+    for (auto j = std::size_t{0}; j < error_class_count; ++j) {
+      to.errors[j] = from.errors[j].load(std::memory_order_relaxed);
+    }
+  }
+  return snapshot;
+}
+
+auto
+foxy::session_errors::reset() noexcept -> void
+{
+  for (auto& phase : phases_) {
+    phase.timeouts.store(0, std::memory_order_relaxed);
+    phase.budget.store(0, std::memory_order_relaxed);
+    phase.elapsed_total.store(0, std::memory_order_relaxed);
+    phase.elapsed_max.store(0, std::memory_order_relaxed);
+    for (auto& count : phase.errors) { count.store(0, std::memory_order_relaxed); }
+  }
+}
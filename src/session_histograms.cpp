@@ -0,0 +1,223 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session_histograms.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+auto
+floor_log2(std::uint64_t v) noexcept -> unsigned
+{
+  auto e = 0u;
+  for (auto shift = 32u; shift > 0; shift /= 2) {
+    if ((v >> shift) != 0) {
+      v >>= shift;
+      e += shift;
+    }
+  }
+  return e;
+}
+
+auto
+bucket_index(std::uint64_t const value) noexcept -> std::size_t
+{
+  using foxy::histogram;
+
+  if (value < histogram::sub_bucket_count) { return static_cast<std::size_t>(value); }
+
+  auto const e = floor_log2(value);
+  if (e >= histogram::max_exponent) { return histogram::bucket_count - 1; }
+
+  auto const shift = e - histogram::sub_bucket_bits;
+  auto const sub   = static_cast<std::size_t>(value >> shift) - histogram::sub_bucket_count;
+
+  return (shift + 1) * histogram::sub_bucket_count + sub;
+}
+
+// bucket_upper_bound is the largest value that goes into the bucket at `index`
+//
+auto
+bucket_upper_bound(std::size_t const index) noexcept -> std::uint64_t
+{
+  using foxy::histogram;
+
+  if (index < histogram::sub_bucket_count) { return index; }
+
+  auto const shift = static_cast<unsigned>(index / histogram::sub_bucket_count) - 1;
+  auto const sub   = static_cast<std::uint64_t>(index % histogram::sub_bucket_count);
+  auto const lower = (histogram::sub_bucket_count + sub) << shift;
+
+  return lower + (std::uint64_t{1} << shift) - 1;
+}
+
+// every thread that records gets a number of its own the first time it does, which picks the
+// shard it records into
+//
+auto
+thread_slot() noexcept -> std::size_t
+{
+  static std::atomic<std::size_t> next_slot{0};
+  thread_local std::size_t const  slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+
+  return slot;
+}
+} // namespace
+
+foxy::histogram::histogram()
+  : buckets_(bucket_count, 0)
+{
+}
+
+auto
+foxy::histogram::record(std::uint64_t const value) noexcept -> void
+{
+  ++buckets_[bucket_index(value)];
+
+  min_ = count_ == 0 ? value : (std::min)(min_, value);
+  max_ = (std::max)(max_, value);
+  sum_ += value;
+  ++count_;
+}
+
+auto
+foxy::histogram::merge(histogram const& other) noexcept -> void
+{
+  if (other.count_ == 0) { return; }
+
+  for (std::size_t idx = 0; idx < bucket_count; ++idx) { buckets_[idx] += other.buckets_[idx]; }
+
+  min_ = count_ == 0 ? other.min_ : (std::min)(min_, other.min_);
+  max_ = (std::max)(max_, other.max_);
+  sum_ += other.sum_;
+  count_ += other.count_;
+}
+
+auto
+foxy::histogram::count() const noexcept -> std::uint64_t
+{
+  return count_;
+}
+
+auto
+foxy::histogram::min() const noexcept -> std::uint64_t
+{
+  return min_;
+}
+
+auto
+foxy::histogram::max() const noexcept -> std::uint64_t
+{
+  return max_;
+}
+
+auto
+foxy::histogram::mean() const noexcept -> std::uint64_t
+{
+  return count_ == 0 ? 0 : sum_ / count_;
+}
+
+auto
+foxy::histogram::value_at_percentile(double const percentile) const noexcept -> std::uint64_t
+{
+  if (count_ == 0) { return 0; }
+
+  auto const p      = (std::min)((std::max)(percentile, 0.0), 100.0);
+  auto const target = std::ceil(p / 100.0 * static_cast<double>(count_));
+  auto const rank   = (std::max)(std::uint64_t{1}, static_cast<std::uint64_t>(target));
+
+  auto seen = std::uint64_t{0};
+  for (std::size_t idx = 0; idx < bucket_count; ++idx) {
+    seen += buckets_[idx];
+    if (seen < rank) { continue; }
+
+    // everything past the tracked range shares the last bucket, whose bound means nothing
+    //
+    if (idx == bucket_count - 1) { return max_; }
+
+    return (std::max)(min_, (std::min)(max_, bucket_upper_bound(idx)));
+  }
+
+  return max_;
+}
+
+auto
+foxy::session_histograms::phase::count() const noexcept -> std::uint64_t
+{
+  return latency.count();
+}
+
+auto
+foxy::session_histograms::phase::percentile(double const p) const noexcept -> duration_type
+{
+  return std::chrono::duration_cast<duration_type>(
+    std::chrono::nanoseconds(latency.value_at_percentile(p)));
+}
+
+auto
+foxy::session_histograms::snapshot_type::operator[](session_op const op) const noexcept
+  -> phase const&
+{
+  return phases[static_cast<std::size_t>(op)];
+}
+
+foxy::session_histograms::session_histograms(std::size_t shard_count)
+{
+  if (shard_count == 0) { shard_count = (std::max)(1u, std::thread::hardware_concurrency()); }
+
+  shards_.reserve(shard_count);
+  for (std::size_t idx = 0; idx < shard_count; ++idx) {
+    shards_.push_back(std::make_unique<shard>());
+  }
+}
+
+auto
+foxy::session_histograms::record(session_op const    op,
+                                 duration_type const elapsed,
+                                 std::size_t const   bytes) -> void
+{
+  auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+  auto& s    = *shards_[thread_slot() % shards_.size()];
+  auto  lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto& p = s.phases[static_cast<std::size_t>(op)];
+  p.latency.record(ns < 0 ? 0 : static_cast<std::uint64_t>(ns));
+  p.bytes += bytes;
+}
+
+auto
+foxy::session_histograms::snapshot() const -> snapshot_type
+{
+  auto snapshot = snapshot_type();
+
+  for (auto const& s : shards_) {
+    auto lock = std::lock_guard<std::mutex>(s->mtx);
+
+    for (std::size_t idx = 0; idx < session_op_count; ++idx) {
+      snapshot.phases[idx].latency.merge(s->phases[idx].latency);
+      snapshot.phases[idx].bytes += s->phases[idx].bytes;
+    }
+  }
+
+  return snapshot;
+}
+
+auto
+foxy::session_histograms::reset() -> void
+{
+  for (auto const& s : shards_) {
+    auto lock = std::lock_guard<std::mutex>(s->mtx);
+    s->phases = {};
+  }
+}
@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/sharded_proxy.hpp>
+
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/detail/socket_option.hpp>
+
+#include <algorithm>
+#include <future>
+
+namespace
+{
+#if defined(SO_REUSEPORT)
+constexpr bool const has_reuse_port = true;
+
+using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#else
+constexpr bool const has_reuse_port = false;
+#endif
+
+auto
+make_acceptor(boost::asio::io_context& io, boost::asio::ip::tcp::endpoint const& endpoint)
+  -> boost::asio::ip::tcp::acceptor
+{
+  auto acceptor = boost::asio::ip::tcp::acceptor(io);
+
+  acceptor.open(endpoint.protocol());
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+#if defined(SO_REUSEPORT)
+  acceptor.set_option(reuse_port(true));
+#endif
+  acceptor.bind(endpoint);
+  acceptor.listen();
+
+  return acceptor;
+}
+
+} // namespace
+
+foxy::sharded_proxy::sharded_proxy(endpoint_type const& endpoint,
+                                   std::size_t          num_shards,
+                                   session_opts         client_opts)
+  : endpoint_(endpoint)
+{
+  num_shards = has_reuse_port ? (std::max)(num_shards, std::size_t{1}) : 1;
+
+  shards_.reserve(num_shards);
+  for (std::size_t idx = 0; idx < num_shards; ++idx) {
+    auto s = std::make_unique<shard>();
+
+    // the first shard settles which port we're on in case the caller asked for an ephemeral one
+    //
+    auto acceptor = make_acceptor(s->io, endpoint_);
+    if (idx == 0) { endpoint_ = acceptor.local_endpoint(); }
+
+    s->proxy = std::make_shared<foxy::proxy>(std::move(acceptor), client_opts);
+    shards_.push_back(std::move(s));
+  }
+}
+
+foxy::sharded_proxy::~sharded_proxy()
+{
+  stop();
+}
+
+auto
+foxy::sharded_proxy::local_endpoint() const -> endpoint_type
+{
+  return endpoint_;
+}
+
+auto
+foxy::sharded_proxy::size() const noexcept -> std::size_t
+{
+  return shards_.size();
+}
+
+auto
+foxy::sharded_proxy::run() -> void
+{
+  for (auto& s : shards_) {
+    if (s->thread.joinable()) { continue; }
+
+    auto drained = std::promise<void>();
+    s->drained   = drained.get_future();
+
+    s->proxy->async_accept();
+    s->thread = std::thread([&io = s->io, drained = std::move(drained)]() mutable {
+      io.run();
+      drained.set_value();
+    });
+  }
+}
+
+auto
+foxy::sharded_proxy::stop(duration_type const drain_timeout) -> void
+{
+  // closing the acceptors is all it takes for a shard to run out of work once its connections are
+  // done, io_context::stop is only for the ones that outstay the deadline
+  //
+  for (auto& s : shards_) { s->proxy->cancel(); }
+
+  auto const deadline = std::chrono::steady_clock::now() + drain_timeout;
+  for (auto& s : shards_) {
+    if (!s->drained.valid()) { continue; }
+
+    if (s->drained.wait_until(deadline) != std::future_status::ready) { s->io.stop(); }
+    s->drained = {};
+  }
+
+  for (auto& s : shards_) {
+    if (s->thread.joinable()) { s->thread.join(); }
+  }
+}
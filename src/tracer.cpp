@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/tracer.hpp>
+#include <foxy/detail/json_string.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+namespace
+{
+// the trace format wants microseconds, the fractional part keeps what the steady clock measured,
+// a span that started before the tracer existed is moved up to its start
+//
+auto
+append_micros(std::string& out, std::chrono::steady_clock::duration const d) -> void
+{
+  auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    (std::max)(d, std::chrono::steady_clock::duration::zero()))
+                    .count();
+
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%lld.%03lld", static_cast<long long>(ns / 1000),
+                static_cast<long long>(ns % 1000));
+  out += buf;
+}
+} // namespace
+
+auto
+foxy::tracer::on_start(session_op, std::uint64_t) -> void
+{
+}
+
+auto
+foxy::tracer::on_end(session_op,
+                     std::uint64_t,
+                     clock_type::time_point,
+                     std::size_t,
+                     boost::system::error_code) -> void
+{
+}
+
+foxy::chrome_tracer::chrome_tracer(std::size_t const max_spans)
+  : epoch_(clock_type::now())
+  , max_spans_(max_spans)
+{
+}
+
+auto
+foxy::chrome_tracer::on_end(session_op const                op,
+                            std::uint64_t const             session,
+                            clock_type::time_point const    started,
+                            std::size_t const               bytes,
+                            boost::system::error_code const ec) -> void
+{
+  auto const ended = clock_type::now();
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  if (spans_.size() >= max_spans_) {
+    ++dropped_;
+    return;
+  }
+
+  spans_.push_back(span{op, session, started, ended, bytes, ec});
+}
+
+auto
+foxy::chrome_tracer::size() const -> std::size_t
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  return spans_.size();
+}
+
+auto
+foxy::chrome_tracer::dropped() const -> std::uint64_t
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  return dropped_;
+}
+
+auto
+foxy::chrome_tracer::write(std::ostream& os) const -> void
+{
+  auto spans = std::vector<span>();
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+    spans     = spans_;
+  }
+
+  auto out = std::string("{\"traceEvents\":[");
+
+  auto is_first = true;
+  for (auto const& span : spans) {
+    if (!is_first) { out += ','; }
+    is_first = false;
+
+    out += "\n{\"name\":\"";
+    out.append(to_string(span.op).data(), to_string(span.op).size());
+    out += "\",\"cat\":\"foxy\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+    out += std::to_string(span.session);
+    out += ",\"ts\":";
+    append_micros(out, span.started - epoch_);
+    out += ",\"dur\":";
+    append_micros(out, span.ended - span.started);
+    out += ",\"args\":{\"bytes\":";
+    out += std::to_string(span.bytes);
+    if (span.ec) {
+      out += ",\"error\":";
+      foxy::detail::append_json_string(out, span.ec.message());
+    }
+    out += "}}";
+  }
+
+  out += "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+  os << out;
+}
+
+auto
+foxy::chrome_tracer::clear() -> void
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  spans_.clear();
+  dropped_ = 0;
+}
@@ -0,0 +1,221 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/tunnel_metrics.hpp>
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+auto
+foxy::sample_tcp_info(boost::asio::ip::tcp::socket& socket) -> boost::optional<tcp_info>
+{
+#if defined(__linux__)
+  if (!socket.is_open()) { return boost::none; }
+
+  auto info = ::tcp_info();
+  auto size = static_cast<socklen_t>(sizeof(info));
+
+  if (::getsockopt(socket.native_handle(), IPPROTO_TCP, TCP_INFO, &info, &size) != 0) {
+    return boost::none;
+  }
+
+  auto sample        = tcp_info();
+  sample.rtt         = std::chrono::microseconds(info.tcpi_rtt);
+  sample.rtt_var     = std::chrono::microseconds(info.tcpi_rttvar);
+  sample.snd_cwnd    = info.tcpi_snd_cwnd;
+  sample.retransmits = info.tcpi_total_retrans;
+  sample.lost        = info.tcpi_lost;
+
+  return sample;
+#else
+  (void)socket;
+  return boost::none;
+#endif
+}
+
+auto
+foxy::tunnel_metrics::latency::add(duration_type const d) noexcept -> void
+{
+  ++count;
+  sum += d;
+  max = (std::max)(max, d);
+}
+
+auto
+foxy::tunnel_metrics::latency::merge(latency const& other) noexcept -> void
+{
+  count += other.count;
+  sum += other.sum;
+  max = (std::max)(max, other.max);
+}
+
+auto
+foxy::tunnel_metrics::latency::mean() const noexcept -> duration_type
+{
+  return count == 0 ? duration_type::zero() : sum / static_cast<duration_type::rep>(count);
+}
+
+foxy::tunnel_metrics::tunnel::tunnel(std::uint64_t const id, boost::asio::ip::tcp::endpoint client)
+  : id_(id)
+  , client_(std::move(client))
+  , opened_(clock_type::now())
+{
+}
+
+auto
+foxy::tunnel_metrics::tunnel::on_connect(boost::string_view const host,
+                                         boost::string_view const service,
+                                         duration_type const      connect,
+                                         duration_type const      handshake) -> void
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  upstream_.assign(host.data(), host.size());
+  upstream_ += ':';
+  upstream_.append(service.data(), service.size());
+
+  connect_   = connect;
+  handshake_ = handshake;
+
+  connects_.add(connect);
+  if (handshake > duration_type::zero()) { handshakes_.add(handshake); }
+}
+
+auto
+foxy::tunnel_metrics::tunnel::on_response(boost::optional<duration_type> const first_byte) -> void
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  ++requests_;
+  if (!first_byte) { return; }
+
+  first_byte_ = *first_byte;
+  first_bytes_.add(*first_byte);
+}
+
+auto
+foxy::tunnel_metrics::tunnel::on_tcp_info(boost::optional<tcp_info> client_side,
+                                          boost::optional<tcp_info> upstream_side) -> void
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  if (client_side) { client_tcp_ = client_side; }
+  if (upstream_side) { upstream_tcp_ = upstream_side; }
+}
+
+auto
+foxy::tunnel_metrics::tunnel::sample(clock_type::time_point const now) const -> tunnel_sample
+{
+  auto sample      = tunnel_sample();
+  sample.id        = id_;
+  sample.client    = client_;
+  sample.lifetime  = now - opened_;
+  sample.bytes_in  = stats.bytes_in;
+  sample.bytes_out = stats.bytes_out;
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  sample.upstream     = upstream_;
+  sample.connect      = connect_;
+  sample.handshake    = handshake_;
+  sample.first_byte   = first_byte_;
+  sample.requests     = requests_;
+  sample.client_tcp   = client_tcp_;
+  sample.upstream_tcp = upstream_tcp_;
+
+  return sample;
+}
+
+auto
+foxy::tunnel_metrics::tunnel::accumulate(totals& total) const -> void
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  total.requests += requests_;
+  total.connect.merge(connects_);
+  total.handshake.merge(handshakes_);
+  total.first_byte.merge(first_bytes_);
+}
+
+auto
+foxy::tunnel_metrics::open(boost::asio::ip::tcp::endpoint client) -> std::shared_ptr<tunnel>
+{
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  auto t = std::make_shared<tunnel>(next_id_++, std::move(client));
+  tunnels_.emplace(t->id_, t);
+  ++totals_.opened;
+
+  return t;
+}
+
+auto
+foxy::tunnel_metrics::close(tunnel& t) -> void
+{
+  auto const lifetime = clock_type::now() - t.opened_;
+
+  auto done = totals();
+  t.accumulate(done);
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  if (tunnels_.erase(t.id_) == 0) { return; }
+
+  ++totals_.closed;
+  totals_.bytes_in += t.stats.bytes_in;
+  totals_.bytes_out += t.stats.bytes_out;
+  totals_.requests += done.requests;
+  totals_.connect.merge(done.connect);
+  totals_.handshake.merge(done.handshake);
+  totals_.first_byte.merge(done.first_byte);
+  totals_.lifetime.add(lifetime);
+}
+
+auto
+foxy::tunnel_metrics::snapshot() const -> snapshot_type
+{
+  auto open_tunnels = std::vector<std::shared_ptr<tunnel>>();
+  auto snapshot     = snapshot_type();
+
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+
+    snapshot.total = totals_;
+
+    open_tunnels.reserve(tunnels_.size());
+    for (auto const& entry : tunnels_) { open_tunnels.push_back(entry.second); }
+  }
+
+  // the tunnels are sampled without holding our own lock so that a snapshot never holds up
+  // connections opening or closing for longer than it takes to copy the list, the open ones add
+  // what they've seen so far to the totals
+  //
+  auto const now = clock_type::now();
+
+  snapshot.tunnels.reserve(open_tunnels.size());
+  for (auto const& t : open_tunnels) {
+    snapshot.tunnels.push_back(t->sample(now));
+
+    snapshot.total.bytes_in += snapshot.tunnels.back().bytes_in;
+    snapshot.total.bytes_out += snapshot.tunnels.back().bytes_out;
+
+    t->accumulate(snapshot.total);
+  }
+
+  std::sort(snapshot.tunnels.begin(), snapshot.tunnels.end(),
+            [](tunnel_sample const& a, tunnel_sample const& b) { return a.id < b.id; });
+
+  return snapshot;
+}
@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/upstream_health.hpp>
+#include <foxy/error.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace
+{
+auto
+make_origin(boost::string_view host, boost::string_view service) -> std::string
+{
+  auto origin = std::string();
+  origin.reserve(host.size() + service.size() + 1);
+  origin.append(host.data(), host.size());
+  origin += ':';
+  origin.append(service.data(), service.size());
+  return origin;
+}
+
+} // namespace
+
+foxy::upstream_health::upstream_health(upstream_health_opts opts)
+  : opts_(std::move(opts))
+{
+  opts_.min_limit     = (std::max)(opts_.min_limit, std::size_t{1});
+  opts_.max_limit     = (std::max)(opts_.max_limit, opts_.min_limit);
+  opts_.initial_limit =
+    (std::min)((std::max)(opts_.initial_limit, opts_.min_limit), opts_.max_limit);
+
+  if (!(opts_.backoff > 0.0 && opts_.backoff < 1.0)) { opts_.backoff = 0.5; }
+  if (opts_.failure_threshold == 0) { opts_.failure_threshold = 1; }
+}
+
+auto
+foxy::upstream_health::try_acquire(boost::string_view         host,
+                                   boost::string_view         service,
+                                   boost::system::error_code& ec) -> permit
+{
+  auto origin = make_origin(host, service);
+  auto now    = clock_type::now();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto& o = get_origin(origin);
+
+  if (o.circuit == circuit_state::open) {
+    if (now - o.opened_at < opts_.open_duration) {
+      ec = ::foxy::error::circuit_open;
+      return {};
+    }
+
+    o.circuit = circuit_state::half_open;
+  }
+
+  // only a single probe is let through while half-open and only once the requests that tripped the
+  // circuit have drained
+  //
+  if (o.circuit == circuit_state::half_open) {
+    if (o.in_flight > 0) {
+      ec = ::foxy::error::circuit_open;
+      return {};
+    }
+
+    ++o.in_flight;
+    ec = {};
+    return {std::move(origin), now, true};
+  }
+
+  if (o.in_flight >= static_cast<std::size_t>(o.limit)) {
+    ec = ::foxy::error::concurrency_limit;
+    return {};
+  }
+
+  ++o.in_flight;
+  ec = {};
+  return {std::move(origin), now, false};
+}
+
+auto
+foxy::upstream_health::release(permit const& p, boost::system::error_code ec) -> void
+{
+  auto const now = clock_type::now();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto pos = origins_.find(p.origin);
+  if (pos == origins_.end()) { return; }
+
+  auto& o = pos->second;
+  if (o.in_flight > 0) { --o.in_flight; }
+
+  auto const is_failure  = static_cast<bool>(ec);
+  auto const is_overload = is_failure || now - p.start > opts_.latency_threshold;
+
+  // only requests made after the last backoff are allowed to trigger another one, otherwise a
+  // single burst of failures would drive the limit straight to its floor
+  //
+  if (is_overload) {
+    if (p.start >= o.backed_off_at) {
+      o.limit         = (std::max)(o.limit * opts_.backoff, static_cast<double>(opts_.min_limit));
+      o.backed_off_at = now;
+    }
+  } else {
+    o.limit = (std::min)(o.limit + 1.0 / o.limit, static_cast<double>(opts_.max_limit));
+  }
+
+  if (!is_failure) {
+    o.failures = 0;
+    if (p.is_probe) { o.circuit = circuit_state::closed; }
+    return;
+  }
+
+  ++o.failures;
+  if (p.is_probe || o.failures >= opts_.failure_threshold) {
+    o.circuit   = circuit_state::open;
+    o.opened_at = now;
+  }
+}
+
+auto
+foxy::upstream_health::limit(boost::string_view host, boost::string_view service) const
+  -> std::size_t
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto const* o = find_origin(host, service);
+  return o ? static_cast<std::size_t>(o->limit) : opts_.initial_limit;
+}
+
+auto
+foxy::upstream_health::state(boost::string_view host, boost::string_view service) const
+  -> circuit_state
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto const* o = find_origin(host, service);
+  if (!o) { return circuit_state::closed; }
+
+  if (o->circuit == circuit_state::open &&
+      clock_type::now() - o->opened_at >= opts_.open_duration) {
+    return circuit_state::half_open;
+  }
+
+  return o->circuit;
+}
+
+auto
+foxy::upstream_health::get_origin(std::string const& origin) -> origin_state&
+{
+  auto pos = origins_.find(origin);
+  if (pos == origins_.end()) {
+    auto o  = origin_state();
+    o.limit = static_cast<double>(opts_.initial_limit);
+
+    pos = origins_.emplace(origin, o).first;
+  }
+  return pos->second;
+}
+
+auto
+foxy::upstream_health::find_origin(boost::string_view host, boost::string_view service) const
+  -> origin_state const*
+{
+  auto pos = origins_.find(make_origin(host, service));
+  return pos == origins_.end() ? nullptr : std::addressof(pos->second);
+}
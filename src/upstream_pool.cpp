@@ -0,0 +1,215 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/upstream_pool.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+auto
+make_origin(boost::string_view host, boost::string_view service) -> std::string
+{
+  auto origin = std::string();
+  origin.reserve(host.size() + service.size() + 1);
+  origin.append(host.data(), host.size());
+  origin += ':';
+  origin.append(service.data(), service.size());
+  return origin;
+}
+
+// is_open checks that the origin hasn't closed the connection while it sat in the pool
+//
+// An idle HTTP connection should have nothing to read, so a peek that would block means the
+// connection is still good while EOF, an error or unsolicited bytes all mean it isn't
+//
+// The peek only sees the TCP layer, which under TLS can hold records the origin sends on its own,
+// e.g. session tickets or a close_notify ahead of its FIN. Bytes don't condemn a TLS connection, so
+// one the origin has closed with a close_notify can get past us, the proxy's retry of the request
+// catches those
+//
+auto
+is_open(foxy::client_session& session) -> bool
+{
+  auto& socket = session.stream.plain();
+  if (!socket.is_open()) { return false; }
+
+  auto ec = boost::system::error_code();
+
+  auto const was_non_blocking = socket.non_blocking();
+  socket.non_blocking(true, ec);
+  if (ec) { return false; }
+
+  char byte = 0;
+  socket.receive(boost::asio::buffer(&byte, 1), socket.message_peek, ec);
+
+  auto ignored = boost::system::error_code();
+  socket.non_blocking(was_non_blocking, ignored);
+
+  if (session.stream.is_ssl() && !ec) { return true; }
+  return ec == boost::asio::error::would_block;
+}
+
+} // namespace
+
+foxy::detail::upstream_pool::upstream_pool(boost::asio::any_io_executor executor,
+                                           std::size_t                  max_idle_per_origin,
+                                           duration_type                idle_timeout)
+  : max_idle_(max_idle_per_origin)
+  , idle_timeout_(idle_timeout)
+  , timer_(executor)
+{
+}
+
+auto
+foxy::detail::upstream_pool::take(boost::string_view host, boost::string_view service)
+  -> std::unique_ptr<::foxy::client_session>
+{
+  auto const now = clock_type::now();
+
+  // connections we pass over are destroyed once we've let go of the lock
+  //
+  auto stale = std::vector<idle_session>();
+
+  std::unique_lock<std::mutex> lock{mtx_};
+
+  auto pos = idle_.find(make_origin(host, service));
+  if (pos == idle_.end()) { return nullptr; }
+
+  // the most recently used connection is the one most likely to still be open
+  //
+  auto& sessions = pos->second;
+  while (!sessions.empty()) {
+    auto idle = std::move(sessions.back());
+    sessions.pop_back();
+
+    if (now - idle.idle_since < idle_timeout_ && is_open(*idle.session)) {
+      if (sessions.empty()) { idle_.erase(pos); }
+      lock.unlock();
+      return std::move(idle.session);
+    }
+
+    stale.push_back(std::move(idle));
+  }
+
+  idle_.erase(pos);
+  lock.unlock();
+
+  return nullptr;
+}
+
+auto
+foxy::detail::upstream_pool::put(boost::string_view                      host,
+                                 boost::string_view                      service,
+                                 std::unique_ptr<::foxy::client_session> session) -> void
+{
+  if (!session || max_idle_ == 0) { return; }
+
+  // a connection we evict is destroyed once we've let go of the lock
+  //
+  auto evicted = std::unique_ptr<::foxy::client_session>();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  if (is_closed_) {
+    evicted = std::move(session);
+    return;
+  }
+
+  auto& sessions = idle_[make_origin(host, service)];
+  if (sessions.size() >= max_idle_) {
+    // the oldest connection makes way for the newest
+    //
+    evicted = std::move(sessions.front().session);
+    sessions.erase(sessions.begin());
+  }
+
+  auto const now = clock_type::now();
+  sessions.push_back({std::move(session), now});
+
+  if (!is_sweep_scheduled_) { schedule_sweep(now + idle_timeout_); }
+}
+
+auto
+foxy::detail::upstream_pool::close() -> void
+{
+  auto closed = decltype(idle_)();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  is_closed_ = true;
+  closed.swap(idle_);
+  timer_.cancel();
+}
+
+auto
+foxy::detail::upstream_pool::schedule_sweep(clock_type::time_point const at) -> void
+{
+  is_sweep_scheduled_ = true;
+
+  timer_.expires_at(at);
+  timer_.async_wait(
+    [weak = std::weak_ptr<upstream_pool>(shared_from_this())](boost::system::error_code ec) {
+      if (auto self = weak.lock()) { self->sweep(ec); }
+    });
+}
+
+auto
+foxy::detail::upstream_pool::sweep(boost::system::error_code ec) -> void
+{
+  auto const now = clock_type::now();
+
+  auto stale = std::vector<idle_session>();
+
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  is_sweep_scheduled_ = false;
+  if (ec || is_closed_) { return; }
+
+  // connections are appended as they go idle so the first one of an origin is its oldest
+  //
+  auto next = (clock_type::time_point::max)();
+  for (auto pos = idle_.begin(); pos != idle_.end();) {
+    auto& sessions = pos->second;
+
+    auto kept = std::vector<idle_session>();
+    for (auto& idle : sessions) {
+      if (now - idle.idle_since < idle_timeout_ && is_open(*idle.session)) {
+        kept.push_back(std::move(idle));
+      } else {
+        stale.push_back(std::move(idle));
+      }
+    }
+    sessions.swap(kept);
+
+    if (sessions.empty()) {
+      pos = idle_.erase(pos);
+      continue;
+    }
+
+    next = (std::min)(next, sessions.front().idle_since + idle_timeout_);
+    ++pos;
+  }
+
+  if (!idle_.empty()) { schedule_sweep(next); }
+}
+
+auto
+foxy::detail::upstream_pool::size() const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock{mtx_};
+
+  auto total = std::size_t{0};
+  for (auto const& origin : idle_) { total += origin.second.size(); }
+  return total;
+}
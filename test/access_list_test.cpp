@@ -0,0 +1,303 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/access_list.hpp>
+#include <foxy/error.hpp>
+#include <foxy/proxy.hpp>
+#include <foxy/client_session.hpp>
+#include <foxy/session_histograms.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <boost/system/system_error.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto const allow = foxy::access_action::allow;
+auto const deny  = foxy::access_action::deny;
+
+} // namespace
+
+TEST_CASE("access_list_test")
+{
+  SECTION("should match domains by their most specific suffix")
+  {
+    auto const list = foxy::access_list({{"example.com"},
+                                         {"API.example.com", allow},
+                                         {".internal.api.example.com."},
+                                         {"ads.net"}});
+
+    CHECK(list.check("example.com") == deny);
+    CHECK(list.check("www.example.com") == deny);
+    CHECK(list.check("WWW.Example.COM.") == deny);
+    CHECK(list.check("api.example.com") == allow);
+    CHECK(list.check("v1.api.example.com") == allow);
+    CHECK(list.check("internal.api.example.com") == deny);
+    CHECK(list.check("x.internal.api.example.com") == deny);
+    CHECK(list.check("tracker.ads.net") == deny);
+
+    // a suffix has to end on a label boundary
+    //
+    CHECK(list.check("badexample.com") == allow);
+    CHECK(list.check("com") == allow);
+    CHECK(list.check("example.org") == allow);
+    CHECK(!list.match("notads.net").has_value());
+    CHECK(!list.match("").has_value());
+
+    auto const closed = foxy::access_list({{"example.com", allow}}, deny);
+    CHECK(closed.default_action() == deny);
+    CHECK(closed.check("www.example.com") == allow);
+    CHECK(closed.check("example.org") == deny);
+
+    CHECK(foxy::access_list().check("anything.at.all") == allow);
+  }
+
+  SECTION("should match addresses by their longest prefix")
+  {
+    auto const list = foxy::access_list({{"10.0.0.0/8"},
+                                         {"10.1.0.0/16", allow},
+                                         {"10.1.2.3"},
+                                         {"192.168.1.0/24"},
+                                         {"fe80::/10"},
+                                         {"2001:db8::/32", allow},
+                                         {"::/0"}});
+
+    CHECK(list.check("10.200.0.1") == deny);
+    CHECK(list.check("10.1.200.1") == allow);
+    CHECK(list.check("10.1.2.3") == deny);
+    CHECK(list.check("10.1.2.4") == allow);
+    CHECK(list.check("192.168.1.77") == deny);
+
+    CHECK(list.check("fe80::1") == deny);
+    CHECK(list.check("[febf::1]") == deny);
+    CHECK(list.check("2001:db8::1") == allow);
+
+    // IPv4 addresses are IPv4-mapped IPv6 ones, which "::/0" covers too
+    //
+    CHECK(list.check("2001:db9::1") == deny);
+    CHECK(list.check("8.8.8.8") == deny);
+    CHECK(list.check("::ffff:10.1.0.1") == allow);
+
+    CHECK(*list.match(asio::ip::make_address("10.1.2.3")) == deny);
+    CHECK(*list.match(asio::ip::make_address("10.1.9.9")) == allow);
+
+    auto const v4 = foxy::access_list({{"127.0.0.0/8"}, {"0.0.0.0/0", allow}});
+    CHECK(v4.check("127.0.0.1") == deny);
+    CHECK(v4.check("128.0.0.1") == allow);
+    CHECK(v4.check("192.168.2.77") == allow);
+    CHECK(!v4.match("::1").has_value());
+
+    // a later rule for the same pattern replaces the earlier one
+    //
+    auto const replaced = foxy::access_list({{"10.0.0.0/8"}, {"10.0.0.0/8", allow}});
+    CHECK(*replaced.match("10.0.0.1") == allow);
+  }
+
+  SECTION("should reject malformed rules")
+  {
+    auto const is_bad = [](std::string pattern) {
+      try {
+        foxy::access_list({{std::move(pattern)}});
+      }
+      catch (boost::system::system_error const& e) {
+        return e.code() == foxy::error::bad_access_rule;
+      }
+      return false;
+    };
+
+    CHECK(is_bad(""));
+    CHECK(is_bad("."));
+    CHECK(is_bad("a..b"));
+    CHECK(is_bad("exa mple.com"));
+    CHECK(is_bad("10.0.0.0/"));
+    CHECK(is_bad("10.0.0.0/33"));
+    CHECK(is_bad("10.0.0.0/x"));
+    CHECK(is_bad("::/129"));
+    CHECK(is_bad(std::string(300, 'a')));
+
+    CHECK(!is_bad("localhost"));
+    CHECK(!is_bad("10.0.0.0/32"));
+  }
+
+  SECTION("should swap in a reloaded list while the old one stays usable")
+  {
+    auto policy = foxy::access_policy(foxy::access_list({{"example.com"}}));
+
+    auto const before = policy.get();
+    CHECK(before->check("example.com") == deny);
+
+    policy.reload(foxy::access_list({{"example.org"}}));
+
+    CHECK(policy.get()->check("example.com") == allow);
+    CHECK(policy.get()->check("example.org") == deny);
+    CHECK(before->check("example.com") == deny);
+  }
+
+  SECTION("should refuse to connect to denied addresses")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto connect_ec = boost::system::error_code();
+    auto histograms = std::make_shared<foxy::session_histograms>();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client        = foxy::client_session(io.get_executor(), {});
+      client.opts.access = std::make_shared<foxy::access_policy>(
+        foxy::access_list({{"127.0.0.0/8"}, {"::1"}}));
+      client.opts.histograms = histograms;
+
+      client.async_connect("localhost", std::to_string(port), yield[connect_ec]);
+    });
+
+    io.run();
+
+    CHECK(connect_ec == foxy::error::access_denied);
+
+    // the refused connect is still timed, same as one that fails on the wire
+    //
+    CHECK(histograms->snapshot()[foxy::session_op::connect].count() == 1);
+  }
+
+  SECTION("should answer requests for denied hosts without contacting them")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts   = foxy::session_opts();
+    auto policy = std::make_shared<foxy::access_policy>(foxy::access_list({{"LocalHost"}}));
+
+    opts.timeout = 5s;
+    opts.access  = policy;
+
+    auto proxy = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+    proxy->async_accept();
+
+    auto num_accepted = 0;
+    auto statuses     = std::vector<http::status>();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto ec     = boost::system::error_code();
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield[ec]);
+      if (ec) { return; }
+
+      ++num_accepted;
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::empty_body>();
+      http::async_read(origin, buffer, request, yield[ec]);
+      if (ec) { return; }
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "hello");
+      response.keep_alive(false);
+      response.prepare_payload();
+
+      http::async_write(origin, response, yield[ec]);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 5s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto const authority = "localhost:" + std::to_string(port);
+
+      // denied by name, the connection stays usable afterwards
+      //
+      {
+        auto request = http::request<http::empty_body>(http::verb::connect, authority, 11);
+        request.set(http::field::host, authority);
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        statuses.push_back(response.result());
+      }
+
+      {
+        auto const request =
+          http::request<http::empty_body>(http::verb::get, "http://" + authority + "/", 11);
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        statuses.push_back(response.result());
+      }
+
+      // the name is allowed now but every address it resolves to is denied
+      //
+      policy->reload(foxy::access_list({{"127.0.0.0/8"}, {"::1"}}));
+
+      {
+        auto const request =
+          http::request<http::empty_body>(http::verb::get, "http://" + authority + "/", 11);
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        statuses.push_back(response.result());
+      }
+
+      policy->reload(foxy::access_list());
+
+      {
+        auto const request = http::request<http::empty_body>(
+          http::verb::get, "http://127.0.0.1:" + std::to_string(port) + "/", 11);
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        statuses.push_back(response.result());
+      }
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      acceptor.cancel();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    REQUIRE(statuses.size() == 4);
+    CHECK(statuses[0] == http::status::forbidden);
+    CHECK(statuses[1] == http::status::forbidden);
+    CHECK(statuses[2] == http::status::forbidden);
+    CHECK(statuses[3] == http::status::ok);
+
+    CHECK(num_accepted == 1);
+  }
+}
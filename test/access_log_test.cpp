@@ -0,0 +1,284 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/access_log.hpp>
+#include <foxy/proxy.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+read_file(std::string const& path) -> std::string
+{
+  auto file = std::ifstream(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+auto
+read_lines(std::string const& path) -> std::vector<std::string>
+{
+  auto lines = std::vector<std::string>();
+
+  auto file = std::ifstream(path);
+  for (auto line = std::string(); std::getline(file, line);) { lines.push_back(line); }
+  return lines;
+}
+
+auto
+make_record(boost::string_view target, unsigned status) -> foxy::access_record
+{
+  auto entry = foxy::access_record();
+
+  entry.timestamp = 1000;
+  entry.duration  = 250;
+  entry.bytes_in  = 3;
+  entry.bytes_out = 5;
+  entry.status    = static_cast<std::uint16_t>(status);
+  entry.method    = static_cast<std::uint8_t>(http::verb::get);
+  entry.set_target(target);
+  entry.set_client(tcp::endpoint(asio::ip::make_address("127.0.0.1"), 4242));
+
+  return entry;
+}
+
+} // namespace
+
+TEST_CASE("access_log_test")
+{
+  SECTION("should write one JSON object per record")
+  {
+    auto const path = std::string("foxy_access_log_text.log");
+    std::remove(path.c_str());
+
+    {
+      auto log = foxy::access_log(path);
+
+      CHECK(log.record(make_record("http://example.com/\"quoted\"\n", 200)));
+
+      // every thread records into a ring of its own
+      //
+      auto t = std::thread([&] { CHECK(log.record(make_record("/other", 404))); });
+      t.join();
+
+      log.flush();
+      CHECK(log.num_written() == 2);
+      CHECK(log.num_dropped() == 0);
+    }
+
+    auto const lines = read_lines(path);
+    REQUIRE(lines.size() == 2);
+
+    CHECK(lines[0] ==
+          R"({"timestamp":1000,"client":"127.0.0.1:4242","kind":"request","method":"GET",)"
+          R"("target":"http://example.com/\"quoted\"\u000a","status":200,"bytes_in":3,)"
+          R"("bytes_out":5,"duration":250})");
+
+    CHECK(lines[1].find(R"("target":"/other","status":404)") != std::string::npos);
+
+    std::remove(path.c_str());
+  }
+
+  SECTION("should write binary records as they are")
+  {
+    auto const path = std::string("foxy_access_log_binary.log");
+    std::remove(path.c_str());
+
+    auto long_target = std::string(300, 'x');
+
+    {
+      auto log = foxy::access_log(path, foxy::access_log_format::binary, 4);
+
+      // enough records to wrap around the ring a few times
+      //
+      for (auto i = 0; i < 10; ++i) {
+        CHECK(log.record(make_record(i == 0 ? long_target : std::to_string(i), 200 + i)));
+        log.flush();
+      }
+    }
+
+    auto const data = read_file(path);
+    REQUIRE(data.size() == 10 * sizeof(foxy::access_record));
+
+    auto records = std::vector<foxy::access_record>(10);
+    std::memcpy(records.data(), data.data(), data.size());
+
+    CHECK(records[0].get_target().size() == records[0].target.size());
+    CHECK(records[0].get_client().port() == 4242);
+    CHECK(records[0].get_client().address().to_v6().is_v4_mapped());
+
+    for (auto i = 1; i < 10; ++i) {
+      CHECK(records[i].get_target() == std::to_string(i));
+      CHECK(records[i].status == 200 + i);
+    }
+
+    std::remove(path.c_str());
+  }
+
+  SECTION("should drop records instead of waiting when a ring is full")
+  {
+    auto const path = std::string("foxy_access_log_dropped.log");
+    std::remove(path.c_str());
+
+    {
+      auto log = foxy::access_log(path, foxy::access_log_format::binary, 2, std::chrono::hours(1));
+
+      CHECK(log.record(make_record("/", 200)));
+      CHECK(log.record(make_record("/", 200)));
+      CHECK(!log.record(make_record("/", 200)));
+      CHECK(log.num_dropped() == 1);
+
+      log.flush();
+      CHECK(log.num_written() == 2);
+
+      CHECK(log.record(make_record("/", 200)));
+    }
+
+    // whatever is left is written when the log is destroyed
+    //
+    CHECK(read_file(path).size() == 3 * sizeof(foxy::access_record));
+
+    std::remove(path.c_str());
+  }
+
+  SECTION("should log the proxy's requests and tunnels")
+  {
+    auto const path = std::string("foxy_access_log_proxy.log");
+    std::remove(path.c_str());
+
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts       = foxy::session_opts();
+    opts.timeout    = 5s;
+    opts.raw_tunnel = true;
+    opts.access_log = std::make_shared<foxy::access_log>(path);
+
+    auto proxy = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+    proxy->async_accept();
+
+    // the origin answers a single request and then echoes whatever comes through the tunnel
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto ec     = boost::system::error_code();
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::string_body>();
+      http::async_read(origin, buffer, request, yield);
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "hello");
+      response.keep_alive(false);
+      response.prepare_payload();
+      http::async_write(origin, response, yield[ec]);
+      origin.shutdown(tcp::socket::shutdown_both, ec);
+      origin.close(ec);
+
+      acceptor.async_accept(origin, yield);
+
+      auto buf = std::array<char, 64>();
+      while (true) {
+        auto const n = origin.async_read_some(asio::buffer(buf), yield[ec]);
+        if (ec) { break; }
+        asio::async_write(origin, asio::buffer(buf.data(), n), yield[ec]);
+        if (ec) { break; }
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const authority = "127.0.0.1:" + std::to_string(port);
+
+      {
+        auto client         = foxy::client_session(io.get_executor(), {});
+        client.opts.timeout = 5s;
+        client.async_connect("127.0.0.1", "1337", yield);
+
+        auto request =
+          http::request<http::string_body>(http::verb::post, "http://" + authority + "/a", 11);
+        request.body() = "abc";
+        request.prepare_payload();
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+        CHECK(response.body() == "hello");
+      }
+
+      auto socket = tcp::socket(io);
+      socket.async_connect(tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), yield);
+
+      auto const request = "CONNECT " + authority + " HTTP/1.1\r\nHost: " + authority + "\r\n\r\n";
+      asio::async_write(socket, asio::buffer(request), yield);
+
+      auto buffer = boost::beast::flat_buffer();
+      auto parser = http::response_parser<http::empty_body>();
+      parser.skip(true);
+      http::async_read_header(socket, buffer, parser, yield);
+      REQUIRE(parser.get().result() == http::status::ok);
+
+      auto buf = std::array<char, 4>();
+      asio::async_write(socket, asio::buffer("ping", 4), yield);
+      asio::async_read(socket, asio::buffer(buf), yield);
+
+      auto ec = boost::system::error_code();
+      socket.shutdown(tcp::socket::shutdown_both, ec);
+      socket.close(ec);
+
+      acceptor.close(ec);
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    opts.access_log->flush();
+
+    auto const lines = read_lines(path);
+    REQUIRE(lines.size() == 2);
+
+    CHECK(lines[0].find(R"("client":"127.0.0.1:)") != std::string::npos);
+    CHECK(lines[0].find(R"("kind":"request","method":"POST")") != std::string::npos);
+    CHECK(lines[0].find(R"("status":200,"bytes_in":3,"bytes_out":5)") != std::string::npos);
+
+    CHECK(lines[1].find(R"("kind":"tunnel","method":"CONNECT")") != std::string::npos);
+    CHECK(lines[1].find(R"("status":200,"bytes_in":4,"bytes_out":4)") != std::string::npos);
+
+    std::remove(path.c_str());
+  }
+}
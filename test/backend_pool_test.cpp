@@ -0,0 +1,458 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/backend_pool.hpp>
+#include <foxy/proxy.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("backend_pool_test")
+{
+  auto const three = std::vector<foxy::backend>{{"a", "80"}, {"b", "80"}, {"c", "80"}};
+
+  SECTION("should take turns and prefer the least loaded backend")
+  {
+    auto round_robin = foxy::backend_pool(three, foxy::balance_policy::round_robin);
+
+    auto picked = std::vector<std::string>();
+    for (auto i = 0; i < 4; ++i) { picked.push_back(round_robin.acquire().get().host); }
+
+    CHECK(picked == std::vector<std::string>{"a", "b", "c", "a"});
+    CHECK(round_robin.outstanding(0) == 0);
+
+    auto least = foxy::backend_pool(three, foxy::balance_policy::least_outstanding);
+
+    auto first  = least.acquire();
+    auto second = least.acquire();
+    CHECK(first.index() != second.index());
+    CHECK(least.outstanding(first.index()) == 1);
+
+    // the only idle backend wins no matter whose turn it is
+    //
+    auto third = least.acquire();
+    CHECK(third.index() != first.index());
+    CHECK(third.index() != second.index());
+
+    second.reset();
+    CHECK(least.outstanding(second.index()) == 0);
+
+    auto fourth = least.acquire();
+    CHECK(fourth.index() == second.index());
+
+    auto moved = std::move(fourth);
+    CHECK(!fourth);
+    CHECK(least.outstanding(moved.index()) == 1);
+  }
+
+  SECTION("should map keys consistently and move few of them when a backend is added")
+  {
+    auto four = three;
+    four.push_back({"d", "80"});
+
+    auto small = foxy::backend_pool(three, foxy::balance_policy::consistent_hash);
+    auto large = foxy::backend_pool(four, foxy::balance_policy::consistent_hash);
+
+    auto counts = std::array<int, 3>{};
+    auto moved  = 0;
+
+    for (auto i = 0; i < 3000; ++i) {
+      auto const key = "/images/" + std::to_string(i) + ".png";
+
+      auto const before = small.acquire(key).index();
+      CHECK(small.acquire(key).index() == before);
+
+      ++counts[before];
+
+      // a key that failed on its backend fails over to the same one every time
+      //
+      auto const skip     = std::vector<std::size_t>{before};
+      auto const failover = small.acquire(key, skip).index();
+      CHECK(failover != before);
+      CHECK(small.acquire(key, skip).index() == failover);
+
+      // a key only ever moves to the backend that was added
+      //
+      auto const after = large.acquire(key).index();
+      if (after != before) {
+        CHECK(after == 3);
+        ++moved;
+      }
+    }
+
+    for (auto const count : counts) { CHECK(count > 600); }
+    CHECK(moved > 300);
+    CHECK(moved < 1200);
+  }
+
+  SECTION("should eject failing backends for longer each time and readmit them")
+  {
+    auto health          = foxy::backend_health_opts();
+    health.max_failures  = 2;
+    health.base_ejection = 100ms;
+    health.max_ejection  = 10s;
+
+    auto pool = foxy::backend_pool(three, foxy::balance_policy::round_robin, health);
+
+    auto const fail_first = [&] {
+      for (auto i = 0; i < 3; ++i) {
+        auto lease = pool.acquire();
+        if (lease.index() == 0) { lease.complete(boost::asio::error::connection_refused); }
+      }
+    };
+
+    fail_first();
+    CHECK(!pool.is_ejected(0));
+    fail_first();
+    CHECK(pool.is_ejected(0));
+
+    // an ejected backend is skipped over
+    //
+    for (auto i = 0; i < 4; ++i) { CHECK(pool.acquire().index() != 0); }
+
+    // a successful probe readmits it early but the next ejection lasts twice as long
+    //
+    pool.report_probe(0, {});
+    CHECK(!pool.is_ejected(0));
+
+    pool.report_probe(0, boost::asio::error::timed_out);
+    pool.report_probe(0, boost::asio::error::timed_out);
+    CHECK(pool.is_ejected(0));
+
+    std::this_thread::sleep_for(150ms);
+    CHECK(pool.is_ejected(0));
+
+    std::this_thread::sleep_for(100ms);
+    CHECK(!pool.is_ejected(0));
+
+    // once everything is ejected, everything is fair game again
+    //
+    for (auto idx = std::size_t{0}; idx < pool.size(); ++idx) {
+      pool.report_probe(idx, boost::asio::error::timed_out);
+      pool.report_probe(idx, boost::asio::error::timed_out);
+      CHECK(pool.is_ejected(idx));
+    }
+    CHECK(static_cast<bool>(pool.acquire()));
+
+    auto slow              = foxy::backend_health_opts();
+    slow.max_failures      = 1;
+    slow.latency_threshold = 1ns;
+
+    auto slow_pool = foxy::backend_pool(three, foxy::balance_policy::round_robin, slow);
+    {
+      auto lease = slow_pool.acquire();
+      std::this_thread::sleep_for(1ms);
+      lease.complete({});
+    }
+    CHECK(slow_pool.is_ejected(0));
+
+    // a lease that's only reset says nothing about the backend
+    //
+    slow_pool.acquire().reset();
+    CHECK(!slow_pool.is_ejected(1));
+  }
+
+  SECTION("should route origin-form requests to its backends over pooled connections")
+  {
+    asio::io_context io{1};
+
+    auto acceptors = std::array<tcp::acceptor, 2>{
+      tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0)),
+      tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0))};
+
+    auto backends = std::vector<foxy::backend>();
+    for (auto& acceptor : acceptors) {
+      backends.push_back({"127.0.0.1", std::to_string(acceptor.local_endpoint().port())});
+    }
+
+    auto opts     = foxy::session_opts();
+    opts.timeout  = 5s;
+    opts.backends = std::make_shared<foxy::backend_pool>(backends);
+
+    auto proxy = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+
+    proxy->async_accept();
+
+    auto num_accepted = 0;
+    auto bodies       = std::vector<std::string>();
+
+    // each backend answers with its name, the target and what the proxy told it about the request
+    //
+    for (auto idx = 0; idx < 2; ++idx) {
+      asio::spawn(io, [&, idx](asio::yield_context yield) {
+        while (true) {
+          auto ec     = boost::system::error_code();
+          auto origin = std::make_shared<tcp::socket>(io);
+          acceptors[idx].async_accept(*origin, yield[ec]);
+          if (ec) { break; }
+
+          ++num_accepted;
+
+          asio::spawn(yield, [origin, idx](asio::yield_context yield) {
+            auto ec     = boost::system::error_code();
+            auto buffer = boost::beast::flat_buffer();
+            while (true) {
+              auto request = http::request<http::empty_body>();
+              http::async_read(*origin, buffer, request, yield[ec]);
+              if (ec) { return; }
+
+              auto body = std::to_string(idx) + " " + static_cast<std::string>(request.target()) +
+                          " " + static_cast<std::string>(request[http::field::host]) + " " +
+                          static_cast<std::string>(request["X-Forwarded-For"]);
+
+              auto response = http::response<http::string_body>(http::status::ok, 11, body);
+              response.prepare_payload();
+              http::async_write(*origin, response, yield[ec]);
+              if (ec) { return; }
+            }
+          });
+        }
+      });
+    }
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 5s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      for (auto i = 0; i < 4; ++i) {
+        auto request = http::request<http::empty_body>(
+          http::verb::get, "/page?n=" + std::to_string(i), 11);
+        request.set(http::field::host, "www.example.com");
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        bodies.push_back(response.body());
+      }
+
+      // a CONNECT is never turned into a tunnel by a reverse proxy
+      //
+      auto request =
+        http::request<http::empty_body>(http::verb::connect, "www.google.com:443", 11);
+      auto response = http::response<http::string_body>();
+      client.async_request(request, response, yield);
+
+      CHECK(response.result() == http::status::bad_request);
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      for (auto& acceptor : acceptors) { acceptor.cancel(); }
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(num_accepted == 2);
+    CHECK(opts.backends->outstanding(0) == 0);
+    CHECK(opts.backends->outstanding(1) == 0);
+
+    REQUIRE(bodies.size() == 4);
+    CHECK(bodies[0] == "0 /page?n=0 www.example.com 127.0.0.1");
+    CHECK(bodies[1] == "1 /page?n=1 www.example.com 127.0.0.1");
+    CHECK(bodies[2] == "0 /page?n=2 www.example.com 127.0.0.1");
+    CHECK(bodies[3] == "1 /page?n=3 www.example.com 127.0.0.1");
+  }
+
+  SECTION("should move on to the next backend when it can't connect")
+  {
+    asio::io_context io{1};
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+
+    // nothing listens on the first backend's port anymore
+    //
+    auto dead = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+
+    auto backends = std::vector<foxy::backend>{
+      {"127.0.0.1", std::to_string(dead.local_endpoint().port())},
+      {"127.0.0.1", std::to_string(acceptor.local_endpoint().port())}};
+
+    dead.close();
+
+    auto opts     = foxy::session_opts();
+    opts.timeout  = 5s;
+    opts.backends = std::make_shared<foxy::backend_pool>(backends);
+
+    auto proxy = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+
+    proxy->async_accept();
+
+    auto num_ok = 0;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      while (true) {
+        auto ec     = boost::system::error_code();
+        auto origin = std::make_shared<tcp::socket>(io);
+        acceptor.async_accept(*origin, yield[ec]);
+        if (ec) { break; }
+
+        asio::spawn(yield, [origin](asio::yield_context yield) {
+          auto ec     = boost::system::error_code();
+          auto buffer = boost::beast::flat_buffer();
+          while (true) {
+            auto request = http::request<http::empty_body>();
+            http::async_read(*origin, buffer, request, yield[ec]);
+            if (ec) { return; }
+
+            auto response = http::response<http::string_body>(http::status::ok, 11, "alive");
+            response.prepare_payload();
+            http::async_write(*origin, response, yield[ec]);
+            if (ec) { return; }
+          }
+        });
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 5s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      for (auto i = 0; i < 4; ++i) {
+        auto request  = http::request<http::empty_body>(http::verb::get, "/", 11);
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        if (response.result() == http::status::ok && response.body() == "alive") { ++num_ok; }
+      }
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      acceptor.cancel();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    // the third failure in a row ejects the dead backend
+    //
+    CHECK(num_ok == 4);
+    CHECK(opts.backends->is_ejected(0));
+    CHECK(!opts.backends->is_ejected(1));
+  }
+
+  SECTION("should fail a consistently hashed request over to the next backend on the ring")
+  {
+    asio::io_context io{1};
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto dead     = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+
+    auto backends = std::vector<foxy::backend>{
+      {"127.0.0.1", std::to_string(dead.local_endpoint().port())},
+      {"127.0.0.1", std::to_string(acceptor.local_endpoint().port())}};
+
+    dead.close();
+
+    // the dead backend is never ejected so every key that hashes to it has to fail over
+    //
+    auto health         = foxy::backend_health_opts();
+    health.max_failures = 1000;
+
+    auto opts     = foxy::session_opts();
+    opts.timeout  = 5s;
+    opts.backends = std::make_shared<foxy::backend_pool>(
+      backends, foxy::balance_policy::consistent_hash, health);
+
+    auto proxy = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+
+    proxy->async_accept();
+
+    auto const num_requests = 16;
+
+    auto num_dead = 0;
+    auto num_ok   = 0;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      while (true) {
+        auto ec     = boost::system::error_code();
+        auto origin = std::make_shared<tcp::socket>(io);
+        acceptor.async_accept(*origin, yield[ec]);
+        if (ec) { break; }
+
+        asio::spawn(yield, [origin](asio::yield_context yield) {
+          auto ec     = boost::system::error_code();
+          auto buffer = boost::beast::flat_buffer();
+          while (true) {
+            auto request = http::request<http::empty_body>();
+            http::async_read(*origin, buffer, request, yield[ec]);
+            if (ec) { return; }
+
+            auto response = http::response<http::string_body>(http::status::ok, 11, "alive");
+            response.prepare_payload();
+            http::async_write(*origin, response, yield[ec]);
+            if (ec) { return; }
+          }
+        });
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 5s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      for (auto i = 0; i < num_requests; ++i) {
+        auto const target = "/" + std::to_string(i);
+        if (opts.backends->acquire(target).index() == 0) { ++num_dead; }
+
+        auto request  = http::request<http::empty_body>(http::verb::get, target, 11);
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        if (response.result() == http::status::ok && response.body() == "alive") { ++num_ok; }
+      }
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      acceptor.cancel();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(num_dead > 0);
+    CHECK(num_ok == num_requests);
+    CHECK(!opts.backends->is_ejected(0));
+  }
+}
@@ -0,0 +1,269 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/client_session.hpp>
+#include <foxy/listener.hpp>
+#include <foxy/session_histograms.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/coroutine.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <boost/optional/optional.hpp>
+
+#include <array>
+#include <memory>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using boost::asio::ip::tcp;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+#include <boost/asio/yield.hpp>
+// upload_handler echoes back the request body if the target is "/accept" and otherwise rejects the
+// upload before reading any of it
+//
+struct upload_handler : asio::coroutine
+{
+  struct frame
+  {
+    http::request_parser<http::empty_body>                   header_parser;
+    boost::optional<http::request_parser<http::string_body>> body_parser;
+    http::response<http::empty_body>                         interim{http::status::continue_, 11};
+    http::response<http::string_body>                        response;
+  };
+
+  foxy::server_session&  server;
+  std::unique_ptr<frame> frame_ptr = std::make_unique<frame>();
+
+  upload_handler(foxy::server_session& server_)
+    : server(server_)
+  {
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0)
+    -> void
+  {
+    auto& f = *frame_ptr;
+
+    reenter(*this)
+    {
+      yield server.async_read_header(f.header_parser, std::move(self));
+      if (ec) { return self.complete(ec, bytes_transferred); }
+
+      if (f.header_parser.get().target() != "/accept") {
+        f.response.result(http::status::payload_too_large);
+        f.response.keep_alive(false);
+        f.response.body() = "upload rejected";
+        f.response.prepare_payload();
+
+        yield server.async_write(f.response, std::move(self));
+        return self.complete(ec, bytes_transferred);
+      }
+
+      if (f.header_parser.get()[http::field::expect] == "100-continue") {
+        yield server.async_write(f.interim, std::move(self));
+        if (ec) { return self.complete(ec, bytes_transferred); }
+      }
+
+      f.body_parser.emplace(std::move(f.header_parser));
+
+      yield server.async_read(*f.body_parser, std::move(self));
+      if (ec) { return self.complete(ec, bytes_transferred); }
+
+      f.response.result(http::status::ok);
+      f.response.body() = f.body_parser->get().body();
+      f.response.prepare_payload();
+
+      yield server.async_write(f.response, std::move(self));
+      self.complete(ec, bytes_transferred);
+    }
+  }
+};
+#include <boost/asio/unyield.hpp>
+
+auto
+make_upload_handler(foxy::server_session& server) -> upload_handler
+{
+  return upload_handler(server);
+}
+
+} // namespace
+
+TEST_CASE("client_upload_test")
+{
+  SECTION("should stream a chunked body once the server sends 100 Continue")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept(&make_upload_handler);
+
+    auto was_valid_upload = false;
+    auto histograms       = std::make_shared<foxy::session_histograms>();
+
+    asio::spawn(io.get_executor(), [&](auto yield) mutable {
+      auto client            = foxy::client_session(io.get_executor(), {{}, 4s, false});
+      client.opts.histograms = histograms;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto request = http::request<http::buffer_body>(http::verb::put, "/accept", 11);
+      request.set(http::field::expect, "100-continue");
+      request.chunked(true);
+
+      auto serializer = http::request_serializer<http::buffer_body>(request);
+      auto interim    = http::response_parser<http::empty_body>();
+
+      auto const send_body = client.async_upload_header(serializer, interim, yield);
+      CHECK(send_body);
+      CHECK(interim.get().result() == http::status::continue_);
+
+      auto const chunks = std::array<boost::string_view, 3>{"hello", ", ", "world!"};
+      for (auto const chunk : chunks) {
+        auto const n =
+          client.async_upload_chunk(serializer, asio::buffer(chunk.data(), chunk.size()), yield);
+        CHECK(n > chunk.size());
+      }
+
+      client.async_upload_finish(serializer, yield);
+      CHECK(serializer.is_done());
+
+      auto parser = http::response_parser<http::string_body>();
+      client.async_read(parser, yield);
+
+      was_valid_upload = parser.get().result() == http::status::ok &&
+                         parser.get().body() == "hello, world!";
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      listener.shutdown();
+    });
+
+    io.run();
+    REQUIRE(was_valid_upload);
+
+    // the upload is timed like any other session operation, every chunk and the finish are writes
+    //
+    auto const snapshot = histograms->snapshot();
+    CHECK(snapshot[foxy::session_op::write_header].count() == 1);
+    CHECK(snapshot[foxy::session_op::read_header].count() == 1);
+    CHECK(snapshot[foxy::session_op::write].count() == 4);
+  }
+
+  SECTION("should stream a body of known length without waiting on the server")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept(&make_upload_handler);
+
+    auto was_valid_upload = false;
+
+    asio::spawn(io.get_executor(), [&](auto yield) mutable {
+      auto client = foxy::client_session(io.get_executor(), {{}, 4s, false});
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto const body = boost::string_view("the quick brown fox");
+
+      auto request = http::request<http::buffer_body>(http::verb::post, "/accept", 11);
+      request.content_length(body.size());
+
+      auto serializer = http::request_serializer<http::buffer_body>(request);
+      auto interim    = http::response_parser<http::empty_body>();
+
+      auto const send_body = client.async_upload_header(serializer, interim, yield);
+      CHECK(send_body);
+      CHECK(!interim.is_header_done());
+
+      auto const n0 = client.async_upload_chunk(serializer, asio::buffer(body.data(), 9), yield);
+      auto const n1 = client.async_upload_chunk(
+        serializer, asio::buffer(body.data() + 9, body.size() - 9), yield);
+      CHECK(n0 + n1 == body.size());
+
+      client.async_upload_finish(serializer, yield);
+
+      auto parser = http::response_parser<http::string_body>();
+      client.async_read(parser, yield);
+
+      was_valid_upload = parser.get().result() == http::status::ok && parser.get().body() == body;
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      listener.shutdown();
+    });
+
+    io.run();
+    REQUIRE(was_valid_upload);
+  }
+
+  SECTION("should not send the body when the server rejects the upload up front")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept(&make_upload_handler);
+
+    auto was_rejected = false;
+
+    asio::spawn(io.get_executor(), [&](auto yield) mutable {
+      auto client = foxy::client_session(io.get_executor(), {{}, 4s, false});
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto request = http::request<http::buffer_body>(http::verb::put, "/reject", 11);
+      request.set(http::field::expect, "100-continue");
+      request.content_length(1024 * 1024);
+
+      auto serializer = http::request_serializer<http::buffer_body>(request);
+      auto interim    = http::response_parser<http::empty_body>();
+
+      auto const send_body = client.async_upload_header(serializer, interim, yield);
+      CHECK(!send_body);
+      CHECK(interim.get().result() == http::status::payload_too_large);
+
+      // the final response was the answer to our Expect so the rest of it can be read by moving
+      // the header into a parser with a more useful Body
+      //
+      auto parser = http::response_parser<http::string_body>(std::move(interim));
+      client.async_read(parser, yield);
+
+      was_rejected = parser.get().body() == "upload rejected";
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      listener.shutdown();
+    });
+
+    io.run();
+    REQUIRE(was_rejected);
+  }
+}
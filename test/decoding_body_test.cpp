@@ -0,0 +1,315 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/decoding_body.hpp>
+#include <foxy/client_session.hpp>
+#include <foxy/listener.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/coroutine.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/zlib/deflate_stream.hpp>
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+namespace zlib = boost::beast::zlib;
+
+using boost::asio::ip::tcp;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+make_text(std::size_t const size) -> std::string
+{
+  auto const phrase = std::string(R"({"id": 1337, "name": "foxy", "tags": ["http", "asio"]}, )");
+
+  auto text = std::string();
+  while (text.size() < size) {
+    text += phrase;
+    text += std::to_string(text.size());
+  }
+  text.resize(size);
+  return text;
+}
+
+auto
+deflate_raw(std::string const& input) -> std::string
+{
+  auto deflater = zlib::deflate_stream();
+  auto output   = std::string(deflater.upper_bound(input.size()), '\0');
+
+  auto zs      = zlib::z_params();
+  zs.next_in   = input.data();
+  zs.avail_in  = input.size();
+  zs.next_out  = &output[0];
+  zs.avail_out = output.size();
+
+  auto ec = boost::system::error_code();
+  deflater.write(zs, zlib::Flush::finish, ec);
+
+  output.resize(zs.total_out);
+  return output;
+}
+
+auto
+append_le32(std::string& s, std::uint32_t const x) -> void
+{
+  for (auto i = 0; i < 4; ++i) { s.push_back(static_cast<char>((x >> (8 * i)) & 0xff)); }
+}
+
+auto
+append_be32(std::string& s, std::uint32_t const x) -> void
+{
+  for (auto i = 3; i >= 0; --i) { s.push_back(static_cast<char>((x >> (8 * i)) & 0xff)); }
+}
+
+// gzip wraps the input in a single gzip member, complete with an FEXTRA and FNAME to skip over
+//
+auto
+gzip(std::string const& input) -> std::string
+{
+  auto crc = boost::crc_32_type();
+  crc.process_bytes(input.data(), input.size());
+
+  auto member = std::string("\x1f\x8b\x08\x0c\x00\x00\x00\x00\x00\xff", 10);
+  member += std::string("\x03\x00xyz", 5);
+  member += std::string("data.json\0", 10);
+  member += deflate_raw(input);
+  append_le32(member, crc.checksum());
+  append_le32(member, static_cast<std::uint32_t>(input.size()));
+  return member;
+}
+
+auto
+zlib_wrap(std::string const& input) -> std::string
+{
+  auto a = std::uint32_t{1};
+  auto b = std::uint32_t{0};
+  for (auto const c : input) {
+    a = (a + static_cast<unsigned char>(c)) % 65521;
+    b = (b + a) % 65521;
+  }
+
+  auto stream = std::string("\x78\x9c", 2);
+  stream += deflate_raw(input);
+  append_be32(stream, (b << 16) | a);
+  return stream;
+}
+
+auto
+make_wire(boost::string_view const coding, std::string const& body) -> std::string
+{
+  auto wire = std::string("HTTP/1.1 200 OK\r\n");
+  wire += "Content-Encoding: " + static_cast<std::string>(coding) + "\r\n";
+  wire += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+  wire += body;
+  return wire;
+}
+
+// feed hands the parser as few octets as it will accept at a time, which exercises every split
+// point of the coded stream
+//
+template <class Parser>
+auto
+feed(Parser& parser, std::string const& wire) -> boost::system::error_code
+{
+  auto ec     = boost::system::error_code();
+  auto offset = std::size_t{0};
+  auto size   = std::size_t{1};
+
+  while (!parser.is_done()) {
+    if (offset + size > wire.size()) { return http::error::partial_message; }
+
+    offset += parser.put(asio::buffer(wire.data() + offset, size), ec);
+    if (ec == http::error::need_more) {
+      ec = {};
+      ++size;
+      continue;
+    }
+
+    if (ec) { return ec; }
+    size = 1;
+  }
+
+  return ec;
+}
+
+#include <boost/asio/yield.hpp>
+// gzip_handler answers with a chunked, gzip coded body but only if the client asked for one
+//
+struct gzip_handler : asio::coroutine
+{
+  struct frame
+  {
+    std::string const&                object;
+    http::request<http::empty_body>   request;
+    http::response<http::string_body> response;
+  };
+
+  foxy::server_session&  server;
+  std::unique_ptr<frame> frame_ptr;
+
+  gzip_handler(foxy::server_session& server_, std::string const& object)
+    : server(server_)
+    , frame_ptr(std::make_unique<frame>(frame{object, {}, {}}))
+  {
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0)
+    -> void
+  {
+    auto& f = *frame_ptr;
+
+    reenter(*this)
+    {
+      yield server.async_read(f.request, std::move(self));
+      if (ec) { return self.complete(ec, bytes_transferred); }
+
+      f.response.result(http::status::ok);
+      f.response.keep_alive(false);
+      f.response.chunked(true);
+
+      if (f.request[http::field::accept_encoding].find("gzip") != boost::string_view::npos) {
+        f.response.set(http::field::content_encoding, "gzip");
+        f.response.body() = gzip(f.object);
+      } else {
+        f.response.body() = f.object;
+      }
+
+      yield server.async_write(f.response, std::move(self));
+      self.complete(ec, bytes_transferred);
+    }
+  }
+};
+#include <boost/asio/unyield.hpp>
+
+} // namespace
+
+TEST_CASE("decoding_body_test")
+{
+  auto const text = make_text(200 * 1000);
+
+  SECTION("should decode a gzip body fed to it an octet at a time")
+  {
+    auto parser = http::response_parser<foxy::decoding_body<http::string_body>>();
+    parser.body_limit(16 * 1024 * 1024);
+
+    auto const ec = feed(parser, make_wire("gzip", gzip(text)));
+
+    CHECK(!ec);
+    CHECK(parser.get().body() == text);
+    CHECK(parser.get()[http::field::content_encoding] == "gzip");
+  }
+
+  SECTION("should decode every member of a multi-member gzip body")
+  {
+    auto parser = http::response_parser<foxy::decoding_body<http::string_body>>();
+
+    auto const ec = feed(parser, make_wire("x-gzip", gzip("hello, ") + gzip("world!")));
+
+    CHECK(!ec);
+    CHECK(parser.get().body() == "hello, world!");
+  }
+
+  SECTION("should decode deflate bodies with and without the zlib wrapper")
+  {
+    auto zlib_parser = http::response_parser<foxy::decoding_body<http::string_body>>();
+    auto raw_parser  = http::response_parser<foxy::decoding_body<http::string_body>>();
+
+    CHECK(!feed(zlib_parser, make_wire("deflate", zlib_wrap(text))));
+    CHECK(!feed(raw_parser, make_wire("Deflate", deflate_raw(text))));
+
+    CHECK(zlib_parser.get().body() == text);
+    CHECK(raw_parser.get().body() == text);
+  }
+
+  SECTION("should pass through bodies it doesn't know how to decode")
+  {
+    auto identity_parser = http::response_parser<foxy::decoding_body<http::string_body>>();
+    auto unknown_parser  = http::response_parser<foxy::decoding_body<http::string_body>>();
+
+    CHECK(!feed(identity_parser, make_wire("identity", "hello, world!")));
+    CHECK(!feed(unknown_parser, make_wire("br", "\x0b\x06\x80hello, world!\x03")));
+
+    CHECK(identity_parser.get().body() == "hello, world!");
+    CHECK(unknown_parser.get().body() == "\x0b\x06\x80hello, world!\x03");
+  }
+
+  SECTION("should reject a corrupted or truncated gzip body")
+  {
+    auto coded = gzip(text);
+
+    auto corrupted = coded;
+    corrupted[corrupted.size() - 5] ^= 0x01;
+
+    auto truncated = coded.substr(0, coded.size() / 2);
+
+    auto corrupted_parser = http::response_parser<foxy::decoding_body<http::string_body>>();
+    auto truncated_parser = http::response_parser<foxy::decoding_body<http::string_body>>();
+
+    auto const corrupted_ec = feed(corrupted_parser, make_wire("gzip", corrupted));
+    auto const truncated_ec = feed(truncated_parser, make_wire("gzip", truncated));
+
+    CHECK(corrupted_ec == foxy::error::bad_content_encoding);
+    CHECK(truncated_ec == foxy::error::bad_content_encoding);
+  }
+
+  SECTION("should advertise and decode gzip when talking to a server")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept(
+      [&text](foxy::server_session& server) { return gzip_handler(server, text); });
+
+    auto was_decoded = false;
+
+    asio::spawn(io.get_executor(), [&](auto yield) mutable {
+      auto client = foxy::client_session(io.get_executor(), {{}, 4s, false});
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+      foxy::accept_encoding(request);
+
+      auto parser = http::response_parser<foxy::decoding_body<http::string_body>>();
+      parser.body_limit(16 * 1024 * 1024);
+
+      client.async_request(request, parser, yield);
+
+      was_decoded = parser.get()[http::field::content_encoding] == "gzip" &&
+                    parser.get().body() == text;
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      listener.shutdown();
+    });
+
+    io.run();
+    REQUIRE(was_decoded);
+  }
+}
@@ -0,0 +1,299 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/download.hpp>
+#include <foxy/listener.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/coroutine.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using boost::asio::ip::tcp;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+make_object(std::size_t const size) -> std::string
+{
+  auto object = std::string(size, '\0');
+  for (auto i = std::size_t{0}; i < size; ++i) {
+    object[i] = static_cast<char>('a' + static_cast<char>((i * 7 + i / 251) % 26));
+  }
+  return object;
+}
+
+#include <boost/asio/yield.hpp>
+// range_handler serves `object` for any target and honors `Range: bytes=first-last` only when the
+// target is "/ranged"
+//
+struct range_handler : asio::coroutine
+{
+  struct frame
+  {
+    std::string const&                object;
+    std::size_t&                      accepted;
+    http::request<http::empty_body>   request;
+    http::response<http::string_body> response;
+  };
+
+  foxy::server_session&  server;
+  std::unique_ptr<frame> frame_ptr;
+
+  range_handler(foxy::server_session& server_, std::string const& object, std::size_t& accepted)
+    : server(server_)
+    , frame_ptr(std::make_unique<frame>(frame{object, accepted, {}, {}}))
+  {
+    ++accepted;
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0)
+    -> void
+  {
+    auto& f = *frame_ptr;
+
+    reenter(*this)
+    {
+      while (true) {
+        f.request = {};
+
+        yield server.async_read(f.request, std::move(self));
+        if (ec) { break; }
+
+        f.response = {};
+        f.response.keep_alive(f.request.keep_alive());
+
+        {
+          auto first = 0ull;
+          auto last  = 0ull;
+
+          auto const range      = static_cast<std::string>(f.request[http::field::range]);
+          auto const is_ranged  = f.request.target() == "/ranged";
+          auto const has_range  = std::sscanf(range.c_str(), "bytes=%llu-%llu", &first, &last) == 2;
+          auto const last_index = static_cast<unsigned long long>(f.object.size() - 1);
+
+          if (is_ranged && has_range && first >= f.object.size()) {
+            f.response.result(http::status::range_not_satisfiable);
+            f.response.set(http::field::content_range,
+                           "bytes */" + std::to_string(f.object.size()));
+            f.response.body() = "Range Not Satisfiable";
+          } else if (is_ranged && has_range) {
+            if (last > last_index) { last = last_index; }
+
+            f.response.result(http::status::partial_content);
+            f.response.set(http::field::content_range, "bytes " + std::to_string(first) + "-" +
+                                                         std::to_string(last) + "/" +
+                                                         std::to_string(f.object.size()));
+            f.response.body() = f.object.substr(first, last - first + 1);
+          } else {
+            f.response.result(http::status::ok);
+            f.response.body() = f.object;
+          }
+        }
+
+        f.response.prepare_payload();
+
+        yield server.async_write(f.response, std::move(self));
+        if (ec || !f.request.keep_alive()) { break; }
+      }
+
+      self.complete({}, 0);
+    }
+  }
+};
+#include <boost/asio/unyield.hpp>
+
+} // namespace
+
+TEST_CASE("download_test")
+{
+  auto const object = make_object(100 * 1000 + 17);
+
+  auto opts            = foxy::download_opts();
+  opts.max_connections = 4;
+  opts.segment_size    = 8 * 1024;
+  opts.buffer_size     = 4 * 1024;
+  opts.session.timeout = 4s;
+
+  SECTION("should fetch an object in parallel segments when the remote supports ranges")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto accepted = std::size_t{0};
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept([&](foxy::server_session& server) {
+      return range_handler(server, object, accepted);
+    });
+
+    auto data = std::string();
+    auto sink = foxy::make_memory_sink(data);
+
+    auto result      = boost::system::error_code();
+    auto transferred = std::uint64_t{0};
+
+    foxy::async_download(io.get_executor(), "127.0.0.1", "1337", "/ranged", sink, opts,
+                         [&](boost::system::error_code ec, std::uint64_t n) {
+                           result      = ec;
+                           transferred = n;
+                           listener.shutdown();
+                         });
+
+    io.run();
+
+    CHECK(!result);
+    CHECK(transferred == object.size());
+    CHECK(data == object);
+    CHECK(accepted > 1);
+    CHECK(accepted <= opts.max_connections);
+  }
+
+  SECTION("should fall back to a single stream when the remote ignores the Range")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto accepted = std::size_t{0};
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept([&](foxy::server_session& server) {
+      return range_handler(server, object, accepted);
+    });
+
+    auto data = std::vector<char>();
+    auto sink = foxy::make_memory_sink(data);
+
+    auto result      = boost::system::error_code();
+    auto transferred = std::uint64_t{0};
+
+    foxy::async_download(io.get_executor(), "127.0.0.1", "1337", "/plain", sink, opts,
+                         [&](boost::system::error_code ec, std::uint64_t n) {
+                           result      = ec;
+                           transferred = n;
+                           listener.shutdown();
+                         });
+
+    io.run();
+
+    CHECK(!result);
+    CHECK(transferred == object.size());
+    CHECK(std::string(data.begin(), data.end()) == object);
+    CHECK(accepted == 1);
+  }
+
+  SECTION("should write the segments of the object into a preallocated file")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto accepted = std::size_t{0};
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept([&](foxy::server_session& server) {
+      return range_handler(server, object, accepted);
+    });
+
+    auto const* const path = "foxy_download_test.bin";
+
+    auto ec   = boost::system::error_code();
+    auto sink = foxy::file_sink(path, ec);
+    REQUIRE(!ec);
+
+    auto result = boost::system::error_code();
+
+    foxy::async_download(io.get_executor(), "127.0.0.1", "1337", "/ranged", sink, opts,
+                         [&](boost::system::error_code ec, std::uint64_t) {
+                           result = ec;
+                           listener.shutdown();
+                         });
+
+    io.run();
+    sink.file.close(ec);
+
+    auto ifs      = std::ifstream(path, std::ios::binary);
+    auto contents = std::string(std::istreambuf_iterator<char>(ifs), {});
+    ifs.close();
+
+    std::remove(path);
+
+    CHECK(!result);
+    CHECK(contents == object);
+  }
+
+  SECTION("should download an empty object whose probe is answered with a 416")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto const empty = std::string();
+
+    auto accepted = std::size_t{0};
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept([&](foxy::server_session& server) {
+      return range_handler(server, empty, accepted);
+    });
+
+    auto data = std::string("stale");
+    auto sink = foxy::make_memory_sink(data);
+
+    auto result      = boost::system::error_code();
+    auto transferred = std::uint64_t{1};
+
+    foxy::async_download(io.get_executor(), "127.0.0.1", "1337", "/ranged", sink, opts,
+                         [&](boost::system::error_code ec, std::uint64_t n) {
+                           result      = ec;
+                           transferred = n;
+                           listener.shutdown();
+                         });
+
+    io.run();
+
+    CHECK(!result);
+    CHECK(transferred == 0);
+    CHECK(data.empty());
+    CHECK(accepted == 1);
+  }
+
+  SECTION("should report a failure to connect")
+  {
+    asio::io_context io{1};
+
+    auto data = std::string();
+    auto sink = foxy::make_memory_sink(data);
+
+    auto result = boost::system::error_code();
+
+    foxy::async_download(io.get_executor(), "127.0.0.1", "1", "/ranged", sink, opts,
+                         [&](boost::system::error_code ec, std::uint64_t) { result = ec; });
+
+    io.run();
+    CHECK(result);
+  }
+}
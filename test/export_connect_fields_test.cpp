@@ -9,6 +9,7 @@
 //
 
 #include <foxy/detail/export_connect_fields.hpp>
+#include <foxy/detail/has_token.hpp>
 
 #include <boost/beast/http.hpp>
 
@@ -16,12 +17,66 @@
 #include <boost/range/algorithm/for_each.hpp>
 
 #include <algorithm>
+#include <cstddef>
+#include <memory>
 
 #include <catch2/catch.hpp>
 
 namespace http  = boost::beast::http;
 namespace range = boost::range;
 
+namespace
+{
+// counting_allocator counts every allocation made through it or any of its rebound copies
+//
+template <class T>
+struct counting_allocator
+{
+  using value_type = T;
+
+  std::size_t* num_allocs;
+
+  explicit counting_allocator(std::size_t* num_allocs_) noexcept
+    : num_allocs(num_allocs_)
+  {
+  }
+
+  template <class U>
+  counting_allocator(counting_allocator<U> const& other) noexcept
+    : num_allocs(other.num_allocs)
+  {
+  }
+
+  auto
+  allocate(std::size_t n) -> T*
+  {
+    ++*num_allocs;
+    return std::allocator<T>().allocate(n);
+  }
+
+  auto
+  deallocate(T* p, std::size_t n) noexcept -> void
+  {
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <class U>
+  auto
+  operator==(counting_allocator<U> const& other) const noexcept -> bool
+  {
+    return num_allocs == other.num_allocs;
+  }
+
+  template <class U>
+  auto
+  operator!=(counting_allocator<U> const& other) const noexcept -> bool
+  {
+    return num_allocs != other.num_allocs;
+  }
+};
+
+} // namespace
+
 TEST_CASE("export_connect_fields_test")
 {
   SECTION("should export all hop-by-hops to an external Fields container")
@@ -70,4 +125,59 @@ TEST_CASE("export_connect_fields_test")
     ++transfer_encoding_iter;
     CHECK(transfer_encoding_iter->value() == "chunked");
   }
+
+  SECTION("should match Connection options regardless of case")
+  {
+    auto a = http::fields();
+    auto b = http::fields();
+
+    a.insert(http::field::connection, "X-Trace-Id, KEEP-ALIVE");
+    a.insert("x-trace-id", "1234");
+    a.insert(http::field::keep_alive, "timeout=5");
+    a.insert(http::field::host, "www.example.com");
+
+    foxy::detail::export_connect_fields(a, b);
+
+    CHECK(std::distance(a.begin(), a.end()) == 1);
+    CHECK(a[http::field::host] == "www.example.com");
+    CHECK(b["X-Trace-Id"] == "1234");
+    CHECK(b[http::field::keep_alive] == "timeout=5");
+    CHECK(b[http::field::connection] == "X-Trace-Id, KEEP-ALIVE");
+  }
+
+  SECTION("should only allocate for the fields it moves")
+  {
+    auto num_allocs = std::size_t{0};
+    auto alloc      = counting_allocator<char>(&num_allocs);
+
+    auto a = http::basic_fields<counting_allocator<char>>(alloc);
+    auto b = http::basic_fields<counting_allocator<char>>(alloc);
+
+    a.insert(http::field::host, "www.example.com");
+    a.insert(http::field::user_agent, "foxy");
+    a.insert(http::field::accept, "*/*");
+    a.insert(http::field::connection, "keep-alive, x-request-start");
+    a.insert(http::field::keep_alive, "timeout=5");
+    a.insert("x-request-start", "t=1546300800");
+    a.insert(http::field::cookie, "session=deadbeef");
+
+    num_allocs = 0;
+    foxy::detail::export_connect_fields(a, b);
+
+    CHECK(num_allocs == 3);
+    CHECK(std::distance(a.begin(), a.end()) == 4);
+    CHECK(std::distance(b.begin(), b.end()) == 3);
+  }
+
+  SECTION("should find our own Via among the others")
+  {
+    auto fields = http::fields();
+    CHECK(!foxy::detail::has_foxy_via(fields));
+
+    fields.insert(http::field::via, "1.0 fred, 1.1 p.example.net");
+    CHECK(!foxy::detail::has_foxy_via(fields));
+
+    fields.insert(http::field::via, "1.0 fred, 1.1 FOXY");
+    CHECK(foxy::detail::has_foxy_via(fields));
+  }
 }
@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/health_checker.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("health_checker_test")
+{
+  SECTION("should eject backends that fail their probes and keep the healthy ones")
+  {
+    asio::io_context io{1};
+
+    auto healthy = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto failing = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto dead    = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+
+    auto backends = std::make_shared<foxy::backend_pool>(std::vector<foxy::backend>{
+      {"127.0.0.1", std::to_string(healthy.local_endpoint().port())},
+      {"127.0.0.1", std::to_string(failing.local_endpoint().port())},
+      {"127.0.0.1", std::to_string(dead.local_endpoint().port())}});
+
+    dead.close();
+
+    auto num_probes  = 0;
+    auto last_target = std::string();
+
+    // the healthy backend answers every probe with a 200, the failing one with a 503
+    //
+    auto const serve = [&](tcp::acceptor& acceptor, http::status status) {
+      asio::spawn(io, [&, status](asio::yield_context yield) {
+        while (true) {
+          auto ec     = boost::system::error_code();
+          auto origin = tcp::socket(io);
+          acceptor.async_accept(origin, yield[ec]);
+          if (ec) { break; }
+
+          auto buffer  = boost::beast::flat_buffer();
+          auto request = http::request<http::empty_body>();
+          http::async_read(origin, buffer, request, yield[ec]);
+          if (ec) { continue; }
+
+          ++num_probes;
+          last_target = static_cast<std::string>(request.target());
+
+          auto response = http::response<http::empty_body>(status, 11);
+          response.keep_alive(false);
+          response.prepare_payload();
+          http::async_write(origin, response, yield[ec]);
+        }
+      });
+    };
+
+    serve(healthy, http::status::ok);
+    serve(failing, http::status::service_unavailable);
+
+    auto opts     = foxy::health_check_opts();
+    opts.interval = 50ms;
+    opts.timeout  = 1s;
+    opts.target   = "/healthz";
+
+    auto checker = std::make_shared<foxy::health_checker>(io.get_executor(), backends, opts);
+    checker->async_run();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      // the default of 3 failures in a row is reached by the third round
+      //
+      auto timer = asio::steady_timer(io, 400ms);
+      timer.async_wait(yield);
+
+      checker->cancel();
+      healthy.cancel();
+      failing.cancel();
+    });
+
+    io.run();
+
+    CHECK(num_probes >= 6);
+    CHECK(last_target == "/healthz");
+
+    CHECK(!backends->is_ejected(0));
+    CHECK(backends->is_ejected(1));
+    CHECK(backends->is_ejected(2));
+  }
+}
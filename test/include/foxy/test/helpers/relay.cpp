@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/test/helpers/relay.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <cstdint>
+#include <limits>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using boost::asio::ip::tcp;
+
+auto
+foxy::test::make_socket_pair(asio::io_context& io) -> std::pair<tcp::socket, tcp::socket>
+{
+  auto acceptor = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+
+  auto client = tcp::socket(io);
+  client.connect(acceptor.local_endpoint());
+
+  return {std::move(client), acceptor.accept()};
+}
+
+foxy::test::relay_fixture::relay_fixture(asio::io_context& io, ::foxy::session_opts const& opts)
+  : relay_fixture(make_socket_pair(io), make_socket_pair(io), opts)
+{
+}
+
+foxy::test::relay_fixture::relay_fixture(socket_pair                 user_pair,
+                                         socket_pair                 origin_pair,
+                                         ::foxy::session_opts const& opts)
+  : user(std::move(user_pair.first))
+  , origin(std::move(origin_pair.second))
+  , server(std::move(user_pair.second), opts)
+  , client(std::move(origin_pair.first), opts)
+{
+}
+
+auto
+foxy::test::relay_through(::foxy::session_opts const& opts,
+                          std::string const&          request_body,
+                          std::string const&          response_body,
+                          std::string&                received,
+                          std::string&                returned,
+                          relay_fn                    relay) -> boost::system::error_code
+{
+  asio::io_context io{1};
+
+  auto f = relay_fixture(io, opts);
+
+  auto relay_ec = boost::system::error_code();
+
+  asio::spawn(io, [&](asio::yield_context yield) { relay(f.server, f.client, yield, relay_ec); });
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    auto buffer = boost::beast::flat_buffer();
+    auto parser = http::request_parser<http::string_body>();
+    parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+    http::async_read(f.origin, buffer, parser, yield);
+
+    received = std::move(parser.get().body());
+
+    auto response = http::response<http::string_body>(http::status::ok, 11, response_body);
+    response.prepare_payload();
+    http::async_write(f.origin, response, yield);
+  });
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    auto request = http::request<http::string_body>(http::verb::post, "/", 11, request_body);
+    request.set(http::field::host, "127.0.0.1");
+    request.prepare_payload();
+    http::async_write(f.user, request, yield);
+
+    auto buffer = boost::beast::flat_buffer();
+    auto parser = http::response_parser<http::string_body>();
+    parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+    http::async_read(f.user, buffer, parser, yield);
+
+    returned = std::move(parser.get().body());
+  });
+
+  io.run();
+
+  return relay_ec;
+}
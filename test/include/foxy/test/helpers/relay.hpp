@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_TEST_HELPERS_RELAY_HPP_
+#define FOXY_TEST_HELPERS_RELAY_HPP_
+
+#include <foxy/session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace foxy
+{
+namespace test
+{
+using relay_session =
+  ::foxy::basic_session<boost::asio::ip::tcp::socket, boost::beast::flat_buffer>;
+
+// make_socket_pair connects two sockets over loopback, the first one is the connecting end
+//
+auto
+make_socket_pair(boost::asio::io_context& io)
+  -> std::pair<boost::asio::ip::tcp::socket, boost::asio::ip::tcp::socket>;
+
+// relay_fixture is everything a relay runs between, `server` is the relay's end of its connection
+// to `user` and `client` the relay's end of its connection to `origin`
+//
+struct relay_fixture
+{
+  boost::asio::ip::tcp::socket user;
+  boost::asio::ip::tcp::socket origin;
+
+  relay_session server;
+  relay_session client;
+
+  relay_fixture(boost::asio::io_context& io, ::foxy::session_opts const& opts);
+
+private:
+  using socket_pair = std::pair<boost::asio::ip::tcp::socket, boost::asio::ip::tcp::socket>;
+
+  relay_fixture(socket_pair user_pair, socket_pair origin_pair, ::foxy::session_opts const& opts);
+};
+
+using relay_fn = std::function<void(
+  relay_session&, relay_session&, boost::asio::yield_context, boost::system::error_code&)>;
+
+// relay_through runs `relay` over a relay_fixture while the user POSTs `request_body` and the
+// origin answers it with `response_body`, the bodies that made it to the other side end up in
+// `received` and `returned`
+//
+auto
+relay_through(::foxy::session_opts const& opts,
+              std::string const&          request_body,
+              std::string const&          response_body,
+              std::string&                received,
+              std::string&                returned,
+              relay_fn                    relay) -> boost::system::error_code;
+
+} // namespace test
+} // namespace foxy
+
+#endif // FOXY_TEST_HELPERS_RELAY_HPP_
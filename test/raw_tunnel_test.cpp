@@ -0,0 +1,375 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/proxy.hpp>
+#include <foxy/detail/raw_tunnel.hpp>
+#include <foxy/test/helpers/relay.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+make_proxy(asio::io_context& io, foxy::session_opts opts) -> std::shared_ptr<foxy::proxy>
+{
+  auto const endpoint = tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337);
+
+  opts.raw_tunnel = true;
+
+  auto proxy = std::make_shared<foxy::proxy>(io, endpoint, true, opts);
+  proxy->async_accept();
+  return proxy;
+}
+
+// connect_tunnel connects to the proxy and asks it for a tunnel to `port`, anything sent after the
+// CONNECT request is already part of the tunneled stream
+//
+auto
+connect_tunnel(tcp::socket&              socket,
+               unsigned short const      port,
+               std::string const&        preamble,
+               boost::beast::flat_buffer& buffer,
+               asio::yield_context        yield) -> http::status
+{
+  socket.async_connect(tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), yield);
+
+  auto const authority = "127.0.0.1:" + std::to_string(port);
+  auto const request =
+    "CONNECT " + authority + " HTTP/1.1\r\nHost: " + authority + "\r\n\r\n" + preamble;
+
+  asio::async_write(socket, asio::buffer(request), yield);
+
+  auto parser = http::response_parser<http::empty_body>();
+  http::async_read_header(socket, buffer, parser, yield);
+
+  return parser.get().result();
+}
+
+// recording_tunnel keeps the error a raw tunnel finishes with
+//
+struct recording_tunnel final : foxy::detail::raw_tunnel
+{
+  boost::system::error_code& finished_ec;
+  bool&                      is_finished;
+
+  recording_tunnel(tcp::socket&               server,
+                   tcp::socket&               client,
+                   boost::beast::flat_buffer& preamble,
+                   foxy::session_opts const&  opts,
+                   boost::system::error_code& finished_ec_,
+                   bool&                      is_finished_)
+    : raw_tunnel(server, client, preamble, opts)
+    , finished_ec(finished_ec_)
+    , is_finished(is_finished_)
+  {
+  }
+
+protected:
+  auto
+  on_finish(boost::system::error_code ec) -> void override
+  {
+    finished_ec = ec;
+    is_finished = true;
+  }
+};
+
+} // namespace
+
+TEST_CASE("raw_tunnel_test")
+{
+  SECTION("should pump opaque bytes both ways and forward half-closes")
+  {
+    asio::io_context io{1};
+
+    auto acceptor  = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto proxy = make_proxy(io, {});
+
+    auto const payload = std::string(1024 * 1024 + 11, 'x');
+
+    auto status   = http::status::unknown;
+    auto greeting = std::string();
+    auto echoed   = std::string();
+    auto farewell = std::string();
+
+    // the origin echoes everything back until the client half-closes, then says goodbye
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto ec  = boost::system::error_code();
+      auto buf = std::string(64 * 1024, '\0');
+      while (true) {
+        auto const n = origin.async_read_some(asio::buffer(buf), yield[ec]);
+        if (ec) { break; }
+        asio::async_write(origin, asio::buffer(buf.data(), n), yield);
+      }
+
+      asio::async_write(origin, asio::buffer(std::string("goodbye")), yield);
+      origin.shutdown(tcp::socket::shutdown_send);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      auto buffer = boost::beast::flat_buffer();
+
+      status = connect_tunnel(socket, port, "hello", buffer, yield);
+
+      greeting.resize(5);
+      auto const buffered = asio::buffer_copy(asio::buffer(greeting), buffer.data());
+      asio::async_read(socket, asio::buffer(&greeting[buffered], greeting.size() - buffered),
+                       yield);
+
+      asio::spawn(yield, [&](asio::yield_context yield) {
+        asio::async_write(socket, asio::buffer(payload), yield);
+      });
+
+      echoed.resize(payload.size());
+      asio::async_read(socket, asio::buffer(echoed), yield);
+
+      socket.shutdown(tcp::socket::shutdown_send);
+
+      auto ec = boost::system::error_code();
+      asio::async_read(socket, asio::dynamic_buffer(farewell), yield[ec]);
+      CHECK(ec == asio::error::eof);
+
+      proxy->cancel();
+    });
+
+    io.run();
+
+    CHECK(status == http::status::ok);
+    CHECK(greeting == "hello");
+    CHECK(echoed == payload);
+    CHECK(farewell == "goodbye");
+  }
+
+  SECTION("should close tunnels that sit idle")
+  {
+    asio::io_context io{1};
+
+    auto acceptor  = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts                = foxy::session_opts();
+    opts.tunnel_idle_timeout = 100ms;
+
+    auto proxy = make_proxy(io, opts);
+
+    auto status    = http::status::unknown;
+    auto closed_ec = boost::system::error_code();
+    auto elapsed   = std::chrono::steady_clock::duration();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto ec  = boost::system::error_code();
+      auto buf = std::array<char, 64>();
+      origin.async_read_some(asio::buffer(buf), yield[ec]);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      auto buffer = boost::beast::flat_buffer();
+
+      status = connect_tunnel(socket, port, "", buffer, yield);
+
+      auto const start = std::chrono::steady_clock::now();
+
+      auto buf = std::array<char, 64>();
+      socket.async_read_some(asio::buffer(buf), yield[closed_ec]);
+
+      elapsed = std::chrono::steady_clock::now() - start;
+
+      proxy->cancel();
+    });
+
+    io.run();
+
+    CHECK(status == http::status::ok);
+    CHECK(closed_ec == asio::error::eof);
+    CHECK(elapsed >= 50ms);
+    CHECK(elapsed < 5s);
+  }
+
+  SECTION("should keep a tunnel open while only one direction moves")
+  {
+    asio::io_context io{1};
+
+    auto acceptor  = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts                = foxy::session_opts();
+    opts.tunnel_idle_timeout = 100ms;
+
+    auto proxy = make_proxy(io, opts);
+
+    auto const chunk      = std::string(64, 'x');
+    auto const num_chunks = 20;
+
+    auto status   = http::status::unknown;
+    auto received = std::string();
+
+    // the origin streams for several times the idle timeout and the client never says a word
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto timer = asio::steady_timer(io);
+      for (auto i = 0; i < num_chunks; ++i) {
+        timer.expires_after(30ms);
+        timer.async_wait(yield);
+        asio::async_write(origin, asio::buffer(chunk), yield);
+      }
+
+      origin.shutdown(tcp::socket::shutdown_send);
+
+      auto ec  = boost::system::error_code();
+      auto buf = std::array<char, 64>();
+      origin.async_read_some(asio::buffer(buf), yield[ec]);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      auto buffer = boost::beast::flat_buffer();
+
+      status = connect_tunnel(socket, port, "", buffer, yield);
+
+      auto ec  = boost::system::error_code();
+      auto buf = std::array<char, 64>();
+      while (!ec) {
+        auto const n = socket.async_read_some(asio::buffer(buf), yield[ec]);
+        received.append(buf.data(), n);
+      }
+
+      proxy->cancel();
+    });
+
+    io.run();
+
+    CHECK(status == http::status::ok);
+    CHECK(received.size() == chunk.size() * num_chunks);
+  }
+
+  SECTION("should time out a tunnel that trickles a byte in just after every rate window")
+  {
+    asio::io_context io{1};
+
+    auto user_pair   = foxy::test::make_socket_pair(io);
+    auto origin_pair = foxy::test::make_socket_pair(io);
+
+    auto& user   = user_pair.first;
+    auto& origin = origin_pair.second;
+
+    // every gap is longer than the rate window but far shorter than the idle timeout
+    //
+    auto opts                = foxy::session_opts();
+    opts.tunnel_min_rate     = 100;
+    opts.tunnel_rate_window  = 100ms;
+    opts.tunnel_idle_timeout = 5s;
+
+    auto preamble    = boost::beast::flat_buffer();
+    auto finished_ec = boost::system::error_code();
+    auto is_finished = false;
+
+    std::make_shared<recording_tunnel>(user_pair.second, origin_pair.first, preamble, opts,
+                                       finished_ec, is_finished)
+      ->run();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto ec    = boost::system::error_code();
+      auto timer = asio::steady_timer(io);
+      for (auto i = 0; !ec && !is_finished && i < 20; ++i) {
+        asio::async_write(user, asio::buffer("x", 1), yield[ec]);
+
+        timer.expires_after(120ms);
+        timer.async_wait(yield);
+      }
+
+      user.close(ec);
+      origin.close(ec);
+    });
+
+    io.run();
+
+    CHECK(is_finished);
+    CHECK(finished_ec == asio::error::timed_out);
+  }
+
+  SECTION("should survive writing into a connection whose peer has gone away")
+  {
+    asio::io_context io{1};
+
+    auto user_pair   = foxy::test::make_socket_pair(io);
+    auto origin_pair = foxy::test::make_socket_pair(io);
+
+    auto& user   = user_pair.first;
+    auto& origin = origin_pair.second;
+
+    auto opts = foxy::session_opts();
+
+    auto preamble    = boost::beast::flat_buffer();
+    auto finished_ec = boost::system::error_code();
+    auto is_finished = false;
+
+    std::make_shared<recording_tunnel>(user_pair.second, origin_pair.first, preamble, opts,
+                                       finished_ec, is_finished)
+      ->run();
+
+    // the origin hangs up without reading a thing, so the tunnel's writes to it end in EPIPE which
+    // would raise a SIGPIPE and take the whole process down with it
+    //
+    origin.close();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const chunk = std::string(64 * 1024, 'x');
+
+      auto ec    = boost::system::error_code();
+      auto timer = asio::steady_timer(io);
+      for (auto i = 0; !ec && !is_finished && i < 200; ++i) {
+        asio::async_write(user, asio::buffer(chunk), yield[ec]);
+
+        timer.expires_after(5ms);
+        timer.async_wait(yield);
+      }
+
+      user.close(ec);
+    });
+
+    io.run();
+
+    CHECK(is_finished);
+    CHECK(finished_ec);
+  }
+}
@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/relay.hpp>
+#include <foxy/detail/buffer_pool.hpp>
+#include <foxy/test/helpers/relay.hpp>
+
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+make_body(std::size_t const size) -> std::string
+{
+  auto body = std::string(size, '\0');
+  for (auto i = std::size_t{0}; i < size; ++i) { body[i] = static_cast<char>('a' + (i * 7) % 26); }
+  return body;
+}
+
+} // namespace
+
+TEST_CASE("relay_buffer_test")
+{
+  SECTION("should round requests up to a size class and reuse released buffers")
+  {
+    auto pool = foxy::detail::buffer_pool();
+
+    auto buf = pool.acquire(3000);
+    REQUIRE(buf.size() == 4096);
+
+    auto* const data = buf.data();
+    buf              = pool.acquire(1);
+
+    CHECK(buf.size() == 1024);
+    CHECK(pool.acquire(4096).data() == data);
+
+    // anything past the largest size class is handed out as-is and never cached
+    //
+    auto const huge_size = (std::size_t{1} << foxy::detail::buffer_pool::max_class_log2) + 1;
+
+    auto huge = pool.acquire(huge_size);
+    CHECK(huge.size() == huge_size);
+
+    auto moved = std::move(huge);
+    CHECK(huge.data() == nullptr);
+    CHECK(moved.size() == huge_size);
+  }
+
+  SECTION("should keep the global pool's released buffers with their thread until it exits")
+  {
+    auto& pool = foxy::detail::buffer_pool::global();
+
+    auto const size = std::size_t{1} << (foxy::detail::buffer_pool::max_class_log2 - 1);
+
+    auto released = std::promise<char*>();
+    auto checked  = std::promise<void>();
+
+    auto worker = std::thread([&] {
+      auto* data = pool.acquire(size).data();
+      released.set_value(data);
+      checked.get_future().wait();
+    });
+
+    auto* const theirs = released.get_future().get();
+
+    // the worker's buffer sits in its own cache, out of our reach
+    //
+    auto ours = pool.acquire(size);
+    CHECK(ours.data() != theirs);
+
+    checked.set_value();
+    worker.join();
+
+    // and comes back to the shared free lists once the worker is gone, where a thread with an empty
+    // cache of its own finds it
+    //
+    auto* reused = static_cast<char*>(nullptr);
+    std::thread([&] { reused = pool.acquire(size).data(); }).join();
+    CHECK(reused == theirs);
+  }
+
+  SECTION("should relay large bodies intact while growing its buffer")
+  {
+    auto opts             = foxy::session_opts();
+    opts.timeout          = 5s;
+    opts.relay_buffer_min = 1024;
+    opts.relay_buffer_max = 64 * 1024;
+
+    auto const request_body  = make_body(512 * 1024 + 17);
+    auto const response_body = make_body(1024 * 1024 + 3);
+
+    auto received_req = std::string();
+    auto received_res = std::string();
+
+    auto const relay_ec = foxy::test::relay_through(
+      opts, request_body, response_body, received_req, received_res,
+      [](foxy::test::relay_session& server, foxy::test::relay_session& client,
+         asio::yield_context yield, boost::system::error_code& ec) {
+        foxy::detail::async_relay(server, client, yield[ec]);
+      });
+
+    CHECK(!relay_ec);
+    CHECK(received_req == request_body);
+    CHECK(received_res == response_body);
+  }
+}
@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/relay.hpp>
+#include <foxy/test/helpers/relay.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+make_opts() -> foxy::session_opts
+{
+  auto opts              = foxy::session_opts();
+  opts.timeout           = 5s;
+  opts.relay_full_duplex = true;
+  return opts;
+}
+
+} // namespace
+
+TEST_CASE("relay_duplex_test")
+{
+  SECTION("should stream the response back while the request body is still going up")
+  {
+    asio::io_context io{1};
+
+    auto f = foxy::test::relay_fixture(io, make_opts());
+
+    auto const body = std::string(4 * 1024 * 1024, 'q');
+
+    auto relay_ec     = boost::system::error_code();
+    auto close_tunnel = true;
+    auto echoed       = std::string();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      close_tunnel = foxy::detail::async_relay(f.server, f.client, yield[relay_ec]);
+    });
+
+    // the origin echoes the request body back as a chunked response as soon as it reads it, which
+    // only finishes if the relay moves both bodies at once
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto& origin = f.origin;
+
+      auto buffer = boost::beast::flat_buffer();
+      auto parser = http::request_parser<http::buffer_body>();
+      parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+      http::async_read_header(origin, buffer, parser, yield);
+
+      auto response = http::response<http::buffer_body>(http::status::ok, 11);
+      response.chunked(true);
+      response.body().data = nullptr;
+      response.body().more = true;
+
+      auto sr = http::response_serializer<http::buffer_body>(response);
+      http::async_write_header(origin, sr, yield);
+
+      auto buf = std::array<char, 16 * 1024>();
+      auto ec  = boost::system::error_code();
+      do {
+        if (!parser.is_done()) {
+          parser.get().body().data = buf.data();
+          parser.get().body().size = buf.size();
+
+          http::async_read(origin, buffer, parser, yield[ec]);
+          if (ec == http::error::need_buffer) { ec = {}; }
+          if (ec) { return; }
+
+          response.body().data = buf.data();
+          response.body().size = buf.size() - parser.get().body().size;
+          response.body().more = !parser.is_done();
+        } else {
+          response.body().data = nullptr;
+          response.body().size = 0;
+        }
+
+        http::async_write(origin, sr, yield[ec]);
+        if (ec == http::error::need_buffer) { ec = {}; }
+        if (ec) { return; }
+
+      } while (!parser.is_done() && !sr.is_done());
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto& user = f.user;
+
+      auto request = http::request<http::string_body>(http::verb::post, "/", 11, body);
+      request.prepare_payload();
+
+      asio::spawn(yield, [&](asio::yield_context yield) { http::async_write(user, request, yield); });
+
+      auto buffer = boost::beast::flat_buffer();
+      auto parser = http::response_parser<http::string_body>();
+      parser.body_limit(8 * 1024 * 1024);
+      http::async_read(user, buffer, parser, yield);
+
+      echoed = std::move(parser.get().body());
+    });
+
+    io.run();
+
+    CHECK(!relay_ec);
+    CHECK(!close_tunnel);
+    CHECK(echoed == body);
+  }
+
+  SECTION("should relay an early response and close the tunnel on an unfinished upload")
+  {
+    asio::io_context io{1};
+
+    auto f = foxy::test::relay_fixture(io, make_opts());
+
+    auto relay_ec     = boost::system::error_code();
+    auto close_tunnel = false;
+    auto status       = http::status::unknown;
+    auto message      = std::string();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      close_tunnel = foxy::detail::async_relay(f.server, f.client, yield[relay_ec]);
+
+      auto ec = boost::system::error_code();
+      f.server.stream.plain().close(ec);
+      f.client.stream.plain().close(ec);
+    });
+
+    // the origin refuses the upload after seeing only its header
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto& origin = f.origin;
+
+      auto buffer = boost::beast::flat_buffer();
+      auto parser = http::request_parser<http::buffer_body>();
+      parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+      http::async_read_header(origin, buffer, parser, yield);
+
+      auto response = http::response<http::string_body>(http::status::payload_too_large, 11,
+                                                        "that's far too big\n");
+      response.keep_alive(false);
+      response.prepare_payload();
+      http::async_write(origin, response, yield);
+
+      auto ec  = boost::system::error_code();
+      auto buf = std::array<char, 64>();
+      origin.async_read_some(asio::buffer(buf), yield[ec]);
+    });
+
+    // the user announces a large body but only sends a sliver of it before waiting on the response
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto& user = f.user;
+
+      auto const head = std::string("POST /upload HTTP/1.1\r\nContent-Length: 10000000\r\n\r\n") +
+                        std::string(64 * 1024, 'z');
+
+      asio::async_write(user, asio::buffer(head), yield);
+
+      auto buffer = boost::beast::flat_buffer();
+      auto parser = http::response_parser<http::string_body>();
+      http::async_read(user, buffer, parser, yield);
+
+      status  = parser.get().result();
+      message = parser.get().body();
+    });
+
+    io.run();
+
+    CHECK(!relay_ec);
+    CHECK(close_tunnel);
+    CHECK(status == http::status::payload_too_large);
+    CHECK(message == "that's far too big\n");
+  }
+}
@@ -0,0 +1,244 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/body_filter.hpp>
+#include <foxy/detail/relay.hpp>
+#include <foxy/test/helpers/relay.hpp>
+
+#include <boost/asio/spawn.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+using session_type = foxy::test::relay_session;
+
+auto
+make_opts() -> foxy::session_opts
+{
+  auto opts             = foxy::session_opts();
+  opts.timeout          = 5s;
+  opts.relay_buffer_min = 512;
+  opts.relay_buffer_max = 512;
+  return opts;
+}
+
+// upper_case rewrites the response body where it was read
+//
+struct upper_case : foxy::detail::body_filter
+{
+  auto
+  on_response_body(asio::mutable_buffer chunk, bool) -> asio::mutable_buffer
+  {
+    auto* const data = static_cast<char*>(chunk.data());
+    for (std::size_t i = 0; i < chunk.size(); ++i) {
+      data[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(data[i])));
+    }
+    return chunk;
+  }
+};
+
+// doubler writes every byte of the request body twice, which can't be done in place
+//
+struct doubler : foxy::detail::body_filter
+{
+  std::vector<char> out;
+  int               num_last = 0;
+
+  auto
+  on_request_header(http::request_header<>& header) -> void
+  {
+    header.erase(http::field::content_length);
+    header.set(http::field::transfer_encoding, "chunked");
+  }
+
+  auto
+  on_request_body(asio::mutable_buffer chunk, bool is_last) -> asio::mutable_buffer
+  {
+    if (is_last) { ++num_last; }
+
+    auto const* const data = static_cast<char const*>(chunk.data());
+
+    out.clear();
+    for (std::size_t i = 0; i < chunk.size(); ++i) {
+      out.push_back(data[i]);
+      out.push_back(data[i]);
+    }
+    return asio::buffer(out);
+  }
+};
+
+// hold_back only lets go of the bodies once it's seen all of them, handing back nothing until then
+//
+struct hold_back : foxy::detail::body_filter
+{
+  std::string request;
+  std::string response;
+
+  auto
+  on_request_header(http::request_header<>& header) -> void
+  {
+    header.erase(http::field::content_length);
+    header.set(http::field::transfer_encoding, "chunked");
+  }
+
+  auto
+  on_request_body(asio::mutable_buffer chunk, bool is_last) -> asio::mutable_buffer
+  {
+    return hold(request, chunk, is_last);
+  }
+
+  auto
+  on_response_header(http::response_header<>& header) -> void
+  {
+    header.erase(http::field::content_length);
+    header.set(http::field::transfer_encoding, "chunked");
+  }
+
+  auto
+  on_response_body(asio::mutable_buffer chunk, bool is_last) -> asio::mutable_buffer
+  {
+    return hold(response, chunk, is_last);
+  }
+
+  static auto
+  hold(std::string& held, asio::mutable_buffer chunk, bool is_last) -> asio::mutable_buffer
+  {
+    held.append(static_cast<char const*>(chunk.data()), chunk.size());
+    if (!is_last) { return asio::mutable_buffer(chunk.data(), 0); }
+    return asio::buffer(&held[0], held.size());
+  }
+};
+
+} // namespace
+
+TEST_CASE("relay_filter_test")
+{
+  auto const request_body  = std::string(3000, 'a') + "xyz";
+  auto const response_body = std::string(2000, 'b') + "hello, world!";
+
+  SECTION("should relay both bodies untouched through the default filter")
+  {
+    auto received = std::string();
+    auto returned = std::string();
+
+    auto const ec = foxy::test::relay_through(
+      make_opts(), request_body, response_body, received, returned,
+      [](session_type& server, session_type& client, asio::yield_context yield,
+         boost::system::error_code& ec) {
+        foxy::detail::async_filtered_relay(server, client, foxy::detail::body_filter{}, yield[ec]);
+      });
+
+    CHECK(!ec);
+    CHECK(received == request_body);
+    CHECK(returned == response_body);
+  }
+
+  SECTION("should let a filter rewrite chunks in place")
+  {
+    auto received = std::string();
+    auto returned = std::string();
+
+    auto chain = foxy::detail::make_body_filter_chain(foxy::detail::body_byte_counter(),
+                                                      upper_case(),
+                                                      foxy::detail::body_byte_counter());
+
+    auto const ec = foxy::test::relay_through(
+      make_opts(), request_body, response_body, received, returned,
+      [&](session_type& server, session_type& client, asio::yield_context yield,
+          boost::system::error_code& ec) {
+        foxy::detail::async_filtered_relay(server, client, chain, yield[ec]);
+      });
+
+    CHECK(!ec);
+    CHECK(received == request_body);
+    CHECK(returned == std::string(2000, 'B') + "HELLO, WORLD!");
+
+    CHECK(chain.get<0>().request_bytes == request_body.size());
+    CHECK(chain.get<0>().response_bytes == response_body.size());
+    CHECK(chain.get<2>().response_bytes == response_body.size());
+  }
+
+  SECTION("should let a filter replace chunks with its own output")
+  {
+    auto received = std::string();
+    auto returned = std::string();
+
+    auto filter = doubler();
+
+    auto const ec = foxy::test::relay_through(
+      make_opts(), request_body, response_body, received, returned,
+      [&](session_type& server, session_type& client, asio::yield_context yield,
+          boost::system::error_code& ec) {
+        foxy::detail::async_filtered_relay(server, client, filter, yield[ec]);
+      });
+
+    auto expected = std::string();
+    for (auto const c : request_body) { expected.append(2, c); }
+
+    CHECK(!ec);
+    CHECK(received == expected);
+    CHECK(returned == response_body);
+    CHECK(filter.num_last == 1);
+  }
+
+  SECTION("should not end a chunked body early while a filter holds data back")
+  {
+    auto received = std::string();
+    auto returned = std::string();
+
+    auto filter = hold_back();
+
+    auto const ec = foxy::test::relay_through(
+      make_opts(), request_body, response_body, received, returned,
+      [&](session_type& server, session_type& client, asio::yield_context yield,
+          boost::system::error_code& ec) {
+        foxy::detail::async_filtered_relay(server, client, filter, yield[ec]);
+      });
+
+    CHECK(!ec);
+    CHECK(received == request_body);
+    CHECK(returned == response_body);
+  }
+
+  SECTION("should filter the request body when relaying full-duplex")
+  {
+    auto received = std::string();
+    auto returned = std::string();
+
+    auto opts              = make_opts();
+    opts.relay_full_duplex = true;
+
+    auto counter = foxy::detail::body_byte_counter();
+
+    auto const ec = foxy::test::relay_through(
+      opts, request_body, response_body, received, returned,
+      [&](session_type& server, session_type& client, asio::yield_context yield,
+          boost::system::error_code& ec) {
+        foxy::detail::async_filtered_relay(server, client, counter, yield[ec]);
+      });
+
+    CHECK(!ec);
+    CHECK(received == request_body);
+    CHECK(returned == response_body);
+    CHECK(counter.request_bytes == request_body.size());
+    CHECK(counter.response_bytes == response_body.size());
+  }
+}
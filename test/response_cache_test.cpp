@@ -0,0 +1,378 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/response_cache.hpp>
+#include <foxy/proxy.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+// spawn_origin serves every request on every connection it accepts with `handler` until the
+// acceptor is cancelled
+//
+template <class Handler>
+auto
+spawn_origin(asio::io_context& io, tcp::acceptor& acceptor, Handler handler) -> void
+{
+  asio::spawn(io, [&io, &acceptor, handler](asio::yield_context yield) {
+    while (true) {
+      auto ec     = boost::system::error_code();
+      auto origin = std::make_shared<tcp::socket>(io);
+      acceptor.async_accept(*origin, yield[ec]);
+      if (ec) { break; }
+
+      asio::spawn(yield, [origin, handler](asio::yield_context yield) {
+        auto ec     = boost::system::error_code();
+        auto buffer = boost::beast::flat_buffer();
+        while (true) {
+          auto request = http::request<http::empty_body>();
+          http::async_read(*origin, buffer, request, yield[ec]);
+          if (ec) { return; }
+
+          auto response = handler(request, yield);
+          response.prepare_payload();
+
+          http::async_write(*origin, response, yield[ec]);
+          if (ec) { return; }
+        }
+      });
+    }
+  });
+}
+
+auto
+fetch(asio::io_context& io, std::string const& uri, asio::yield_context yield)
+  -> http::response<http::string_body>
+{
+  auto client         = foxy::client_session(io.get_executor(), {});
+  client.opts.timeout = 5s;
+  client.async_connect("127.0.0.1", "1337", yield);
+
+  auto request  = http::request<http::empty_body>(http::verb::get, uri, 11);
+  auto response = http::response<http::string_body>();
+  client.async_request(request, response, yield);
+
+  auto ec = boost::system::error_code();
+  client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+  client.stream.plain().close(ec);
+
+  return response;
+}
+
+auto
+make_cache_proxy(asio::io_context& io) -> std::shared_ptr<foxy::proxy>
+{
+  auto opts            = foxy::session_opts();
+  opts.timeout         = 5s;
+  opts.cache_max_bytes = 1024 * 1024;
+
+  auto proxy = std::make_shared<foxy::proxy>(
+    io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+
+  proxy->async_accept();
+  return proxy;
+}
+
+} // namespace
+
+TEST_CASE("response_cache_test")
+{
+  SECTION("should parse the fields that decide what's stored and for how long")
+  {
+    auto const date = foxy::detail::parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT");
+    REQUIRE(date.has_value());
+    CHECK(std::chrono::duration_cast<std::chrono::seconds>(date->time_since_epoch()).count() ==
+          784111777);
+
+    CHECK(!foxy::detail::parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT"));
+    CHECK(!foxy::detail::parse_http_date("Sun, 06 Nov 1994 08:49:37 PST"));
+
+    auto fields = http::fields();
+    fields.insert(http::field::cache_control, R"(public, max-age=60, no-cache="Set-Cookie")");
+    fields.insert(http::field::cache_control, "S-MAXAGE=99999999999");
+
+    auto const cc = foxy::detail::parse_cache_control(fields);
+    CHECK(cc.is_public);
+    CHECK(cc.no_cache);
+    CHECK(!cc.no_store);
+    REQUIRE(cc.max_age.has_value());
+    REQUIRE(cc.s_maxage.has_value());
+    CHECK(cc.max_age->count() == 60);
+    CHECK(cc.s_maxage->count() == 2147483648);
+
+    auto request = http::request_header<>();
+    request.method(http::verb::get);
+
+    auto response = http::response_header<>();
+    response.result(http::status::ok);
+    CHECK(foxy::detail::response_cache::is_storable(request, response));
+
+    response.set(http::field::cache_control, "private, max-age=60");
+    CHECK(!foxy::detail::response_cache::is_storable(request, response));
+
+    response.set(http::field::cache_control, "max-age=60");
+    request.set(http::field::authorization, "Basic Zm94eQ==");
+    CHECK(!foxy::detail::response_cache::is_storable(request, response));
+
+    request.erase(http::field::authorization);
+    response.result(http::status::partial_content);
+    CHECK(!foxy::detail::response_cache::is_storable(request, response));
+
+    response.result(http::status::ok);
+    response.set(http::field::vary, "*");
+    CHECK(!foxy::detail::response_cache::is_storable(request, response));
+  }
+
+  SECTION("should pick variants by Vary and evict the least recently used")
+  {
+    auto cache = foxy::detail::response_cache(8 * 1024, 4 * 1024);
+
+    auto request = http::request_header<>();
+    request.method(http::verb::get);
+    request.set(http::field::accept_encoding, "gzip");
+
+    auto response = http::response_header<>();
+    response.result(http::status::ok);
+    response.set(http::field::cache_control, "max-age=60");
+    response.set(http::field::vary, "Accept-Encoding");
+    response.set(http::field::connection, "close");
+
+    auto const gzipped = cache.store("http://a:80/", request, response, "gzipped");
+    REQUIRE(gzipped);
+    CHECK(gzipped->is_fresh(std::chrono::system_clock::now()));
+    CHECK(gzipped->fields.find(http::field::connection) == gzipped->fields.end());
+
+    request.set(http::field::accept_encoding, "identity");
+    CHECK(!cache.lookup("http://a:80/", request));
+
+    cache.store("http://a:80/", request, response, "plain");
+    CHECK(cache.lookup("http://a:80/", request)->body == "plain");
+
+    request.set(http::field::accept_encoding, "gzip");
+    CHECK(cache.lookup("http://a:80/", request)->body == "gzipped");
+    CHECK(cache.size() == 2);
+
+    // too large to keep at all
+    //
+    CHECK(!cache.store("http://b:80/", request, response, std::string(5 * 1024, 'b')));
+
+    // the identity variant is now the least recently used and goes first, then "http://c:80/" has
+    // to make room as well since the gzipped variant was looked up after it was stored
+    //
+    cache.store("http://c:80/", request, response, std::string(3584, 'c'));
+    CHECK(cache.lookup("http://a:80/", request) != nullptr);
+    cache.store("http://d:80/", request, response, std::string(3584, 'd'));
+
+    CHECK(cache.bytes() <= 8 * 1024);
+    CHECK(cache.size() == 2);
+    CHECK(cache.lookup("http://a:80/", request) != nullptr);
+    CHECK(cache.lookup("http://c:80/", request) == nullptr);
+    CHECK(cache.lookup("http://d:80/", request) != nullptr);
+
+    request.set(http::field::accept_encoding, "identity");
+    CHECK(!cache.lookup("http://a:80/", request));
+
+    cache.invalidate("http://d:80/");
+    CHECK(cache.size() == 1);
+  }
+
+  SECTION("should spill what memory can't hold to mapped files and serve it from there")
+  {
+    auto cache = foxy::detail::response_cache(8 * 1024, 4 * 1024, ".", 8 * 1024);
+
+    auto request = http::request_header<>();
+    request.method(http::verb::get);
+
+    auto response = http::response_header<>();
+    response.result(http::status::ok);
+    response.set(http::field::cache_control, "max-age=60");
+
+    cache.store("http://a:80/", request, response, std::string(3584, 'a'));
+    cache.store("http://b:80/", request, response, std::string(3584, 'b'));
+    cache.store("http://c:80/", request, response, std::string(3584, 'c'));
+
+    CHECK(cache.size() == 2);
+    CHECK(cache.spilled_size() == 1);
+
+    auto const a = cache.lookup("http://a:80/", request);
+    REQUIRE(a);
+    CHECK(a->body.empty());
+    CHECK(a->content() == std::string(3584, 'a'));
+    CHECK(a->is_fresh(std::chrono::system_clock::now()));
+
+    cache.invalidate("http://a:80/");
+    CHECK(!cache.lookup("http://a:80/", request));
+    CHECK(cache.spilled_size() == 0);
+
+    // b and then c are spilled, d goes after them and pushes b out of the spill tier as well
+    //
+    cache.store("http://d:80/", request, response, std::string(3584, 'd'));
+    cache.store("http://e:80/", request, response, std::string(3584, 'e'));
+    cache.store("http://f:80/", request, response, std::string(3584, 'f'));
+
+    CHECK(cache.spilled_bytes() <= 8 * 1024);
+    CHECK(cache.spilled_size() == 2);
+    CHECK(!cache.lookup("http://b:80/", request));
+    CHECK(cache.lookup("http://c:80/", request)->content() == std::string(3584, 'c'));
+
+    // a fresher response for a spilled URI replaces the one on disk
+    //
+    cache.store("http://c:80/", request, response, "fresher");
+    CHECK(cache.lookup("http://c:80/", request)->content() == "fresher");
+
+    // without a directory to spill to, evicted responses are dropped
+    //
+    auto nowhere = foxy::detail::response_cache(8 * 1024, 4 * 1024, "./does-not-exist", 8 * 1024);
+
+    nowhere.store("http://a:80/", request, response, std::string(3584, 'a'));
+    nowhere.store("http://b:80/", request, response, std::string(3584, 'b'));
+    nowhere.store("http://c:80/", request, response, std::string(3584, 'c'));
+
+    CHECK(nowhere.size() == 2);
+    CHECK(nowhere.spilled_size() == 0);
+    CHECK(!nowhere.lookup("http://a:80/", request));
+  }
+
+  SECTION("should serve fresh responses and revalidate stale ones through the proxy")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto proxy = make_cache_proxy(io);
+
+    auto num_requests    = 0;
+    auto num_revalidated = 0;
+    auto responses       = std::vector<http::response<http::string_body>>();
+
+    spawn_origin(io, acceptor, [&](http::request<http::empty_body> const& request,
+                                   asio::yield_context) -> http::response<http::string_body> {
+      ++num_requests;
+
+      if (request.target() == "/fresh") {
+        auto response = http::response<http::string_body>(http::status::ok, 11, "fresh body");
+        response.set(http::field::cache_control, "max-age=60");
+        return response;
+      }
+
+      if (request[http::field::if_none_match] == R"("v1")") {
+        ++num_revalidated;
+
+        auto response = http::response<http::string_body>(http::status::not_modified, 11);
+        response.set(http::field::etag, R"("v1")");
+        response.set(http::field::cache_control, "no-cache");
+        return response;
+      }
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "stale body");
+      response.set(http::field::etag, R"("v1")");
+      response.set(http::field::cache_control, "no-cache");
+      return response;
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const origin = "http://127.0.0.1:" + port;
+
+      responses.push_back(fetch(io, origin + "/fresh", yield));
+      responses.push_back(fetch(io, origin + "/fresh", yield));
+      responses.push_back(fetch(io, origin + "/stale", yield));
+      responses.push_back(fetch(io, origin + "/stale", yield));
+
+      acceptor.cancel();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    REQUIRE(responses.size() == 4);
+
+    CHECK(responses[0].body() == "fresh body");
+    CHECK(responses[1].body() == "fresh body");
+    CHECK(responses[1].count(http::field::age) == 1);
+
+    CHECK(responses[2].body() == "stale body");
+    CHECK(responses[3].result() == http::status::ok);
+    CHECK(responses[3].body() == "stale body");
+
+    // the fresh response is only fetched once, the stale one twice but the second time is a 304
+    //
+    CHECK(num_requests == 3);
+    CHECK(num_revalidated == 1);
+  }
+
+  SECTION("should coalesce concurrent misses into a single upstream fetch")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto proxy = make_cache_proxy(io);
+
+    auto const num_clients = 8;
+
+    auto num_requests = 0;
+    auto num_ok       = 0;
+    auto num_done     = 0;
+
+    spawn_origin(io, acceptor, [&](http::request<http::empty_body> const&,
+                                   asio::yield_context yield) -> http::response<http::string_body> {
+      ++num_requests;
+
+      // give every client the chance to miss before the response is stored
+      //
+      auto timer = asio::steady_timer(io, 100ms);
+      timer.async_wait(yield);
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "popular");
+      response.set(http::field::cache_control, "max-age=60");
+      return response;
+    });
+
+    for (auto i = 0; i < num_clients; ++i) {
+      asio::spawn(io, [&](asio::yield_context yield) {
+        auto const response = fetch(io, "http://127.0.0.1:" + port + "/popular", yield);
+        if (response.body() == "popular") { ++num_ok; }
+
+        if (++num_done == num_clients) {
+          acceptor.cancel();
+          proxy->cancel();
+          proxy.reset();
+        }
+      });
+    }
+
+    io.run();
+
+    CHECK(num_ok == num_clients);
+    CHECK(num_requests == 1);
+  }
+}
@@ -0,0 +1,217 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session_errors.hpp>
+#include <foxy/client_session.hpp>
+#include <foxy/server_session.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ssl/error.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("session_errors_test")
+{
+  SECTION("should classify the errors sessions fail with")
+  {
+    CHECK(foxy::classify(asio::error::eof) == foxy::error_class::eof);
+    CHECK(foxy::classify(http::error::end_of_stream) == foxy::error_class::eof);
+    CHECK(foxy::classify(asio::error::connection_reset) == foxy::error_class::reset);
+    CHECK(foxy::classify(asio::error::broken_pipe) == foxy::error_class::reset);
+    CHECK(foxy::classify(asio::error::connection_refused) == foxy::error_class::refused);
+    CHECK(foxy::classify(asio::error::operation_aborted) == foxy::error_class::aborted);
+    CHECK(foxy::classify(asio::error::host_not_found) == foxy::error_class::resolve);
+    CHECK(foxy::classify(asio::ssl::error::stream_truncated) == foxy::error_class::tls);
+    CHECK(foxy::classify(http::error::bad_version) == foxy::error_class::http);
+    CHECK(foxy::classify(make_error_code(boost::system::errc::invalid_argument)) ==
+          foxy::error_class::other);
+
+    CHECK(foxy::to_string(foxy::error_class::refused) == "refused");
+
+    CHECK(foxy::is_failure(asio::error::eof));
+    CHECK_FALSE(foxy::is_failure({}));
+    CHECK_FALSE(foxy::is_failure(http::error::need_buffer));
+  }
+
+  SECTION("should count timeouts and errors by operation")
+  {
+    auto errors = foxy::session_errors();
+
+    errors.on_timeout(foxy::session_op::read_header, 1s, 1001ms);
+    errors.on_timeout(foxy::session_op::read_header, 2s, 2003ms);
+    errors.on_timeout(foxy::session_op::connect, 1s, 1s);
+
+    errors.on_error(foxy::session_op::read, asio::error::eof);
+    errors.on_error(foxy::session_op::read, asio::error::connection_reset);
+    errors.on_error(foxy::session_op::write, asio::error::connection_reset);
+    errors.on_error(foxy::session_op::write, {});
+
+    auto snapshot = errors.snapshot();
+
+    auto const& read_header = snapshot[foxy::session_op::read_header];
+    CHECK(read_header.timeouts == 2);
+    CHECK(read_header.budget == 2s);
+    CHECK(read_header.elapsed_total == 3004ms);
+    CHECK(read_header.elapsed_max == 2003ms);
+
+    CHECK(snapshot.timeouts() == 3);
+    CHECK(snapshot[foxy::session_op::read][foxy::error_class::eof] == 1);
+    CHECK(snapshot[foxy::session_op::read][foxy::error_class::reset] == 1);
+    CHECK(snapshot[foxy::session_op::write][foxy::error_class::other] == 0);
+    CHECK(snapshot.errors(foxy::error_class::reset) == 2);
+
+    errors.reset();
+
+    snapshot = errors.snapshot();
+    CHECK(snapshot.timeouts() == 0);
+    CHECK(snapshot.errors(foxy::error_class::reset) == 0);
+    CHECK(snapshot[foxy::session_op::read_header].elapsed_max == 0ms);
+  }
+
+  SECTION("should not count a read that filled the buffer of a buffer_body as an error")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto errors = std::make_shared<foxy::session_errors>();
+
+    auto opts    = foxy::session_opts();
+    opts.timeout = 5s;
+    opts.errors  = errors;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io.get_executor());
+      acceptor.async_accept(stream.plain(), yield);
+
+      auto server = foxy::server_session(std::move(stream), opts);
+
+      auto response = http::response<http::string_body>(http::status::ok, 11);
+      response.body() = std::string(64 * 1024, 'x');
+      response.prepare_payload();
+
+      server.async_write(response, yield);
+    });
+
+    auto need_buffers = 0;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client = foxy::client_session(io.get_executor(), opts);
+      client.async_connect("127.0.0.1", std::to_string(port), yield);
+
+      auto parser = http::response_parser<http::buffer_body>();
+      client.async_read_header(parser, yield);
+
+      char buf[1024];
+      while (!parser.is_done()) {
+        parser.get().body().data = buf;
+        parser.get().body().size = sizeof(buf);
+
+        auto ec = boost::system::error_code();
+        client.async_read(parser, yield[ec]);
+        if (ec == http::error::need_buffer) {
+          ++need_buffers;
+          ec = {};
+        }
+        REQUIRE(!ec);
+      }
+    });
+
+    io.run();
+
+    CHECK(need_buffers > 0);
+
+    auto const snapshot = errors->snapshot();
+    for (auto i = std::size_t{0}; i < foxy::error_class_count; ++i) {
+      CHECK(snapshot.errors(static_cast<foxy::error_class>(i)) == 0);
+    }
+  }
+
+  SECTION("should attribute a timeout to the operation that ran out of time")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto errors = std::make_shared<foxy::session_errors>();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io.get_executor());
+      acceptor.async_accept(stream.plain(), yield);
+
+      auto opts    = foxy::session_opts();
+      opts.timeout = 50ms;
+      opts.errors  = errors;
+
+      auto server = foxy::server_session(std::move(stream), opts);
+
+      auto ec     = boost::system::error_code();
+      auto parser = http::request_parser<http::empty_body>();
+      server.async_read_header(parser, yield[ec]);
+      CHECK(ec);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto opts    = foxy::session_opts();
+      opts.timeout = 5s;
+      opts.errors  = errors;
+
+      auto client = foxy::client_session(io.get_executor(), opts);
+      client.async_connect("127.0.0.1", std::to_string(port), yield);
+
+      // by the time we send the request, the server's given up on it and closed the connection
+      //
+      auto timer = asio::steady_timer(io, 250ms);
+      timer.async_wait(yield);
+
+      auto ec      = boost::system::error_code();
+      auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+      auto parser  = http::response_parser<http::empty_body>();
+      client.async_request(request, parser, yield[ec]);
+      CHECK(ec);
+    });
+
+    io.run();
+
+    auto const snapshot = errors->snapshot();
+
+    auto const& read_header = snapshot[foxy::session_op::read_header];
+    CHECK(snapshot.timeouts() == 1);
+    CHECK(read_header.timeouts == 1);
+    CHECK(read_header.budget == 50ms);
+    CHECK(read_header.elapsed_max >= 50ms);
+
+    // the server's read failing once its timer closed the stream doesn't count as an error
+    //
+    for (auto i = std::size_t{0}; i < foxy::error_class_count; ++i) {
+      CHECK(read_header.errors[i] == 0);
+    }
+
+    CHECK(snapshot.errors(foxy::error_class::eof) + snapshot.errors(foxy::error_class::reset) ==
+          1);
+  }
+}
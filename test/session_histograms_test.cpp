@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session_histograms.hpp>
+#include <foxy/server_session.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("session_histograms_test")
+{
+  SECTION("should report percentiles within the histogram's precision")
+  {
+    auto h = foxy::histogram();
+    CHECK(h.value_at_percentile(99) == 0);
+
+    for (std::uint64_t value = 1; value <= 10000; ++value) { h.record(value); }
+
+    CHECK(h.count() == 10000);
+    CHECK(h.min() == 1);
+    CHECK(h.max() == 10000);
+    CHECK(h.mean() == 5000);
+
+    CHECK(h.value_at_percentile(0) == 1);
+    CHECK(h.value_at_percentile(100) == 10000);
+
+    auto const p50  = h.value_at_percentile(50);
+    auto const p99  = h.value_at_percentile(99);
+    auto const p999 = h.value_at_percentile(99.9);
+
+    CHECK(p50 >= 5000);
+    CHECK(p50 <= 5000 + 5000 / 32);
+    CHECK(p99 >= 9900);
+    CHECK(p99 <= 9900 + 9900 / 32);
+    CHECK(p999 >= 9990);
+    CHECK(p999 <= 10000);
+
+    // small values are kept exactly and huge ones still report the largest value seen
+    //
+    auto small = foxy::histogram();
+    small.record(3);
+    small.record(7);
+    CHECK(small.value_at_percentile(50) == 3);
+
+    small.record(std::uint64_t{1} << 50);
+    CHECK(small.value_at_percentile(100) == std::uint64_t{1} << 50);
+
+    h.merge(small);
+    CHECK(h.count() == 10003);
+    CHECK(h.min() == 1);
+    CHECK(h.max() == std::uint64_t{1} << 50);
+  }
+
+  SECTION("should merge what every thread recorded")
+  {
+    auto histograms = foxy::session_histograms(2);
+
+    auto threads = std::vector<std::thread>();
+    for (auto idx = 0; idx < 4; ++idx) {
+      threads.emplace_back([&histograms] {
+        for (auto n = 0; n < 1000; ++n) {
+          histograms.record(foxy::session_op::read, 1ms, 10);
+          histograms.record(foxy::session_op::write, 2ms, 20);
+        }
+      });
+    }
+    for (auto& t : threads) { t.join(); }
+
+    auto const snapshot = histograms.snapshot();
+
+    CHECK(snapshot[foxy::session_op::read].count() == 4000);
+    CHECK(snapshot[foxy::session_op::read].bytes == 40000);
+    CHECK(snapshot[foxy::session_op::write].count() == 4000);
+    CHECK(snapshot[foxy::session_op::write].bytes == 80000);
+    CHECK(snapshot[foxy::session_op::connect].count() == 0);
+
+    auto const p99 = snapshot[foxy::session_op::write].percentile(99);
+    CHECK(p99 >= 2ms);
+    CHECK(p99 <= 2ms + 2ms / 32);
+
+    CHECK(foxy::to_string(foxy::session_op::read_header) == "read_header");
+
+    histograms.reset();
+    CHECK(histograms.snapshot()[foxy::session_op::read].count() == 0);
+  }
+
+  SECTION("should time the operations of the sessions it's attached to")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts       = foxy::session_opts();
+    opts.timeout    = 5s;
+    opts.histograms = std::make_shared<foxy::session_histograms>();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io.get_executor());
+      acceptor.async_accept(stream.plain(), yield);
+
+      auto server = std::make_shared<foxy::server_session>(std::move(stream), opts);
+
+      auto parser = http::request_parser<http::string_body>();
+      server->async_read_header(parser, yield);
+      server->async_read(parser, yield);
+      CHECK(parser.get().body() == "hello");
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "world");
+      response.prepare_payload();
+
+      auto serializer = http::response_serializer<http::string_body>(response);
+      server->async_write(serializer, yield);
+
+      server->async_shutdown([server](boost::system::error_code, std::size_t) {});
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client = foxy::client_session(io.get_executor(), opts);
+      client.async_connect("127.0.0.1", std::to_string(port), yield);
+
+      auto request = http::request<http::string_body>(http::verb::post, "/", 11, "hello");
+      request.prepare_payload();
+
+      auto parser = http::response_parser<http::string_body>();
+      client.async_request(request, parser, yield);
+      CHECK(parser.get().body() == "world");
+
+      auto ec = boost::system::error_code();
+      client.async_shutdown(yield[ec]);
+    });
+
+    io.run();
+
+    auto const snapshot = opts.histograms->snapshot();
+
+#if defined(FOXY_NO_SESSION_HISTOGRAMS)
+    CHECK(snapshot[foxy::session_op::connect].count() == 0);
+#else
+    CHECK(snapshot[foxy::session_op::connect].count() == 1);
+    CHECK(snapshot[foxy::session_op::handshake].count() == 0);
+    CHECK(snapshot[foxy::session_op::read_header].count() == 1);
+    CHECK(snapshot[foxy::session_op::read].count() == 2);
+    CHECK(snapshot[foxy::session_op::write].count() == 2);
+    CHECK(snapshot[foxy::session_op::shutdown].count() == 2);
+
+    CHECK(snapshot[foxy::session_op::read_header].bytes > 0);
+    CHECK(snapshot[foxy::session_op::write].bytes > 10);
+    CHECK(snapshot[foxy::session_op::connect].percentile(100) > 0ms);
+#endif
+  }
+}
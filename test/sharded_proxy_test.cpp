@@ -0,0 +1,199 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/sharded_proxy.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("sharded_proxy_test")
+{
+  SECTION("should relay many clients at once across its shards")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto proxy = std::make_unique<foxy::sharded_proxy>(
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0), 4);
+
+#if defined(SO_REUSEPORT)
+    CHECK(proxy->size() == 4);
+#else
+    CHECK(proxy->size() == 1);
+#endif
+
+    auto const proxy_port = std::to_string(proxy->local_endpoint().port());
+    CHECK(proxy_port != "0");
+
+    proxy->run();
+
+    auto const num_clients = 32;
+
+    auto num_ok   = 0;
+    auto num_done = 0;
+
+    // the origin echoes the request target back for as long as each connection stays open
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      while (true) {
+        auto ec     = boost::system::error_code();
+        auto origin = std::make_shared<tcp::socket>(io);
+        acceptor.async_accept(*origin, yield[ec]);
+        if (ec) { break; }
+
+        asio::spawn(yield, [origin](asio::yield_context yield) {
+          auto ec     = boost::system::error_code();
+          auto buffer = boost::beast::flat_buffer();
+          while (true) {
+            auto request = http::request<http::empty_body>();
+            http::async_read(*origin, buffer, request, yield[ec]);
+            if (ec) { return; }
+
+            auto response = http::response<http::string_body>(
+              http::status::ok, 11, static_cast<std::string>(request.target()));
+            response.prepare_payload();
+            http::async_write(*origin, response, yield[ec]);
+            if (ec) { return; }
+          }
+        });
+      }
+    });
+
+    for (auto i = 0; i < num_clients; ++i) {
+      asio::spawn(io, [&, i](asio::yield_context yield) {
+        auto client         = foxy::client_session(io.get_executor(), {});
+        client.opts.timeout = 5s;
+
+        auto ec = boost::system::error_code();
+        client.async_connect("127.0.0.1", proxy_port, yield[ec]);
+
+        auto const target = "/client/" + std::to_string(i);
+
+        auto request = http::request<http::empty_body>(
+          http::verb::get, "http://127.0.0.1:" + port + target, 11);
+
+        auto response = http::response<http::string_body>();
+        if (!ec) { client.async_request(request, response, yield[ec]); }
+
+        if (!ec && response.result() == http::status::ok && response.body() == target) { ++num_ok; }
+
+        client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+        client.stream.plain().close(ec);
+
+        // the last one out tears down the proxy, which also closes its pooled upstreams
+        //
+        if (++num_done == num_clients) {
+          proxy.reset();
+          acceptor.cancel();
+        }
+      });
+    }
+
+    io.run();
+
+    CHECK(num_ok == num_clients);
+  }
+
+  SECTION("should let the connections in flight finish when it stops")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto proxy = std::make_unique<foxy::sharded_proxy>(
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0), 2);
+
+    auto const proxy_port = std::to_string(proxy->local_endpoint().port());
+
+    proxy->run();
+
+    auto stopper      = std::thread();
+    auto stop_elapsed = std::chrono::steady_clock::duration();
+
+    auto result = http::status::unknown;
+    auto body   = std::string();
+
+    // the proxy is told to stop while the origin is still working on its answer
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::empty_body>();
+      http::async_read(origin, buffer, request, yield);
+
+      stopper = std::thread([&] {
+        auto const start = std::chrono::steady_clock::now();
+        proxy->stop();
+        stop_elapsed = std::chrono::steady_clock::now() - start;
+      });
+
+      auto timer = asio::steady_timer(io, 300ms);
+      timer.async_wait(yield);
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "finished");
+      response.keep_alive(false);
+      response.prepare_payload();
+      http::async_write(origin, response, yield);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 5s;
+
+      auto ec = boost::system::error_code();
+      client.async_connect("127.0.0.1", proxy_port, yield[ec]);
+
+      auto request =
+        http::request<http::empty_body>(http::verb::get, "http://127.0.0.1:" + port + "/", 11);
+      request.keep_alive(false);
+
+      auto response = http::response<http::string_body>();
+      if (!ec) { client.async_request(request, response, yield[ec]); }
+
+      if (!ec) {
+        result = response.result();
+        body   = response.body();
+      }
+
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+    });
+
+    io.run();
+    stopper.join();
+
+    CHECK(result == http::status::ok);
+    CHECK(body == "finished");
+    CHECK(stop_elapsed < 5s);
+  }
+}
@@ -0,0 +1,336 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/speak_many.hpp>
+#include <foxy/listener.hpp>
+#include <foxy/error.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using boost::asio::ip::tcp;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+struct connection_stats
+{
+  std::size_t accepted = 0;
+  std::size_t open     = 0;
+  std::size_t max_open = 0;
+};
+
+#include <boost/asio/yield.hpp>
+// keep_alive_handler answers requests on a single connection until the client asks for it to be
+// closed, recording how many connections were open at once
+//
+struct keep_alive_handler : asio::coroutine
+{
+  struct frame
+  {
+    connection_stats&                 stats;
+    http::request<http::empty_body>   request;
+    http::response<http::string_body> response;
+
+    frame(connection_stats& stats_)
+      : stats(stats_)
+    {
+      ++stats.accepted;
+      ++stats.open;
+      stats.max_open = (std::max)(stats.max_open, stats.open);
+    }
+
+    ~frame() { --stats.open; }
+  };
+
+  foxy::server_session&  server;
+  std::unique_ptr<frame> frame_ptr;
+
+  keep_alive_handler(foxy::server_session& server_, connection_stats& stats)
+    : server(server_)
+    , frame_ptr(std::make_unique<frame>(stats))
+  {
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}, std::size_t bytes_transferred = 0)
+    -> void
+  {
+    auto& f = *frame_ptr;
+
+    reenter(*this)
+    {
+      while (true) {
+        f.request = {};
+
+        yield server.async_read(f.request, std::move(self));
+        if (ec) { break; }
+
+        f.response = {};
+        f.response.result(http::status::ok);
+        f.response.keep_alive(f.request.keep_alive());
+        f.response.body() = static_cast<std::string>(f.request.target());
+        f.response.prepare_payload();
+
+        yield server.async_write(f.response, std::move(self));
+        if (ec || !f.request.keep_alive()) { break; }
+      }
+
+      // the client closing the connection between requests is the expected outcome here
+      //
+      frame_ptr.reset();
+      self.complete({}, 0);
+    }
+  }
+};
+
+// get_op sends a GET for the target and reports back whether the connection can be reused
+//
+struct get_op : asio::coroutine
+{
+  foxy::client_session&                              client;
+  std::unique_ptr<http::request<http::empty_body>>   request;
+  std::unique_ptr<http::response<http::string_body>> response =
+    std::make_unique<http::response<http::string_body>>();
+
+  get_op(foxy::client_session& client_, foxy::speak_target const& target)
+    : client(client_)
+    , request(std::make_unique<http::request<http::empty_body>>(http::verb::get, target.target, 11))
+  {
+    request->set(http::field::host, target.host);
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}, std::size_t = 0) -> void
+  {
+    reenter(*this)
+    {
+      yield client.async_request(*request, *response, std::move(self));
+      if (ec) { return self.complete(ec, false); }
+
+      if (response->body() != request->target()) {
+        return self.complete(boost::asio::error::invalid_argument, false);
+      }
+
+      self.complete({}, response->keep_alive());
+    }
+  }
+};
+#include <boost/asio/unyield.hpp>
+
+} // namespace
+
+TEST_CASE("speak_many_test")
+{
+  SECTION("should bound the number of connections made to a single host and reuse them")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto stats    = connection_stats();
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept(
+      [&stats](foxy::server_session& server) { return keep_alive_handler(server, stats); });
+
+    auto targets = std::vector<foxy::speak_target>();
+    for (auto i = 0; i < 32; ++i) {
+      targets.push_back({"127.0.0.1", "1337", "/" + std::to_string(i)});
+    }
+
+    auto num_ok   = std::size_t{0};
+    auto num_done = std::size_t{0};
+
+    auto opts                     = foxy::speak_many_opts();
+    opts.max_connections          = 8;
+    opts.max_connections_per_host = 2;
+    opts.session.timeout          = 4s;
+
+    foxy::speak_many(
+      io.get_executor(), targets,
+      [](foxy::client_session& client, foxy::speak_target const& target) {
+        return get_op(client, target);
+      },
+      [&](foxy::speak_target const&, boost::system::error_code ec) {
+        if (!ec) { ++num_ok; }
+        if (++num_done == targets.size()) { listener.shutdown(); }
+      },
+      opts);
+
+    io.run();
+
+    CHECK(num_done == targets.size());
+    CHECK(num_ok == targets.size());
+    CHECK(stats.accepted == 2);
+    CHECK(stats.max_open <= 2);
+  }
+
+  SECTION("should bound the total number of connections across hosts")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto stats    = connection_stats();
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept(
+      [&stats](foxy::server_session& server) { return keep_alive_handler(server, stats); });
+
+    // the same server reached through different names is treated as different hosts
+    //
+    auto targets = std::vector<foxy::speak_target>();
+    for (auto i = 0; i < 16; ++i) {
+      targets.push_back({"127.0.0.1", "1337", "/a/" + std::to_string(i)});
+      targets.push_back({"localhost", "1337", "/b/" + std::to_string(i)});
+    }
+
+    auto num_ok   = std::size_t{0};
+    auto num_done = std::size_t{0};
+
+    auto opts                     = foxy::speak_many_opts();
+    opts.max_connections          = 3;
+    opts.max_connections_per_host = 2;
+    opts.session.timeout          = 4s;
+
+    foxy::speak_many(
+      io.get_executor(), targets,
+      [](foxy::client_session& client, foxy::speak_target const& target) {
+        return get_op(client, target);
+      },
+      [&](foxy::speak_target const&, boost::system::error_code ec) {
+        if (!ec) { ++num_ok; }
+        if (++num_done == targets.size()) { listener.shutdown(); }
+      },
+      opts);
+
+    io.run();
+
+    CHECK(num_done == targets.size());
+    CHECK(num_ok == targets.size());
+    CHECK(stats.max_open <= 3);
+  }
+
+  SECTION("should report connection failures for every affected target")
+  {
+    asio::io_context io{1};
+
+    auto targets = std::vector<foxy::speak_target>(4, {"127.0.0.1", "1", "/"});
+
+    auto num_failed = std::size_t{0};
+
+    auto opts            = foxy::speak_many_opts();
+    opts.session.timeout = 1s;
+
+    foxy::speak_many(
+      io.get_executor(), targets,
+      [](foxy::client_session& client, foxy::speak_target const& target) {
+        return get_op(client, target);
+      },
+      [&](foxy::speak_target const&, boost::system::error_code ec) {
+        if (ec) { ++num_failed; }
+      },
+      opts);
+
+    io.run();
+
+    CHECK(num_failed == targets.size());
+  }
+
+  SECTION("should wait for a permit while the upstream is at its concurrency limit")
+  {
+    asio::io_context io{1};
+
+    auto const endpoint =
+      tcp::endpoint(asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(1337));
+
+    auto stats    = connection_stats();
+    auto listener = foxy::listener(io.get_executor(), endpoint);
+    listener.async_accept(
+      [&stats](foxy::server_session& server) { return keep_alive_handler(server, stats); });
+
+    auto health_opts          = foxy::upstream_health_opts();
+    health_opts.initial_limit = 1;
+
+    auto opts                  = foxy::speak_many_opts();
+    opts.session.timeout       = 4s;
+    opts.health                = std::make_shared<foxy::upstream_health>(health_opts);
+    opts.permit_retry_interval = 10ms;
+
+    // someone else holds the upstream's only permit for a while
+    //
+    auto acquire_ec = boost::system::error_code();
+    auto permit     = opts.health->try_acquire("127.0.0.1", "1337", acquire_ec);
+    REQUIRE(!acquire_ec);
+
+    auto timer = asio::steady_timer(io, 100ms);
+    timer.async_wait([&](boost::system::error_code) { opts.health->release(permit, {}); });
+
+    auto targets = std::vector<foxy::speak_target>();
+    for (auto i = 0; i < 4; ++i) {
+      targets.push_back({"127.0.0.1", "1337", "/" + std::to_string(i)});
+    }
+
+    auto num_ok   = std::size_t{0};
+    auto num_done = std::size_t{0};
+    auto is_done  = false;
+
+    foxy::speak_many(
+      io.get_executor(), targets,
+      [](foxy::client_session& client, foxy::speak_target const& target) {
+        return get_op(client, target);
+      },
+      [&](foxy::speak_target const&, boost::system::error_code ec) {
+        if (!ec) { ++num_ok; }
+        ++num_done;
+      },
+      opts, [&] {
+        is_done = num_done == targets.size();
+        listener.shutdown();
+      });
+
+    io.run();
+
+    CHECK(is_done);
+    CHECK(num_ok == targets.size());
+  }
+
+  SECTION("should complete right away when there's nothing to do")
+  {
+    asio::io_context io{1};
+
+    auto is_done = false;
+
+    foxy::speak_many(
+      io.get_executor(), std::vector<foxy::speak_target>(),
+      [](foxy::client_session& client, foxy::speak_target const& target) {
+        return get_op(client, target);
+      },
+      [](foxy::speak_target const&, boost::system::error_code) {}, foxy::speak_many_opts(),
+      [&] { is_done = true; });
+
+    io.run();
+
+    CHECK(is_done);
+  }
+}
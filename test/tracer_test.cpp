@@ -0,0 +1,220 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/tracer.hpp>
+#include <foxy/proxy.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+// recording_tracer keeps every hook call, the test only ever runs a single thread
+//
+struct recording_tracer : foxy::tracer
+{
+  struct span
+  {
+    foxy::session_op          op;
+    std::uint64_t             session;
+    std::size_t               bytes;
+    boost::system::error_code ec;
+  };
+
+  std::array<int, foxy::session_op_count> started = {};
+  std::vector<span>                       ended;
+
+  auto
+  on_start(foxy::session_op op, std::uint64_t) -> void override
+  {
+    ++started[static_cast<std::size_t>(op)];
+  }
+
+  auto
+  on_end(foxy::session_op          op,
+         std::uint64_t             session,
+         clock_type::time_point,
+         std::size_t               bytes,
+         boost::system::error_code ec) -> void override
+  {
+    ended.push_back(span{op, session, bytes, ec});
+  }
+
+  auto
+  count(foxy::session_op const op) const -> int
+  {
+    auto n = 0;
+    for (auto const& span : ended) {
+      if (span.op == op) { ++n; }
+    }
+    return n;
+  }
+
+  auto
+  first(foxy::session_op const op) const -> span const*
+  {
+    for (auto const& span : ended) {
+      if (span.op == op) { return &span; }
+    }
+    return nullptr;
+  }
+};
+} // namespace
+
+TEST_CASE("tracer_test")
+{
+  SECTION("should write its spans as Chrome trace events")
+  {
+    auto tracer = foxy::chrome_tracer(2);
+
+    auto const now = foxy::chrome_tracer::clock_type::now();
+
+    tracer.on_start(foxy::session_op::read_header, 7);
+    tracer.on_end(foxy::session_op::read_header, 7, now - 1h, 42, {});
+    tracer.on_end(foxy::session_op::connect, 8, now, 0, asio::error::connection_refused);
+    tracer.on_end(foxy::session_op::write, 7, now, 1, {});
+
+    CHECK(tracer.size() == 2);
+    CHECK(tracer.dropped() == 1);
+
+    auto os = std::ostringstream();
+    tracer.write(os);
+
+    auto const json = os.str();
+    CHECK(json.find("{\"traceEvents\":[") == 0);
+    CHECK(json.find("\"name\":\"read_header\",\"cat\":\"foxy\",\"ph\":\"X\",\"pid\":1,\"tid\":7,"
+                    "\"ts\":0.000,") != std::string::npos);
+    CHECK(json.find("\"args\":{\"bytes\":42}}") != std::string::npos);
+    CHECK(json.find("\"name\":\"connect\"") != std::string::npos);
+    CHECK(json.find("\"error\":\"" + boost::system::error_code(asio::error::connection_refused)
+                                       .message()) != std::string::npos);
+    CHECK(json.find("\"name\":\"write\"") == std::string::npos);
+    CHECK(json.find("\"displayTimeUnit\":\"ns\"}") != std::string::npos);
+
+    tracer.clear();
+    CHECK(tracer.size() == 0);
+    CHECK(tracer.dropped() == 0);
+  }
+
+  SECTION("should trace the proxy's requests and relays")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto tracer = std::make_shared<recording_tracer>();
+
+    auto opts    = foxy::session_opts();
+    opts.timeout = 5s;
+    opts.tracer  = tracer;
+
+    auto proxy = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+    proxy->async_accept();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto ec     = boost::system::error_code();
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::string_body>();
+      http::async_read(origin, buffer, request, yield);
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "hello");
+      response.keep_alive(false);
+      response.prepare_payload();
+      http::async_write(origin, response, yield[ec]);
+      origin.shutdown(tcp::socket::shutdown_both, ec);
+      origin.close(ec);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const authority = "127.0.0.1:" + std::to_string(port);
+
+      {
+        auto client         = foxy::client_session(io.get_executor(), {});
+        client.opts.timeout = 5s;
+        client.async_connect("127.0.0.1", "1337", yield);
+
+        auto request =
+          http::request<http::string_body>(http::verb::post, "http://" + authority + "/a", 11);
+        request.body() = "abc";
+        request.prepare_payload();
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+        CHECK(response.body() == "hello");
+
+        auto ec = boost::system::error_code();
+        client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      }
+
+      auto ec = boost::system::error_code();
+      acceptor.close(ec);
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    // every span that was started was also ended
+    //
+    for (auto i = std::size_t{0}; i < foxy::session_op_count; ++i) {
+      auto const op = static_cast<foxy::session_op>(i);
+      CHECK(tracer->started[i] == tracer->count(op));
+    }
+
+    REQUIRE(tracer->count(foxy::session_op::tunnel) == 1);
+    REQUIRE(tracer->count(foxy::session_op::relay) == 1);
+
+    auto const& tunnel = *tracer->first(foxy::session_op::tunnel);
+    auto const& relay  = *tracer->first(foxy::session_op::relay);
+    CHECK(!tunnel.ec);
+    CHECK(!relay.ec);
+    CHECK(relay.bytes == 3 + 5);
+
+    // the relay and the request it answers are traced under the client connection's session,
+    // which read the request's header, and the upstream connection is a session of its own
+    //
+    CHECK(relay.session == tunnel.session);
+
+    auto const* read_header = tracer->first(foxy::session_op::read_header);
+    REQUIRE(read_header != nullptr);
+    CHECK(read_header->session == tunnel.session);
+
+    auto const* connect = tracer->first(foxy::session_op::connect);
+    REQUIRE(connect != nullptr);
+    CHECK(!connect->ec);
+    CHECK(connect->session != tunnel.session);
+  }
+}
@@ -0,0 +1,482 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/tunnel_limits.hpp>
+#include <foxy/proxy.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+make_proxy(asio::io_context& io, foxy::session_opts const& opts) -> std::shared_ptr<foxy::proxy>
+{
+  auto const endpoint = tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337);
+
+  auto proxy = std::make_shared<foxy::proxy>(io, endpoint, true, opts);
+  proxy->async_accept();
+  return proxy;
+}
+
+} // namespace
+
+TEST_CASE("tunnel_limits_test")
+{
+  SECTION("should measure transfer rates and budgets")
+  {
+    auto const start = std::chrono::steady_clock::now();
+
+    auto meter = foxy::detail::rate_meter(100, 1s);
+    CHECK(meter.is_enabled());
+
+    // a window starts with the first byte and is only judged once it's over
+    //
+    CHECK(meter.on_transfer(10, start + 500ms));
+    CHECK(meter.on_transfer(10, start + 900ms));
+    CHECK(meter.on_transfer(10, start + 1200ms));
+    CHECK(!meter.on_transfer(10, start + 1500ms));
+
+    CHECK(meter.on_transfer(150, start + 2400ms));
+    CHECK(meter.on_transfer(10, start + 2500ms));
+    CHECK(!foxy::detail::rate_meter().is_enabled());
+
+    CHECK(foxy::detail::parse_deadline("1500")->count() == 1500);
+    CHECK(!foxy::detail::parse_deadline("").has_value());
+    CHECK(!foxy::detail::parse_deadline("-1").has_value());
+    CHECK(!foxy::detail::parse_deadline("1.5").has_value());
+
+    auto const never = (std::chrono::steady_clock::time_point::max)();
+
+    CHECK(!foxy::detail::remaining_budget(boost::none, start, never, start).has_value());
+
+    auto const client_only =
+      foxy::detail::remaining_budget(std::chrono::milliseconds(800), start, never, start + 300ms);
+    CHECK(*client_only == 500ms);
+
+    auto const capped = foxy::detail::remaining_budget(std::chrono::milliseconds(800), start,
+                                                       start + 400ms, start + 300ms);
+    CHECK(*capped == 100ms);
+  }
+
+  SECTION("should hold silence against the window it falls into")
+  {
+    auto const start = std::chrono::steady_clock::now();
+
+    auto meter = foxy::detail::rate_meter(100, 1s);
+
+    // a burst after a long silence is judged over the silence too
+    //
+    CHECK(meter.on_transfer(500, start));
+    CHECK(meter.on_transfer(10, start + 5s));
+    CHECK(meter.on_transfer(500, start + 5500ms));
+    CHECK(!meter.on_transfer(10, start + 11s));
+
+    // and so is a byte sent just after every window
+    //
+    auto trickle = foxy::detail::rate_meter(100, 1s);
+    CHECK(trickle.on_transfer(1, start + 20s));
+    CHECK(!trickle.on_transfer(1, start + 21100ms));
+
+    // only a restart leaves the window it drops unjudged
+    //
+    meter.restart();
+    CHECK(meter.on_transfer(1, start + 30s));
+    meter.restart();
+    CHECK(meter.on_transfer(500, start + 30900ms));
+    CHECK(meter.on_transfer(10, start + 31900ms));
+  }
+
+  SECTION("should close a busy raw tunnel once the connection outlives its lifetime")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts                = foxy::session_opts();
+    opts.raw_tunnel          = true;
+    opts.tunnel_max_lifetime = 300ms;
+
+    auto proxy = make_proxy(io, opts);
+
+    auto num_echoed = 0;
+    auto elapsed    = std::chrono::steady_clock::duration();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto ec  = boost::system::error_code();
+      auto buf = std::array<char, 64>();
+      while (true) {
+        auto const n = origin.async_read_some(asio::buffer(buf), yield[ec]);
+        if (ec) { break; }
+        asio::async_write(origin, asio::buffer(buf.data(), n), yield[ec]);
+        if (ec) { break; }
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const start = std::chrono::steady_clock::now();
+
+      auto socket = tcp::socket(io);
+      socket.async_connect(tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), yield);
+
+      auto const authority = "127.0.0.1:" + std::to_string(port);
+      auto const request = "CONNECT " + authority + " HTTP/1.1\r\nHost: " + authority + "\r\n\r\n";
+      asio::async_write(socket, asio::buffer(request), yield);
+
+      auto buffer = boost::beast::flat_buffer();
+      auto parser = http::response_parser<http::empty_body>();
+      http::async_read_header(socket, buffer, parser, yield);
+      REQUIRE(parser.get().result() == http::status::ok);
+
+      // the tunnel never goes idle but is torn down all the same
+      //
+      auto ec    = boost::system::error_code();
+      auto timer = asio::steady_timer(io);
+      auto buf   = std::array<char, 4>();
+      while (true) {
+        asio::async_write(socket, asio::buffer("ping", 4), yield[ec]);
+        if (ec) { break; }
+
+        asio::async_read(socket, asio::buffer(buf), yield[ec]);
+        if (ec) { break; }
+
+        ++num_echoed;
+
+        timer.expires_after(20ms);
+        timer.async_wait(yield);
+      }
+
+      elapsed = std::chrono::steady_clock::now() - start;
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(num_echoed > 2);
+    CHECK(elapsed >= 250ms);
+    CHECK(elapsed < 3s);
+  }
+
+  SECTION("should abort a relayed response that trickles in")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    // every read of the relay finishes well within the timeout but the body as a whole would take
+    // over ten seconds to arrive
+    //
+    auto opts               = foxy::session_opts();
+    opts.timeout            = 5s;
+    opts.relay_buffer_min   = 1024;
+    opts.relay_buffer_max   = 1024;
+    opts.tunnel_min_rate    = 50 * 1024;
+    opts.tunnel_rate_window = 300ms;
+
+    auto proxy = make_proxy(io, opts);
+
+    auto request_ec = boost::system::error_code();
+    auto elapsed    = std::chrono::steady_clock::duration();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::empty_body>();
+      http::async_read(origin, buffer, request, yield);
+
+      auto const header = std::string("HTTP/1.1 200 OK\r\nContent-Length: 65536\r\n\r\n");
+      auto const chunk  = std::string(512, 'x');
+
+      auto ec    = boost::system::error_code();
+      auto timer = asio::steady_timer(io);
+
+      asio::async_write(origin, asio::buffer(header), yield[ec]);
+      for (auto i = 0; !ec && i < 128; ++i) {
+        timer.expires_after(100ms);
+        timer.async_wait(yield);
+        asio::async_write(origin, asio::buffer(chunk), yield[ec]);
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const start = std::chrono::steady_clock::now();
+
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 30s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto const request = http::request<http::empty_body>(
+        http::verb::get, "http://127.0.0.1:" + std::to_string(port) + "/", 11);
+
+      auto response = http::response<http::string_body>();
+      client.async_request(request, response, yield[request_ec]);
+
+      elapsed = std::chrono::steady_clock::now() - start;
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(request_ec);
+    CHECK(elapsed < 3s);
+  }
+
+  SECTION("should not hold a slow response header against the body that follows")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    // the upstream thinks for most of a window before it answers and then sends its body well
+    // above the minimum rate, which only the body's own window gets to see
+    //
+    auto opts               = foxy::session_opts();
+    opts.timeout            = 5s;
+    opts.tunnel_min_rate    = 256 * 1024;
+    opts.tunnel_rate_window = 1s;
+
+    auto proxy = make_proxy(io, opts);
+
+    auto const piece      = std::string(64 * 1024, 'x');
+    auto const num_pieces = 16;
+
+    auto request_ec = boost::system::error_code();
+    auto body_size  = std::size_t{0};
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::string_body>();
+      http::async_read(origin, buffer, request, yield);
+
+      auto timer = asio::steady_timer(io);
+      timer.expires_after(900ms);
+      timer.async_wait(yield);
+
+      auto const header = "HTTP/1.1 200 OK\r\nContent-Length: " +
+                          std::to_string(piece.size() * num_pieces) + "\r\n\r\n";
+
+      auto ec = boost::system::error_code();
+      asio::async_write(origin, asio::buffer(header), yield[ec]);
+      for (auto i = 0; !ec && i < num_pieces; ++i) {
+        asio::async_write(origin, asio::buffer(piece), yield[ec]);
+        timer.expires_after(50ms);
+        timer.async_wait(yield);
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 30s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto request = http::request<http::string_body>(
+        http::verb::post, "http://127.0.0.1:" + std::to_string(port) + "/", 11,
+        std::string(16, 'r'));
+      request.prepare_payload();
+
+      auto parser = http::response_parser<http::string_body>();
+      parser.body_limit((std::numeric_limits<std::uint64_t>::max)());
+      client.async_request(request, parser, yield[request_ec]);
+
+      body_size = parser.get().body().size();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(!request_ec);
+    CHECK(body_size == piece.size() * num_pieces);
+  }
+
+  SECTION("should close a connection waiting on its upstream once it outlives its lifetime")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts                = foxy::session_opts();
+    opts.timeout             = 5s;
+    opts.tunnel_max_lifetime = 300ms;
+
+    auto proxy = make_proxy(io, opts);
+
+    auto request_ec = boost::system::error_code();
+    auto elapsed    = std::chrono::steady_clock::duration();
+
+    // the origin never answers and hangs up after a while so the test doesn't have to wait on the
+    // proxy's timeout
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::empty_body>();
+      http::async_read(origin, buffer, request, yield);
+
+      auto timer = asio::steady_timer(io);
+      timer.expires_after(1s);
+      timer.async_wait(yield);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const start = std::chrono::steady_clock::now();
+
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 30s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto const request = http::request<http::empty_body>(
+        http::verb::get, "http://127.0.0.1:" + std::to_string(port) + "/", 11);
+
+      auto response = http::response<http::string_body>();
+      client.async_request(request, response, yield[request_ec]);
+
+      elapsed = std::chrono::steady_clock::now() - start;
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(request_ec);
+    CHECK(elapsed >= 250ms);
+    CHECK(elapsed < 1s);
+  }
+
+  SECTION("should pass the client's deadline upstream with the proxy's share taken off")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts                = foxy::session_opts();
+    opts.timeout             = 5s;
+    opts.tunnel_max_lifetime = 3s;
+    opts.deadline_header     = "X-Request-Timeout";
+
+    auto proxy = make_proxy(io, opts);
+
+    auto num_requests = 0;
+    auto forwarded    = std::vector<std::string>();
+    auto statuses     = std::vector<http::status>();
+
+    // the origin answers with the deadline it was given
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto ec     = boost::system::error_code();
+      auto buffer = boost::beast::flat_buffer();
+      while (true) {
+        auto request = http::request<http::empty_body>();
+        http::async_read(origin, buffer, request, yield[ec]);
+        if (ec) { break; }
+
+        ++num_requests;
+
+        auto response = http::response<http::string_body>(
+          http::status::ok, 11, static_cast<std::string>(request["X-Request-Timeout"]));
+        response.prepare_payload();
+
+        http::async_write(origin, response, yield[ec]);
+        if (ec) { break; }
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 5s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      for (auto const deadline : {"10000", "0", "500", "soon"}) {
+        auto request = http::request<http::empty_body>(
+          http::verb::get, "http://127.0.0.1:" + std::to_string(port) + "/", 11);
+        request.set("X-Request-Timeout", deadline);
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        statuses.push_back(response.result());
+        forwarded.push_back(response.body());
+      }
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      acceptor.cancel();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    REQUIRE(statuses.size() == 4);
+
+    // the connection's lifetime caps a generous deadline, a spent one never reaches the origin and
+    // one we can't read leaves the connection's own budget
+    //
+    CHECK(statuses[0] == http::status::ok);
+    CHECK(std::stoi(forwarded[0]) <= 3000);
+    CHECK(std::stoi(forwarded[0]) > 2000);
+
+    CHECK(statuses[1] == http::status::gateway_timeout);
+
+    CHECK(statuses[2] == http::status::ok);
+    CHECK(std::stoi(forwarded[2]) <= 500);
+    CHECK(std::stoi(forwarded[2]) > 0);
+
+    CHECK(statuses[3] == http::status::ok);
+    CHECK(std::stoi(forwarded[3]) <= 3000);
+
+    CHECK(num_requests == 3);
+  }
+}
@@ -0,0 +1,236 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/tunnel_metrics.hpp>
+#include <foxy/proxy.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("tunnel_metrics_test")
+{
+  SECTION("should sum up latencies")
+  {
+    auto latency = foxy::tunnel_metrics::latency();
+    CHECK(latency.mean() == 0ms);
+
+    latency.add(10ms);
+    latency.add(30ms);
+    latency.add(20ms);
+
+    CHECK(latency.count == 3);
+    CHECK(latency.sum == 60ms);
+    CHECK(latency.max == 30ms);
+    CHECK(latency.mean() == 20ms);
+  }
+
+  SECTION("should keep totals for tunnels that are gone")
+  {
+    auto metrics = foxy::tunnel_metrics();
+
+    auto const client = tcp::endpoint(asio::ip::make_address("127.0.0.1"), 4242);
+
+    auto a = metrics.open(client);
+    auto b = metrics.open(client);
+
+    a->stats.count_in(10);
+    a->stats.count_out(20);
+    a->on_connect("example.com", "443", 5ms, 7ms);
+    a->on_response(foxy::tunnel_metrics::duration_type(3ms));
+
+    b->stats.count_in(1);
+    b->on_connect("example.com", "80", 9ms, 0ms);
+    b->on_response(boost::none);
+
+    auto snapshot = metrics.snapshot();
+    REQUIRE(snapshot.tunnels.size() == 2);
+
+    CHECK(snapshot.tunnels[0].upstream == "example.com:443");
+    CHECK(snapshot.tunnels[0].client == client);
+    CHECK(snapshot.tunnels[0].bytes_in == 10);
+    CHECK(snapshot.tunnels[0].bytes_out == 20);
+    CHECK(snapshot.tunnels[0].handshake == 7ms);
+    CHECK(snapshot.tunnels[0].first_byte == 3ms);
+    CHECK(snapshot.tunnels[1].upstream == "example.com:80");
+    CHECK(snapshot.tunnels[1].first_byte == 0ms);
+
+    CHECK(snapshot.total.opened == 2);
+    CHECK(snapshot.total.closed == 0);
+    CHECK(snapshot.total.bytes_in == 11);
+    CHECK(snapshot.total.requests == 2);
+    CHECK(snapshot.total.connect.count == 2);
+    CHECK(snapshot.total.connect.max == 9ms);
+    CHECK(snapshot.total.handshake.count == 1);
+    CHECK(snapshot.total.first_byte.count == 1);
+
+    metrics.close(*a);
+    metrics.close(*a);
+
+    snapshot = metrics.snapshot();
+    REQUIRE(snapshot.tunnels.size() == 1);
+    CHECK(snapshot.tunnels[0].upstream == "example.com:80");
+
+    CHECK(snapshot.total.closed == 1);
+    CHECK(snapshot.total.bytes_in == 11);
+    CHECK(snapshot.total.bytes_out == 20);
+    CHECK(snapshot.total.lifetime.count == 1);
+
+    // a closed tunnel's latencies are folded into the totals exactly once
+    //
+    CHECK(snapshot.total.requests == 2);
+    CHECK(snapshot.total.connect.count == 2);
+    CHECK(snapshot.total.connect.max == 9ms);
+    CHECK(snapshot.total.handshake.count == 1);
+    CHECK(snapshot.total.first_byte.count == 1);
+  }
+
+  SECTION("should track the proxy's requests and tunnels")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = acceptor.local_endpoint().port();
+
+    auto opts           = foxy::session_opts();
+    opts.timeout        = 5s;
+    opts.raw_tunnel     = true;
+    opts.tunnel_metrics = std::make_shared<foxy::tunnel_metrics>();
+
+    auto proxy = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), true, opts);
+    proxy->async_accept();
+
+    // the origin answers a single request and then echoes whatever comes through the tunnel
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto ec     = boost::system::error_code();
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto buffer  = boost::beast::flat_buffer();
+      auto request = http::request<http::string_body>();
+      http::async_read(origin, buffer, request, yield);
+
+      auto response = http::response<http::string_body>(http::status::ok, 11, "hello");
+      response.keep_alive(false);
+      response.prepare_payload();
+      http::async_write(origin, response, yield[ec]);
+      origin.shutdown(tcp::socket::shutdown_both, ec);
+      origin.close(ec);
+
+      acceptor.async_accept(origin, yield);
+
+      auto buf = std::array<char, 64>();
+      while (true) {
+        auto const n = origin.async_read_some(asio::buffer(buf), yield[ec]);
+        if (ec) { break; }
+        asio::async_write(origin, asio::buffer(buf.data(), n), yield[ec]);
+        if (ec) { break; }
+      }
+    });
+
+    auto live = foxy::tunnel_metrics::snapshot_type();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto const authority = "127.0.0.1:" + std::to_string(port);
+
+      {
+        auto client         = foxy::client_session(io.get_executor(), {});
+        client.opts.timeout = 5s;
+        client.async_connect("127.0.0.1", "1337", yield);
+
+        auto request =
+          http::request<http::string_body>(http::verb::post, "http://" + authority + "/a", 11);
+        request.body() = "abc";
+        request.prepare_payload();
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+        CHECK(response.body() == "hello");
+      }
+
+      auto socket = tcp::socket(io);
+      socket.async_connect(tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337), yield);
+
+      auto const request = "CONNECT " + authority + " HTTP/1.1\r\nHost: " + authority + "\r\n\r\n";
+      asio::async_write(socket, asio::buffer(request), yield);
+
+      auto buffer = boost::beast::flat_buffer();
+      auto parser = http::response_parser<http::empty_body>();
+      parser.skip(true);
+      http::async_read_header(socket, buffer, parser, yield);
+      REQUIRE(parser.get().result() == http::status::ok);
+
+      auto buf = std::array<char, 4>();
+      asio::async_write(socket, asio::buffer("ping", 4), yield);
+      asio::async_read(socket, asio::buffer(buf), yield);
+
+      live = opts.tunnel_metrics->snapshot();
+
+      auto ec = boost::system::error_code();
+      socket.shutdown(tcp::socket::shutdown_both, ec);
+      socket.close(ec);
+
+      acceptor.close(ec);
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    REQUIRE(!live.tunnels.empty());
+
+    auto const& tunnel = live.tunnels.back();
+    CHECK(tunnel.upstream == "127.0.0.1:" + std::to_string(port));
+    CHECK(tunnel.bytes_in == 4);
+    CHECK(tunnel.bytes_out == 4);
+    CHECK(tunnel.requests == 0);
+    CHECK(tunnel.connect > 0ms);
+    CHECK(tunnel.lifetime > 0ms);
+
+#if defined(__linux__)
+    REQUIRE(tunnel.upstream_tcp.has_value());
+    CHECK(tunnel.upstream_tcp->rtt > 0us);
+    CHECK(tunnel.upstream_tcp->snd_cwnd > 0);
+#endif
+
+    auto const done = opts.tunnel_metrics->snapshot();
+    CHECK(done.tunnels.empty());
+
+    CHECK(done.total.opened == 2);
+    CHECK(done.total.closed == 2);
+    CHECK(done.total.requests == 2);
+    CHECK(done.total.bytes_in == 3 + 4);
+    CHECK(done.total.bytes_out == 5 + 4);
+    CHECK(done.total.connect.count == 2);
+    CHECK(done.total.handshake.count == 0);
+    CHECK(done.total.first_byte.count == 2);
+    CHECK(done.total.lifetime.count == 2);
+  }
+}
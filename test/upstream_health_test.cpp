@@ -0,0 +1,224 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/upstream_health.hpp>
+#include <foxy/speak_many.hpp>
+#include <foxy/error.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/error.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+#include <boost/asio/yield.hpp>
+struct get_op : asio::coroutine
+{
+  foxy::client_session&                              client;
+  std::unique_ptr<http::request<http::empty_body>>   request;
+  std::unique_ptr<http::response<http::string_body>> response =
+    std::make_unique<http::response<http::string_body>>();
+
+  get_op(foxy::client_session& client_, foxy::speak_target const& target)
+    : client(client_)
+    , request(std::make_unique<http::request<http::empty_body>>(http::verb::get, target.target, 11))
+  {
+  }
+
+  template <class Self>
+  auto operator()(Self& self, boost::system::error_code ec = {}) -> void
+  {
+    reenter(*this)
+    {
+      yield client.async_request(*request, *response, std::move(self));
+      self.complete(ec, !ec && response->keep_alive());
+    }
+  }
+};
+#include <boost/asio/unyield.hpp>
+
+} // namespace
+
+TEST_CASE("upstream_health_test")
+{
+  SECTION("should bound the requests in flight to an origin by its limit")
+  {
+    auto opts          = foxy::upstream_health_opts();
+    opts.initial_limit = 2;
+
+    auto health = foxy::upstream_health(opts);
+
+    auto ec = boost::system::error_code();
+
+    auto const p1 = health.try_acquire("127.0.0.1", "80", ec);
+    CHECK(!ec);
+
+    auto const p2 = health.try_acquire("127.0.0.1", "80", ec);
+    CHECK(!ec);
+
+    health.try_acquire("127.0.0.1", "80", ec);
+    CHECK(ec == foxy::error::concurrency_limit);
+
+    // origins are independent of one another
+    //
+    auto const p3 = health.try_acquire("127.0.0.1", "443", ec);
+    CHECK(!ec);
+
+    health.release(p1, {});
+    health.try_acquire("127.0.0.1", "80", ec);
+    CHECK(!ec);
+
+    health.release(p2, {});
+    health.release(p3, {});
+  }
+
+  SECTION("should back off on failures and grow back additively")
+  {
+    auto opts              = foxy::upstream_health_opts();
+    opts.initial_limit     = 16;
+    opts.min_limit         = 2;
+    opts.backoff           = 0.5;
+    opts.failure_threshold = 100;
+
+    auto health = foxy::upstream_health(opts);
+
+    auto ec = boost::system::error_code();
+
+    // every request in a burst was made before the first failure came back so only one backoff
+    // is applied for all of them
+    //
+    auto permits = std::vector<foxy::upstream_health::permit>();
+    for (auto i = 0; i < 8; ++i) { permits.push_back(health.try_acquire("example.com", "80", ec)); }
+    for (auto const& p : permits) { health.release(p, asio::error::connection_reset); }
+
+    CHECK(health.limit("example.com", "80") == 8);
+
+    permits.clear();
+    for (auto i = 0; i < 8; ++i) { permits.push_back(health.try_acquire("example.com", "80", ec)); }
+    for (auto const& p : permits) { health.release(p, {}); }
+
+    CHECK(health.limit("example.com", "80") == 8);
+
+    for (auto i = 0; i < 4; ++i) {
+      health.release(health.try_acquire("example.com", "80", ec), asio::error::timed_out);
+    }
+
+    CHECK(health.limit("example.com", "80") == 2);
+  }
+
+  SECTION("should treat slow requests as overload")
+  {
+    auto opts              = foxy::upstream_health_opts();
+    opts.initial_limit     = 8;
+    opts.latency_threshold = 1ms;
+
+    auto health = foxy::upstream_health(opts);
+
+    auto ec = boost::system::error_code();
+
+    auto const p = health.try_acquire("example.com", "80", ec);
+    std::this_thread::sleep_for(5ms);
+    health.release(p, {});
+
+    CHECK(health.limit("example.com", "80") == 4);
+    CHECK(health.state("example.com", "80") == foxy::circuit_state::closed);
+  }
+
+  SECTION("should open the circuit after consecutive failures and half-open it for a probe")
+  {
+    auto opts              = foxy::upstream_health_opts();
+    opts.failure_threshold = 3;
+    opts.open_duration     = 20ms;
+
+    auto health = foxy::upstream_health(opts);
+
+    auto ec = boost::system::error_code();
+
+    for (auto i = 0; i < 3; ++i) {
+      health.release(health.try_acquire("example.com", "80", ec), asio::error::connection_refused);
+    }
+
+    CHECK(health.state("example.com", "80") == foxy::circuit_state::open);
+
+    health.try_acquire("example.com", "80", ec);
+    CHECK(ec == foxy::error::circuit_open);
+
+    std::this_thread::sleep_for(30ms);
+    CHECK(health.state("example.com", "80") == foxy::circuit_state::half_open);
+
+    // only the one probe is let through, a failed probe opens the circuit right back up
+    //
+    auto const probe = health.try_acquire("example.com", "80", ec);
+    CHECK(!ec);
+
+    health.try_acquire("example.com", "80", ec);
+    CHECK(ec == foxy::error::circuit_open);
+
+    health.release(probe, asio::error::connection_refused);
+    CHECK(health.state("example.com", "80") == foxy::circuit_state::open);
+
+    std::this_thread::sleep_for(30ms);
+
+    health.release(health.try_acquire("example.com", "80", ec), {});
+    CHECK(!ec);
+    CHECK(health.state("example.com", "80") == foxy::circuit_state::closed);
+  }
+
+  SECTION("should fail fast in speak_many once an upstream's circuit is open")
+  {
+    asio::io_context io{1};
+
+    auto targets = std::vector<foxy::speak_target>(8, {"127.0.0.1", "1", "/"});
+
+    auto health_opts              = foxy::upstream_health_opts();
+    health_opts.failure_threshold = 2;
+    health_opts.open_duration     = 60s;
+
+    auto opts                     = foxy::speak_many_opts();
+    opts.max_connections_per_host = 1;
+    opts.session.timeout          = 1s;
+    opts.health                   = std::make_shared<foxy::upstream_health>(health_opts);
+
+    auto num_refused  = std::size_t{0};
+    auto num_rejected = std::size_t{0};
+
+    foxy::speak_many(
+      io.get_executor(), targets,
+      [](foxy::client_session& client, foxy::speak_target const& target) {
+        return get_op(client, target);
+      },
+      [&](foxy::speak_target const&, boost::system::error_code ec) {
+        if (ec == foxy::error::circuit_open) {
+          ++num_rejected;
+        } else if (ec) {
+          ++num_refused;
+        }
+      },
+      opts);
+
+    io.run();
+
+    CHECK(num_refused == 2);
+    CHECK(num_rejected == 6);
+    CHECK(opts.health->state("127.0.0.1", "1") == foxy::circuit_state::open);
+  }
+}
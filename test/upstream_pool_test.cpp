@@ -0,0 +1,309 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/upstream_pool.hpp>
+#include <foxy/proxy.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("upstream_pool_test")
+{
+  SECTION("should only hand back connections that are still usable")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto pool_handle = std::make_shared<foxy::detail::upstream_pool>(io.get_executor(), 2, 30s);
+    auto& pool       = *pool_handle;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      CHECK(pool.take("127.0.0.1", port) == nullptr);
+
+      auto origins = std::vector<tcp::socket>();
+      for (int i = 0; i < 3; ++i) {
+        auto session =
+          std::make_unique<foxy::client_session>(io.get_executor(), foxy::session_opts{});
+        session->async_connect("127.0.0.1", port, yield);
+
+        origins.emplace_back(io);
+        acceptor.async_accept(origins.back(), yield);
+
+        pool.put("127.0.0.1", port, std::move(session));
+      }
+
+      // the first connection was evicted to make room for the third
+      //
+      CHECK(pool.size() == 2);
+
+      auto reused = pool.take("127.0.0.1", port);
+      REQUIRE(reused != nullptr);
+      CHECK(reused->stream.plain().remote_endpoint().port() == acceptor.local_endpoint().port());
+      CHECK(pool.size() == 1);
+
+      CHECK(pool.take("localhost", port) == nullptr);
+
+      // once the origin hangs up, the pooled connection is useless
+      //
+      origins[1].close();
+
+      auto timer = asio::steady_timer(io, 50ms);
+      timer.async_wait(yield);
+
+      CHECK(pool.take("127.0.0.1", port) == nullptr);
+      CHECK(pool.size() == 0);
+
+      // and so is one that's been sitting around for too long
+      //
+      auto expiring = std::make_shared<foxy::detail::upstream_pool>(io.get_executor(), 2, 20ms);
+      expiring->put("127.0.0.1", port, std::move(reused));
+      CHECK(expiring->size() == 1);
+
+      timer.expires_after(50ms);
+      timer.async_wait(yield);
+
+      CHECK(expiring->take("127.0.0.1", port) == nullptr);
+      CHECK(expiring->size() == 0);
+
+      pool.close();
+    });
+
+    io.run();
+  }
+
+  SECTION("should close idle connections to origins nobody asks for again")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto pool = std::make_shared<foxy::detail::upstream_pool>(io.get_executor(), 2, 50ms);
+
+    auto origin_ec = boost::system::error_code();
+    auto elapsed   = std::chrono::steady_clock::duration();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto session =
+        std::make_unique<foxy::client_session>(io.get_executor(), foxy::session_opts{});
+      session->async_connect("127.0.0.1", port, yield);
+
+      auto origin = tcp::socket(io);
+      acceptor.async_accept(origin, yield);
+
+      auto const start = std::chrono::steady_clock::now();
+      pool->put("127.0.0.1", port, std::move(session));
+
+      // the pool hangs up on the origin without anyone taking the connection back out
+      //
+      auto buf = std::array<char, 1>();
+      origin.async_read_some(asio::buffer(buf), yield[origin_ec]);
+
+      elapsed = std::chrono::steady_clock::now() - start;
+    });
+
+    io.run();
+
+    CHECK(origin_ec == asio::error::eof);
+    CHECK(elapsed >= 40ms);
+    CHECK(elapsed < 5s);
+    CHECK(pool->size() == 0);
+  }
+
+  SECTION("should reuse an upstream connection across client connections")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto const endpoint = tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337);
+
+    auto proxy = std::make_shared<foxy::proxy>(io, endpoint, true);
+    proxy->async_accept();
+
+    auto num_accepted = 0;
+    auto bodies       = std::vector<std::string>();
+
+    // the origin answers requests on a connection for as long as it stays open
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      while (true) {
+        auto ec     = boost::system::error_code();
+        auto origin = std::make_shared<tcp::socket>(io);
+        acceptor.async_accept(*origin, yield[ec]);
+        if (ec) { break; }
+
+        ++num_accepted;
+
+        asio::spawn(yield, [&, origin](asio::yield_context yield) {
+          auto ec     = boost::system::error_code();
+          auto buffer = boost::beast::flat_buffer();
+          for (auto i = 0; true; ++i) {
+            auto request = http::request<http::empty_body>();
+            http::async_read(*origin, buffer, request, yield[ec]);
+            if (ec) { return; }
+
+            auto response = http::response<http::string_body>(http::status::ok, 11,
+                                                              "response " + std::to_string(i));
+            response.prepare_payload();
+            http::async_write(*origin, response, yield[ec]);
+            if (ec) { return; }
+          }
+        });
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      for (int i = 0; i < 2; ++i) {
+        auto client         = foxy::client_session(io.get_executor(), {});
+        client.opts.timeout = 5s;
+        client.async_connect("127.0.0.1", "1337", yield);
+
+        auto request =
+          http::request<http::empty_body>(http::verb::get, "http://127.0.0.1:" + port + "/", 11);
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        bodies.push_back(response.body());
+
+        auto ec = boost::system::error_code();
+        client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+        client.stream.plain().close(ec);
+      }
+
+      // the proxy's pool owns the last upstream connection, tearing the proxy down closes it
+      //
+      acceptor.cancel();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(num_accepted == 1);
+    REQUIRE(bodies.size() == 2);
+    CHECK(bodies[0] == "response 0");
+    CHECK(bodies[1] == "response 1");
+  }
+
+  SECTION("should retry or answer a request that a pooled connection drops")
+  {
+    asio::io_context io{1};
+
+    auto acceptor   = tcp::acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto const endpoint = tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1337);
+
+    auto proxy = std::make_shared<foxy::proxy>(io, endpoint, true);
+    proxy->async_accept();
+
+    auto num_accepted = 0;
+    auto results      = std::vector<unsigned>();
+    auto bodies       = std::vector<std::string>();
+
+    // every connection of the origin answers its first request and hangs up on the second one as
+    // it arrives, the way an origin closing an idle connection races a request sent over it
+    //
+    asio::spawn(io, [&](asio::yield_context yield) {
+      while (true) {
+        auto ec     = boost::system::error_code();
+        auto origin = std::make_shared<tcp::socket>(io);
+        acceptor.async_accept(*origin, yield[ec]);
+        if (ec) { break; }
+
+        ++num_accepted;
+
+        asio::spawn(yield, [origin](asio::yield_context yield) {
+          auto ec     = boost::system::error_code();
+          auto buffer = boost::beast::flat_buffer();
+
+          auto request = http::request<http::string_body>();
+          http::async_read(*origin, buffer, request, yield[ec]);
+          if (ec) { return; }
+
+          auto response = http::response<http::string_body>(http::status::ok, 11, "fresh");
+          response.prepare_payload();
+          http::async_write(*origin, response, yield[ec]);
+          if (ec) { return; }
+
+          request = {};
+          http::async_read(*origin, buffer, request, yield[ec]);
+          origin->close(ec);
+        });
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client         = foxy::client_session(io.get_executor(), {});
+      client.opts.timeout = 5s;
+      client.async_connect("127.0.0.1", "1337", yield);
+
+      auto const target = "http://127.0.0.1:" + port + "/";
+
+      // a GET can be sent again over a new connection, a POST can't and gets a 502 instead
+      //
+      auto requests = std::vector<http::request<http::string_body>>();
+      requests.emplace_back(http::verb::get, target, 11);
+      requests.emplace_back(http::verb::get, target, 11);
+      requests.emplace_back(http::verb::post, target, 11, "body");
+
+      for (auto& request : requests) {
+        request.prepare_payload();
+
+        auto response = http::response<http::string_body>();
+        client.async_request(request, response, yield);
+
+        results.push_back(response.result_int());
+        bodies.push_back(response.body());
+      }
+
+      auto ec = boost::system::error_code();
+      client.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+      client.stream.plain().close(ec);
+
+      acceptor.cancel();
+      proxy->cancel();
+      proxy.reset();
+    });
+
+    io.run();
+
+    CHECK(num_accepted == 2);
+    REQUIRE(results.size() == 3);
+    CHECK(results[0] == 200);
+    CHECK(bodies[0] == "fresh");
+    CHECK(results[1] == 200);
+    CHECK(bodies[1] == "fresh");
+    CHECK(results[2] == 502);
+  }
+}